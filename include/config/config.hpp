@@ -5,6 +5,8 @@
 #include <iostream>
 
 namespace dcz {
+	// Per thread: UsingConfig / no_grad() / test_mode() only affect the calling
+	// thread, and new threads start from the defaults below
 	class Config {
 	public:
 		bool enable_backprop = true;
@@ -12,7 +14,7 @@ namespace dcz {
 		bool profile = false;
 
 		static Config& get() {
-			static Config instance;
+			static thread_local Config instance;
 			return instance;
 		}
 	};
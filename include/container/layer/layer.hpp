@@ -71,7 +71,11 @@ namespace layer {
 
 		// Load W and b from npz file for this layer
 		void load_params_from_npz(const std::string& npz_path, const std::string& layer_name);
-		void load_params_from_npz(const cnpy::npz_t& npz, const std::string& layer_name);
+		virtual void load_params_from_npz(const cnpy::npz_t& npz, const std::string& layer_name);
+
+		// Same for a memory-mapped tensor file ("<layer_name>.W" / ".b"), and the reverse
+		virtual void load_params_from_file(const tensor::TensorFile& file, const std::string& layer_name);
+		virtual void save_params_to_file(tensor::TensorFileWriter& writer, const std::string& layer_name) const;
 
 	};
 
@@ -80,6 +84,9 @@ namespace layer {
 		size_t out_size;
 		size_t in_size;
 
+		// Inference-only packed copy of W ([out, in] rows, possibly quantized)
+		std::shared_ptr<tensor::PackedTensor> packed;
+
 	public:
 		Linear( size_t out_size, 
 				bool nobias = false,
@@ -92,6 +99,29 @@ namespace layer {
 
 		Variable forward(const std::vector<Variable>& xs) override;
 
+		// Also picks up 16-bit / quantized "<layer_name>.W_<format>" entries as packed rows
+		using Layer::load_params_from_npz;
+		void load_params_from_npz(const cnpy::npz_t& npz, const std::string& layer_name) override;
+		// "<layer_name>.W_<format>" rows are used in place (no copy) from the mapping
+		void load_params_from_file(const tensor::TensorFile& file, const std::string& layer_name) override;
+		// Packed weights are written as "<layer_name>.W_<format>"
+		void save_params_to_file(tensor::TensorFileWriter& writer, const std::string& layer_name) const override;
+
+		// Pack W into format and release the fp32 W; forward then runs the packed
+		// kernels (no autograd). Returns bytes of the packed weight.
+		size_t pack_weight(tensor::PackedFormat format);
+		// Load a pre-packed "<layer_name>.W_<format>" entry: [out, in] uint16 for
+		// bf16/f16 (scripts/convert_llama_weights.py --dtype), uint8 [out, row_bytes]
+		// for block formats (scripts/quantize_llama_weights.py). False if there is none.
+		bool load_packed_from_npz(const cnpy::npz_t& npz, const std::string& layer_name);
+		bool is_packed() const { return packed != nullptr; }
+		std::shared_ptr<tensor::PackedTensor> get_packed() const { return packed; }
+		// Use an existing packed weight [out, in] (e.g. a row view of a fused matrix)
+		void set_packed(std::shared_ptr<tensor::PackedTensor> weight);
+		// Drop the packed weight without restoring W: the layer has no weight until
+		// set_packed (e.g. while LlamaTensorParallel holds it as shards)
+		void release_packed() { packed.reset(); }
+
 	};
 
 	class Conv2d : public Layer {
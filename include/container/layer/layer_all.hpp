@@ -2,5 +2,7 @@
 
 #include "container/layer/layer.hpp"
 #include "container/layer/model.hpp"
+#include "container/layer/session.hpp"
 #include "container/layer/yolov5.hpp"
 #include "container/layer/llama.hpp"
+#include "container/layer/llama_parallel.hpp"
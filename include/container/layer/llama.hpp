@@ -2,11 +2,15 @@
 
 #include "container/layer/layer.hpp"
 #include "container/layer/model.hpp"
+#include "container/layer/session.hpp"
+#include "utils/kv_cache.hpp"
 
 #include <vector>
 #include <memory>
 #include <string>
 #include <cstddef>
+#include <cstdint>
+#include <optional>
 
 namespace cnpy {
 	struct NpyArray;
@@ -15,6 +19,8 @@ namespace cnpy {
 
 namespace layer {
 
+class LlamaTensorParallel;
+
 // ============================================================
 // Embedding: token ID -> vector lookup
 // ============================================================
@@ -22,6 +28,10 @@ class Embedding : public Layer {
 private:
 	size_t embed_dim;
 
+	// Inference-only rows [vocab, embed_dim] used in place of W (e.g. bf16 rows
+	// mapped from a tensor file); lookups and the tied lm_head read them directly
+	std::shared_ptr<tensor::PackedTensor> packed;
+
 public:
 	Embedding() = default;
 	Embedding(size_t vocab_size, size_t embed_dim);
@@ -34,9 +44,16 @@ public:
 	Variable forward(const std::vector<Variable>& xs) override;
 
 	void load_from_npz(const cnpy::npz_t& npz, const std::string& prefix);
+	// "<prefix>.W_<format>" rows are used in place; "<prefix>.W" is copied
+	void load_from_file(const tensor::TensorFile& file, const std::string& prefix);
+	void save_to_file(tensor::TensorFileWriter& writer, const std::string& prefix) const;
+
+	// Keep the table as packed rows (inference only); returns packed bytes
+	size_t pack_weight(tensor::PackedFormat format);
 
 	// Access weight for tied embeddings (lm_head)
 	Tensor<> get_weight() const;
+	std::shared_ptr<tensor::PackedTensor> get_packed() const { return packed; }
 };
 
 // ============================================================
@@ -52,7 +69,85 @@ public:
 
 	Variable forward(const std::vector<Variable>& xs) override;
 
+	// CPU inference without an autograd graph, over `rows` rows of hidden_size.
+	// forward_rows: out = norm(x). add_forward_rows: residual += delta, out = norm(residual)
+	void forward_rows(const float* x, float* out, size_t rows) const;
+	void add_forward_rows(float* residual, const float* delta, float* out, size_t rows) const;
+
 	void load_from_npz(const cnpy::npz_t& npz, const std::string& prefix);
+	void load_from_file(const tensor::TensorFile& file, const std::string& prefix);
+	void save_to_file(tensor::TensorFileWriter& writer, const std::string& prefix) const;
+};
+
+// ============================================================
+// BatchLayout: several prompts padded to one [batch, seq_len] block
+// ============================================================
+enum class PaddingSide {
+	Left,   // tokens end at the last slot (pads first)
+	Right,  // tokens start at slot 0 (pads last)
+};
+
+// Row b holds its tokens in slots [start[b], start[b] + length[b]) of the padded
+// [batch, seq_len] KV cache; the other slots are padding. Activations skip the padding:
+// the tokens of all rows are packed back to back, row b's from packed row offset[b], so
+// every GEMM runs over num_tokens() rows. Each row's tokens take positions 0, 1, ...
+// and attend only to keys of the same row at or before them.
+struct BatchLayout {
+	size_t seq_len = 0;
+	std::vector<size_t> start;
+	std::vector<size_t> length;
+	std::vector<size_t> offset;
+
+	BatchLayout() = default;
+	// seq_len is the longest length; throws on an empty batch or an empty row
+	BatchLayout(const std::vector<size_t>& lengths, PaddingSide side);
+
+	size_t batch() const { return start.size(); }
+	size_t num_tokens() const { return offset.empty() ? 0 : offset.back() + length.back(); }
+	bool is_token(size_t b, size_t s) const { return s >= start[b] && s < start[b] + length[b]; }
+	// Position id of slot s in row b (0 for padding)
+	size_t position(size_t b, size_t s) const { return is_token(b, s) ? s - start[b] : 0; }
+	// Slot of row b's last token
+	size_t last_slot(size_t b) const { return start[b] + length[b] - 1; }
+	// Packed row of row b's last token
+	size_t last_token(size_t b) const { return offset[b] + length[b] - 1; }
+
+	// Per-row position ids and attention masks (1 = token, 0 = padding), [batch, seq_len]
+	std::vector<size_t> position_ids() const;
+	std::vector<uint8_t> attention_mask() const;
+};
+
+// ============================================================
+// LlamaAttentionState: what a forward pass mutates in LlamaAttention
+// ============================================================
+struct LlamaAttentionState {
+	// KV Cache: pre-allocated [batch, cache_max_len, num_kv_heads, head_dim] rows,
+	// stored as kv_format (rows are quantized as they are appended)
+	KVCacheFormat kv_format = KVCacheFormat::F32;
+	KVCacheStore k_cache;
+	KVCacheStore v_cache;
+	size_t cache_len = 0;
+	size_t cache_max_len = 0;  // allocated capacity, grows up to max_seq_len
+
+	// Beam search: cached key j of batch entry b is stored in entry key_owners[b][j],
+	// so entries share the rows of a common prefix instead of copying them.
+	// Empty: every entry reads its own rows.
+	std::vector<std::vector<uint32_t>> key_owners;
+
+	// Streaming (attention sinks): sinks in slots [0, stream_sinks), then a ring of
+	// stream_window slots; sink keys are re-rotated to sit right before the window. 0: off.
+	size_t stream_sinks = 0;
+	size_t stream_window = 0;
+	size_t stream_tokens = 0;  // tokens appended since the last reset (cache_len caps at capacity)
+	float rope_theta = 500000.0f;  // for positions past the RoPE tables
+	std::vector<float> sink_keys;  // [stream_sinks, kv_stride()] un-rotated keys
+	std::vector<long long> sink_pos;  // position each sink row is currently rotated to
+
+	size_t stream_capacity() const { return stream_sinks + stream_window; }
+	// Cache slot of the n-th streamed token
+	size_t stream_slot(size_t n) const {
+		return n < stream_sinks ? n : stream_sinks + (n - stream_sinks) % stream_window;
+	}
 };
 
 // ============================================================
@@ -71,26 +166,98 @@ private:
 	std::shared_ptr<Linear> v_proj;
 	std::shared_ptr<Linear> o_proj;
 
-	// KV Cache: pre-allocated tensors of [batch, max_seq_len, num_kv_heads, head_dim]
-	Tensor<> k_cache;
-	Tensor<> v_cache;
-	size_t cache_len = 0;
-	size_t cache_max_len = 0;  // allocated capacity (max_seq_len)
+	// Packed [q; k; v] rows: one GEMM per forward. q/k/v_proj hold row views of it.
+	std::shared_ptr<tensor::PackedTensor> qkv_packed;
+
+	size_t max_seq_len = 512;  // max_position_embeddings
+
+	// Cache of the calling thread's session, or `cache` without one (see session.hpp).
+	// The KV format and streaming settings belong to it too.
+	LlamaAttentionState cache;
+	LlamaAttentionState& state();
+	const LlamaAttentionState& state() const;
+
+	// Make room for needed tokens (grows by doubling, keeps cached rows)
+	void ensure_cache(LlamaAttentionState& st, size_t batch, size_t needed);
+	// Rotate the sink rows so that they precede a full window ending at query_pos
+	void rebase_sinks(LlamaAttentionState& st, long long query_pos,
+					  const float* cos_data, const float* sin_data, size_t table_len);
 
 public:
 	LlamaAttention() = default;
-	LlamaAttention(size_t hidden_size, size_t num_heads, size_t num_kv_heads);
+	LlamaAttention(size_t hidden_size, size_t num_heads, size_t num_kv_heads,
+				   size_t max_seq_len = 512);
 
-	// Forward with RoPE + KV cache
+	// Forward with RoPE + KV cache.
+	// layout: hidden_states [1, num_tokens, hidden] packs a batch of prompts (CPU, empty
+	// cache); positions, cache slots and attended keys follow each row's layout
 	Variable forward_attn(const Variable& hidden_states,
 						  const Tensor<>& cos_cache,
 						  const Tensor<>& sin_cache,
-						  size_t position_offset);
+						  size_t position_offset,
+						  const BatchLayout* layout = nullptr);
 
 	Variable forward(const std::vector<Variable>& xs) override;
 
 	void reset_cache();
-	void load_from_npz(const cnpy::npz_t& npz, const std::string& prefix);
+	// weight_format: pack (quantize) each projection right after it is loaded
+	void load_from_npz(const cnpy::npz_t& npz, const std::string& prefix,
+					   std::optional<tensor::PackedFormat> weight_format = std::nullopt);
+	// Pack projection weights for inference; returns packed bytes
+	size_t pack_weights(tensor::PackedFormat format);
+	// Concatenate packed q/k/v into one matrix; false unless all three are packed alike
+	bool fuse_projections();
+	// Use qkv [q; k; v] rows as the fused matrix; q/k/v_proj become row views of it
+	void set_fused(std::shared_ptr<tensor::PackedTensor> qkv);
+	bool is_fused() const { return qkv_packed != nullptr; }
+	std::shared_ptr<tensor::PackedTensor> get_qkv_packed() const { return qkv_packed; }
+	// Drop the q/k/v/o weights; set_fused and o_proj->set_packed put them back
+	void release_weights();
+	std::shared_ptr<Linear> get_o_proj() const { return o_proj; }
+	size_t get_num_heads() const { return num_heads; }
+	size_t get_num_kv_heads() const { return num_kv_heads; }
+	size_t get_head_dim() const { return head_dim; }
+	size_t get_max_seq_len() const { return max_seq_len; }
+
+	// Tensor file I/O: fused projections are stored as one "<prefix>.qkv_proj.W_<format>".
+	// Separate q/k/v entries load as they are (no fusing copy); see fuse_projections().
+	void load_from_file(const tensor::TensorFile& file, const std::string& prefix);
+	void save_to_file(tensor::TensorFileWriter& writer, const std::string& prefix) const;
+
+	// Storage format of the KV cache; changing it drops the cached tokens
+	void set_kv_cache_format(KVCacheFormat format);
+	KVCacheFormat get_kv_cache_format() const { return state().kv_format; }
+	// K + V bytes per cached token (one sequence)
+	size_t kv_cache_bytes_per_token() const;
+
+	// KV cache access (batch 0) for prefix caching.
+	// k/v layout: [len, num_kv_heads, head_dim], dequantized to float
+	size_t get_cache_len() const { return state().cache_len; }
+	size_t kv_stride() const { return num_kv_heads * head_dim; }
+	void export_kv(size_t start, size_t len, std::vector<float>& k, std::vector<float>& v) const;
+	// Writes len tokens at position start and sets cache_len = start + len
+	void import_kv(size_t start, size_t len, const float* k, const float* v);
+
+	// Roll back the cache to its first len tokens (e.g. rejected speculative tokens)
+	void truncate_cache(size_t len);
+	// Drop the first `drop` cached tokens and move the rest to the front. Their keys are
+	// rotated back by `drop` positions (RoPE scores depend only on the distance between
+	// query and key), so the next token continues at position get_cache_len().
+	void shift_cache(size_t drop, const Tensor<>& cos_cache, const Tensor<>& sin_cache);
+
+	// Turn the cached sequence (batch 1) into `batch` entries that all share its rows
+	void fork_cache(size_t batch);
+	// Entry b continues the cached sequence of entry parents[b]. Only the key owner
+	// tables change: no K/V rows are copied. Next tokens are written to each entry's
+	// own rows, which no other entry references yet.
+	void reorder_cache(const std::vector<size_t>& parents);
+
+	// Streaming KV cache of sink_tokens + window_tokens slots (window_tokens 0: off);
+	// drops the cached tokens. Single sequence, CPU path.
+	void set_streaming(size_t sink_tokens, size_t window_tokens, float rope_theta);
+	bool is_streaming() const { return state().stream_window > 0; }
+	size_t stream_capacity() const { return state().stream_capacity(); }
+	size_t get_stream_tokens() const { return state().stream_tokens; }
 };
 
 // ============================================================
@@ -102,13 +269,34 @@ private:
 	std::shared_ptr<Linear> up_proj;
 	std::shared_ptr<Linear> down_proj;
 
+	// Packed [gate; up] rows, run with the SiLU*up epilogue. gate/up_proj hold row views.
+	std::shared_ptr<tensor::PackedTensor> gate_up_packed;
+
 public:
 	LlamaMLP() = default;
 	LlamaMLP(size_t hidden_size, size_t intermediate_size);
 
 	Variable forward(const std::vector<Variable>& xs) override;
 
-	void load_from_npz(const cnpy::npz_t& npz, const std::string& prefix);
+	// weight_format: pack (quantize) each projection right after it is loaded
+	void load_from_npz(const cnpy::npz_t& npz, const std::string& prefix,
+					   std::optional<tensor::PackedFormat> weight_format = std::nullopt);
+	// Pack projection weights for inference; returns packed bytes
+	size_t pack_weights(tensor::PackedFormat format);
+	// Concatenate packed gate/up into one matrix; false unless both are packed alike
+	bool fuse_projections();
+	// Use gate_up [gate; up] rows as the fused matrix; gate/up_proj become row views of it
+	void set_fused(std::shared_ptr<tensor::PackedTensor> gate_up);
+	bool is_fused() const { return gate_up_packed != nullptr; }
+	std::shared_ptr<tensor::PackedTensor> get_gate_up_packed() const { return gate_up_packed; }
+	// Drop the gate/up/down weights; set_fused and down_proj->set_packed put them back
+	void release_weights();
+	std::shared_ptr<Linear> get_down_proj() const { return down_proj; }
+
+	// Tensor file I/O: fused projections are stored as one "<prefix>.gate_up_proj.W_<format>".
+	// Separate gate/up entries load as they are (no fusing copy); see fuse_projections().
+	void load_from_file(const tensor::TensorFile& file, const std::string& prefix);
+	void save_to_file(tensor::TensorFileWriter& writer, const std::string& prefix) const;
 };
 
 // ============================================================
@@ -125,17 +313,41 @@ public:
 	LlamaDecoderLayer() = default;
 	LlamaDecoderLayer(size_t hidden_size, size_t num_heads,
 					   size_t num_kv_heads, size_t intermediate_size,
-					   float rms_norm_eps = 1e-5f);
+					   float rms_norm_eps = 1e-5f,
+					   size_t max_position_embeddings = 512);
 
 	Variable forward_with_cache(const Variable& hidden_states,
 								const Tensor<>& cos_cache,
 								const Tensor<>& sin_cache,
 								size_t position_offset);
 
+	// CPU inference path: every residual add is fused with the norm that follows it.
+	// `residual` [batch, seq, hidden] is updated in place; `normed` holds
+	// input_layernorm(residual) on entry and next_norm(residual) on return, where
+	// next_norm is the following layer's input_layernorm or the model's final norm.
+	void forward_fused(Tensor<>& residual, Tensor<>& normed, const LlamaRMSNorm& next_norm,
+					   const Tensor<>& cos_cache, const Tensor<>& sin_cache,
+					   size_t position_offset, const BatchLayout* layout = nullptr);
+
 	Variable forward(const std::vector<Variable>& xs) override;
 
 	void reset_cache();
-	void load_from_npz(const cnpy::npz_t& npz, const std::string& prefix);
+	void truncate_cache(size_t len);
+	void shift_cache(size_t drop, const Tensor<>& cos_cache, const Tensor<>& sin_cache);
+	void fork_cache(size_t batch);
+	void reorder_cache(const std::vector<size_t>& parents);
+	// weight_format: pack (quantize) each projection right after it is loaded
+	void load_from_npz(const cnpy::npz_t& npz, const std::string& prefix,
+					   std::optional<tensor::PackedFormat> weight_format = std::nullopt);
+	// Pack projection weights for inference; returns packed bytes
+	size_t pack_weights(tensor::PackedFormat format);
+	void load_from_file(const tensor::TensorFile& file, const std::string& prefix);
+	void save_to_file(tensor::TensorFileWriter& writer, const std::string& prefix) const;
+
+	std::shared_ptr<LlamaAttention> get_self_attn() const { return self_attn; }
+	std::shared_ptr<LlamaRMSNorm> get_input_layernorm() const { return input_layernorm; }
+	std::shared_ptr<LlamaRMSNorm> get_post_attention_layernorm() const { return post_attention_layernorm; }
+	std::shared_ptr<LlamaMLP> get_mlp() const { return mlp; }
 };
 
 // ============================================================
@@ -144,6 +356,7 @@ public:
 class LlamaModel : public Layer {
 private:
 	size_t num_layers;
+	float rope_theta = 500000.0f;
 	std::shared_ptr<Embedding> embed_tokens;
 	std::vector<std::shared_ptr<LlamaDecoderLayer>> layers;
 	std::shared_ptr<LlamaRMSNorm> norm;
@@ -152,6 +365,15 @@ private:
 	Tensor<> cos_cache;
 	Tensor<> sin_cache;
 
+	// Bounds how many decoder layers of mapped weights stay resident (null: all)
+	std::shared_ptr<tensor::LayerStreamer> streamer;
+	// Runs the decoder layers sharded across worker groups (null: this thread)
+	std::shared_ptr<LlamaTensorParallel> tensor_parallel;
+
+	// Decoder layers + final norm over embedded hidden states
+	Variable forward_layers(Variable hidden_states, size_t position_offset,
+							const BatchLayout* layout);
+
 public:
 	LlamaModel() = default;
 	LlamaModel(size_t vocab_size, size_t hidden_size, size_t num_layers,
@@ -160,6 +382,13 @@ public:
 			   float rope_theta = 500000.0f, float rms_norm_eps = 1e-5f);
 
 	Variable forward_ids(const std::vector<int>& token_ids, size_t position_offset = 0);
+	// Batch of prompts: token_ids holds the layout.num_tokens() ids of all rows back to
+	// back. Fills a fresh KV cache of layout.batch() padded rows; CPU inference only.
+	// Returns packed hidden states [1, num_tokens, hidden_size].
+	Variable forward_batch(const std::vector<int>& token_ids, const BatchLayout& layout);
+	// One new token per batch entry of the KV cache (e.g. beams), all at position_offset.
+	// Returns [batch, 1, hidden_size].
+	Variable forward_step(const std::vector<int>& token_ids, size_t position_offset);
 	Variable forward(const std::vector<Variable>& xs) override;
 
 	void to(const dcz::Device& device) override {
@@ -171,10 +400,42 @@ public:
 	}
 
 	void reset_cache();
-	void load_from_npz(const cnpy::npz_t& npz, const std::string& prefix);
+	void truncate_cache(size_t len);
+	// Drop the oldest `drop` cached tokens of every layer (see LlamaAttention::shift_cache)
+	void shift_cache(size_t drop);
+	// Streaming KV cache in every layer (see LlamaAttention::set_streaming)
+	void set_streaming(size_t sink_tokens, size_t window_tokens);
+	// Beam bookkeeping of every layer (see LlamaAttention::fork_cache / reorder_cache)
+	void fork_cache(size_t batch);
+	void reorder_cache(const std::vector<size_t>& parents);
+	// Applies to every layer's KV cache (drops cached tokens if the format changes)
+	void set_kv_cache_format(KVCacheFormat format);
+	// weight_format: pack (quantize) each projection right after it is loaded
+	void load_from_npz(const cnpy::npz_t& npz, const std::string& prefix,
+					   std::optional<tensor::PackedFormat> weight_format = std::nullopt);
+	// Pack projection weights for inference; returns packed bytes
+	size_t pack_weights(tensor::PackedFormat format);
+	void load_from_file(const tensor::TensorFile& file, const std::string& prefix);
+	void save_to_file(tensor::TensorFileWriter& writer, const std::string& prefix) const;
 
 	// Access embed_tokens for tied weights
 	std::shared_ptr<Embedding> get_embed_tokens() const { return embed_tokens; }
+
+	size_t get_num_layers() const { return num_layers; }
+	std::shared_ptr<LlamaDecoderLayer> get_layer(size_t i) const { return layers[i]; }
+	std::shared_ptr<LlamaRMSNorm> get_norm() const { return norm; }
+	const Tensor<>& get_cos_cache() const { return cos_cache; }
+	const Tensor<>& get_sin_cache() const { return sin_cache; }
+
+	// forward_ids() brackets each decoder layer with streamer->begin(i) / end(i)
+	void set_layer_streamer(std::shared_ptr<tensor::LayerStreamer> s) { streamer = std::move(s); }
+	std::shared_ptr<tensor::LayerStreamer> get_layer_streamer() const { return streamer; }
+
+	// CPU inference of single sequences runs through tp (see llama_parallel.hpp), which
+	// then owns the KV cache: reset / truncate / format changes reach it, the other
+	// cache operations throw. Null switches back (both drop the cached tokens).
+	void set_tensor_parallel(std::shared_ptr<LlamaTensorParallel> tp);
+	std::shared_ptr<LlamaTensorParallel> get_tensor_parallel() const { return tensor_parallel; }
 };
 
 } // namespace layer
@@ -186,9 +447,14 @@ public:
 class LlamaForCausalLM : public Model {
 private:
 	std::shared_ptr<layer::LlamaModel> model;
-
-	// Cached transposed embedding weight for lm_head (avoid recomputing every forward)
-	Tensor<> lm_head_weight;  // [hidden_size, vocab_size]
+	// Mapping the weights were loaded from (tensor file / safetensors), if any
+	std::shared_ptr<tensor::TensorFile> weights_file;
+	size_t vocab_size = 0;
+	size_t hidden_size = 0;
+	// lm_head of an untied checkpoint (null: tied to embed_tokens)
+	std::shared_ptr<layer::Linear> lm_head_proj;
+	// Takes head as lm_head_proj if it holds a weight; checks its shape
+	void set_lm_head(std::shared_ptr<layer::Linear> head);
 
 public:
 	LlamaForCausalLM() = default;
@@ -203,15 +469,90 @@ public:
 					  float rms_norm_eps = 1e-5f);
 
 	// Returns logits: Variable of shape [batch, seq_len, vocab_size]
-	Variable forward_ids(const std::vector<int>& token_ids, size_t position_offset = 0);
+	// logits_positions: compute lm_head only for these positions (relative to token_ids),
+	// giving [batch, logits_positions.size(), vocab_size]; empty = all positions
+	Variable forward_ids(const std::vector<int>& token_ids, size_t position_offset = 0,
+						 const std::vector<size_t>& logits_positions = {});
 	Variable forward(const std::vector<Variable>& xs) override;
-
-	void to(const dcz::Device& device) override {
-		Layer::to(device);
-		if (!lm_head_weight.empty())
-			lm_head_weight = lm_head_weight.to(device);
-	}
-
+	void to(const dcz::Device& device) override;
+
+	// lm_head over final hidden states [batch, rows, hidden_size] -> logits
+	// [batch, rows, vocab_size]; tied to embed_tokens unless the checkpoint has its own
+	Variable lm_head(const Variable& hidden_states) const;
+	// Separate lm_head loaded from an untied checkpoint, null when tied
+	std::shared_ptr<layer::Linear> get_lm_head() const { return lm_head_proj; }
+
+	// Chunked prefill: runs token_ids through the model chunk_size tokens at a time,
+	// appending each chunk to the KV cache. Activation memory is bounded by chunk_size
+	// instead of the prompt length. Returns logits of the last token: [1, 1, vocab_size].
+	// chunk_size = 0 processes the whole prompt at once.
+	// (A scheduler can instead drive get_model()->forward_ids() one chunk at a time and
+	//  interleave other sequences' decode steps between chunks.)
+	Variable prefill(const std::vector<int>& token_ids, size_t position_offset = 0,
+					 size_t chunk_size = 256);
+
+	// Prefill all prompts in one pass; the KV cache is reset to the BatchLayout of the prompts
+	// padded on `padding` side. Returns last-token logits [batch, 1, vocab_size].
+	Variable prefill_batch(const std::vector<std::vector<int>>& prompts,
+						   layer::PaddingSide padding = layer::PaddingSide::Right);
+
+	// The KV cache and everything below acting on it belong to the calling thread's
+	// layer::InferenceSession when one is bound, so threads with their own sessions can
+	// share this model (tensor parallelism and weight streaming then throw).
 	void reset_cache();
-	void load_weights(const std::string& weights_path);
+	void truncate_cache(size_t len);
+	// Sliding window: drop the oldest `drop` cached tokens, keeping the rest in place of
+	// recomputing them; the next forward_ids continues at position cache_len().
+	// Deeper layers keep K/V computed with the dropped tokens still in context.
+	void shift_cache(size_t drop);
+	// Streaming generation: keep the first sink_tokens plus the latest window_tokens in a
+	// fixed-size cache; pass absolute positions to forward_ids. 0 turns it off; drops the cache.
+	void set_streaming(size_t sink_tokens, size_t window_tokens);
+	bool is_streaming() const;
+	// Shard the decoder layers across num_groups NUMA-pinned groups (0 or 1: off); needs
+	// packed weights. Not available with sessions, streaming, beams or batched prefill.
+	void enable_tensor_parallel(size_t num_groups);
+	// Beams over a shared KV cache: fork_cache(n) splits the cached sequence into n
+	// entries sharing it, reorder_cache(parents) makes entry b continue parents[b]'s
+	// sequence without copying K/V, and forward_step feeds one token per entry:
+	// logits [batch, 1, vocab_size]. reset_cache() returns to a single sequence.
+	void fork_cache(size_t batch);
+	void reorder_cache(const std::vector<size_t>& parents);
+	Variable forward_step(const std::vector<int>& token_ids, size_t position_offset);
+	// KV cache storage (f32 default, f16, or int8 with per-token, per-head scales).
+	// Changing the format drops the cached tokens.
+	void set_kv_cache_format(KVCacheFormat format);
+	KVCacheFormat get_kv_cache_format() const;
+	// K + V bytes per cached token over all layers (one sequence)
+	size_t kv_cache_bytes_per_token() const;
+	// weight_format: pack decoder projections while loading (e.g. Q8_0, Q4_0).
+	// Projections already quantized by scripts/quantize_llama_weights.py load packed as-is.
+	// A .dczt tensor file (see tensor_file.hpp) is memory-mapped instead of read: packed
+	// projections and embedding rows alias the file pages, only norms are copied.
+	// HuggingFace safetensors (a .safetensors file, its sharded .index.json, or the model
+	// directory) are mapped the same way: "<name>.weight" [out, in] bf16/f16/f32 matrices
+	// are used as packed rows in their stored dtype. Unfused q/k/v and gate/up stay
+	// zero-copy; pass weight_format (or call pack_weights) to fuse them.
+	// An untied lm_head ("lm_head.weight", or "lm_head.W*" in npz / tensor files) is
+	// loaded as its own projection; a safetensors copy identical to the embedding
+	// keeps lm_head tied.
+	void load_weights(const std::string& weights_path,
+					  std::optional<tensor::PackedFormat> weight_format = std::nullopt);
+	// Write the current (possibly packed) weights as a .dczt tensor file; returns its size
+	size_t save_weights_file(const std::string& path) const;
+	// Pack decoder projections of an already loaded model; returns packed bytes
+	size_t pack_weights(tensor::PackedFormat format);
+
+	// Layer-streamed execution for weights larger than RAM: at most resident_layers
+	// decoder layers of the mapped weight file are kept in memory, the next ones are
+	// read ahead by a background thread while the current one runs (see
+	// layer_streamer.hpp). Needs weights loaded from a .dczt / safetensors file and
+	// left in place (no weight_format repacking, which copies them to the heap).
+	// resident_layers = 0 turns streaming off.
+	void enable_weight_streaming(size_t resident_layers);
+
+	std::shared_ptr<layer::LlamaModel> get_model() const { return model; }
+
+	// Number of tokens currently held in the KV cache
+	size_t cache_len() const;
 };
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "container/layer/llama.hpp"
+#include "container/tensor/packed_tensor.hpp"
+#include "utils/kv_cache.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace layer {
+
+// ============================================================
+// LlamaTensorParallel: decoder layers sharded across worker groups
+//
+// Every layer is split num_groups ways: a group owns whole KV heads (with the query
+// heads reading them) of attention and a 32-column range of the MLP intermediate.
+// Its shards are
+//   qkv     rows of the fused q/k/v matrix for its heads
+//   o       o_proj columns of its heads
+//   gate_up gate and up rows of its intermediate range
+//   down    down_proj columns of that range
+// plus the K/V cache of its heads. Each group is one worker thread pinned to the
+// CPUs of a NUMA node (groups take nodes round robin and split a shared node's
+// CPUs); its OpenMP team inherits the pinning. The worker copies its shards and
+// allocates its cache itself, so first touch places those pages on its node and
+// the decode loop reads weights from local memory only.
+//
+// Per layer the main thread hands the normed hidden state to all groups twice
+// (attention, then MLP). Each group writes a partial [seq, hidden] output (its
+// share of o_proj / down_proj) to its buffer; the main thread sums the partials
+// into the residual with the fused add + RMSNorm. Only hidden-sized vectors cross
+// nodes, never weights.
+//
+// Single sequence, CPU inference; the model's projections must be packed and fused
+// (pack_weights). Shards are copies. Installed in a model (LlamaModel::
+// set_tensor_parallel), the engine takes the layers' qkv/o/gate_up/down weights:
+// the layers drop theirs, so the weights are held once, and get them back
+// reassembled from the shards when the engine is removed (heap copies, also for
+// weights that were mapped from a file).
+// ============================================================
+class LlamaTensorParallel {
+public:
+	struct GroupInfo {
+		int node = 0;
+		std::vector<int> cpus;
+		bool pinned = false;
+		size_t kv_head_begin = 0, kv_head_end = 0;
+		size_t inter_begin = 0, inter_end = 0;
+		size_t weight_bytes = 0;  // shards over all layers
+	};
+
+	LlamaTensorParallel(const LlamaModel& model, size_t num_groups);
+	~LlamaTensorParallel();
+	LlamaTensorParallel(const LlamaTensorParallel&) = delete;
+	LlamaTensorParallel& operator=(const LlamaTensorParallel&) = delete;
+
+	// Embedded tokens [1, seq, hidden] at position_offset.. -> final-normed hidden
+	// states [1, seq, hidden], appending the tokens to the groups' KV caches
+	Tensor<> forward(const Tensor<>& embedded, size_t position_offset);
+
+	void reset_cache();
+	void truncate_cache(size_t len);
+	// Drops the cached tokens
+	void set_kv_cache_format(KVCacheFormat format);
+	size_t get_cache_len() const { return cache_len; }
+
+	// Drop the layers' projection weights (the shards hold them) / put them back,
+	// reassembled from the shards. Called by LlamaModel::set_tensor_parallel.
+	void release_model_weights();
+	void restore_model_weights();
+
+	size_t num_groups() const { return groups.size(); }
+	const GroupInfo& group_info(size_t g) const { return groups[g]->info; }
+
+private:
+	enum class Job { None, Build, Attention, Mlp, ResetCache, Stop };
+
+	struct LayerShard {
+		tensor::PackedTensor qkv, o, gate_up, down;
+		KVCacheStore k_cache, v_cache;
+	};
+
+	struct Group {
+		GroupInfo info;
+		std::vector<LayerShard> layers;
+		std::vector<float> qkv, q, attn, h;  // scratch
+		std::vector<float> partial;          // [seq, hidden] share of the layer output
+		std::thread thread;
+	};
+
+	// Model structure (the layers' parameters are read once, by Build)
+	std::vector<std::shared_ptr<LlamaDecoderLayer>> layers;
+	std::shared_ptr<LlamaRMSNorm> final_norm;
+	Tensor<> cos_cache, sin_cache;
+	size_t hidden_size, num_heads, num_kv_heads, head_dim, intermediate_size, max_seq_len;
+	KVCacheFormat kv_format;
+
+	std::vector<std::unique_ptr<Group>> groups;
+	size_t cache_len = 0;
+	bool holds_weights = false;  // layers released theirs
+
+	// Current job, read by the workers after generation changes
+	std::mutex mutex;
+	std::condition_variable cv;
+	size_t generation = 0;
+	size_t finished = 0;
+	Job job = Job::None;
+	size_t job_layer = 0;
+	size_t job_seq = 0;
+	size_t job_position = 0;
+	const float* job_input = nullptr;  // [seq, hidden] normed hidden states
+	std::exception_ptr error;
+
+	// Runs job on every group and waits for all of them; rethrows a worker's error
+	void run(Job what, size_t layer = 0, size_t seq = 0, size_t position = 0, const float* input = nullptr);
+	void worker(size_t g);
+	// Ends and joins the workers
+	void stop();
+	void build(Group& group);
+	void attention(Group& group, size_t layer, size_t seq, size_t position, const float* input);
+	void mlp(Group& group, size_t layer, size_t seq, const float* input);
+};
+
+} // namespace layer
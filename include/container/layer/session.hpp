@@ -0,0 +1,83 @@
+#pragma once
+
+#include "config/config.hpp"
+
+#include <memory>
+#include <unordered_map>
+
+namespace layer {
+
+// ============================================================
+// InferenceSession: per-request state of a model shared between threads
+//
+// Layers keep their parameters; whatever a forward pass mutates (a Llama layer's KV
+// cache, streaming and beam bookkeeping, YOLOv5's last detections) is looked up in
+// the session bound to the calling thread, keyed by the owning layer. Each worker
+// binds its own session with UsingSession and can then run forward / generate on
+// the one shared model while other threads do the same. Without a bound session
+// layers use the state they hold themselves (single-threaded use). Weights must be
+// in place before sharing: layers initializing them lazily on the first forward do
+// so unsynchronized.
+//
+// dcz::Config is per thread: while bound, the session's flags apply to the thread
+// (inference defaults: no train mode, no autograd graph).
+//
+// A session's Llama layers start with the model's KV format and streaming settings.
+// A PrefixCache is not synchronized: concurrent sessions must not share one.
+// ============================================================
+class InferenceSession {
+public:
+	bool train = false;
+	bool enable_backprop = false;
+
+	InferenceSession() = default;
+	InferenceSession(const InferenceSession&) = delete;
+	InferenceSession& operator=(const InferenceSession&) = delete;
+
+	// State of owner in this session, default-constructed on first use. An owner
+	// always asks for the same T.
+	template <class T>
+	T& state(const void* owner) {
+		return state<T>(owner, [](T&) {});
+	}
+	// Same, with init(T&) run once when the state is created (e.g. to copy the
+	// owner's settings)
+	template <class T, class Init>
+	T& state(const void* owner, Init&& init) {
+		std::shared_ptr<void>& slot = states[owner];
+		if (!slot) {
+			auto created = std::make_shared<T>();
+			init(*created);
+			slot = std::move(created);
+		}
+		return *static_cast<T*>(slot.get());
+	}
+
+	// Drop every layer's state (e.g. before reusing the session for a new model)
+	void clear() { states.clear(); }
+
+	// Session bound to the calling thread, null if none
+	static InferenceSession* current();
+
+private:
+	std::unordered_map<const void*, std::shared_ptr<void>> states;
+
+	friend class UsingSession;
+	static void bind(InferenceSession* session);
+};
+
+// Binds session to the calling thread for its lifetime (nestable, like UsingConfig)
+class UsingSession {
+private:
+	InferenceSession* previous;
+	dcz::UsingConfig train;
+	dcz::UsingConfig enable_backprop;
+
+public:
+	explicit UsingSession(InferenceSession& session);
+	~UsingSession();
+	UsingSession(const UsingSession&) = delete;
+	UsingSession& operator=(const UsingSession&) = delete;
+};
+
+} // namespace layer
@@ -2,6 +2,7 @@
 
 #include "container/layer/layer.hpp"
 #include "container/layer/model.hpp"
+#include "container/layer/session.hpp"
 
 #include <vector>
 #include <memory>
@@ -133,8 +134,9 @@ private:
 	std::shared_ptr<layer::Conv2d> detect_p4;  // w(512) -> out_ch, 1x1
 	std::shared_ptr<layer::Conv2d> detect_p5;  // w(1024) -> out_ch, 1x1
 
-	// Multi-scale outputs stored after forward
+	// Multi-scale outputs stored after forward (in the calling thread's session, if any)
 	std::vector<Variable> detection_outputs;
+	std::vector<Variable>& detection_state() const;
 
 public:
 	YOLOv5(size_t num_classes = 80,
@@ -151,6 +153,6 @@ public:
 	void load_weights(const std::string& weights_path);
 
 	const std::vector<Variable>& get_detection_outputs() const {
-		return detection_outputs;
+		return detection_state();
 	}
 };
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "container/tensor/tensor.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace tensor {
+
+// ============================================================
+// Scalar conversions (round to nearest even)
+// ============================================================
+
+inline float bf16_to_fp32(uint16_t h) {
+	uint32_t bits = static_cast<uint32_t>(h) << 16;
+	float f;
+	std::memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+inline uint16_t fp32_to_bf16(float f) {
+	uint32_t bits;
+	std::memcpy(&bits, &f, sizeof(bits));
+	if ((bits & 0x7fffffff) > 0x7f800000)
+		return static_cast<uint16_t>((bits >> 16) | 0x40);  // keep NaN quiet
+	bits += 0x7fff + ((bits >> 16) & 1);
+	return static_cast<uint16_t>(bits >> 16);
+}
+
+inline float fp16_to_fp32(uint16_t h) {
+	uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+	uint32_t exp = (h >> 10) & 0x1f;
+	uint32_t mant = h & 0x3ff;
+	uint32_t bits;
+	if (exp == 0) {
+		if (mant == 0) {
+			bits = sign;
+		} else {
+			// subnormal: renormalize
+			exp = 127 - 15 + 1;
+			while ((mant & 0x400) == 0) { mant <<= 1; --exp; }
+			mant &= 0x3ff;
+			bits = sign | (exp << 23) | (mant << 13);
+		}
+	} else if (exp == 0x1f) {
+		bits = sign | 0x7f800000 | (mant << 13);
+	} else {
+		bits = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+	}
+	float f;
+	std::memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+inline uint16_t fp32_to_fp16(float f) {
+	uint32_t bits;
+	std::memcpy(&bits, &f, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int32_t exp = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+	uint32_t mant = bits & 0x7fffff;
+	if (((bits >> 23) & 0xff) == 0xff) return static_cast<uint16_t>(sign | 0x7c00 | (mant ? 0x200 : 0));
+	if (exp >= 0x1f) return static_cast<uint16_t>(sign | 0x7c00);  // overflow -> inf
+	if (exp <= 0) {
+		if (exp < -10) return static_cast<uint16_t>(sign);
+		mant |= 0x800000;
+		uint32_t shift = static_cast<uint32_t>(14 - exp);
+		uint32_t half = mant >> shift;
+		uint32_t rem = mant & ((1u << shift) - 1);
+		uint32_t mid = 1u << (shift - 1);
+		if (rem > mid || (rem == mid && (half & 1))) ++half;
+		return static_cast<uint16_t>(sign | half);
+	}
+	uint32_t half = sign | (static_cast<uint32_t>(exp) << 10) | (mant >> 13);
+	uint32_t rem = mant & 0x1fff;
+	if (rem > 0x1000 || (rem == 0x1000 && (half & 1))) ++half;  // round to nearest even
+	return static_cast<uint16_t>(half);
+}
+
+// ============================================================
+// 16-bit storage types: Tensor<bf16> / Tensor<fp16>
+// Arithmetic goes through float; only storage is 16-bit.
+// ============================================================
+
+struct bf16 {
+	uint16_t bits;
+
+	bf16() = default;
+	bf16(float f) : bits(fp32_to_bf16(f)) {}
+	operator float() const { return bf16_to_fp32(bits); }
+
+	static bf16 from_bits(uint16_t b) { bf16 h; h.bits = b; return h; }
+};
+
+struct fp16 {
+	uint16_t bits;
+
+	fp16() = default;
+	fp16(float f) : bits(fp32_to_fp16(f)) {}
+	operator float() const { return fp16_to_fp32(bits); }
+
+	static fp16 from_bits(uint16_t b) { fp16 h; h.bits = b; return h; }
+};
+
+static_assert(sizeof(bf16) == 2 && sizeof(fp16) == 2, "16-bit storage types must be 2 bytes");
+
+// ============================================================
+// Bulk conversions (AVX512-BF16 / F16C / AVX2 when available)
+// ============================================================
+
+void fp32_to_bf16_row(const float* src, bf16* dst, size_t n);
+void bf16_to_fp32_row(const bf16* src, float* dst, size_t n);
+void fp32_to_fp16_row(const float* src, fp16* dst, size_t n);
+void fp16_to_fp32_row(const fp16* src, float* dst, size_t n);
+
+Tensor<bf16> to_bf16(const Tensor<>& x);
+Tensor<fp16> to_fp16(const Tensor<>& x);
+Tensor<> to_fp32(const Tensor<bf16>& x);
+Tensor<> to_fp32(const Tensor<fp16>& x);
+
+} // namespace tensor
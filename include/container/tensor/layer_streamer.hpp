@@ -0,0 +1,85 @@
+#pragma once
+
+#include "container/tensor/tensor_file.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tensor {
+
+// ============================================================
+// LayerStreamer: bounded residency for memory-mapped layer weights
+//
+// Groups the entries of a TensorFile by layer prefix ("model.layers.3" owns every
+// "model.layers.3.*" tensor) and keeps at most resident_layers of those groups
+// mapped in. Layers run in order and wrap around (the next forward starts at
+// layer 0 again):
+//   begin(i)  waits for layer i to be resident, then queues layers
+//             i+1 .. i+resident_layers-1 for the background reader
+//   end(i)    drops layer i's pages (MADV_DONTNEED) unless every layer fits
+// The reader thread issues MADV_WILLNEED and touches each page, so the disk reads
+// overlap with compute on the current layer. Released pages of a read-only file
+// mapping are clean: the kernel can reclaim them without writeback, and they are
+// re-read from the file the next time the layer comes around.
+//
+// Only bytes that live in the mapping are managed; weights copied to the heap
+// (unpacked f32 W, norms, fused copies made by pack_weights) are unaffected.
+// ============================================================
+class LayerStreamer {
+public:
+	struct Stats {
+		size_t prefetched = 0;     // layers read ahead by the background thread
+		size_t released = 0;       // layers dropped after use
+		size_t cold_misses = 0;    // begin() on a layer nobody had queued
+		double stall_ms = 0.0;     // time begin() spent waiting for the reader
+	};
+
+	LayerStreamer(std::shared_ptr<const TensorFile> file, const std::vector<std::string>& layer_prefixes,
+				  size_t resident_layers);
+	~LayerStreamer();
+	LayerStreamer(const LayerStreamer&) = delete;
+	LayerStreamer& operator=(const LayerStreamer&) = delete;
+
+	void begin(size_t layer);
+	void end(size_t layer);
+
+	size_t num_layers() const { return layers.size(); }
+	size_t get_resident_layers() const { return resident_layers; }
+	// Mapped bytes owned by one layer
+	size_t layer_bytes(size_t layer) const;
+	Stats get_stats() const;
+
+private:
+	struct Range {
+		const uint8_t* begin;
+		const uint8_t* end;
+	};
+	enum class State { Released, Queued, Loading, Resident };
+
+	std::shared_ptr<const TensorFile> file;
+	std::vector<std::vector<Range>> layers;
+	size_t resident_layers;
+
+	mutable std::mutex mutex;
+	std::condition_variable cv;
+	std::vector<State> state;
+	std::deque<size_t> queue;
+	Stats stats;
+	bool stopping = false;
+	std::thread reader;
+
+	void run();
+	void load(size_t layer) const;
+	void release(size_t layer) const;
+	// Callers hold mutex
+	void enqueue(size_t layer);
+};
+
+} // namespace tensor
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "container/tensor/tensor.hpp"
+#include "container/tensor/half.hpp"
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace tensor {
+
+// Storage formats for inference weight matrices
+enum class PackedFormat {
+	F32,   // plain fp32 rows
+	BF16,  // bfloat16 rows (the checkpoint dtype, lossless vs. HF weights)
+	F16,   // IEEE fp16 rows
+	Q8_0,  // blocks of 32 int8 weights + fp16 scale (34 bytes / 32 weights)
+	Q4_0,  // blocks of 32 4-bit weights + fp16 scale, w = d * (q - 8) (18 bytes / 32 weights)
+	Q4_1,  // blocks of 32 4-bit weights + fp16 scale and min, w = d * q + m (20 bytes / 32 weights)
+};
+
+const char* packed_format_name(PackedFormat format);
+PackedFormat packed_format_from_name(const std::string& name);
+
+// Weight matrix [rows, cols] kept row-major in a packed format, one row per
+// output feature (the [out, in] layout of HF checkpoints). Rows are contiguous
+// so y = x @ W^T streams each row once; quantized rows are dequantized in
+// registers and accumulated in fp32.
+class PackedTensor {
+private:
+	PackedFormat format = PackedFormat::F32;
+	size_t rows = 0;
+	size_t cols = 0;
+	size_t row_bytes = 0;
+	// Row data lives in a shared buffer so row slices (e.g. q/k/v inside a fused
+	// QKV matrix) are views rather than copies
+	std::shared_ptr<const void> owner;
+	const uint8_t* base = nullptr;
+
+	static PackedTensor allocate(size_t rows, size_t cols, PackedFormat format, uint8_t*& data);
+
+public:
+	PackedTensor() = default;
+
+	// src: [rows, cols] row-major fp32
+	static PackedTensor from_rows(const float* src, size_t rows, size_t cols, PackedFormat format);
+	// w: Linear weight [in, out] (x @ W convention) -> packed [out, in]
+	static PackedTensor from_linear_weight(const Tensor<>& w, PackedFormat format);
+	// 16-bit rows [rows, cols] kept as-is (no round trip through fp32)
+	static PackedTensor from_rows(const Tensor<bf16>& rows);
+	static PackedTensor from_rows(const Tensor<fp16>& rows);
+	// Already packed rows (e.g. written by scripts/quantize_llama_weights.py)
+	static PackedTensor from_packed_bytes(const uint8_t* data, size_t rows, size_t cols, PackedFormat format);
+	// Rows owned by someone else (e.g. a memory-mapped weight file); no copy is made
+	// and owner keeps the storage alive for as long as the view or its slices exist
+	static PackedTensor view(std::shared_ptr<const void> owner, const uint8_t* data,
+							 size_t rows, size_t cols, PackedFormat format);
+	// Stack row blocks of one format/width into a single matrix (fused projections)
+	static PackedTensor concat_rows(const std::vector<PackedTensor>& parts);
+	// Join column blocks of one format/row count side by side (inverse of column_slice)
+	static PackedTensor concat_columns(const std::vector<PackedTensor>& parts);
+
+	static size_t row_size(PackedFormat format, size_t cols);
+	// Inverse of row_size
+	static size_t cols_for_row_bytes(PackedFormat format, size_t row_bytes);
+
+	PackedFormat get_format() const { return format; }
+	size_t get_rows() const { return rows; }
+	size_t get_cols() const { return cols; }
+	size_t nbytes() const { return rows * row_bytes; }
+	bool empty() const { return rows == 0; }
+
+	const uint8_t* row_ptr(size_t r) const { return base + r * row_bytes; }
+	// Rows [begin, end) sharing this tensor's storage
+	PackedTensor row_slice(size_t begin, size_t end) const;
+	// Columns [begin, end) of every row, copied byte for byte into new storage
+	// (quantized formats need begin / end on 32-column block boundaries)
+	PackedTensor column_slice(size_t begin, size_t end) const;
+
+	// Dequantize row r into out[cols]
+	void dequantize_row(size_t r, float* out) const;
+	// Dequantize everything: [rows, cols] fp32
+	Tensor<> unpack() const;
+};
+
+// y[m, rows] = x[m, cols] @ W^T  (raw pointers, row-major)
+void packed_matmul(const float* x, size_t m, const PackedTensor& w, float* y);
+
+// SwiGLU with a fused epilogue: gate_up = [gate rows; up rows] ([2 * n, cols]),
+// h[m, n] = silu(x @ gate^T) * (x @ up^T) written without the [m, 2n] intermediate
+void packed_matmul_swiglu(const float* x, size_t m, const PackedTensor& gate_up, float* h);
+
+// x: [..., cols] -> [..., rows], optional bias [rows]
+Tensor<> packed_linear(const Tensor<>& x, const PackedTensor& w, const Tensor<>& bias = Tensor<>());
+
+} // namespace tensor
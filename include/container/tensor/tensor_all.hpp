@@ -12,4 +12,7 @@
 #include "container/tensor/tensor_utils.hpp"
 #include "container/tensor/tensor_functions.hpp"
 #include "container/tensor/tensor_random.hpp"
-
+#include "container/tensor/half.hpp"
+#include "container/tensor/packed_tensor.hpp"
+#include "container/tensor/tensor_file.hpp"
+#include "container/tensor/layer_streamer.hpp"
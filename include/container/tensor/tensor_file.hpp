@@ -0,0 +1,137 @@
+#pragma once
+
+#include "container/tensor/tensor.hpp"
+#include "container/tensor/packed_tensor.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tensor {
+
+// ============================================================
+// Native tensor container (.dczt)
+//
+// Little-endian layout:
+//   char   magic[4] = "DCZT"
+//   uint32 version  = 1
+//   uint64 count
+//   uint64 data_offset                      (multiple of TENSOR_FILE_ALIGN)
+//   count x { uint32 name_len, char name[name_len],
+//             uint32 dtype, uint32 ndim, uint64 shape[ndim],
+//             uint64 offset, uint64 nbytes }  (offset is absolute)
+//   tensor data, each starting on a TENSOR_FILE_ALIGN boundary
+//
+// Names follow the npz keys of scripts/convert_llama_weights.py. Projection
+// weights are stored as packed rows "<layer>.W_<format>" ([out, in] for
+// f32/bf16/f16, uint8 [out, row_bytes] for block formats) so they can be used
+// in place; see scripts/convert_npz_to_dczt.py.
+// ============================================================
+
+constexpr size_t TENSOR_FILE_ALIGN = 64;
+
+enum class DType : uint32_t {
+	F32 = 0,
+	F16 = 1,
+	BF16 = 2,
+	U8 = 3,
+};
+
+size_t dtype_size(DType dtype);
+const char* dtype_name(DType dtype);
+
+struct TensorFileEntry {
+	std::string name;
+	DType dtype = DType::F32;
+	std::vector<size_t> shape;
+	size_t offset = 0;  // within its shard
+	size_t nbytes = 0;
+	size_t shard = 0;
+};
+
+// Read-only, memory-mapped tensor file. Opening only parses the index; tensor
+// data stays in the page cache (shared between processes mapping the same
+// file) and is faulted in on first use. Views handed out by share() and
+// packed_weight() keep the mapping alive after the TensorFile itself is gone.
+//
+// Besides .dczt files, HuggingFace safetensors checkpoints (one file or the
+// shards listed by model.safetensors.index.json) open the same way, with the
+// checkpoint's own tensor names; add_alias() maps them onto layer names.
+class TensorFile : public std::enable_shared_from_this<TensorFile> {
+private:
+	struct Mapping {
+		const uint8_t* base = nullptr;
+		size_t size = 0;
+	};
+
+	std::string path;
+	std::vector<Mapping> shards;
+	std::vector<TensorFileEntry> entries;
+	std::unordered_map<std::string, size_t> index;
+
+	TensorFile() = default;
+	void map_shard(const std::string& shard_path);
+	void add_entry(TensorFileEntry e);
+	void parse_safetensors(size_t shard, const std::string& shard_path);
+
+public:
+	~TensorFile();
+	TensorFile(const TensorFile&) = delete;
+	TensorFile& operator=(const TensorFile&) = delete;
+
+	static std::shared_ptr<TensorFile> open(const std::string& path);
+	// Checks the magic only
+	static bool is_tensor_file(const std::string& path);
+
+	// path: a .safetensors file, a *.safetensors.index.json, or a directory holding
+	// model.safetensors / model.safetensors.index.json. Tensors of dtypes other
+	// than F32/F16/BF16/U8 are skipped.
+	static std::shared_ptr<TensorFile> open_safetensors(const std::string& path);
+	static bool is_safetensors(const std::string& path);
+
+	const std::vector<TensorFileEntry>& get_entries() const { return entries; }
+	const TensorFileEntry* find(const std::string& name) const;
+	bool contains(const std::string& name) const { return find(name) != nullptr; }
+	// Make an existing tensor also reachable as alias (no data is touched)
+	void add_alias(const std::string& alias, const std::string& name);
+	// Total mapped bytes over all shards
+	size_t file_size() const;
+
+	const uint8_t* data(const TensorFileEntry& e) const { return shards[e.shard].base + e.offset; }
+	// Aliasing pointer to e's data that owns the mapping
+	std::shared_ptr<const void> share(const TensorFileEntry& e) const;
+
+	// Copy an f32/bf16/f16 entry into a float Tensor (norms, biases, unpacked W)
+	Tensor<> to_tensor(const TensorFileEntry& e) const;
+	Tensor<> to_tensor(const std::string& name) const;
+
+	// Zero-copy packed rows from the first "<layer_name>.W_<format>" entry, or nullptr
+	std::shared_ptr<PackedTensor> packed_weight(const std::string& layer_name) const;
+};
+
+// Collects tensors and writes them as one .dczt file. Only references are kept
+// until save(): raw pointers passed to add() must stay valid until then.
+class TensorFileWriter {
+private:
+	struct Pending {
+		TensorFileEntry entry;
+		const void* data;
+		std::shared_ptr<const void> keep;
+	};
+	std::vector<Pending> pending;
+
+public:
+	void add(const std::string& name, DType dtype, const std::vector<size_t>& shape, const void* data);
+	// f32 tensor, written in its logical (contiguous) layout
+	void add(const std::string& name, const Tensor<>& t);
+	// Packed rows under their own name (callers append ".W_<format>" for Linear weights)
+	void add(const std::string& name, const PackedTensor& w);
+
+	// Returns the file size in bytes
+	size_t save(const std::string& path) const;
+};
+
+} // namespace tensor
@@ -723,6 +723,75 @@ Tensor<T> dot(const Tensor<T>& a, const Tensor<T>& b) {
 	return dot_naive(a, b);
 }
 
+// Matrix multiplication with transposed right operand: a @ b^T
+// a: [..., M, K], b: [N, K] -> [..., M, N]
+// Lets callers keep weights in [out, in] layout (e.g. tied embeddings) without a transposed copy.
+template<typename T>
+Tensor<T> dot_nt_naive(const Tensor<T>& a, const Tensor<T>& b) {
+	std::vector<size_t> a_shape = a.get_shape();
+	std::vector<size_t> b_shape = b.get_shape();
+
+	if (a_shape.size() < 2 || b_shape.size() != 2)
+		throw std::runtime_error("dot_nt: a must be at least 2D and b must be 2D");
+
+	size_t K = a_shape.back();
+	size_t N = b_shape[0];
+	if (b_shape[1] != K)
+		throw std::runtime_error("dot_nt: inner dimensions mismatch");
+	size_t M = a.size() / K;
+
+	Tensor<T> a_c = a.contiguous();
+	Tensor<T> b_c = b.contiguous();
+	const T* A = a_c.raw_data().data();
+	const T* B = b_c.raw_data().data();
+
+	std::vector<size_t> result_shape = a_shape;
+	result_shape.back() = N;
+	std::vector<T> result_data(M * N);
+	T* C = result_data.data();
+
+	// Tile over rows of b so each tile is reused across all rows of a
+	const long NB = 64;
+	const long n_total = static_cast<long>(N);
+
+	#pragma omp parallel for schedule(static)
+	for (long n0 = 0; n0 < n_total; n0 += NB) {
+		size_t n1 = static_cast<size_t>(std::min(n_total, n0 + NB));
+		for (size_t m = 0; m < M; ++m) {
+			const T* a_row = A + m * K;
+			for (size_t n = static_cast<size_t>(n0); n < n1; ++n) {
+				const T* b_row = B + n * K;
+				T sum = T{};
+				#pragma omp simd reduction(+:sum)
+				for (size_t k = 0; k < K; ++k)
+					sum += a_row[k] * b_row[k];
+				C[m * N + n] = sum;
+			}
+		}
+	}
+
+	return Tensor<T>(result_shape, result_data);
+}
+
+template<typename T>
+Tensor<T> dot_nt(const Tensor<T>& a, const Tensor<T>& b) {
+	check_same_device(a, b);
+#ifdef USE_SYCL
+	if (a.device().type == dcz::DeviceType::SYCL) return dot_nt_sycl(a, b);
+#endif
+#ifdef USE_CUDA
+	if (a.device().type == dcz::DeviceType::CUDA) return dot_nt_cuda(a, b);
+#endif
+#ifdef USE_MKL
+	if constexpr (std::is_same<T, float>::value || std::is_same<T, double>::value) {
+		if (dcz::BackendConfig::get().use_mkl) {
+			return dot_nt_mkl(a, b);
+		}
+	}
+#endif
+	return dot_nt_naive(a, b);
+}
+
 template<typename T>
 Tensor<T> tensordot(const Tensor<T> &A, 
                     const Tensor<T>& B,
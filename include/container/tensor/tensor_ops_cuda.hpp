@@ -20,6 +20,9 @@ void cuda_cos_f(const float* x, float* r, size_t n);
 void cuda_pow_f(const float* x, float scalar, float* r, size_t n);
 void cuda_gemm_f(const float* a, const float* b, float* c,
 				  size_t M, size_t N, size_t K, float alpha, float beta);
+// c = a @ b^T with b [N, K]
+void cuda_gemm_nt_f(const float* a, const float* b, float* c,
+					 size_t M, size_t N, size_t K, float alpha, float beta);
 }
 
 namespace tensor {
@@ -196,6 +199,32 @@ Tensor<T> dot_cuda(const Tensor<T>& a, const Tensor<T>& b) {
 	return make_cuda_tensor(result_buf, result_shape);
 }
 
+// a [..., M, K] @ b^T with b [N, K]: one GEMM over all rows of a, b read in place
+template<typename T>
+Tensor<T> dot_nt_cuda(const Tensor<T>& a, const Tensor<T>& b) {
+	auto a_shape = a.get_shape();
+	auto b_shape = b.get_shape();
+	if (a_shape.size() < 2 || b_shape.size() != 2)
+		throw std::runtime_error("dot_nt_cuda: a must be at least 2D and b must be 2D");
+
+	size_t K = a_shape.back();
+	size_t N = b_shape[0];
+	if (b_shape[1] != K)
+		throw std::runtime_error("dot_nt_cuda: inner dimensions mismatch");
+	size_t M = a.size() / K;
+
+	std::vector<size_t> result_shape = a_shape;
+	result_shape.back() = N;
+	auto result_buf = std::make_shared<dcz::CUDABuffer<T>>(M * N);
+
+	if constexpr (std::is_same_v<T, float>) {
+		cuda_gemm_nt_f(a.device_buffer()->device_ptr(), b.device_buffer()->device_ptr(),
+					   result_buf->device_ptr(), M, N, K, 1.0f, 0.0f);
+	}
+
+	return make_cuda_tensor(result_buf, result_shape);
+}
+
 } // namespace tensor
 
 #endif // USE_CUDA
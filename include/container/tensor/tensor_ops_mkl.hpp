@@ -135,6 +135,37 @@ Tensor<T> dot_mkl(const Tensor<T>& a, const Tensor<T>& b) {
     return Tensor<T>(result_shape, result_data);
 }
 
+// MKL-optimized a @ b^T: a [..., M, K], b [N, K] -> [..., M, N]
+template<typename T>
+Tensor<T> dot_nt_mkl(const Tensor<T>& a, const Tensor<T>& b) {
+    static_assert(can_use_mkl<T>(), "MKL only supports float and double types");
+
+    std::vector<size_t> a_shape = a.get_shape();
+    std::vector<size_t> b_shape = b.get_shape();
+
+    if (a_shape.size() < 2 || b_shape.size() != 2)
+        throw std::runtime_error("dot_nt_mkl: a must be at least 2D and b must be 2D");
+
+    size_t K = a_shape.back();
+    size_t N = b_shape[0];
+    if (b_shape[1] != K)
+        throw std::runtime_error("dot_nt_mkl: inner dimensions mismatch");
+    size_t M = a.size() / K;
+
+    Tensor<T> a_c = a.contiguous();
+    Tensor<T> b_c = b.contiguous();
+
+    std::vector<size_t> result_shape = a_shape;
+    result_shape.back() = N;
+    std::vector<T> result_data(M * N);
+
+    // Batch dims fold into M since b is shared
+    mkl_gemm_2d(a_c.raw_data().data(), b_c.raw_data().data(), result_data.data(),
+                M, K, N, false, true);
+
+    return Tensor<T>(result_shape, result_data);
+}
+
 // MKL VML-optimized element-wise math functions
 
 template<typename T>
@@ -259,6 +259,43 @@ Tensor<T> dot_sycl(const Tensor<T>& a, const Tensor<T>& b) {
 	return make_device_tensor(result_buf, result_shape);
 }
 
+// a [..., M, K] @ b^T with b [N, K]: one GEMM over all rows of a, b read in place
+template<typename T>
+Tensor<T> dot_nt_sycl(const Tensor<T>& a, const Tensor<T>& b) {
+	auto& q = dcz::SYCLContext::get().queue();
+
+	auto a_shape = a.get_shape();
+	auto b_shape = b.get_shape();
+	if (a_shape.size() < 2 || b_shape.size() != 2)
+		throw std::runtime_error("dot_nt_sycl: a must be at least 2D and b must be 2D");
+
+	size_t K = a_shape.back();
+	size_t N = b_shape[0];
+	if (b_shape[1] != K)
+		throw std::runtime_error("dot_nt_sycl: inner dimensions mismatch");
+	size_t M = a.size() / K;
+
+	std::vector<size_t> result_shape = a_shape;
+	result_shape.back() = N;
+	auto result_buf = std::make_shared<dcz::SYCLBuffer<T>>(M * N, q);
+
+	oneapi::mkl::blas::row_major::gemm(
+		q,
+		oneapi::mkl::transpose::nontrans,
+		oneapi::mkl::transpose::trans,
+		static_cast<int64_t>(M),
+		static_cast<int64_t>(N),
+		static_cast<int64_t>(K),
+		T(1.0),
+		a.device_buffer()->device_ptr(), static_cast<int64_t>(K),
+		b.device_buffer()->device_ptr(), static_cast<int64_t>(K),
+		T(0.0),
+		result_buf->device_ptr(), static_cast<int64_t>(N)
+	).wait();
+
+	return make_device_tensor(result_buf, result_shape);
+}
+
 } // namespace tensor
 
 #endif // USE_SYCL
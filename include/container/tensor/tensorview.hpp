@@ -14,7 +14,7 @@ namespace tensor {
 		std::vector<size_t> shape;
 		std::shared_ptr<std::vector<T>> data_ptr;
 		std::vector<size_t> strides;
-		size_t offset;
+		size_t offset = 0;
 
 	public:
 		TensorView(	const std::vector<size_t>& shape, 
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "utils/kv_cache.hpp"
+
+#include <cstddef>
+
+// Causal GQA attention of new queries against a KV cache (CPU).
+// Online softmax over keys: no [heads, seq, total] scores or mask are materialized,
+// so scratch memory is O(head_dim) per thread regardless of context length.
+//
+// q:       [seq_len, num_heads, head_dim]          (RoPE already applied)
+// k, v:    [>= position_offset + seq_len, num_kv_heads, head_dim]  (cache rows)
+// out:     [seq_len, num_heads, head_dim]
+// Query i is at position position_offset + i and attends to keys 0..position_offset + i.
+// Query head h reads KV head h / (num_heads / num_kv_heads).
+void cached_attention_cpu(const float* q, const float* k, const float* v, float* out,
+						  size_t seq_len, size_t position_offset,
+						  size_t num_heads, size_t num_kv_heads, size_t head_dim,
+						  float scale);
+
+// Same over compressed cache rows. F16 rows are widened one key at a time; INT8
+// rows are read as int8 with the per-(token, head) scale folded into the score
+// (K) or the softmax weight (V), so nothing is dequantized up front.
+void cached_attention_cpu(const float* q, const KVCacheView& k, const KVCacheView& v, float* out,
+						  size_t seq_len, size_t position_offset,
+						  size_t num_heads, size_t num_kv_heads, size_t head_dim,
+						  float scale);
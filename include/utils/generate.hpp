@@ -3,16 +3,126 @@
 #include "container/layer/llama.hpp"
 #include <vector>
 #include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <functional>
+
+class PrefixCache;
 
 struct GenerationConfig {
 	size_t max_new_tokens = 128;
 	float temperature = 1.0f;
 	bool do_sample = false;  // false = greedy (argmax), true = sampling
 	int eos_token_id = 128009;  // <|eot_id|> for Llama 3.2
+
+	// Sampling filters (see Sampler), applied in this order after temperature
+	size_t top_k = 0;        // keep the k most likely tokens (0 = off)
+	float top_p = 1.0f;      // nucleus: smallest set with cumulative prob >= top_p (1 = off)
+	float min_p = 0.0f;      // drop tokens with prob < min_p * max prob (0 = off)
+
+	// Penalties over the context (prompt + generated tokens)
+	float repetition_penalty = 1.0f;  // logit / p if positive, * p if negative (1 = off)
+	float frequency_penalty = 0.0f;   // logit -= f * count
+	float presence_penalty = 0.0f;    // logit -= p if the token appeared
+
+	uint64_t seed = 42;  // sampling RNG seed
+	PrefixCache* prefix_cache = nullptr;  // optional: reuse KV of previously seen prompt prefixes
+	size_t prefill_chunk_size = 256;  // prompt tokens per prefill pass (0 = whole prompt at once)
+	// KV cache storage for this generation (unset = keep the model's current format).
+	// INT8 stores a quarter of f32's bytes per token; see utils/kv_cache.hpp.
+	std::optional<KVCacheFormat> kv_cache_format;
+	// Streaming KV cache for this generation (streaming_window = 0: keep the model's
+	// current setting): attention_sinks first tokens + a window of the latest
+	// streaming_window tokens, so arbitrarily long outputs run in constant memory.
+	// See LlamaForCausalLM::set_streaming.
+	size_t attention_sinks = 4;
+	size_t streaming_window = 0;
+
+	// Speculative decoding: draft model (same vocab) proposes tokens, target verifies them
+	LlamaForCausalLM* draft_model = nullptr;
+	size_t num_draft_tokens = 4;  // k tokens proposed per round
+
+	// Beam search (num_beams > 1, see beam_search); the sampling fields above are ignored
+	size_t num_beams = 1;
+	float length_penalty = 1.0f;  // score = log prob / generated_len^length_penalty
+	bool early_stopping = false;  // stop once num_beams hypotheses have finished
+	size_t num_return_sequences = 1;  // hypotheses returned by beam_search (<= num_beams)
+};
+
+struct SpeculativeStats {
+	size_t draft_tokens = 0;     // tokens proposed by the draft model
+	size_t accepted_tokens = 0;  // proposed tokens accepted by the target model
+	size_t target_forwards = 0;  // target forward passes (prefill + verification rounds)
+
+	double acceptance_rate() const {
+		return draft_tokens == 0 ? 0.0 : static_cast<double>(accepted_tokens) / draft_tokens;
+	}
 };
 
-// Generate token IDs autoregressively
+// Timing of one generate_stream call. Per-token latency is the forward + sampling time
+// of each decode step; time spent in the token callback is excluded throughout.
+struct GenerationStats {
+	size_t prompt_tokens = 0;
+	size_t prefill_tokens = 0;     // prompt tokens run through the model (excludes prefix cache hits)
+	size_t generated_tokens = 0;
+	double time_to_first_token_ms = 0.0;  // cache restore + prefill + first sample
+	double decode_ms = 0.0;               // sum of token_latencies_ms
+	std::vector<double> token_latencies_ms;  // one per token after the first
+	bool cancelled = false;               // the callback stopped generation
+
+	double prefill_tokens_per_sec() const {
+		return time_to_first_token_ms > 0.0 ? prefill_tokens * 1000.0 / time_to_first_token_ms : 0.0;
+	}
+	double decode_tokens_per_sec() const {
+		return decode_ms > 0.0 ? token_latencies_ms.size() * 1000.0 / decode_ms : 0.0;
+	}
+	// Nearest-rank percentile of token_latencies_ms, p in [0, 100]
+	double latency_percentile(double p) const;
+};
+
+// One finished beam search hypothesis
+struct BeamHypothesis {
+	std::vector<int> tokens;  // generated tokens (ends with eos if the beam finished)
+	double log_prob = 0.0;    // summed log-probability of tokens
+	double score = 0.0;       // log_prob / tokens.size()^length_penalty
+};
+
+// Receives each token as soon as it is sampled (eos included); return false to cancel.
+// Use IncrementalDetokenizer (utils/tokenizer.hpp) to turn the ids into printable text.
+using TokenCallback = std::function<bool(int token)>;
+
+// Generate token IDs autoregressively (beam search if config.num_beams > 1)
 // Returns only the generated tokens (not including the prompt)
 std::vector<int> generate(LlamaForCausalLM& model,
 						  const std::vector<int>& prompt_ids,
 						  const GenerationConfig& config = {});
+
+// generate() that hands every token to on_token as it is produced and can be cancelled
+// from it. Returns the tokens produced (including the one the callback rejected).
+// Speculative decoding (config.draft_model) is not supported here.
+std::vector<int> generate_stream(LlamaForCausalLM& model,
+								 const std::vector<int>& prompt_ids,
+								 const TokenCallback& on_token,
+								 const GenerationConfig& config = {},
+								 GenerationStats* stats = nullptr);
+
+// Beam search over config.num_beams beams, batched into one forward per step. Beams
+// share the KV rows of their common prefix (LlamaForCausalLM::reorder_cache), so
+// switching parents copies no K/V. Each step keeps the num_beams best continuations
+// among the top 2 * num_beams tokens of every beam; a beam ending in eos becomes a
+// hypothesis. Stops when num_beams hypotheses are finished and (unless early_stopping)
+// no running beam can still beat the worst of them, or after max_new_tokens.
+// Returns the config.num_return_sequences best hypotheses, best first. The prompt is
+// restored from config.prefix_cache if given; the KV cache is reset afterwards.
+std::vector<BeamHypothesis> beam_search(LlamaForCausalLM& model,
+										const std::vector<int>& prompt_ids,
+										const GenerationConfig& config = {});
+
+// Speculative decoding: draft proposes num_draft_tokens per round, target verifies
+// them in one multi-token forward. Output distribution matches generate() on target
+// (identical tokens for greedy decoding).
+std::vector<int> generate_speculative(LlamaForCausalLM& target,
+									  LlamaForCausalLM& draft,
+									  const std::vector<int>& prompt_ids,
+									  const GenerationConfig& config = {},
+									  SpeculativeStats* stats = nullptr);
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Storage format of cached K / V rows.
+//   F32   4 bytes per element
+//   F16   2 bytes per element (IEEE half)
+//   INT8  1 byte per element + one fp32 scale per (token, kv head):
+//         symmetric absmax quantization, x ~= q * scale with q in [-127, 127]
+enum class KVCacheFormat {
+	F32,
+	F16,
+	INT8,
+};
+
+const char* kv_cache_format_name(KVCacheFormat format);
+// "f32" / "f16" / "int8"
+KVCacheFormat parse_kv_cache_format(const std::string& name);
+
+// Read-only view of one batch entry's cached rows, [len, num_kv_heads, head_dim],
+// passed to cached_attention_cpu which dequantizes inside its inner loops
+struct KVCacheView {
+	KVCacheFormat format = KVCacheFormat::F32;
+	const void* data = nullptr;
+	const float* scales = nullptr;  // INT8: [len, num_kv_heads]
+	// Optional indirection for entries sharing a prefix (beam search): key j is read from
+	// batch entry owners[j], entries being entry_stride rows apart. Null: key j is row j.
+	const uint32_t* owners = nullptr;
+	size_t entry_stride = 0;
+};
+
+// K or V rows of every cached token: [batch, capacity, num_kv_heads, head_dim] in one
+// KVCacheFormat. Rows are quantized once when written (on append) and only read
+// through views afterwards.
+class KVCacheStore {
+private:
+	KVCacheFormat format = KVCacheFormat::F32;
+	size_t batch = 0;
+	size_t capacity = 0;
+	size_t num_kv_heads = 0;
+	size_t head_dim = 0;
+	std::vector<uint8_t> data;
+	std::vector<float> scales;
+
+	size_t row_index(size_t b, size_t pos) const { return b * capacity + pos; }
+
+public:
+	KVCacheStore() = default;
+	KVCacheStore(KVCacheFormat format, size_t batch, size_t capacity, size_t num_kv_heads, size_t head_dim);
+
+	// Reallocate to new_capacity tokens, keeping the first len rows of every batch entry
+	void grow(size_t new_capacity, size_t len) { resize(batch, new_capacity, len); }
+	// Same with new_batch entries: entries beyond the old batch start out empty
+	void resize(size_t new_batch, size_t new_capacity, size_t len);
+
+	// row: num_kv_heads * head_dim floats
+	void write_row(size_t b, size_t pos, const float* row);
+	// Dequantized rows [start, start + len) of batch entry b
+	void read_rows(size_t b, size_t start, size_t len, float* out) const;
+	// F32 only: row storage to write in place
+	float* f32_row(size_t b, size_t pos);
+
+	// Rows of batch entry b from slot start on
+	KVCacheView view(size_t b, size_t start = 0) const;
+	// Key j read from batch entry owners[j] (owners outlives the view)
+	KVCacheView shared_view(const uint32_t* owners) const;
+
+	bool empty() const { return capacity == 0; }
+	KVCacheFormat get_format() const { return format; }
+	size_t get_batch() const { return batch; }
+	size_t get_capacity() const { return capacity; }
+	// Storage of one token of one batch entry (all kv heads, including scales)
+	size_t bytes_per_token() const;
+	static size_t bytes_per_token(KVCacheFormat format, size_t num_kv_heads, size_t head_dim);
+	// Allocated bytes
+	size_t nbytes() const { return data.size() + scales.size() * sizeof(float); }
+};
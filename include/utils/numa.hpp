@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// NUMA node and the CPUs of it this process may run on
+struct NumaNode {
+	int id = 0;
+	std::vector<int> cpus;
+};
+
+// Nodes from /sys/devices/system/node, restricted to the process' CPU affinity.
+// Without node information (non-NUMA kernels, containers hiding sysfs) this is a
+// single node 0 holding every allowed CPU.
+std::vector<NumaNode> numa_nodes();
+
+// "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11} (sysfs cpulist format)
+std::vector<int> parse_cpu_list(const std::string& list);
+
+// Restrict the calling thread to cpus. Threads it creates afterwards (e.g. its
+// OpenMP team) inherit the mask. Returns false if the kernel refused.
+bool pin_current_thread(const std::vector<int>& cpus);
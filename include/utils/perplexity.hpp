@@ -0,0 +1,47 @@
+#pragma once
+
+#include "container/layer/llama.hpp"
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+// Strided sliding-window evaluation: the first window runs context_len tokens, every
+// later one moves on by `stride` tokens. Every token but the first is scored exactly
+// once, conditioned on at least context_len - stride preceding tokens (all of them
+// while the text fits into the first window).
+struct PerplexityConfig {
+	size_t context_len = 512;  // tokens in the KV cache per window (<= max_position_embeddings)
+	size_t stride = 256;       // new tokens per window after the first (<= context_len)
+	// true: keep the overlap in the KV cache (LlamaForCausalLM::shift_cache) and run only
+	// the new tokens. false: recompute every window from scratch (HF-style), which runs
+	// about context_len / stride times as many tokens. Both agree for one-layer models.
+	bool reuse_cache = true;
+	size_t max_tokens = 0;     // evaluate only the first max_tokens tokens (0 = all)
+	size_t lm_head_rows = 64;  // positions per lm_head GEMM (bounds the logits buffer)
+};
+
+struct PerplexityResult {
+	double nll = 0.0;            // summed negative log-likelihood of the scored tokens (nats)
+	size_t scored_tokens = 0;
+	size_t forwarded_tokens = 0; // tokens run through the model
+	size_t windows = 0;
+	double elapsed_ms = 0.0;
+
+	double mean_nll() const { return scored_tokens == 0 ? 0.0 : nll / scored_tokens; }
+	double perplexity() const;
+	double tokens_per_sec() const {
+		return elapsed_ms <= 0.0 ? 0.0 : scored_tokens * 1000.0 / elapsed_ms;
+	}
+};
+
+// Called after every window with the running totals
+using PerplexityCallback = std::function<void(const PerplexityResult&)>;
+
+// log p(target) of one row of logits: log-softmax evaluated at the target only
+// (max and sum of exponentials in two passes over the row, nothing materialized)
+double target_log_prob(const float* logits, size_t vocab_size, int target);
+
+// Perplexity of `tokens` under `model` (CPU inference). Resets the model's KV cache.
+PerplexityResult evaluate_perplexity(LlamaForCausalLM& model, const std::vector<int>& tokens,
+									 const PerplexityConfig& config = PerplexityConfig(),
+									 const PerplexityCallback& on_window = nullptr);
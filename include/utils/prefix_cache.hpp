@@ -0,0 +1,54 @@
+#pragma once
+
+#include "container/layer/llama.hpp"
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+// Prompt-prefix KV cache shared across generate() calls.
+// A radix tree over fixed-size token blocks: each node owns the per-layer
+// K/V of one block, so a path from the root is a cached prefix.
+// Least recently used leaves are evicted once memory exceeds the budget.
+class PrefixCache {
+private:
+	struct Node {
+		std::vector<int> tokens;                 // [block_size]
+		std::vector<std::vector<float>> k;       // per layer: [block_size, kv_stride]
+		std::vector<std::vector<float>> v;
+		Node* parent = nullptr;
+		std::unordered_map<uint64_t, std::unique_ptr<Node>> children;  // keyed by block hash
+		uint64_t key = 0;
+		uint64_t last_used = 0;
+		size_t bytes = 0;
+	};
+
+	size_t block_size;
+	size_t memory_budget;   // bytes
+	size_t memory_used = 0;
+	size_t block_count = 0;
+	uint64_t use_tick = 0;
+	Node root;
+
+	uint64_t hash_block(const int* ids) const;
+	Node* find_child(Node* node, const int* ids) const;
+	void evict();
+
+public:
+	explicit PrefixCache(size_t block_size = 16, size_t memory_budget = size_t(512) << 20);
+
+	// Reset model cache and load the longest cached prefix of token_ids
+	// (at most max_tokens tokens). Returns the number of tokens restored.
+	size_t restore(LlamaForCausalLM& model, const std::vector<int>& token_ids, size_t max_tokens);
+
+	// Store the model's current KV for the full blocks of token_ids
+	void insert(const LlamaForCausalLM& model, const std::vector<int>& token_ids);
+
+	void clear();
+
+	size_t get_block_size() const { return block_size; }
+	size_t memory_usage() const { return memory_used; }
+	size_t num_blocks() const { return block_count; }
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+// Row-wise RMSNorm kernels for CPU inference (no autograd graph).
+// Each row of `hidden` floats is normalized independently; rows run in parallel.
+
+// out = x / sqrt(mean(x^2) + eps) * weight
+void rmsnorm_cpu(const float* x, const float* weight, float* out,
+				 size_t rows, size_t hidden, float eps);
+
+// residual += delta, then out = rmsnorm(residual) * weight.
+// Fuses the decoder's residual add with the following norm: each row is read
+// once for the add + sum of squares and once more for the scaled write.
+void add_rmsnorm_cpu(float* residual, const float* delta, const float* weight, float* out,
+					 size_t rows, size_t hidden, float eps);
@@ -13,6 +13,13 @@ std::pair<Tensor<>, Tensor<>> precompute_rope_frequencies(
 	size_t max_seq_len,
 	float theta = 500000.0f);
 
+// One row of those tables for any position (angles in double precision), for
+// positions past a precomputed table, e.g. a streaming KV cache that runs on
+// indefinitely. Negative positions rotate backwards.
+// cos_row, sin_row: [head_dim]
+void rope_frequencies_row(double position, size_t head_dim, float theta,
+						  float* cos_row, float* sin_row);
+
 // Apply RoPE to a tensor
 // x: [batch, seq_len, num_heads, head_dim]
 // cos_cache, sin_cache: [max_seq_len, head_dim] (from precompute_rope_frequencies)
@@ -22,3 +29,11 @@ Variable apply_rope(const Variable& x,
 					const Tensor<>& cos_cache,
 					const Tensor<>& sin_cache,
 					size_t position_offset = 0);
+
+// Rotate the heads of one token (CPU). out may alias x, so callers can apply
+// RoPE in place or while copying a projection row into its destination
+// (e.g. straight into the KV cache).
+// x, out: [num_heads, head_dim]
+// cos_row, sin_row: the tables' row for this token's position
+void rope_rotate_row(const float* x, float* out, size_t num_heads, size_t head_dim,
+					 const float* cos_row, const float* sin_row);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <random>
+#include <cstddef>
+#include <cstdint>
+
+struct GenerationConfig;
+
+// Index of the largest element (first one on ties). AVX2 when the CPU supports it.
+int argmax_f32(const float* x, size_t n);
+
+// out[i] = exp((x[i] - max) * scale). AVX2 polynomial exp when the CPU supports it.
+void exp_shifted_f32(const float* x, float max, float scale, float* out, size_t n);
+
+// Per-sequence token sampler for generate().
+// Order: penalties -> temperature -> top-k -> top-p -> min-p, then one draw.
+// Top-k uses a size-k heap, full-vocab top-p a logit histogram: neither sorts the vocab.
+// Scratch buffers are kept between calls, so a step allocates nothing once warmed up.
+class Sampler {
+private:
+	float temperature;
+	bool greedy;
+	size_t top_k;               // 0 = disabled
+	float top_p;                // 1 = disabled
+	float min_p;                // 0 = disabled
+	float repetition_penalty;   // 1 = disabled
+	float frequency_penalty;    // 0 = disabled
+	float presence_penalty;     // 0 = disabled
+
+	std::mt19937 rng;
+
+	// Token history (prompt + generated) for penalties
+	std::vector<int> counts;    // [vocab], grown on demand
+	std::vector<int> seen;      // tokens with counts > 0
+
+	// Scratch
+	std::vector<float> penalized;     // [vocab]
+	std::vector<float> all_weights;   // [vocab] exp((logit - max) / T)
+	std::vector<int> candidates;      // kept token ids
+	std::vector<float> weights;       // unnormalized probs of candidates
+	std::vector<int> boundary;        // tokens of the histogram bucket a cut falls in
+	std::vector<float> bucket_mass;
+
+	bool has_penalties() const;
+	const float* apply_penalties(const float* logits, size_t vocab_size);
+	// Fills candidates/weights with the filtered (unnormalized) distribution; returns weight sum
+	float build_candidates(const float* logits, size_t vocab_size);
+
+public:
+	explicit Sampler(const GenerationConfig& config);
+
+	bool is_greedy() const { return greedy; }
+
+	// Next token for logits[vocab_size]. Does not record it: call accept() for that.
+	int sample(const float* logits, size_t vocab_size);
+
+	// Full-vocab distribution the sampler draws from (zeros outside the kept set).
+	// Sampling mode only; used by speculative decoding for the p/q acceptance test.
+	void distribution(const float* logits, size_t vocab_size, std::vector<float>& probs);
+	int sample_from(const std::vector<float>& probs);
+	float uniform();
+
+	// Token history for penalties
+	void accept(int token);
+	void forget(int token);  // undo one accept() (e.g. rejected draft token)
+	void reset();
+};
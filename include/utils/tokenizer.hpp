@@ -1,20 +1,44 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <list>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <utility>
 
 class LlamaTokenizer {
 private:
-	// Vocabulary: token string -> id
-	std::unordered_map<std::string, int> vocab;
-	// Reverse vocabulary: id -> token string
-	std::vector<std::string> id_to_token;
-	// BPE merge rules: (pair) -> rank (lower rank = higher priority)
-	std::unordered_map<std::string, int> merge_ranks;
-	// Ordered merge pairs for BPE
-	std::vector<std::pair<std::string, std::string>> merges;
+	// BPE merge rule: (left id, right id) -> (rank, merged id), lower rank = higher
+	// priority. Flat open-addressing table with linear probing; key is left << 32 | right.
+	struct MergeEntry {
+		uint64_t key;
+		int32_t rank;
+		int32_t merged_id;
+	};
+
+	// Everything encode / decode reads lives in one flat image, laid out exactly as the
+	// binary cache file (see save_binary): token strings in an arena, a hash table of
+	// ids for string -> id lookups, the merge table and the byte -> id table.
+	// load() builds the image in memory from tokenizer.json; a binary cache is
+	// memory-mapped and used in place.
+	std::vector<uint8_t> owned_image;
+	const uint8_t* mapped_image = nullptr;
+	size_t mapped_size = 0;
+
+	// Views into the image
+	size_t num_tokens = 0;
+	const uint32_t* token_offsets = nullptr;  // [num_tokens + 1] into arena
+	const char* arena = nullptr;
+	const int32_t* vocab_table = nullptr;     // id per slot, -1 = empty
+	size_t vocab_mask = 0;
+	const MergeEntry* merge_table = nullptr;
+	size_t merge_mask = 0;
+	size_t num_merges = 0;
+	const int32_t* byte_ids = nullptr;        // raw byte -> id of its single-byte token, -1 if missing
 
 	// Special token IDs
 	int bos_token_id = -1;
@@ -26,21 +50,71 @@ private:
 	// Reverse: unicode string -> raw byte
 	std::unordered_map<std::string, unsigned char> token_to_byte;
 
+	// LRU cache of pre-token bytes -> ids, split into shards by hash so encode_batch
+	// threads rarely wait on each other. Index keys view the strings held by the list
+	// nodes, which never move.
+	using CacheList = std::list<std::pair<std::string, std::vector<int>>>;
+	struct CacheShard {
+		std::mutex mutex;
+		CacheList lru;
+		std::unordered_map<std::string_view, CacheList::iterator> index;
+		size_t hits = 0;
+		size_t misses = 0;
+	};
+	static constexpr size_t CACHE_SHARDS = 16;
+	size_t cache_capacity = 16384;
+	mutable std::array<CacheShard, CACHE_SHARDS> cache;
+
 	void init_byte_to_token();
-	std::string merge_key(const std::string& a, const std::string& b) const;
+	void release_image();
+	// Point the views at an image; throws if it is truncated or inconsistent
+	void attach_image(const uint8_t* image, size_t size, const std::string& source);
+	void load_json(const std::string& tokenizer_json_path);
+	void load_binary(const std::string& path);
+
+	const MergeEntry* find_merge(int left, int right) const;
+	std::string_view token_string(int id) const;
+	// Id of a token string, -1 if not in the vocab
+	int find_token(std::string_view token) const;
 
-	// BPE algorithm: merge tokens according to merge rules
-	std::vector<std::string> bpe(const std::vector<std::string>& tokens) const;
+	// BPE algorithm: merge the byte tokens of one pre-token according to merge ranks
+	void bpe(std::string_view pretoken, std::vector<int>& out) const;
+	// Encode one pre-token through the cache
+	void encode_pretoken(std::string_view pretoken, std::vector<int>& out) const;
 
 public:
 	LlamaTokenizer() = default;
+	~LlamaTokenizer();
+	LlamaTokenizer(const LlamaTokenizer&) = delete;
+	LlamaTokenizer& operator=(const LlamaTokenizer&) = delete;
 
-	// Load from HuggingFace tokenizer.json
-	void load(const std::string& tokenizer_json_path);
+	// Load from HuggingFace tokenizer.json, or from a binary cache written by save_binary
+	// (recognized by its magic)
+	void load(const std::string& path);
+
+	// Load tokenizer.json through the binary cache at cache_path (default: json path +
+	// ".bin"). The cache is used while it matches the json's size and mtime; otherwise
+	// the json is parsed and the cache (re)written.
+	void load_cached(const std::string& tokenizer_json_path, const std::string& cache_path = "");
+
+	// Write the loaded tokenizer as a binary cache
+	void save_binary(const std::string& path) const;
+
+	// True if the tokenizer came from a memory-mapped binary cache
+	bool is_mapped() const { return mapped_image != nullptr; }
 
 	// Encode text to token IDs
 	std::vector<int> encode(const std::string& text) const;
 
+	// Encode many texts in parallel (OpenMP); num_threads 0 uses the OpenMP default
+	std::vector<std::vector<int>> encode_batch(const std::vector<std::string>& texts, int num_threads = 0) const;
+
+	// Split text the way the Llama 3 pre-tokenizer regex does:
+	//   (?i:'s|'t|'re|'ve|'m|'ll|'d)|[^\r\n\p{L}\p{N}]?\p{L}+|\p{N}{1,3}|
+	//    ?[^\s\p{L}\p{N}]+[\r\n]*|\s*[\r\n]+|\s+(?!\S)|\s+
+	// Pieces view text. Letter / number classes follow Unicode for the common scripts.
+	static std::vector<std::string_view> pretokenize(std::string_view text);
+
 	// Decode token IDs to text
 	std::string decode(const std::vector<int>& ids) const;
 
@@ -51,9 +125,37 @@ public:
 	// Decode a single token
 	std::string decode_token(int id) const;
 
+	// Pre-token cache: 0 disables it (and drops its entries)
+	void set_cache_capacity(size_t capacity);
+	size_t get_cache_capacity() const { return cache_capacity; }
+	size_t get_cache_hits() const;
+	size_t get_cache_misses() const;
+	void clear_cache();
+
 	// Getters
 	int get_bos_token_id() const { return bos_token_id; }
 	int get_eos_token_id() const { return eos_token_id; }
 	int get_eot_token_id() const { return eot_token_id; }
-	size_t vocab_size() const { return id_to_token.size(); }
+	size_t vocab_size() const { return num_tokens; }
+	size_t merges_size() const { return num_merges; }
+};
+
+// Turns a stream of token ids into text that is safe to print as it arrives. A UTF-8
+// character split across tokens is held back until its last byte shows up, so every
+// returned piece consists of whole characters.
+class IncrementalDetokenizer {
+private:
+	const LlamaTokenizer& tokenizer;
+	std::string pending;  // bytes of an incomplete trailing character
+
+public:
+	explicit IncrementalDetokenizer(const LlamaTokenizer& tokenizer) : tokenizer(tokenizer) {}
+
+	// Text completed by this token (may be empty)
+	std::string push(int id);
+	// End of stream: whatever is still held, an incomplete character as U+FFFD
+	std::string flush();
+	void reset() { pending.clear(); }
+	// Bytes currently held back
+	size_t pending_bytes() const { return pending.size(); }
 };
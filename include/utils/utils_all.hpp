@@ -4,6 +4,13 @@
 #include "utils/io.hpp"
 #include "utils/preprocess.hpp"
 #include "utils/rope.hpp"
+#include "utils/kv_cache.hpp"
+#include "utils/attention.hpp"
+#include "utils/rmsnorm.hpp"
 #include "utils/tokenizer.hpp"
 #include "utils/generate.hpp"
-#include "utils/eval_metrics.hpp"
\ No newline at end of file
+#include "utils/sampler.hpp"
+#include "utils/prefix_cache.hpp"
+#include "utils/perplexity.hpp"
+#include "utils/eval_metrics.hpp"
+#include "utils/numa.hpp"
\ No newline at end of file
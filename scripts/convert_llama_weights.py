@@ -1,15 +1,26 @@
 #!/usr/bin/env python3
 """
 Convert Llama 3.2 1B Instruct weights from HuggingFace safetensors (bfloat16)
-to numpy NPZ (float32) for DeepCZero framework.
+to numpy NPZ (float32 by default) for DeepCZero framework.
 
 Usage:
     pip install safetensors torch transformers numpy
     python scripts/convert_llama_weights.py meta-llama/Llama-3.2-1B-Instruct
     python scripts/convert_llama_weights.py /path/to/local/Llama-3.2-1B-Instruct
+    python scripts/convert_llama_weights.py meta-llama/Llama-3.2-1B-Instruct --dtype bf16
 
 Output: ~/.deepczero/weights/llama-3.2-1b-instruct.npz
 
+--dtype bf16 / f16 keeps 16-bit storage (half the size, bf16 is bit-exact to
+the checkpoint). Projections are written as "*_proj.W_bf16" / "*_proj.W_f16"
+in the HF [out, in] layout, which Linear loads directly as packed rows; the
+embedding becomes "model.embed_tokens.W_bf16" / "_f16" [vocab, hidden].
+bf16 has no numpy dtype, so it is stored as its raw uint16 bits. Norms stay fp32.
+
+A local checkpoint directory does not need converting at all:
+LlamaForCausalLM::load_weights() memory-maps model.safetensors (or the shards
+of model.safetensors.index.json) directly, keeping the stored dtype.
+
 Note: For gated models, you need to authenticate:
     huggingface-cli login
 """
@@ -19,7 +30,15 @@ import os
 import numpy as np
 
 
-def convert_llama(model_id, output_path=None):
+def half_array(tensor, dtype):
+    """torch tensor -> numpy array with 16-bit storage (bf16 as raw uint16 bits)"""
+    import torch
+    if dtype == "bf16":
+        return tensor.cpu().to(torch.bfloat16).view(torch.int16).numpy().view(np.uint16)
+    return tensor.cpu().to(torch.float16).numpy()
+
+
+def convert_llama(model_id, output_path=None, dtype="f32"):
     try:
         from transformers import AutoModelForCausalLM, AutoTokenizer
         import torch
@@ -32,7 +51,8 @@ def convert_llama(model_id, output_path=None):
     if output_path is None:
         cache_dir = os.path.join(os.path.expanduser("~"), ".deepczero", "weights")
         os.makedirs(cache_dir, exist_ok=True)
-        output_path = os.path.join(cache_dir, "llama-3.2-1b-instruct.npz")
+        suffix = "" if dtype == "f32" else "-" + dtype
+        output_path = os.path.join(cache_dir, f"llama-3.2-1b-instruct{suffix}.npz")
 
     # Save tokenizer.json
     tokenizer_out = os.path.join(os.path.dirname(output_path), "tokenizer.json")
@@ -45,9 +65,10 @@ def convert_llama(model_id, output_path=None):
         print(f"Tokenizer already exists: {tokenizer_out}")
 
     print(f"Loading model: {model_id}")
+    # bf16 is the checkpoint dtype: load it as-is so nothing is rounded twice
     model = AutoModelForCausalLM.from_pretrained(
         model_id,
-        torch_dtype=torch.float32,
+        torch_dtype=torch.bfloat16 if dtype == "bf16" else torch.float32,
         device_map="cpu",
     )
 
@@ -57,6 +78,8 @@ def convert_llama(model_id, output_path=None):
     out = {}
     skipped = 0
 
+    half = dtype in ("bf16", "f16")
+
     for key, tensor in sd.items():
         arr = tensor.cpu().float().numpy()
 
@@ -72,6 +95,9 @@ def convert_llama(model_id, output_path=None):
         # Keep shape [vocab_size, hidden_size] as-is for gather_rows lookup
         if key == "model.embed_tokens.weight":
             npz_key = "model.embed_tokens.W"
+            if half:
+                npz_key += "_" + dtype
+                arr = half_array(tensor, dtype)
             # No transpose needed - gather_rows selects rows
             out[npz_key] = arr
             print(f"  {key:60s} -> {npz_key:60s}  shape={list(arr.shape)}")
@@ -96,6 +122,14 @@ def convert_llama(model_id, output_path=None):
         # Linear weight: *.{q,k,v,o,gate,up,down}_proj.weight -> *.W
         # DeepCZero Linear does x @ W, HF stores [out_features, in_features]
         # So we transpose: [out, in] -> [in, out]
+        if key.endswith("_proj.weight") and half:
+            # 16-bit: keep the [out, in] row layout, loaded as packed rows
+            npz_key = key.replace(".weight", ".W_" + dtype)
+            arr = half_array(tensor, dtype)
+            out[npz_key] = arr
+            print(f"  {key:60s} -> {npz_key:60s}  shape={list(arr.shape)} ({dtype})")
+            continue
+
         if key.endswith("_proj.weight"):
             npz_key = key.replace(".weight", ".W")
             arr = arr.T  # Transpose for DeepCZero convention
@@ -124,15 +158,30 @@ def convert_llama(model_id, output_path=None):
     loaded = np.load(output_path)
     print(f"  Keys in npz: {len(loaded.files)}")
 
-    expected = [
-        ("model.embed_tokens.W", (128256, 2048)),
-        ("model.layers.0.self_attn.q_proj.W", (2048, 2048)),
-        ("model.layers.0.self_attn.k_proj.W", (2048, 512)),
-        ("model.layers.0.self_attn.v_proj.W", (2048, 512)),
-        ("model.layers.0.self_attn.o_proj.W", (2048, 2048)),
-        ("model.layers.0.mlp.gate_proj.W", (2048, 8192)),
-        ("model.layers.0.mlp.up_proj.W", (2048, 8192)),
-        ("model.layers.0.mlp.down_proj.W", (8192, 2048)),
+    if half:
+        suffix = "_" + dtype
+        expected = [
+            ("model.embed_tokens.W" + suffix, (128256, 2048)),
+            ("model.layers.0.self_attn.q_proj.W" + suffix, (2048, 2048)),
+            ("model.layers.0.self_attn.k_proj.W" + suffix, (512, 2048)),
+            ("model.layers.0.self_attn.v_proj.W" + suffix, (512, 2048)),
+            ("model.layers.0.self_attn.o_proj.W" + suffix, (2048, 2048)),
+            ("model.layers.0.mlp.gate_proj.W" + suffix, (8192, 2048)),
+            ("model.layers.0.mlp.up_proj.W" + suffix, (8192, 2048)),
+            ("model.layers.0.mlp.down_proj.W" + suffix, (2048, 8192)),
+        ]
+    else:
+        expected = [
+            ("model.embed_tokens.W", (128256, 2048)),
+            ("model.layers.0.self_attn.q_proj.W", (2048, 2048)),
+            ("model.layers.0.self_attn.k_proj.W", (2048, 512)),
+            ("model.layers.0.self_attn.v_proj.W", (2048, 512)),
+            ("model.layers.0.self_attn.o_proj.W", (2048, 2048)),
+            ("model.layers.0.mlp.gate_proj.W", (2048, 8192)),
+            ("model.layers.0.mlp.up_proj.W", (2048, 8192)),
+            ("model.layers.0.mlp.down_proj.W", (8192, 2048)),
+        ]
+    expected += [
         ("model.layers.0.input_layernorm.weight", (2048,)),
         ("model.layers.0.post_attention_layernorm.weight", (2048,)),
         ("model.norm.weight", (2048,)),
@@ -158,11 +207,21 @@ def convert_llama(model_id, output_path=None):
 
 
 if __name__ == "__main__":
-    if len(sys.argv) < 2:
-        print("Usage: python scripts/convert_llama_weights.py <model_id_or_path> [output_path]")
+    args = sys.argv[1:]
+    dtype = "f32"
+    if "--dtype" in args:
+        i = args.index("--dtype")
+        if i + 1 >= len(args) or args[i + 1] not in ("f32", "bf16", "f16"):
+            print("--dtype must be one of f32, bf16, f16")
+            sys.exit(1)
+        dtype = args[i + 1]
+        del args[i:i + 2]
+
+    if len(args) < 1:
+        print("Usage: python scripts/convert_llama_weights.py <model_id_or_path> [output_path] [--dtype f32|bf16|f16]")
         print("Example: python scripts/convert_llama_weights.py meta-llama/Llama-3.2-1B-Instruct")
         sys.exit(1)
 
-    model_id = sys.argv[1]
-    out = sys.argv[2] if len(sys.argv) > 2 else None
-    convert_llama(model_id, out)
+    model_id = args[0]
+    out = args[1] if len(args) > 1 else None
+    convert_llama(model_id, out, dtype)
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+Convert a Llama NPZ (scripts/convert_llama_weights.py, optionally
+scripts/quantize_llama_weights.py) into a DeepCZero tensor file (.dczt).
+
+LlamaForCausalLM::load_weights() memory-maps .dczt files: loading only reads
+the index, and projection / embedding rows are used straight from the page
+cache (shared by every process that maps the same file) instead of being
+inflated and copied like npz arrays.
+
+Layout written here (see include/container/tensor/tensor_file.hpp):
+    *_proj.W            [in, out] fp32  -> *_proj.W_f32 [out, in] f32 rows
+    *_proj.W_bf16/_f16  [out, in]       -> same name, bf16 / f16 dtype
+    *_proj.W_q8_0/...   uint8 rows      -> same name, u8 dtype
+    embed_tokens.W      [vocab, hidden] -> embed_tokens.W_f32 rows
+    q/k/v_proj and gate/up_proj of one format are concatenated into
+    self_attn.qkv_proj.W_<fmt> and mlp.gate_up_proj.W_<fmt> (the fused layout
+    LlamaAttention / LlamaMLP run), so no copy is needed at load time either.
+    lm_head.W           [hidden, vocab] -> lm_head.W_f32 [vocab, hidden] rows
+                                           (only in untied checkpoints)
+    Norms stay fp32.
+
+Usage:
+    python scripts/convert_npz_to_dczt.py <input.npz> [output.dczt]
+"""
+
+import sys
+import os
+import struct
+import numpy as np
+
+MAGIC = b"DCZT"
+VERSION = 1
+ALIGN = 64
+
+DTYPES = {"f32": 0, "f16": 1, "bf16": 2, "u8": 3}
+FORMATS = ("f32", "bf16", "f16", "q8_0", "q4_0", "q4_1")
+
+
+def _align(n):
+    return (n + ALIGN - 1) // ALIGN * ALIGN
+
+
+def _dtype_of(fmt, arr):
+    if fmt in ("f32", "bf16", "f16"):
+        return fmt
+    if arr.dtype != np.uint8:
+        raise ValueError(f"{fmt} rows must be uint8, got {arr.dtype}")
+    return "u8"
+
+
+def _split_format(key):
+    """'a.q_proj.W_q4_0' -> ('a.q_proj', 'q4_0'); None if not a packed weight"""
+    for fmt in FORMATS:
+        if key.endswith(".W_" + fmt):
+            return key[:-len(".W_" + fmt)], fmt
+    return None
+
+
+def collect(src):
+    """-> {name: (dtype, array)} with projections as packed rows"""
+    out = {}
+    for key in src.files:
+        arr = src[key]
+        if key.endswith("_proj.W") or key == "lm_head.W":
+            rows = np.ascontiguousarray(arr.T, dtype=np.float32)
+            out[key + "_f32"] = ("f32", rows)
+            continue
+        if key.endswith("embed_tokens.W"):
+            out[key + "_f32"] = ("f32", np.ascontiguousarray(arr, dtype=np.float32))
+            continue
+        packed = _split_format(key)
+        if packed is not None:
+            out[key] = (_dtype_of(packed[1], arr), np.ascontiguousarray(arr))
+            continue
+        if arr.dtype != np.float32:
+            raise ValueError(f"{key}: unsupported dtype {arr.dtype}")
+        out[key] = ("f32", np.ascontiguousarray(arr))
+    return out
+
+
+def fuse(tensors, parts, fused):
+    """Concatenate rows of <prefix>.<part>.W_<fmt> into <prefix>.<fused>.W_<fmt>"""
+    first = "." + parts[0] + ".W_"
+    for key in [k for k in tensors if first in k]:
+        prefix, fmt = key.split(first)
+        names = [f"{prefix}.{p}.W_{fmt}" for p in parts]
+        if not all(n in tensors for n in names):
+            continue
+        dtype = tensors[names[0]][0]
+        tensors[f"{prefix}.{fused}.W_{fmt}"] = (
+            dtype, np.concatenate([tensors.pop(n)[1] for n in names], axis=0))
+
+
+def write_dczt(tensors, output_path):
+    names = sorted(tensors)
+    header = len(MAGIC) + 4 + 8 + 8
+    for name in names:
+        header += 4 + len(name.encode()) + 4 + 4 + 8 * tensors[name][1].ndim + 16
+    data_offset = _align(header)
+
+    offsets, end = [], data_offset
+    for name in names:
+        offsets.append(end)
+        end = _align(end + tensors[name][1].nbytes)
+
+    with open(output_path, "wb") as f:
+        f.write(MAGIC + struct.pack("<IQQ", VERSION, len(names), data_offset))
+        for name, offset in zip(names, offsets):
+            dtype, arr = tensors[name]
+            encoded = name.encode()
+            f.write(struct.pack("<I", len(encoded)) + encoded)
+            f.write(struct.pack("<II", DTYPES[dtype], arr.ndim))
+            f.write(struct.pack(f"<{arr.ndim}Q", *arr.shape))
+            f.write(struct.pack("<QQ", offset, arr.nbytes))
+        for name, offset in zip(names, offsets):
+            f.write(b"\0" * (offset - f.tell()))
+            tensors[name][1].tofile(f)
+            print(f"  {name:60s} {tensors[name][0]:5s} shape={list(tensors[name][1].shape)}")
+        f.write(b"\0" * (end - f.tell()))
+    return end
+
+
+def convert(input_path, output_path):
+    print(f"Loading: {input_path}")
+    src = np.load(input_path)
+    tensors = collect(src)
+    fuse(tensors, ("q_proj", "k_proj", "v_proj"), "qkv_proj")
+    fuse(tensors, ("gate_proj", "up_proj"), "gate_up_proj")
+    print(f"Writing {len(tensors)} tensors to {output_path}")
+    size = write_dczt(tensors, output_path)
+    print(f"File size: {size / 1024 / 1024:.1f} MB")
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("Usage: python scripts/convert_npz_to_dczt.py <input.npz> [output.dczt]")
+        print("Example: python scripts/convert_npz_to_dczt.py "
+              "~/.deepczero/weights/llama-3.2-1b-instruct-q4_0.npz")
+        sys.exit(1)
+
+    input_path = sys.argv[1]
+    output_path = sys.argv[2] if len(sys.argv) > 2 else os.path.splitext(input_path)[0] + ".dczt"
+    convert(input_path, output_path)
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""
+Quantize the decoder projections of a converted Llama NPZ
+(scripts/convert_llama_weights.py) into DeepCZero packed block formats.
+
+Every "*_proj.W" ([in, out], fp32) is replaced by "*_proj.W_<format>":
+a uint8 array of shape [out, row_bytes] holding the packed rows exactly as
+tensor::PackedTensor stores them. 16-bit inputs ("*_proj.W_bf16" / "_f16",
+[out, in], from convert_llama_weights.py --dtype) are accepted as well.
+Linear::load_packed_from_npz picks these up, so LlamaForCausalLM::load_weights()
+needs no extra option. Embedding, norms and lm_head are copied unchanged.
+
+Formats (blocks of 32 weights along the input dimension):
+    q8_0  fp16 d + 32 x int8                     34 bytes / 32 weights
+    q4_0  fp16 d + 16 bytes of nibbles           18 bytes / 32 weights   w = d * (q - 8)
+    q4_1  fp16 d, fp16 m + 16 bytes of nibbles   20 bytes / 32 weights   w = d * q + m
+
+Usage:
+    python scripts/quantize_llama_weights.py <input.npz> <output.npz> [q4_0|q4_1|q8_0]
+"""
+
+import sys
+import os
+import numpy as np
+
+QK = 32
+
+
+def _fp16_bytes(x):
+    return x.astype(np.float16).view(np.uint8).reshape(x.shape[0], x.shape[1], 2)
+
+
+def _pack_nibbles(q):
+    # qs[j] low nibble = weight j, high nibble = weight j + 16
+    q = q.astype(np.uint8)
+    return q[..., :QK // 2] | (q[..., QK // 2:] << 4)
+
+
+def quantize_q8_0(blocks):
+    amax = np.abs(blocks).max(axis=-1)
+    d = (amax / np.float32(127.0)).astype(np.float32)
+    with np.errstate(divide="ignore"):
+        inv = np.where(d > 0, np.float32(1.0) / d, np.float32(0.0)).astype(np.float32)
+    v = blocks * inv[..., None]
+    q = (np.sign(v) * np.floor(np.abs(v) + np.float32(0.5))).astype(np.int8)  # lround
+    return np.concatenate([_fp16_bytes(d), q.view(np.uint8)], axis=-1)
+
+
+def quantize_q4_0(blocks):
+    idx = np.abs(blocks).argmax(axis=-1)
+    vmax = np.take_along_axis(blocks, idx[..., None], axis=-1)[..., 0]
+    d = (vmax / np.float32(-8.0)).astype(np.float32)
+    with np.errstate(divide="ignore"):
+        inv = np.where(d != 0, np.float32(1.0) / d, np.float32(0.0)).astype(np.float32)
+    q = np.minimum(15, np.floor(blocks * inv[..., None] + np.float32(8.5))).astype(np.int32)
+    return np.concatenate([_fp16_bytes(d), _pack_nibbles(q)], axis=-1)
+
+
+def quantize_q4_1(blocks):
+    vmin = blocks.min(axis=-1)
+    vmax = blocks.max(axis=-1)
+    d = ((vmax - vmin) / np.float32(15.0)).astype(np.float32)
+    with np.errstate(divide="ignore"):
+        inv = np.where(d != 0, np.float32(1.0) / d, np.float32(0.0)).astype(np.float32)
+    q = np.minimum(15, np.floor((blocks - vmin[..., None]) * inv[..., None] + np.float32(0.5))).astype(np.int32)
+    return np.concatenate([_fp16_bytes(d), _fp16_bytes(vmin), _pack_nibbles(q)], axis=-1)
+
+
+QUANTIZERS = {
+    "q8_0": quantize_q8_0,
+    "q4_0": quantize_q4_0,
+    "q4_1": quantize_q4_1,
+}
+
+
+def quantize_linear_weight(w, fmt):
+    """w: [in, out] fp32 (x @ W convention) -> uint8 [out, row_bytes]"""
+    rows = np.ascontiguousarray(w.T, dtype=np.float32)
+    out_features, in_features = rows.shape
+    if in_features % QK != 0:
+        raise ValueError(f"in_features={in_features} is not divisible by {QK}")
+    blocks = rows.reshape(out_features, in_features // QK, QK)
+    packed = QUANTIZERS[fmt](blocks)
+    return packed.reshape(out_features, -1)
+
+
+def half_rows_to_linear_weight(arr, dtype):
+    """[out, in] bf16 bits / fp16 -> [in, out] fp32"""
+    if dtype == "bf16":
+        rows = (arr.astype(np.uint32) << 16).view(np.float32)
+    else:
+        rows = arr.astype(np.float32)
+    return rows.T
+
+
+def quantize_npz(input_path, output_path, fmt="q4_0"):
+    if fmt not in QUANTIZERS:
+        print(f"Unknown format: {fmt} (expected one of {', '.join(QUANTIZERS)})")
+        sys.exit(1)
+
+    print(f"Loading: {input_path}")
+    src = np.load(input_path)
+    out = {}
+    fp32_bytes = 0
+    packed_bytes = 0
+
+    for key in src.files:
+        arr = src[key]
+        half = next((d for d in ("bf16", "f16") if key.endswith(f"_proj.W_{d}")), None)
+        if half is not None:
+            arr = half_rows_to_linear_weight(arr, half)
+            key = key[:-len(half) - 1]
+        if key.endswith("_proj.W") and not key.startswith("lm_head"):
+            packed = quantize_linear_weight(arr, fmt)
+            npz_key = f"{key}_{fmt}"
+            out[npz_key] = packed
+            fp32_bytes += arr.size * 4
+            packed_bytes += packed.size
+            print(f"  {key:60s} -> {npz_key:60s}  shape={list(packed.shape)}")
+        else:
+            out[key] = arr
+
+    print(f"\nProjections: {fp32_bytes / 1024 / 1024:.1f} MB fp32 -> "
+          f"{packed_bytes / 1024 / 1024:.1f} MB {fmt} ({fp32_bytes / max(packed_bytes, 1):.2f}x)")
+    print(f"Saving {len(out)} tensors to {output_path}")
+    np.savez(output_path, **out)
+    print(f"File size: {os.path.getsize(output_path) / 1024 / 1024:.1f} MB")
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 3:
+        print("Usage: python scripts/quantize_llama_weights.py <input.npz> <output.npz> [q4_0|q4_1|q8_0]")
+        print("Example: python scripts/quantize_llama_weights.py "
+              "~/.deepczero/weights/llama-3.2-1b-instruct.npz "
+              "~/.deepczero/weights/llama-3.2-1b-instruct-q4_0.npz q4_0")
+        sys.exit(1)
+
+    fmt = sys.argv[3] if len(sys.argv) > 3 else "q4_0"
+    quantize_npz(sys.argv[1], sys.argv[2], fmt)
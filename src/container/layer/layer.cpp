@@ -31,6 +31,8 @@ namespace layer {
 	}
 
 	Variable Layer::operator()(const std::vector<Variable>& inputs) {
+		// Only kept for a graph; inference leaves the (possibly shared) layer untouched
+		if (!dcz::Config::get().enable_backprop) return forward(inputs);
 		this->inputs = inputs;
 		this->output = forward(inputs);
 		return this->output;
@@ -43,8 +45,7 @@ namespace layer {
 
 
 	Variable Layer::operator()(const Variable& input) {
-		this->inputs = {input};
-		return (*this)({input});
+		return (*this)(std::vector<Variable>{input});
 	}
 
 	void Layer::cleargrads() {
@@ -304,6 +305,21 @@ namespace layer {
 		}
 	}
 
+	void Layer::load_params_from_file(const tensor::TensorFile& file, const std::string& layer_name) {
+		if (file.contains(layer_name + ".W"))
+			set_param_data("W", file.to_tensor(layer_name + ".W"));
+		if (file.contains(layer_name + ".b"))
+			set_param_data("b", file.to_tensor(layer_name + ".b"));
+	}
+
+	void Layer::save_params_to_file(tensor::TensorFileWriter& writer, const std::string& layer_name) const {
+		for (const char* name : {"W", "b"}) {
+			auto it = params.find(name);
+			if (it != params.end() && !it->second.data().empty())
+				writer.add(layer_name + "." + name, it->second.data());
+		}
+	}
+
 // [Linear]
 	Linear::Linear( size_t out_size, 
 					bool nobias,
@@ -333,6 +349,16 @@ namespace layer {
 		const Variable& x = xs[0];
 		const Parameter& W = get_param("W");
 		const Parameter& b = get_param("b");
+
+		if (packed) {
+			// Packed kernels run on CPU
+			if (x.is_device()) {
+				Tensor<> y = packed_linear(x.data().cpu(), *packed, b.data().empty() ? Tensor<>() : b.data().cpu());
+				return Variable(y.to(x.device()));
+			}
+			return Variable(packed_linear(x.data(), *packed, b.data()));
+		}
+
 		if (W.data().empty()) {
 			in_size = x.shape().back();
 			init_W();
@@ -356,6 +382,86 @@ namespace layer {
 	}
 
 
+	size_t Linear::pack_weight(tensor::PackedFormat format) {
+		if (packed) {
+			// Already packed (e.g. loaded pre-quantized): convert between formats
+			if (packed->get_format() == format) return packed->nbytes();
+			Tensor<> rows = packed->unpack();
+			packed = std::make_shared<tensor::PackedTensor>(tensor::PackedTensor::from_rows(
+				rows.raw_data().data(), packed->get_rows(), packed->get_cols(), format));
+			return packed->nbytes();
+		}
+		if (get_param("W").data().empty()) {
+			if (in_size == 0)
+				throw std::runtime_error("Linear::pack_weight: weight is not initialized");
+			init_W();
+		}
+		Tensor<> W_data = get_param("W").data();
+		if (W_data.is_device()) W_data = W_data.cpu();
+
+		packed = std::make_shared<tensor::PackedTensor>(
+			tensor::PackedTensor::from_linear_weight(W_data, format));
+		in_size = packed->get_cols();
+		params["W"].data() = Tensor<>();
+		return packed->nbytes();
+	}
+
+	void Linear::set_packed(std::shared_ptr<tensor::PackedTensor> weight) {
+		if (weight->get_rows() != out_size)
+			throw std::runtime_error("Linear::set_packed: expected " + std::to_string(out_size)
+									+ " rows, got " + std::to_string(weight->get_rows()));
+		packed = std::move(weight);
+		in_size = packed->get_cols();
+		params["W"].data() = Tensor<>();
+	}
+
+	bool Linear::load_packed_from_npz(const cnpy::npz_t& npz, const std::string& layer_name) {
+		for (tensor::PackedFormat format : {tensor::PackedFormat::BF16, tensor::PackedFormat::F16,
+											tensor::PackedFormat::Q8_0, tensor::PackedFormat::Q4_0,
+											tensor::PackedFormat::Q4_1}) {
+			auto it = npz.find(layer_name + ".W_" + tensor::packed_format_name(format));
+			if (it == npz.end()) continue;
+
+			const cnpy::NpyArray& arr = it->second;
+			if (arr.shape.size() != 2)
+				throw std::runtime_error("Linear::load_packed_from_npz: " + it->first + " must be 2D");
+			size_t rows = arr.shape[0];
+			size_t cols = tensor::PackedTensor::cols_for_row_bytes(format, arr.shape[1] * arr.word_size);
+			if (rows != out_size)
+				throw std::runtime_error("Linear::load_packed_from_npz: " + it->first + " has "
+										+ std::to_string(rows) + " rows, expected " + std::to_string(out_size));
+			if (in_size != 0 && cols != in_size)
+				throw std::runtime_error("Linear::load_packed_from_npz: " + it->first + " has "
+										+ std::to_string(cols) + " columns, expected " + std::to_string(in_size));
+
+			packed = std::make_shared<tensor::PackedTensor>(
+				tensor::PackedTensor::from_packed_bytes(arr.data<uint8_t>(), rows, cols, format));
+			in_size = cols;
+			params["W"].data() = Tensor<>();
+			return true;
+		}
+		return false;
+	}
+
+	void Linear::load_params_from_npz(const cnpy::npz_t& npz, const std::string& layer_name) {
+		// Packed W first; the base loader then only finds the bias
+		load_packed_from_npz(npz, layer_name);
+		Layer::load_params_from_npz(npz, layer_name);
+	}
+
+	void Linear::load_params_from_file(const tensor::TensorFile& file, const std::string& layer_name) {
+		if (auto weight = file.packed_weight(layer_name))
+			set_packed(weight);
+		Layer::load_params_from_file(file, layer_name);
+	}
+
+	void Linear::save_params_to_file(tensor::TensorFileWriter& writer, const std::string& layer_name) const {
+		if (packed)
+			writer.add(layer_name + ".W_" + tensor::packed_format_name(packed->get_format()), *packed);
+		Layer::save_params_to_file(writer, layer_name);
+	}
+
+
 	Conv2d::Conv2d(size_t out_channels,
 					std::pair<size_t, size_t> kernel_size,
 					std::pair<size_t, size_t> stride,
@@ -1,13 +1,17 @@
 #include "container/layer/llama.hpp"
+#include "container/layer/llama_parallel.hpp"
 #include "function/rmsnorm_functions.hpp"
 #include "function/ops/ops_all.hpp"
 #include "container/variable_ops.hpp"
 #include "utils/rope.hpp"
+#include "utils/attention.hpp"
+#include "utils/rmsnorm.hpp"
 #include "cnpy.h"
 
 #include "config/config.hpp"
 
 #include <cmath>
+#include <cstring>
 #include <iostream>
 #include <algorithm>
 #include <numeric>
@@ -38,6 +42,17 @@ Embedding::Embedding(size_t vocab_size, size_t embed_dim)
 }
 
 Variable Embedding::forward_ids(const std::vector<int>& token_ids) {
+	if (packed) {
+		std::vector<float> out(token_ids.size() * embed_dim);
+		for (size_t i = 0; i < token_ids.size(); ++i) {
+			if (token_ids[i] < 0 || static_cast<size_t>(token_ids[i]) >= packed->get_rows())
+				throw std::runtime_error("Embedding::forward_ids: token id " + std::to_string(token_ids[i])
+										+ " out of range");
+			packed->dequantize_row(static_cast<size_t>(token_ids[i]), out.data() + i * embed_dim);
+		}
+		return Variable(Tensor<>({1, token_ids.size(), embed_dim}, out));
+	}
+
 	const Tensor<>& W = get_param("W").data();
 
 	// Convert int -> size_t for gather_rows
@@ -59,18 +74,66 @@ Variable Embedding::forward(const std::vector<Variable>& xs) {
 }
 
 void Embedding::load_from_npz(const cnpy::npz_t& npz, const std::string& prefix) {
+	packed.reset();
 	std::string w_key = prefix + ".W";
 	auto it = npz.find(w_key);
-	if (it == npz.end()) {
+	if (it != npz.end()) {
+		const cnpy::NpyArray& arr = it->second;
+		std::vector<float> data = arr.as_vec<float>();
+		Tensor<> w_tensor(arr.shape, data);
+		set_param_data("W", w_tensor);
+		return;
+	}
+
+	// 16-bit checkpoints (convert_llama_weights.py --dtype bf16/f16): the table is
+	// widened once here since gather_rows and the tied lm_head run on fp32
+	auto bf16_it = npz.find(w_key + "_bf16");
+	auto f16_it = npz.find(w_key + "_f16");
+	if (bf16_it == npz.end() && f16_it == npz.end()) {
 		throw std::runtime_error("Embedding weight not found: " + w_key);
 	}
-	const cnpy::NpyArray& arr = it->second;
-	std::vector<float> data = arr.as_vec<float>();
-	Tensor<> w_tensor(arr.shape, data);
-	set_param_data("W", w_tensor);
+	const cnpy::NpyArray& arr = bf16_it != npz.end() ? bf16_it->second : f16_it->second;
+	size_t n = arr.num_vals;
+	std::vector<float> data(n);
+	if (bf16_it != npz.end())
+		bf16_to_fp32_row(arr.data<bf16>(), data.data(), n);
+	else
+		fp16_to_fp32_row(arr.data<fp16>(), data.data(), n);
+	set_param_data("W", Tensor<>(arr.shape, data));
+}
+
+void Embedding::load_from_file(const tensor::TensorFile& file, const std::string& prefix) {
+	if (auto rows = file.packed_weight(prefix)) {
+		if (rows->get_cols() != embed_dim)
+			throw std::runtime_error("Embedding::load_from_file: " + prefix + " has "
+									+ std::to_string(rows->get_cols()) + " columns, expected "
+									+ std::to_string(embed_dim));
+		packed = rows;
+		params["W"].data() = Tensor<>();
+		return;
+	}
+	packed.reset();
+	set_param_data("W", file.to_tensor(prefix + ".W"));
+}
+
+void Embedding::save_to_file(tensor::TensorFileWriter& writer, const std::string& prefix) const {
+	if (packed) writer.add(prefix + ".W_" + packed_format_name(packed->get_format()), *packed);
+	else writer.add(prefix + ".W", get_param("W").data());
+}
+
+size_t Embedding::pack_weight(tensor::PackedFormat format) {
+	Tensor<> rows = packed ? packed->unpack() : get_param("W").data();
+	if (rows.is_device()) rows = rows.cpu();
+	rows = rows.contiguous();
+	auto shape = rows.get_shape();
+	packed = std::make_shared<PackedTensor>(
+		PackedTensor::from_rows(rows.raw_data().data(), shape[0], shape[1], format));
+	params["W"].data() = Tensor<>();
+	return packed->nbytes();
 }
 
 Tensor<> Embedding::get_weight() const {
+	if (packed) return packed->unpack();
 	return get_param("W").data();
 }
 
@@ -94,6 +157,16 @@ Variable LlamaRMSNorm::forward(const std::vector<Variable>& xs) {
 	return (*f)({x, weight});
 }
 
+void LlamaRMSNorm::forward_rows(const float* x, float* out, size_t rows) const {
+	Tensor<> weight = get_param("weight").data();
+	rmsnorm_cpu(x, weight.raw_data().data(), out, rows, weight.size(), eps);
+}
+
+void LlamaRMSNorm::add_forward_rows(float* residual, const float* delta, float* out, size_t rows) const {
+	Tensor<> weight = get_param("weight").data();
+	add_rmsnorm_cpu(residual, delta, weight.raw_data().data(), out, rows, weight.size(), eps);
+}
+
 void LlamaRMSNorm::load_from_npz(const cnpy::npz_t& npz, const std::string& prefix) {
 	std::string key = prefix + ".weight";
 	auto it = npz.find(key);
@@ -106,13 +179,56 @@ void LlamaRMSNorm::load_from_npz(const cnpy::npz_t& npz, const std::string& pref
 	set_param_data("weight", w_tensor);
 }
 
+void LlamaRMSNorm::load_from_file(const tensor::TensorFile& file, const std::string& prefix) {
+	set_param_data("weight", file.to_tensor(prefix + ".weight"));
+}
+
+void LlamaRMSNorm::save_to_file(tensor::TensorFileWriter& writer, const std::string& prefix) const {
+	writer.add(prefix + ".weight", get_param("weight").data());
+}
+
+// ============================================================
+// BatchLayout
+// ============================================================
+
+BatchLayout::BatchLayout(const std::vector<size_t>& lengths, PaddingSide side) {
+	if (lengths.empty()) throw std::runtime_error("BatchLayout: empty batch");
+	for (size_t len : lengths) {
+		if (len == 0) throw std::runtime_error("BatchLayout: empty row");
+		seq_len = std::max(seq_len, len);
+	}
+	length = lengths;
+	start.resize(lengths.size());
+	offset.resize(lengths.size());
+	for (size_t b = 0; b < lengths.size(); ++b) {
+		start[b] = side == PaddingSide::Left ? seq_len - lengths[b] : 0;
+		offset[b] = b == 0 ? 0 : offset[b - 1] + lengths[b - 1];
+	}
+}
+
+std::vector<size_t> BatchLayout::position_ids() const {
+	std::vector<size_t> ids(batch() * seq_len);
+	for (size_t b = 0; b < batch(); ++b)
+		for (size_t s = 0; s < seq_len; ++s) ids[b * seq_len + s] = position(b, s);
+	return ids;
+}
+
+std::vector<uint8_t> BatchLayout::attention_mask() const {
+	std::vector<uint8_t> mask(batch() * seq_len);
+	for (size_t b = 0; b < batch(); ++b)
+		for (size_t s = 0; s < seq_len; ++s) mask[b * seq_len + s] = is_token(b, s);
+	return mask;
+}
+
 // ============================================================
 // LlamaAttention
 // ============================================================
 
-LlamaAttention::LlamaAttention(size_t hidden_size, size_t num_heads, size_t num_kv_heads)
+LlamaAttention::LlamaAttention(size_t hidden_size, size_t num_heads, size_t num_kv_heads,
+							   size_t max_seq_len)
 	: hidden_size(hidden_size), num_heads(num_heads), num_kv_heads(num_kv_heads),
-	  head_dim(hidden_size / num_heads), num_kv_groups(num_heads / num_kv_heads) {
+	  head_dim(hidden_size / num_heads), num_kv_groups(num_heads / num_kv_heads),
+	  max_seq_len(max_seq_len) {
 
 	q_proj = std::make_shared<Linear>(num_heads * head_dim, /*nobias=*/true, hidden_size);
 	k_proj = std::make_shared<Linear>(num_kv_heads * head_dim, /*nobias=*/true, hidden_size);
@@ -125,18 +241,216 @@ LlamaAttention::LlamaAttention(size_t hidden_size, size_t num_heads, size_t num_
 	register_sublayers("o_proj", o_proj);
 }
 
+LlamaAttentionState& LlamaAttention::state() {
+	InferenceSession* session = InferenceSession::current();
+	if (!session) return cache;
+	// A new session starts with the layer's KV format and streaming settings
+	return session->state<LlamaAttentionState>(this, [&](LlamaAttentionState& st) {
+		st.kv_format = cache.kv_format;
+		st.stream_sinks = cache.stream_sinks;
+		st.stream_window = cache.stream_window;
+		st.rope_theta = cache.rope_theta;
+		st.sink_keys.assign(st.stream_sinks * kv_stride(), 0.0f);
+		st.sink_pos.assign(st.stream_sinks, 0);
+	});
+}
+
+const LlamaAttentionState& LlamaAttention::state() const {
+	return const_cast<LlamaAttention*>(this)->state();
+}
+
 Variable LlamaAttention::forward_attn(const Variable& hidden_states,
 									   const Tensor<>& cos_cache,
 									   const Tensor<>& sin_cache,
-									   size_t position_offset) {
+									   size_t position_offset,
+									   const BatchLayout* layout) {
+	LlamaAttentionState& st = state();
 	auto shape = hidden_states.shape();
 	size_t batch = shape[0];
 	size_t seq_len = shape[1];
 
+	// Packed batch: token t of the [1, num_tokens] rows is (row b, cache slot s)
+	std::vector<size_t> token_row, token_slot;
+	if (layout) {
+		if (!hidden_states.is_cpu() || st.cache_len != 0)
+			throw std::runtime_error("LlamaAttention: batched prompts need the CPU path and an empty cache");
+		if (batch != 1 || layout->num_tokens() != seq_len)
+			throw std::runtime_error("LlamaAttention: batch layout does not match hidden_states");
+		token_row.resize(seq_len);
+		token_slot.resize(seq_len);
+		for (size_t b = 0; b < layout->batch(); ++b) {
+			for (size_t i = 0; i < layout->length[b]; ++i) {
+				token_row[layout->offset[b] + i] = b;
+				token_slot[layout->offset[b] + i] = layout->start[b] + i;
+			}
+		}
+	}
+
+	if (st.stream_window > 0) {
+		if (layout || batch != 1 || !hidden_states.is_cpu())
+			throw std::runtime_error("LlamaAttention: the streaming cache holds one sequence on the CPU path");
+		if (seq_len > 1 && st.stream_tokens + seq_len > st.stream_capacity())
+			throw std::runtime_error("LlamaAttention: a full streaming window takes one token at a time");
+	}
+
+	// Checks the context length before RoPE reads past its tables
+	if (layout) ensure_cache(st, layout->batch(), layout->seq_len);
+	else if (st.stream_window > 0) ensure_cache(st, batch, std::min(st.cache_len + seq_len, st.stream_capacity()));
+	else ensure_cache(st, batch, st.cache_len + seq_len);
+
+	dcz::Device orig_device = hidden_states.device();
+	size_t q_dim = num_heads * head_dim;
+	size_t kv_stride = num_kv_heads * head_dim;
+	float scale = 1.0f / std::sqrt(static_cast<float>(head_dim));
+
+	// CPU: RoPE is the projection epilogue. Each token's Q/K/V row is rotated while
+	// it is split out, with K and V written straight into the cache, then fused
+	// attention runs from the cache: online softmax, GQA by index, no scores / mask /
+	// expanded K,V tensors -> memory does not grow with total_len
+	if (orig_device.is_cpu()) {
+		size_t m = batch * seq_len;
+		std::vector<float> qkv;
+		Tensor<> Q_t, K_t, V_t;
+		const float *q_src, *k_src, *v_src;
+		size_t q_src_stride, kv_src_stride;
+		if (qkv_packed) {
+			Tensor<> x = hidden_states.data().contiguous();
+			size_t qkv_dim = q_dim + 2 * kv_stride;
+			qkv.resize(m * qkv_dim);
+			packed_matmul(x.raw_data().data(), m, *qkv_packed, qkv.data());
+			q_src = qkv.data();
+			k_src = q_src + q_dim;
+			v_src = k_src + kv_stride;
+			q_src_stride = kv_src_stride = qkv_dim;
+		} else {
+			Q_t = (*q_proj)(hidden_states).data().contiguous();
+			K_t = (*k_proj)(hidden_states).data().contiguous();
+			V_t = (*v_proj)(hidden_states).data().contiguous();
+			q_src = Q_t.raw_data().data();
+			k_src = K_t.raw_data().data();
+			v_src = V_t.raw_data().data();
+			q_src_stride = q_dim;
+			kv_src_stride = kv_stride;
+		}
+
+		Tensor<> cos_cpu = cos_cache.is_cpu() ? cos_cache : cos_cache.cpu();
+		Tensor<> sin_cpu = sin_cache.is_cpu() ? sin_cache : sin_cache.cpu();
+		const float* cos_data = cos_cpu.raw_data().data();
+		const float* sin_data = sin_cpu.raw_data().data();
+		size_t table_len = cos_cpu.get_shape()[0];
+
+		// Streaming positions run past the tables: compute those rows
+		std::vector<float> far_cos, far_sin;
+		if (!layout && position_offset + seq_len > table_len) {
+			if (st.stream_window == 0)
+				throw std::runtime_error("LlamaAttention: position " + std::to_string(position_offset + seq_len - 1)
+										+ " exceeds max_position_embeddings " + std::to_string(table_len));
+			far_cos.resize(seq_len * head_dim);
+			far_sin.resize(seq_len * head_dim);
+			for (size_t s = 0; s < seq_len; ++s)
+				rope_frequencies_row(static_cast<double>(position_offset + s), head_dim, st.rope_theta,
+									 far_cos.data() + s * head_dim, far_sin.data() + s * head_dim);
+		}
+
+		// f32 caches take the rotated K row in place; others quantize it from k_rot
+		bool k_in_place = st.kv_format == KVCacheFormat::F32;
+		std::vector<float> q(m * q_dim);
+		std::vector<float> k_rot(k_in_place ? 0 : m * kv_stride);
+		#pragma omp parallel for schedule(static) if (m > 1)
+		for (long t = 0; t < static_cast<long>(m); ++t) {
+			size_t b = static_cast<size_t>(t) / seq_len;
+			size_t s = static_cast<size_t>(t) % seq_len;
+			size_t pos = position_offset + s;
+			size_t slot = st.stream_window > 0 ? st.stream_slot(st.stream_tokens + s) : st.cache_len + s;
+			if (layout) {
+				b = token_row[t];
+				slot = token_slot[t];
+				pos = slot - layout->start[b];
+			}
+			bool far = pos >= table_len;
+			const float* cos_row = far ? far_cos.data() + s * head_dim : cos_data + pos * head_dim;
+			const float* sin_row = far ? far_sin.data() + s * head_dim : sin_data + pos * head_dim;
+			if (st.stream_window > 0 && st.stream_tokens + s < st.stream_sinks) {
+				const float* k_raw = k_src + t * kv_src_stride;
+				std::copy(k_raw, k_raw + kv_stride, st.sink_keys.begin() + slot * kv_stride);
+				st.sink_pos[slot] = static_cast<long long>(pos);
+			}
+
+			rope_rotate_row(q_src + t * q_src_stride, q.data() + t * q_dim, num_heads, head_dim,
+							cos_row, sin_row);
+			float* k_dst = k_in_place ? st.k_cache.f32_row(b, slot) : k_rot.data() + t * kv_stride;
+			rope_rotate_row(k_src + t * kv_src_stride, k_dst, num_kv_heads, head_dim, cos_row, sin_row);
+			if (!k_in_place) st.k_cache.write_row(b, slot, k_dst);
+			st.v_cache.write_row(b, slot, v_src + t * kv_src_stride);
+		}
+
+		size_t past_len = st.cache_len;
+		if (st.stream_window > 0) {
+			// Once tokens have been evicted, the single query sees every slot
+			st.stream_tokens += seq_len;
+			st.cache_len = std::min(st.stream_tokens, st.stream_capacity());
+			past_len = st.cache_len - seq_len;
+			if (st.stream_tokens > st.stream_capacity())
+				rebase_sinks(st, static_cast<long long>(position_offset), cos_data, sin_data, table_len);
+		} else {
+			st.cache_len += layout ? layout->seq_len : seq_len;
+		}
+		for (size_t b = 0; b < st.key_owners.size(); ++b) st.key_owners[b].resize(st.cache_len, static_cast<uint32_t>(b));
+
+		std::vector<float> out_data(m * hidden_size);
+		if (layout) {
+			// Keys are read from the row's first slot on, so left padding is never seen
+			// and right padding only follows the row's tokens (hidden by the causal mask)
+			for (size_t b = 0; b < layout->batch(); ++b) {
+				size_t first = layout->offset[b];
+				cached_attention_cpu(q.data() + first * q_dim,
+									 st.k_cache.view(b, layout->start[b]), st.v_cache.view(b, layout->start[b]),
+									 out_data.data() + first * hidden_size,
+									 layout->length[b], 0,
+									 num_heads, num_kv_heads, head_dim, scale);
+			}
+		} else {
+			for (size_t b = 0; b < batch; ++b) {
+				bool shared = !st.key_owners.empty();
+				cached_attention_cpu(q.data() + b * seq_len * q_dim,
+									 shared ? st.k_cache.shared_view(st.key_owners[b].data()) : st.k_cache.view(b),
+									 shared ? st.v_cache.shared_view(st.key_owners[b].data()) : st.v_cache.view(b),
+									 out_data.data() + b * seq_len * hidden_size,
+									 seq_len, past_len,
+									 num_heads, num_kv_heads, head_dim, scale);
+			}
+		}
+		Variable out(Tensor<>({batch, seq_len, hidden_size}, out_data));
+		return (*o_proj)(out);
+	}
+	if (!st.key_owners.empty())
+		throw std::runtime_error("LlamaAttention: shared (beam) caches need the CPU path");
+
 	// 1. Project Q, K, V
-	Variable Q = (*q_proj)(hidden_states);  // [batch, seq, num_heads * head_dim]
-	Variable K = (*k_proj)(hidden_states);  // [batch, seq, num_kv_heads * head_dim]
-	Variable V = (*v_proj)(hidden_states);  // [batch, seq, num_kv_heads * head_dim]
+	Variable Q, K, V;
+	if (qkv_packed) {
+		// One GEMM over the fused [q; k; v] rows, then split per token
+		Tensor<> x = hidden_states.data().cpu();
+		size_t m = batch * seq_len;
+		size_t qkv_dim = q_dim + 2 * kv_stride;
+		std::vector<float> qkv(m * qkv_dim);
+		packed_matmul(x.raw_data().data(), m, *qkv_packed, qkv.data());
+
+		std::vector<float> q(m * q_dim), k(m * kv_stride), v(m * kv_stride);
+		for (size_t t = 0; t < m; ++t) {
+			const float* row = qkv.data() + t * qkv_dim;
+			std::copy(row, row + q_dim, q.begin() + t * q_dim);
+			std::copy(row + q_dim, row + q_dim + kv_stride, k.begin() + t * kv_stride);
+			std::copy(row + q_dim + kv_stride, row + qkv_dim, v.begin() + t * kv_stride);
+		}
+		Q = Variable(Tensor<>({batch, seq_len, q_dim}, q).to(orig_device));
+		K = Variable(Tensor<>({batch, seq_len, kv_stride}, k).to(orig_device));
+		V = Variable(Tensor<>({batch, seq_len, kv_stride}, v).to(orig_device));
+	} else {
+		Q = (*q_proj)(hidden_states);  // [batch, seq, num_heads * head_dim]
+		K = (*k_proj)(hidden_states);  // [batch, seq, num_kv_heads * head_dim]
+		V = (*v_proj)(hidden_states);  // [batch, seq, num_kv_heads * head_dim]
+	}
 
 	// 2. Reshape to multi-head
 	Q = reshape(Q, {batch, seq_len, num_heads, head_dim});
@@ -148,63 +462,33 @@ Variable LlamaAttention::forward_attn(const Variable& hidden_states,
 	K = apply_rope(K, cos_cache, sin_cache, position_offset);
 
 	// 4. KV Cache: append new K, V to pre-allocated cache (always CPU)
-	dcz::Device orig_device = hidden_states.device();
-	Tensor<> K_data = K.data().contiguous();
-	Tensor<> V_data = V.data().contiguous();
-	// KV cache stays on CPU; move K/V to CPU for cache writes
-	if (!orig_device.is_cpu()) {
-		K_data = K_data.cpu();
-		V_data = V_data.cpu();
-	}
-
-	size_t kv_stride = num_kv_heads * head_dim;
-
-	if (cache_max_len == 0) {
-		// First call: pre-allocate for max sequence length (512)
-		cache_max_len = 512;
-		k_cache = Tensor<>({batch, cache_max_len, num_kv_heads, head_dim}, 0.0f);
-		v_cache = Tensor<>({batch, cache_max_len, num_kv_heads, head_dim}, 0.0f);
-	}
+	Tensor<> K_data = K.data().contiguous().cpu();
+	Tensor<> V_data = V.data().contiguous().cpu();
 
-	// Write new K,V at cache_len offset (no reallocation needed)
-	auto& k_buf = k_cache.raw_data();
-	auto& v_buf = v_cache.raw_data();
+	// Write new K,V at st.cache_len offset (no reallocation needed)
 	const auto& cur_k = K_data.raw_data();
 	const auto& cur_v = V_data.raw_data();
 
 	for (size_t b = 0; b < batch; ++b) {
-		std::copy(cur_k.begin() + b * seq_len * kv_stride,
-				  cur_k.begin() + (b + 1) * seq_len * kv_stride,
-				  k_buf.begin() + (b * cache_max_len + cache_len) * kv_stride);
-		std::copy(cur_v.begin() + b * seq_len * kv_stride,
-				  cur_v.begin() + (b + 1) * seq_len * kv_stride,
-				  v_buf.begin() + (b * cache_max_len + cache_len) * kv_stride);
-	}
-
-	size_t total_len = cache_len + seq_len;
-	cache_len = total_len;
-
-	// 5. Extract valid cache portion [batch, total_len, num_kv_heads, head_dim]
-	Tensor<> k_valid, v_valid;
-	if (total_len == cache_max_len) {
-		k_valid = k_cache;
-		v_valid = v_cache;
-	} else {
-		// Slice valid portion from pre-allocated cache
-		std::vector<float> k_slice(batch * total_len * kv_stride);
-		std::vector<float> v_slice(batch * total_len * kv_stride);
-		for (size_t b = 0; b < batch; ++b) {
-			std::copy(k_buf.begin() + b * cache_max_len * kv_stride,
-					  k_buf.begin() + (b * cache_max_len + total_len) * kv_stride,
-					  k_slice.begin() + b * total_len * kv_stride);
-			std::copy(v_buf.begin() + b * cache_max_len * kv_stride,
-					  v_buf.begin() + (b * cache_max_len + total_len) * kv_stride,
-					  v_slice.begin() + b * total_len * kv_stride);
+		for (size_t s = 0; s < seq_len; ++s) {
+			st.k_cache.write_row(b, st.cache_len + s, cur_k.data() + (b * seq_len + s) * kv_stride);
+			st.v_cache.write_row(b, st.cache_len + s, cur_v.data() + (b * seq_len + s) * kv_stride);
 		}
-		k_valid = Tensor<>({batch, total_len, num_kv_heads, head_dim}, k_slice);
-		v_valid = Tensor<>({batch, total_len, num_kv_heads, head_dim}, v_slice);
 	}
 
+	size_t total_len = st.cache_len + seq_len;
+	st.cache_len = total_len;
+
+	// 5. Extract valid cache portion [batch, total_len, num_kv_heads, head_dim] (dequantized)
+	std::vector<float> k_slice(batch * total_len * kv_stride);
+	std::vector<float> v_slice(batch * total_len * kv_stride);
+	for (size_t b = 0; b < batch; ++b) {
+		st.k_cache.read_rows(b, 0, total_len, k_slice.data() + b * total_len * kv_stride);
+		st.v_cache.read_rows(b, 0, total_len, v_slice.data() + b * total_len * kv_stride);
+	}
+	Tensor<> k_valid({batch, total_len, num_kv_heads, head_dim}, k_slice);
+	Tensor<> v_valid({batch, total_len, num_kv_heads, head_dim}, v_slice);
+
 	// Move KV cache results back to device for attention computation
 	if (!orig_device.is_cpu()) {
 		k_valid = k_valid.to(orig_device);
@@ -238,7 +522,6 @@ Variable LlamaAttention::forward_attn(const Variable& hidden_states,
 
 	// scores = Q @ K^T / sqrt(head_dim)
 	Variable scores = matmul(Q_var, K_T);
-	float scale = 1.0f / std::sqrt(static_cast<float>(head_dim));
 	scores = scores * scale;
 
 	// Apply causal mask (only needed when seq_len > 1, i.e., prompt processing)
@@ -283,18 +566,304 @@ Variable LlamaAttention::forward(const std::vector<Variable>& xs) {
 	throw std::runtime_error("LlamaAttention::forward not supported. Use forward_attn().");
 }
 
+void LlamaAttention::ensure_cache(LlamaAttentionState& st, size_t batch, size_t needed) {
+	if (needed > max_seq_len) {
+		throw std::runtime_error("LlamaAttention: sequence length " + std::to_string(needed)
+								+ " exceeds max_position_embeddings " + std::to_string(max_seq_len));
+	}
+	if (!st.k_cache.empty() && st.k_cache.get_batch() != batch) {
+		// A new batch size starts over (e.g. a batched prefill after single-sequence use)
+		if (st.cache_len != 0)
+			throw std::runtime_error("LlamaAttention: batch size " + std::to_string(batch)
+									+ " does not match the cached batch of " + std::to_string(st.k_cache.get_batch()));
+		reset_cache();
+	}
+	if (needed <= st.cache_max_len) return;
+
+	// First call allocates up to 512 tokens; longer contexts double the capacity
+	size_t limit = st.stream_window > 0 ? st.stream_capacity() : max_seq_len;
+	size_t new_max_len = std::max<size_t>(st.cache_max_len, std::min<size_t>(512, limit));
+	while (new_max_len < needed) new_max_len *= 2;
+	new_max_len = std::min(new_max_len, limit);
+
+	if (st.k_cache.empty()) {
+		st.k_cache = KVCacheStore(st.kv_format, batch, new_max_len, num_kv_heads, head_dim);
+		st.v_cache = KVCacheStore(st.kv_format, batch, new_max_len, num_kv_heads, head_dim);
+	} else {
+		// Keep already cached rows
+		st.k_cache.grow(new_max_len, st.cache_len);
+		st.v_cache.grow(new_max_len, st.cache_len);
+	}
+	st.cache_max_len = new_max_len;
+}
+
+void LlamaAttention::set_kv_cache_format(KVCacheFormat format) {
+	LlamaAttentionState& st = state();
+	if (format == st.kv_format) return;
+	st.kv_format = format;
+	reset_cache();
+}
+
+size_t LlamaAttention::kv_cache_bytes_per_token() const {
+	const LlamaAttentionState& st = state();
+	return 2 * KVCacheStore::bytes_per_token(st.kv_format, num_kv_heads, head_dim);
+}
+
+void LlamaAttention::export_kv(size_t start, size_t len,
+							   std::vector<float>& k, std::vector<float>& v) const {
+	const LlamaAttentionState& st = state();
+	if (start + len > st.cache_len) {
+		throw std::runtime_error("LlamaAttention::export_kv: range exceeds cached tokens");
+	}
+	if (!st.key_owners.empty()) {
+		throw std::runtime_error("LlamaAttention::export_kv: not supported on a shared (beam) cache");
+	}
+	if (st.stream_tokens > st.cache_len) {
+		throw std::runtime_error("LlamaAttention::export_kv: the streaming window has evicted tokens");
+	}
+	size_t stride = kv_stride();
+	k.resize(len * stride);
+	v.resize(len * stride);
+	st.k_cache.read_rows(0, start, len, k.data());
+	st.v_cache.read_rows(0, start, len, v.data());
+}
+
+void LlamaAttention::import_kv(size_t start, size_t len, const float* k, const float* v) {
+	LlamaAttentionState& st = state();
+	if (start > st.cache_len) {
+		throw std::runtime_error("LlamaAttention::import_kv: range exceeds cached tokens");
+	}
+	if (st.stream_window > 0 && (st.stream_tokens > st.cache_len || start + len > st.stream_capacity())) {
+		throw std::runtime_error("LlamaAttention::import_kv: range exceeds the streaming window");
+	}
+	ensure_cache(st, 1, start + len);
+	size_t stride = kv_stride();
+	for (size_t i = 0; i < len; ++i) {
+		st.k_cache.write_row(0, start + i, k + i * stride);
+		st.v_cache.write_row(0, start + i, v + i * stride);
+	}
+	st.cache_len = start + len;
+	if (st.stream_window == 0) return;
+
+	// Imported keys are rotated to their slot's position: recover the raw sink rows
+	st.stream_tokens = st.cache_len;
+	std::vector<float> cos_row(head_dim), neg_sin(head_dim);
+	for (size_t slot = start; slot < std::min(st.cache_len, st.stream_sinks); ++slot) {
+		rope_frequencies_row(-static_cast<double>(slot), head_dim, st.rope_theta, cos_row.data(), neg_sin.data());
+		rope_rotate_row(k + (slot - start) * stride, st.sink_keys.data() + slot * stride, num_kv_heads, head_dim,
+						cos_row.data(), neg_sin.data());
+		st.sink_pos[slot] = static_cast<long long>(slot);
+	}
+}
+
+void LlamaAttention::truncate_cache(size_t len) {
+	LlamaAttentionState& st = state();
+	if (st.stream_window > 0 && len < st.cache_len) {
+		if (st.stream_tokens > st.cache_len)
+			throw std::runtime_error("LlamaAttention::truncate_cache: the streaming window has evicted tokens");
+		st.stream_tokens = len;
+	}
+	if (len < st.cache_len) st.cache_len = len;
+	for (auto& owners : st.key_owners) owners.resize(st.cache_len);
+}
+
+void LlamaAttention::shift_cache(size_t drop, const Tensor<>& cos_cache, const Tensor<>& sin_cache) {
+	LlamaAttentionState& st = state();
+	if (drop == 0) return;
+	if (!st.key_owners.empty())
+		throw std::runtime_error("LlamaAttention::shift_cache: not supported on a shared (beam) cache");
+	if (st.stream_window > 0)
+		throw std::runtime_error("LlamaAttention::shift_cache: not supported on a streaming cache");
+	if (drop > st.cache_len) {
+		throw std::runtime_error("LlamaAttention::shift_cache: cannot drop " + std::to_string(drop)
+								+ " of " + std::to_string(st.cache_len) + " cached tokens");
+	}
+	size_t keep = st.cache_len - drop;
+
+	// Rotation by -drop: the cos row of position drop with its sin row negated
+	Tensor<> cos_cpu = cos_cache.is_cpu() ? cos_cache : cos_cache.cpu();
+	Tensor<> sin_cpu = sin_cache.is_cpu() ? sin_cache : sin_cache.cpu();
+	const float* cos_row = cos_cpu.raw_data().data() + drop * head_dim;
+	const float* sin_row = sin_cpu.raw_data().data() + drop * head_dim;
+	std::vector<float> neg_sin(sin_row, sin_row + head_dim);
+	for (float& x : neg_sin) x = -x;
+
+	// Rows move forward, so reading a chunk before writing it never clobbers unread rows
+	size_t stride = kv_stride();
+	const size_t chunk = 64;
+	std::vector<float> k(chunk * stride), v(chunk * stride);
+	for (size_t b = 0; b < st.k_cache.get_batch(); ++b) {
+		for (size_t first = 0; first < keep; first += chunk) {
+			size_t len = std::min(chunk, keep - first);
+			st.k_cache.read_rows(b, drop + first, len, k.data());
+			st.v_cache.read_rows(b, drop + first, len, v.data());
+			for (size_t i = 0; i < len; ++i) {
+				float* row = k.data() + i * stride;
+				rope_rotate_row(row, row, num_kv_heads, head_dim, cos_row, neg_sin.data());
+				st.k_cache.write_row(b, first + i, row);
+				st.v_cache.write_row(b, first + i, v.data() + i * stride);
+			}
+		}
+	}
+	st.cache_len = keep;
+}
+
 void LlamaAttention::reset_cache() {
-	k_cache = Tensor<>();
-	v_cache = Tensor<>();
-	cache_len = 0;
-	cache_max_len = 0;
+	LlamaAttentionState& st = state();
+	st.k_cache = KVCacheStore();
+	st.v_cache = KVCacheStore();
+	st.cache_len = 0;
+	st.cache_max_len = 0;
+	st.key_owners.clear();
+	st.stream_tokens = 0;
+}
+
+void LlamaAttention::set_streaming(size_t sink_tokens, size_t window_tokens, float theta) {
+	LlamaAttentionState& st = state();
+	if (window_tokens > 0 && sink_tokens + window_tokens > max_seq_len) {
+		throw std::runtime_error("LlamaAttention::set_streaming: " + std::to_string(sink_tokens) + " sinks + "
+								+ std::to_string(window_tokens) + " window tokens exceed max_position_embeddings "
+								+ std::to_string(max_seq_len));
+	}
+	reset_cache();
+	st.stream_window = window_tokens;
+	st.stream_sinks = window_tokens > 0 ? sink_tokens : 0;
+	st.rope_theta = theta;
+	st.sink_keys.assign(st.stream_sinks * kv_stride(), 0.0f);
+	st.sink_pos.assign(st.stream_sinks, 0);
+}
+
+void LlamaAttention::rebase_sinks(LlamaAttentionState& st, long long query_pos,
+								  const float* cos_data, const float* sin_data, size_t table_len) {
+	// StreamingLLM positions: sinks at [0, sinks), window after them up to the query
+	long long first = query_pos - static_cast<long long>(st.stream_capacity() - 1);
+	size_t stride = kv_stride();
+	std::vector<float> cos_row(head_dim), sin_row(head_dim), k(stride);
+	for (size_t i = 0; i < st.stream_sinks; ++i) {
+		long long pos = first + static_cast<long long>(i);
+		if (st.sink_pos[i] == pos) continue;
+		const float *c = cos_row.data(), *sn = sin_row.data();
+		if (pos >= 0 && static_cast<size_t>(pos) < table_len) {
+			c = cos_data + pos * head_dim;
+			sn = sin_data + pos * head_dim;
+		} else {
+			rope_frequencies_row(static_cast<double>(pos), head_dim, st.rope_theta, cos_row.data(), sin_row.data());
+		}
+		bool in_place = st.kv_format == KVCacheFormat::F32;
+		float* dst = in_place ? st.k_cache.f32_row(0, i) : k.data();
+		rope_rotate_row(st.sink_keys.data() + i * stride, dst, num_kv_heads, head_dim, c, sn);
+		if (!in_place) st.k_cache.write_row(0, i, dst);
+		st.sink_pos[i] = pos;
+	}
 }
 
-void LlamaAttention::load_from_npz(const cnpy::npz_t& npz, const std::string& prefix) {
+void LlamaAttention::fork_cache(size_t batch) {
+	LlamaAttentionState& st = state();
+	if (batch == 0) throw std::runtime_error("LlamaAttention::fork_cache: batch must be positive");
+	if (st.stream_window > 0) throw std::runtime_error("LlamaAttention::fork_cache: not supported on a streaming cache");
+	if (!st.k_cache.empty()) {
+		if (st.k_cache.get_batch() != 1)
+			throw std::runtime_error("LlamaAttention::fork_cache: cache already holds several sequences");
+		// New entries only receive the tokens written after the fork
+		st.k_cache.resize(batch, st.cache_max_len, st.cache_len);
+		st.v_cache.resize(batch, st.cache_max_len, st.cache_len);
+	}
+	st.key_owners.assign(batch, std::vector<uint32_t>(st.cache_len, 0));
+}
+
+void LlamaAttention::reorder_cache(const std::vector<size_t>& parents) {
+	LlamaAttentionState& st = state();
+	size_t batch = st.k_cache.empty() ? st.key_owners.size() : st.k_cache.get_batch();
+	if (parents.size() != batch)
+		throw std::runtime_error("LlamaAttention::reorder_cache: expected " + std::to_string(batch) + " parents");
+	if (st.key_owners.empty()) {
+		st.key_owners.resize(batch);
+		for (size_t b = 0; b < batch; ++b) st.key_owners[b].assign(st.cache_len, static_cast<uint32_t>(b));
+	}
+	std::vector<std::vector<uint32_t>> reordered(batch);
+	for (size_t b = 0; b < batch; ++b) {
+		if (parents[b] >= batch)
+			throw std::runtime_error("LlamaAttention::reorder_cache: parent out of range");
+		reordered[b] = st.key_owners[parents[b]];
+	}
+	st.key_owners = std::move(reordered);
+}
+
+void LlamaAttention::load_from_npz(const cnpy::npz_t& npz, const std::string& prefix,
+								   std::optional<tensor::PackedFormat> weight_format) {
 	q_proj->load_params_from_npz(npz, prefix + ".q_proj");
 	k_proj->load_params_from_npz(npz, prefix + ".k_proj");
 	v_proj->load_params_from_npz(npz, prefix + ".v_proj");
 	o_proj->load_params_from_npz(npz, prefix + ".o_proj");
+	if (weight_format) pack_weights(*weight_format);
+	else fuse_projections();  // pre-packed checkpoints
+}
+
+size_t LlamaAttention::pack_weights(tensor::PackedFormat format) {
+	size_t bytes = q_proj->pack_weight(format) + k_proj->pack_weight(format)
+				 + v_proj->pack_weight(format) + o_proj->pack_weight(format);
+	fuse_projections();
+	return bytes;
+}
+
+bool LlamaAttention::fuse_projections() {
+	auto q = q_proj->get_packed();
+	auto k = k_proj->get_packed();
+	auto v = v_proj->get_packed();
+	if (!q || !k || !v || q->get_format() != k->get_format() || q->get_format() != v->get_format())
+		return false;
+
+	size_t q_rows = q->get_rows();
+	size_t kv_rows = k->get_rows();
+	// Already views of the current fused matrix
+	if (qkv_packed && q->row_ptr(0) == qkv_packed->row_ptr(0)
+		&& v->row_ptr(0) == qkv_packed->row_ptr(q_rows + kv_rows))
+		return true;
+
+	set_fused(std::make_shared<PackedTensor>(PackedTensor::concat_rows({*q, *k, *v})));
+	return true;
+}
+
+void LlamaAttention::set_fused(std::shared_ptr<PackedTensor> qkv) {
+	size_t q_rows = num_heads * head_dim;
+	size_t kv_rows = num_kv_heads * head_dim;
+	if (qkv->get_rows() != q_rows + 2 * kv_rows)
+		throw std::runtime_error("LlamaAttention::set_fused: expected " + std::to_string(q_rows + 2 * kv_rows)
+								+ " rows, got " + std::to_string(qkv->get_rows()));
+	qkv_packed = std::move(qkv);
+	q_proj->set_packed(std::make_shared<PackedTensor>(qkv_packed->row_slice(0, q_rows)));
+	k_proj->set_packed(std::make_shared<PackedTensor>(qkv_packed->row_slice(q_rows, q_rows + kv_rows)));
+	v_proj->set_packed(std::make_shared<PackedTensor>(
+		qkv_packed->row_slice(q_rows + kv_rows, q_rows + 2 * kv_rows)));
+}
+
+void LlamaAttention::release_weights() {
+	qkv_packed.reset();
+	for (auto& proj : {q_proj, k_proj, v_proj, o_proj})
+		proj->release_packed();
+}
+
+void LlamaAttention::load_from_file(const tensor::TensorFile& file, const std::string& prefix) {
+	if (auto qkv = file.packed_weight(prefix + ".qkv_proj")) {
+		set_fused(qkv);
+	} else {
+		qkv_packed.reset();
+		q_proj->load_params_from_file(file, prefix + ".q_proj");
+		k_proj->load_params_from_file(file, prefix + ".k_proj");
+		v_proj->load_params_from_file(file, prefix + ".v_proj");
+	}
+	o_proj->load_params_from_file(file, prefix + ".o_proj");
+}
+
+void LlamaAttention::save_to_file(tensor::TensorFileWriter& writer, const std::string& prefix) const {
+	if (qkv_packed) {
+		writer.add(prefix + ".qkv_proj.W_" + packed_format_name(qkv_packed->get_format()), *qkv_packed);
+	} else {
+		q_proj->save_params_to_file(writer, prefix + ".q_proj");
+		k_proj->save_params_to_file(writer, prefix + ".k_proj");
+		v_proj->save_params_to_file(writer, prefix + ".v_proj");
+	}
+	o_proj->save_params_to_file(writer, prefix + ".o_proj");
 }
 
 // ============================================================
@@ -313,6 +882,24 @@ LlamaMLP::LlamaMLP(size_t hidden_size, size_t intermediate_size) {
 
 Variable LlamaMLP::forward(const std::vector<Variable>& xs) {
 	const Variable& x = xs[0];
+
+	if (gate_up_packed) {
+		// One pass over the fused [gate; up] rows; silu(gate) * up is the GEMM
+		// epilogue and lands directly in down_proj's input
+		Tensor<> x_data = x.data();
+		x_data = x_data.is_device() ? x_data.cpu() : x_data.contiguous();
+		auto shape = x_data.get_shape();
+		size_t intermediate = gate_up_packed->get_rows() / 2;
+		size_t m = x_data.size() / shape.back();
+		std::vector<float> hidden(m * intermediate);
+		packed_matmul_swiglu(x_data.raw_data().data(), m, *gate_up_packed, hidden.data());
+
+		shape.back() = intermediate;
+		Variable out = (*down_proj)(Variable(Tensor<>(shape, hidden)));
+		if (x.is_device()) return Variable(out.data().to(x.device()));
+		return out;
+	}
+
 	// SwiGLU: down_proj(silu(gate_proj(x)) * up_proj(x))
 	Variable gate = silu((*gate_proj)(x));
 	Variable up = (*up_proj)(x);
@@ -320,10 +907,72 @@ Variable LlamaMLP::forward(const std::vector<Variable>& xs) {
 	return (*down_proj)(hidden);
 }
 
-void LlamaMLP::load_from_npz(const cnpy::npz_t& npz, const std::string& prefix) {
+void LlamaMLP::load_from_npz(const cnpy::npz_t& npz, const std::string& prefix,
+							 std::optional<tensor::PackedFormat> weight_format) {
 	gate_proj->load_params_from_npz(npz, prefix + ".gate_proj");
 	up_proj->load_params_from_npz(npz, prefix + ".up_proj");
 	down_proj->load_params_from_npz(npz, prefix + ".down_proj");
+	if (weight_format) pack_weights(*weight_format);
+	else fuse_projections();  // pre-packed checkpoints
+}
+
+size_t LlamaMLP::pack_weights(tensor::PackedFormat format) {
+	size_t bytes = gate_proj->pack_weight(format) + up_proj->pack_weight(format)
+				 + down_proj->pack_weight(format);
+	fuse_projections();
+	return bytes;
+}
+
+bool LlamaMLP::fuse_projections() {
+	auto gate = gate_proj->get_packed();
+	auto up = up_proj->get_packed();
+	if (!gate || !up || gate->get_format() != up->get_format())
+		return false;
+
+	size_t rows = gate->get_rows();
+	if (gate_up_packed && gate->row_ptr(0) == gate_up_packed->row_ptr(0)
+		&& up->row_ptr(0) == gate_up_packed->row_ptr(rows))
+		return true;
+
+	set_fused(std::make_shared<PackedTensor>(PackedTensor::concat_rows({*gate, *up})));
+	return true;
+}
+
+void LlamaMLP::set_fused(std::shared_ptr<PackedTensor> gate_up) {
+	if (gate_up->get_rows() % 2 != 0)
+		throw std::runtime_error("LlamaMLP::set_fused: gate_up needs an even number of rows");
+	size_t rows = gate_up->get_rows() / 2;
+	gate_up_packed = std::move(gate_up);
+	gate_proj->set_packed(std::make_shared<PackedTensor>(gate_up_packed->row_slice(0, rows)));
+	up_proj->set_packed(std::make_shared<PackedTensor>(gate_up_packed->row_slice(rows, 2 * rows)));
+}
+
+void LlamaMLP::release_weights() {
+	gate_up_packed.reset();
+	for (auto& proj : {gate_proj, up_proj, down_proj})
+		proj->release_packed();
+}
+
+void LlamaMLP::load_from_file(const tensor::TensorFile& file, const std::string& prefix) {
+	if (auto gate_up = file.packed_weight(prefix + ".gate_up_proj")) {
+		set_fused(gate_up);
+	} else {
+		gate_up_packed.reset();
+		gate_proj->load_params_from_file(file, prefix + ".gate_proj");
+		up_proj->load_params_from_file(file, prefix + ".up_proj");
+	}
+	down_proj->load_params_from_file(file, prefix + ".down_proj");
+}
+
+void LlamaMLP::save_to_file(tensor::TensorFileWriter& writer, const std::string& prefix) const {
+	if (gate_up_packed) {
+		writer.add(prefix + ".gate_up_proj.W_" + packed_format_name(gate_up_packed->get_format()),
+				   *gate_up_packed);
+	} else {
+		gate_proj->save_params_to_file(writer, prefix + ".gate_proj");
+		up_proj->save_params_to_file(writer, prefix + ".up_proj");
+	}
+	down_proj->save_params_to_file(writer, prefix + ".down_proj");
 }
 
 // ============================================================
@@ -332,8 +981,9 @@ void LlamaMLP::load_from_npz(const cnpy::npz_t& npz, const std::string& prefix)
 
 LlamaDecoderLayer::LlamaDecoderLayer(size_t hidden_size, size_t num_heads,
 									   size_t num_kv_heads, size_t intermediate_size,
-									   float rms_norm_eps) {
-	self_attn = std::make_shared<LlamaAttention>(hidden_size, num_heads, num_kv_heads);
+									   float rms_norm_eps, size_t max_position_embeddings) {
+	self_attn = std::make_shared<LlamaAttention>(hidden_size, num_heads, num_kv_heads,
+												 max_position_embeddings);
 	mlp = std::make_shared<LlamaMLP>(hidden_size, intermediate_size);
 	input_layernorm = std::make_shared<LlamaRMSNorm>(hidden_size, rms_norm_eps);
 	post_attention_layernorm = std::make_shared<LlamaRMSNorm>(hidden_size, rms_norm_eps);
@@ -362,6 +1012,23 @@ Variable LlamaDecoderLayer::forward_with_cache(const Variable& hidden_states,
 	return h;
 }
 
+void LlamaDecoderLayer::forward_fused(Tensor<>& residual, Tensor<>& normed,
+									  const LlamaRMSNorm& next_norm,
+									  const Tensor<>& cos_cache, const Tensor<>& sin_cache,
+									  size_t position_offset, const BatchLayout* layout) {
+	auto shape = residual.get_shape();
+	size_t rows = residual.size() / shape.back();
+
+	Tensor<> attn_out = self_attn->forward_attn(Variable(normed), cos_cache, sin_cache,
+												position_offset, layout).data().contiguous();
+	post_attention_layernorm->add_forward_rows(residual.raw_data().data(), attn_out.raw_data().data(),
+											   normed.raw_data().data(), rows);
+
+	Tensor<> mlp_out = (*mlp)(Variable(normed)).data().contiguous();
+	next_norm.add_forward_rows(residual.raw_data().data(), mlp_out.raw_data().data(),
+							   normed.raw_data().data(), rows);
+}
+
 Variable LlamaDecoderLayer::forward(const std::vector<Variable>& xs) {
 	(void)xs;
 	throw std::runtime_error("LlamaDecoderLayer::forward not supported. Use forward_with_cache().");
@@ -371,13 +1038,48 @@ void LlamaDecoderLayer::reset_cache() {
 	self_attn->reset_cache();
 }
 
-void LlamaDecoderLayer::load_from_npz(const cnpy::npz_t& npz, const std::string& prefix) {
-	self_attn->load_from_npz(npz, prefix + ".self_attn");
-	mlp->load_from_npz(npz, prefix + ".mlp");
+void LlamaDecoderLayer::truncate_cache(size_t len) {
+	self_attn->truncate_cache(len);
+}
+
+void LlamaDecoderLayer::shift_cache(size_t drop, const Tensor<>& cos_cache, const Tensor<>& sin_cache) {
+	self_attn->shift_cache(drop, cos_cache, sin_cache);
+}
+
+void LlamaDecoderLayer::fork_cache(size_t batch) {
+	self_attn->fork_cache(batch);
+}
+
+void LlamaDecoderLayer::reorder_cache(const std::vector<size_t>& parents) {
+	self_attn->reorder_cache(parents);
+}
+
+void LlamaDecoderLayer::load_from_npz(const cnpy::npz_t& npz, const std::string& prefix,
+									  std::optional<tensor::PackedFormat> weight_format) {
+	self_attn->load_from_npz(npz, prefix + ".self_attn", weight_format);
+	mlp->load_from_npz(npz, prefix + ".mlp", weight_format);
 	input_layernorm->load_from_npz(npz, prefix + ".input_layernorm");
 	post_attention_layernorm->load_from_npz(npz, prefix + ".post_attention_layernorm");
 }
 
+size_t LlamaDecoderLayer::pack_weights(tensor::PackedFormat format) {
+	return self_attn->pack_weights(format) + mlp->pack_weights(format);
+}
+
+void LlamaDecoderLayer::load_from_file(const tensor::TensorFile& file, const std::string& prefix) {
+	self_attn->load_from_file(file, prefix + ".self_attn");
+	mlp->load_from_file(file, prefix + ".mlp");
+	input_layernorm->load_from_file(file, prefix + ".input_layernorm");
+	post_attention_layernorm->load_from_file(file, prefix + ".post_attention_layernorm");
+}
+
+void LlamaDecoderLayer::save_to_file(tensor::TensorFileWriter& writer, const std::string& prefix) const {
+	self_attn->save_to_file(writer, prefix + ".self_attn");
+	mlp->save_to_file(writer, prefix + ".mlp");
+	input_layernorm->save_to_file(writer, prefix + ".input_layernorm");
+	post_attention_layernorm->save_to_file(writer, prefix + ".post_attention_layernorm");
+}
+
 // ============================================================
 // LlamaModel
 // ============================================================
@@ -386,14 +1088,15 @@ LlamaModel::LlamaModel(size_t vocab_size, size_t hidden_size, size_t num_layers,
 						 size_t num_heads, size_t num_kv_heads, size_t intermediate_size,
 						 size_t max_position_embeddings,
 						 float rope_theta, float rms_norm_eps)
-	: num_layers(num_layers) {
+	: num_layers(num_layers), rope_theta(rope_theta) {
 
 	embed_tokens = std::make_shared<Embedding>(vocab_size, hidden_size);
 	register_sublayers("embed_tokens", embed_tokens);
 
 	for (size_t i = 0; i < num_layers; ++i) {
 		auto layer = std::make_shared<LlamaDecoderLayer>(
-			hidden_size, num_heads, num_kv_heads, intermediate_size, rms_norm_eps);
+			hidden_size, num_heads, num_kv_heads, intermediate_size, rms_norm_eps,
+			max_position_embeddings);
 		layers.push_back(layer);
 		register_sublayers("layers." + std::to_string(i), layer);
 	}
@@ -410,6 +1113,26 @@ LlamaModel::LlamaModel(size_t vocab_size, size_t hidden_size, size_t num_layers,
 }
 
 Variable LlamaModel::forward_ids(const std::vector<int>& token_ids, size_t position_offset) {
+	// Streaming cache: tokens past the free slots run one at a time, so each of them
+	// attends to the sinks and the full window right before it
+	std::shared_ptr<LlamaAttention> attn = num_layers > 0 ? layers[0]->get_self_attn() : nullptr;
+	if (attn && attn->is_streaming() && token_ids.size() > 1) {
+		size_t streamed = attn->get_stream_tokens();
+		size_t room = attn->stream_capacity() > streamed ? attn->stream_capacity() - streamed : 0;
+		if (token_ids.size() > room) {
+			std::vector<float> out;
+			for (size_t first = 0; first < token_ids.size();) {
+				size_t count = first == 0 && room > 0 ? room : 1;
+				std::vector<int> piece(token_ids.begin() + first, token_ids.begin() + first + count);
+				Tensor<> h = forward_ids(piece, position_offset + first).data().cpu();
+				out.insert(out.end(), h.raw_data().begin(), h.raw_data().end());
+				first += count;
+			}
+			size_t hidden_size = out.size() / token_ids.size();
+			return Variable(Tensor<>({1, token_ids.size(), hidden_size}, out));
+		}
+	}
+
 	using clock = std::chrono::high_resolution_clock;
 	bool profiling = dcz::Config::get().profile;
 
@@ -425,11 +1148,75 @@ Variable LlamaModel::forward_ids(const std::vector<int>& token_ids, size_t posit
 				  << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms" << std::endl;
 	}
 
+	return forward_layers(hidden_states, position_offset, nullptr);
+}
+
+Variable LlamaModel::forward_batch(const std::vector<int>& token_ids, const BatchLayout& layout) {
+	if (token_ids.size() != layout.num_tokens()) {
+		throw std::runtime_error("LlamaModel::forward_batch: expected " + std::to_string(layout.num_tokens())
+								+ " token ids, got " + std::to_string(token_ids.size()));
+	}
+	reset_cache();
+
+	Variable hidden_states = embed_tokens->forward_ids(token_ids);
+	return forward_layers(hidden_states, 0, &layout);
+}
+
+Variable LlamaModel::forward_step(const std::vector<int>& token_ids, size_t position_offset) {
+	if (token_ids.empty()) throw std::runtime_error("LlamaModel::forward_step: empty token_ids");
+	Variable hidden_states = embed_tokens->forward_ids(token_ids);
+	size_t hidden_size = hidden_states.shape().back();
+	hidden_states = Variable(hidden_states.data().reshape({token_ids.size(), 1, hidden_size}));
+	return forward_layers(hidden_states, position_offset, nullptr);
+}
+
+Variable LlamaModel::forward_layers(Variable hidden_states, size_t position_offset,
+									const BatchLayout* layout) {
+	using clock = std::chrono::high_resolution_clock;
+	bool profiling = dcz::Config::get().profile;
+
+	auto t0 = clock::now();
+
+	// Both keep one stream of state per model, which a session cannot take over
+	if (InferenceSession::current() && (tensor_parallel || streamer)) {
+		throw std::runtime_error("LlamaModel: tensor parallelism and weight streaming cannot run in an "
+								 "InferenceSession");
+	}
+	if (tensor_parallel) {
+		if (layout || dcz::Config::get().enable_backprop || !hidden_states.is_cpu()) {
+			throw std::runtime_error("LlamaModel: tensor parallelism runs single sequences on the CPU "
+									 "inference path only");
+		}
+		return Variable(tensor_parallel->forward(hidden_states.data(), position_offset));
+	}
+
+	// Inference on CPU: residual adds are fused into the following norm, including
+	// the model's final norm after the last layer
+	bool fused = !dcz::Config::get().enable_backprop && hidden_states.is_cpu() && num_layers > 0;
+	if (layout && !fused && num_layers > 0) {
+		throw std::runtime_error("LlamaModel: batched prompts run on the CPU inference path only "
+								 "(enable_backprop off)");
+	}
+	Tensor<> residual, normed;
+	if (fused) {
+		residual = hidden_states.data().contiguous();
+		normed = Tensor<>(residual.get_shape(), std::vector<float>(residual.size()));
+		layers[0]->get_input_layernorm()->forward_rows(residual.raw_data().data(), normed.raw_data().data(),
+													   residual.size() / residual.get_shape().back());
+	}
+
 	// 2. Pass through decoder layers
 	for (size_t i = 0; i < num_layers; ++i) {
 		auto tl0 = clock::now();
-		hidden_states = layers[i]->forward_with_cache(
-			hidden_states, cos_cache, sin_cache, position_offset);
+		if (streamer) streamer->begin(i);
+		if (fused) {
+			const LlamaRMSNorm& next_norm = i + 1 < num_layers ? *layers[i + 1]->get_input_layernorm() : *norm;
+			layers[i]->forward_fused(residual, normed, next_norm, cos_cache, sin_cache, position_offset, layout);
+		} else {
+			hidden_states = layers[i]->forward_with_cache(
+				hidden_states, cos_cache, sin_cache, position_offset);
+		}
+		if (streamer) streamer->end(i);
 		if (profiling) {
 			auto tl1 = clock::now();
 			std::cerr << "[Profile] Layer " << i << ": "
@@ -438,9 +1225,10 @@ Variable LlamaModel::forward_ids(const std::vector<int>& token_ids, size_t posit
 		}
 	}
 
-	// 3. Final norm
+	// 3. Final norm (already applied by the last layer on the fused path)
 	auto tn0 = clock::now();
-	hidden_states = (*norm)(hidden_states);
+	if (fused) hidden_states = Variable(normed);
+	else hidden_states = (*norm)(hidden_states);
 
 	if (profiling) {
 		auto tn1 = clock::now();
@@ -461,21 +1249,119 @@ Variable LlamaModel::forward(const std::vector<Variable>& xs) {
 }
 
 void LlamaModel::reset_cache() {
+	if (tensor_parallel) tensor_parallel->reset_cache();
 	for (auto& layer : layers) {
 		layer->reset_cache();
 	}
 }
 
-void LlamaModel::load_from_npz(const cnpy::npz_t& npz, const std::string& prefix) {
+void LlamaModel::set_kv_cache_format(KVCacheFormat format) {
+	if (tensor_parallel) tensor_parallel->set_kv_cache_format(format);
+	for (auto& layer : layers) {
+		layer->get_self_attn()->set_kv_cache_format(format);
+	}
+}
+
+void LlamaModel::truncate_cache(size_t len) {
+	if (tensor_parallel) {
+		tensor_parallel->truncate_cache(len);
+		return;
+	}
+	for (auto& layer : layers) {
+		layer->truncate_cache(len);
+	}
+}
+
+void LlamaModel::shift_cache(size_t drop) {
+	if (tensor_parallel)
+		throw std::runtime_error("LlamaModel::shift_cache: not supported with tensor parallelism");
+	for (auto& layer : layers) {
+		layer->shift_cache(drop, cos_cache, sin_cache);
+	}
+}
+
+void LlamaModel::set_streaming(size_t sink_tokens, size_t window_tokens) {
+	if (tensor_parallel)
+		throw std::runtime_error("LlamaModel::set_streaming: not supported with tensor parallelism");
+	for (auto& layer : layers) {
+		layer->get_self_attn()->set_streaming(sink_tokens, window_tokens, rope_theta);
+	}
+}
+
+void LlamaModel::set_tensor_parallel(std::shared_ptr<LlamaTensorParallel> tp) {
+	// The engine holding the projection weights hands them back before the next takes them
+	if (tensor_parallel) tensor_parallel->restore_model_weights();
+	// Drop both the old engine's and the layers' cached tokens
+	tensor_parallel = std::move(tp);
+	if (tensor_parallel) tensor_parallel->release_model_weights();
+	for (auto& layer : layers) {
+		layer->reset_cache();
+	}
+}
+
+void LlamaModel::fork_cache(size_t batch) {
+	if (tensor_parallel)
+		throw std::runtime_error("LlamaModel::fork_cache: not supported with tensor parallelism");
+	for (auto& layer : layers) {
+		layer->fork_cache(batch);
+	}
+}
+
+void LlamaModel::reorder_cache(const std::vector<size_t>& parents) {
+	if (tensor_parallel)
+		throw std::runtime_error("LlamaModel::reorder_cache: not supported with tensor parallelism");
+	for (auto& layer : layers) {
+		layer->reorder_cache(parents);
+	}
+}
+
+void LlamaModel::load_from_npz(const cnpy::npz_t& npz, const std::string& prefix,
+							   std::optional<tensor::PackedFormat> weight_format) {
+	if (tensor_parallel)
+		throw std::runtime_error("LlamaModel::load_from_npz: the projection weights are held by the tensor-parallel "
+								 "engine (turn it off first)");
 	embed_tokens->load_from_npz(npz, prefix + ".embed_tokens");
 
 	for (size_t i = 0; i < num_layers; ++i) {
-		layers[i]->load_from_npz(npz, prefix + ".layers." + std::to_string(i));
+		layers[i]->load_from_npz(npz, prefix + ".layers." + std::to_string(i), weight_format);
 	}
 
 	norm->load_from_npz(npz, prefix + ".norm");
 }
 
+size_t LlamaModel::pack_weights(tensor::PackedFormat format) {
+	if (tensor_parallel)
+		throw std::runtime_error("LlamaModel::pack_weights: the projection weights are held by the tensor-parallel "
+								 "engine (turn it off first)");
+	size_t bytes = 0;
+	for (auto& layer : layers) {
+		bytes += layer->pack_weights(format);
+	}
+	return bytes;
+}
+
+void LlamaModel::load_from_file(const tensor::TensorFile& file, const std::string& prefix) {
+	if (tensor_parallel)
+		throw std::runtime_error("LlamaModel::load_from_file: the projection weights are held by the tensor-parallel "
+								 "engine (turn it off first)");
+	embed_tokens->load_from_file(file, prefix + ".embed_tokens");
+	for (size_t i = 0; i < num_layers; ++i) {
+		layers[i]->load_from_file(file, prefix + ".layers." + std::to_string(i));
+	}
+	norm->load_from_file(file, prefix + ".norm");
+}
+
+void LlamaModel::save_to_file(tensor::TensorFileWriter& writer, const std::string& prefix) const {
+	if (tensor_parallel)
+		throw std::runtime_error("LlamaModel::save_to_file: the projection weights are held by the tensor-parallel "
+								 "engine (turn it off first)");
+	embed_tokens->save_to_file(writer, prefix + ".embed_tokens");
+	for (size_t i = 0; i < num_layers; ++i) {
+		layers[i]->save_to_file(writer, prefix + ".layers." + std::to_string(i));
+	}
+	norm->save_to_file(writer, prefix + ".norm");
+}
+
 } // namespace layer
 
 
@@ -488,18 +1374,17 @@ LlamaForCausalLM::LlamaForCausalLM(size_t vocab_size, size_t hidden_size,
 									 size_t num_kv_heads, size_t intermediate_size,
 									 size_t max_position_embeddings,
 									 float rope_theta, float rms_norm_eps)
+	: vocab_size(vocab_size), hidden_size(hidden_size)
 {
 	model = std::make_shared<layer::LlamaModel>(
 		vocab_size, hidden_size, num_layers, num_heads, num_kv_heads,
 		intermediate_size, max_position_embeddings, rope_theta, rms_norm_eps);
 
 	register_sublayers("model", model);
-
-	// Tie lm_head with embedding weights even before external weight loading.
-	lm_head_weight = model->get_embed_tokens()->get_weight().transpose({1, 0}).contiguous();
 }
 
-Variable LlamaForCausalLM::forward_ids(const std::vector<int>& token_ids, size_t position_offset) {
+Variable LlamaForCausalLM::forward_ids(const std::vector<int>& token_ids, size_t position_offset,
+									   const std::vector<size_t>& logits_positions) {
 	using clock = std::chrono::high_resolution_clock;
 	bool profiling = dcz::Config::get().profile;
 
@@ -510,16 +1395,24 @@ Variable LlamaForCausalLM::forward_ids(const std::vector<int>& token_ids, size_t
 
 	auto t1 = clock::now();
 
-	// Fallback for default-constructed/partially initialized states.
-	if (lm_head_weight.empty()) {
-		lm_head_weight = model->get_embed_tokens()->get_weight().transpose({1, 0}).contiguous();
+	// 2. Gather only the hidden rows that need logits before the lm_head GEMM
+	if (!logits_positions.empty()) {
+		auto shape = hidden_states.shape();  // [1, seq_len, hidden_size]
+		size_t seq_len = shape[1];
+		size_t hidden_size = shape[2];
+		for (size_t pos : logits_positions) {
+			if (pos >= seq_len) {
+				throw std::runtime_error("LlamaForCausalLM::forward_ids: logits position "
+										+ std::to_string(pos) + " out of range");
+			}
+		}
+		Tensor<> rows = hidden_states.data().reshape({seq_len, hidden_size})
+							.gather_rows(logits_positions).contiguous();
+		hidden_states = Variable(rows.reshape({1, logits_positions.size(), hidden_size}));
 	}
 
-	// 2. lm_head: tied with embed_tokens weight (cached transposed)
-	// Return logits for all provided positions: [batch, seq_len, vocab_size]
-
-	Variable lm_weight(lm_head_weight);
-	Variable logits = matmul(hidden_states, lm_weight);
+	// 3. lm_head for the selected positions: [batch, num_positions, vocab_size]
+	Variable logits = lm_head(hidden_states);
 
 	if (profiling) {
 		auto t2 = clock::now();
@@ -531,7 +1424,48 @@ Variable LlamaForCausalLM::forward_ids(const std::vector<int>& token_ids, size_t
 				  << std::chrono::duration<double, std::milli>(t2 - t0).count() << " ms" << std::endl;
 	}
 
-	return logits;  // [batch, seq_len, vocab_size]
+	return logits;  // [batch, num_positions, vocab_size]
+}
+
+Variable LlamaForCausalLM::prefill_batch(const std::vector<std::vector<int>>& prompts,
+										 layer::PaddingSide padding) {
+	std::vector<size_t> lengths;
+	for (const auto& p : prompts) lengths.push_back(p.size());
+	layer::BatchLayout layout(lengths, padding);
+
+	std::vector<int> ids;
+	ids.reserve(layout.num_tokens());
+	for (const auto& p : prompts) ids.insert(ids.end(), p.begin(), p.end());
+
+	Tensor<> hidden = model->forward_batch(ids, layout).data();
+	size_t hidden_size = hidden.get_shape().back();
+
+	// lm_head only over each row's last token
+	std::vector<size_t> last(prompts.size());
+	for (size_t b = 0; b < prompts.size(); ++b) last[b] = layout.last_token(b);
+	Tensor<> rows = hidden.reshape({layout.num_tokens(), hidden_size}).gather_rows(last).contiguous();
+	return lm_head(Variable(rows.reshape({prompts.size(), 1, hidden_size})));
+}
+
+Variable LlamaForCausalLM::lm_head(const Variable& hidden_states) const {
+	if (lm_head_proj)
+		return (*lm_head_proj)(hidden_states);
+	// Tied with embed_tokens weight [vocab_size, hidden_size], used directly through a
+	// transposed-B GEMM (no transposed copy)
+	if (auto rows = model->get_embed_tokens()->get_packed()) {
+		// Embedding rows kept packed (e.g. mapped from a tensor file): y = h @ rows^T
+		Tensor<> h = hidden_states.data();
+		Tensor<> y = packed_linear(h.is_device() ? h.cpu() : h, *rows);
+		return Variable(h.is_device() ? y.to(h.device()) : y);
+	}
+	Tensor<> embed_weight = model->get_embed_tokens()->get_weight();
+	return Variable(dot_nt(hidden_states.data(), embed_weight));
+}
+
+void LlamaForCausalLM::to(const dcz::Device& device) {
+	Model::to(device);
+	if (lm_head_proj)
+		lm_head_proj->to(device);
 }
 
 Variable LlamaForCausalLM::forward(const std::vector<Variable>& xs) {
@@ -539,19 +1473,209 @@ Variable LlamaForCausalLM::forward(const std::vector<Variable>& xs) {
 	throw std::runtime_error("LlamaForCausalLM::forward not supported. Use forward_ids().");
 }
 
+Variable LlamaForCausalLM::prefill(const std::vector<int>& token_ids, size_t position_offset,
+								   size_t chunk_size) {
+	if (token_ids.empty()) {
+		throw std::runtime_error("LlamaForCausalLM::prefill: empty token_ids");
+	}
+	if (chunk_size == 0 || chunk_size > token_ids.size()) chunk_size = token_ids.size();
+
+	// All chunks but the last only fill the KV cache (no lm_head)
+	size_t start = 0;
+	for (; start + chunk_size < token_ids.size(); start += chunk_size) {
+		std::vector<int> chunk(token_ids.begin() + start, token_ids.begin() + start + chunk_size);
+		model->forward_ids(chunk, position_offset + start);
+	}
+
+	std::vector<int> last(token_ids.begin() + start, token_ids.end());
+	return forward_ids(last, position_offset + start, {last.size() - 1});
+}
+
+size_t LlamaForCausalLM::pack_weights(tensor::PackedFormat format) {
+	return model->pack_weights(format);
+}
+
 void LlamaForCausalLM::reset_cache() {
 	model->reset_cache();
 }
 
-void LlamaForCausalLM::load_weights(const std::string& weights_path) {
+void LlamaForCausalLM::truncate_cache(size_t len) {
+	model->truncate_cache(len);
+}
+
+void LlamaForCausalLM::shift_cache(size_t drop) {
+	model->shift_cache(drop);
+}
+
+void LlamaForCausalLM::set_streaming(size_t sink_tokens, size_t window_tokens) {
+	model->set_streaming(sink_tokens, window_tokens);
+}
+
+bool LlamaForCausalLM::is_streaming() const {
+	return model->get_num_layers() > 0 && model->get_layer(0)->get_self_attn()->is_streaming();
+}
+
+void LlamaForCausalLM::fork_cache(size_t batch) {
+	model->fork_cache(batch);
+}
+
+void LlamaForCausalLM::reorder_cache(const std::vector<size_t>& parents) {
+	model->reorder_cache(parents);
+}
+
+Variable LlamaForCausalLM::forward_step(const std::vector<int>& token_ids, size_t position_offset) {
+	return lm_head(model->forward_step(token_ids, position_offset));
+}
+
+void LlamaForCausalLM::set_kv_cache_format(KVCacheFormat format) {
+	model->set_kv_cache_format(format);
+}
+
+KVCacheFormat LlamaForCausalLM::get_kv_cache_format() const {
+	if (model->get_num_layers() == 0) return KVCacheFormat::F32;
+	return model->get_layer(0)->get_self_attn()->get_kv_cache_format();
+}
+
+size_t LlamaForCausalLM::kv_cache_bytes_per_token() const {
+	size_t bytes = 0;
+	for (size_t i = 0; i < model->get_num_layers(); ++i)
+		bytes += model->get_layer(i)->get_self_attn()->kv_cache_bytes_per_token();
+	return bytes;
+}
+
+size_t LlamaForCausalLM::cache_len() const {
+	if (model->get_num_layers() == 0) return 0;
+	if (auto tp = model->get_tensor_parallel()) return tp->get_cache_len();
+	return model->get_layer(0)->get_self_attn()->get_cache_len();
+}
+
+// HF checkpoints store Linear and embedding weights as "<name>.weight" [out, in], which is
+// already the packed row layout (y = x W^T runs on rows directly). Aliasing them as
+// "<name>.W_<dtype>" lets the tensor file loaders pick them up without any transpose.
+static void alias_hf_weights(tensor::TensorFile& file) {
+	const std::string suffix = ".weight";
+	std::vector<std::pair<std::string, std::string>> aliases;
+	for (const auto& e : file.get_entries()) {
+		// Norm scales ("<norm>.weight", 1D) already match LlamaRMSNorm's own names
+		if (e.shape.size() != 2 || e.dtype == tensor::DType::U8 || e.name.size() <= suffix.size()
+			|| e.name.compare(e.name.size() - suffix.size(), suffix.size(), suffix) != 0)
+			continue;
+		std::string base = e.name.substr(0, e.name.size() - suffix.size());
+		aliases.emplace_back(base + ".W_" + tensor::dtype_name(e.dtype), e.name);
+	}
+	for (const auto& [alias, name] : aliases) file.add_alias(alias, name);
+}
+
+void LlamaForCausalLM::set_lm_head(std::shared_ptr<layer::Linear> head) {
+	const std::string what = "LlamaForCausalLM::load_weights: lm_head ";
+	if (auto rows = head->get_packed()) {
+		if (rows->get_cols() != hidden_size)
+			throw std::runtime_error(what + "has " + std::to_string(rows->get_cols())
+									 + " columns, expected " + std::to_string(hidden_size));
+	} else {
+		Tensor<> W = head->get_param("W").data();
+		if (W.empty()) return;
+		if (W.get_shape() != std::vector<size_t>{hidden_size, vocab_size})
+			throw std::runtime_error(what + "W must be [" + std::to_string(hidden_size) + ", "
+									 + std::to_string(vocab_size) + "]");
+	}
+	lm_head_proj = std::move(head);
+}
+
+// A tied checkpoint may still store lm_head: a byte-for-byte copy of the embedding
+static bool is_embedding_copy(const tensor::TensorFile& file, const std::string& head_name,
+							  const std::string& embed_name) {
+	const tensor::TensorFileEntry* head = file.find(head_name);
+	const tensor::TensorFileEntry* embed = file.find(embed_name);
+	return head && embed && head->dtype == embed->dtype && head->shape == embed->shape
+		&& head->nbytes == embed->nbytes
+		&& std::memcmp(file.data(*head), file.data(*embed), head->nbytes) == 0;
+}
+
+void LlamaForCausalLM::load_weights(const std::string& weights_path,
+									std::optional<tensor::PackedFormat> weight_format) {
 	std::cout << "Loading Llama weights from: " << weights_path << std::endl;
+	model->set_layer_streamer(nullptr);  // it tracks the previous mapping
+	model->set_tensor_parallel(nullptr);  // its shards are of the previous weights
+	bool safetensors = !tensor::TensorFile::is_tensor_file(weights_path)
+					 && tensor::TensorFile::is_safetensors(weights_path);
+	if (safetensors || tensor::TensorFile::is_tensor_file(weights_path)) {
+		// Only the index is read; packed weights stay in the (shared) page cache
+		auto file = safetensors ? tensor::TensorFile::open_safetensors(weights_path)
+								: tensor::TensorFile::open(weights_path);
+		std::cout << (safetensors ? "Safetensors" : "Tensor file") << " mapped, "
+				  << file->get_entries().size() << " tensors" << std::endl;
+		bool tied = false;
+		if (safetensors) {
+			alias_hf_weights(*file);
+			tied = is_embedding_copy(*file, "lm_head.weight", "model.embed_tokens.weight");
+			if (tied)
+				std::cout << "lm_head.weight equals embed_tokens; lm_head stays tied" << std::endl;
+		}
+		model->load_from_file(*file, "model");
+		lm_head_proj.reset();
+		if (!tied) {
+			auto head = std::make_shared<layer::Linear>(vocab_size, /*nobias=*/true, hidden_size);
+			head->load_params_from_file(*file, "lm_head");
+			set_lm_head(head);
+		}
+		if (lm_head_proj)
+			std::cout << "Untied lm_head loaded" << std::endl;
+		weights_file = file;
+		if (weight_format) {
+			model->pack_weights(*weight_format);
+			std::cout << "Decoder weights packed as " << tensor::packed_format_name(*weight_format) << std::endl;
+		}
+		std::cout << "Weights loaded successfully." << std::endl;
+		return;
+	}
+
+	weights_file.reset();
 	cnpy::npz_t npz = cnpy::npz_load(weights_path);
 	std::cout << "NPZ loaded, " << npz.size() << " arrays" << std::endl;
 
-	model->load_from_npz(npz, "model");
-
-	// Cache transposed embedding weight for lm_head (avoid recomputing every forward)
-	lm_head_weight = model->get_embed_tokens()->get_weight().transpose({1, 0}).contiguous();
+	model->load_from_npz(npz, "model", weight_format);
+	lm_head_proj.reset();
+	auto head = std::make_shared<layer::Linear>(vocab_size, /*nobias=*/true, hidden_size);
+	head->load_params_from_npz(npz, "lm_head");
+	set_lm_head(head);
+	if (lm_head_proj)
+		std::cout << "Untied lm_head loaded" << std::endl;
+	if (weight_format) {
+		std::cout << "Decoder weights packed as " << tensor::packed_format_name(*weight_format) << std::endl;
+	}
 
 	std::cout << "Weights loaded successfully." << std::endl;
 }
+
+void LlamaForCausalLM::enable_tensor_parallel(size_t num_groups) {
+	// Stop the old workers before the new ones copy their shards
+	model->set_tensor_parallel(nullptr);
+	// One group would only add the hand-off to its worker thread
+	if (num_groups > 1)
+		model->set_tensor_parallel(std::make_shared<layer::LlamaTensorParallel>(*model, num_groups));
+}
+
+void LlamaForCausalLM::enable_weight_streaming(size_t resident_layers) {
+	if (resident_layers == 0 || model->get_num_layers() == 0) {
+		model->set_layer_streamer(nullptr);
+		return;
+	}
+	if (!weights_file)
+		throw std::runtime_error("LlamaForCausalLM::enable_weight_streaming: weights were not "
+								 "loaded from a memory-mapped file");
+	std::vector<std::string> prefixes;
+	for (size_t i = 0; i < model->get_num_layers(); ++i)
+		prefixes.push_back("model.layers." + std::to_string(i));
+	// Drop the old streamer (and its reader thread) before starting a new one
+	model->set_layer_streamer(nullptr);
+	model->set_layer_streamer(std::make_shared<tensor::LayerStreamer>(weights_file, prefixes, resident_layers));
+}
+
+size_t LlamaForCausalLM::save_weights_file(const std::string& path) const {
+	tensor::TensorFileWriter writer;
+	model->save_to_file(writer, "model");
+	if (lm_head_proj)
+		lm_head_proj->save_params_to_file(writer, "lm_head");
+	return writer.save(path);
+}
@@ -0,0 +1,360 @@
+#include "container/layer/llama_parallel.hpp"
+#include "utils/attention.hpp"
+#include "utils/numa.hpp"
+#include "utils/rope.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+using namespace tensor;
+
+namespace layer {
+
+// Split total units into parts as even as possible; returns part p's [begin, end)
+static std::pair<size_t, size_t> even_split(size_t total, size_t parts, size_t p) {
+	size_t base = total / parts, extra = total % parts;
+	size_t begin = p * base + std::min(p, extra);
+	return {begin, begin + base + (p < extra ? 1 : 0)};
+}
+
+LlamaTensorParallel::LlamaTensorParallel(const LlamaModel& model, size_t num_groups) {
+	if (num_groups == 0) throw std::runtime_error("LlamaTensorParallel: num_groups must be positive");
+	if (model.get_num_layers() == 0) throw std::runtime_error("LlamaTensorParallel: model has no layers");
+
+	for (size_t i = 0; i < model.get_num_layers(); ++i) {
+		auto layer = model.get_layer(i);
+		auto attn = layer->get_self_attn();
+		auto mlp = layer->get_mlp();
+		if (!attn->is_fused() || !attn->get_o_proj()->is_packed()
+			|| !mlp->is_fused() || !mlp->get_down_proj()->is_packed()) {
+			throw std::runtime_error("LlamaTensorParallel: layer " + std::to_string(i)
+									+ " has unpacked projections (call pack_weights first)");
+		}
+		if (attn->is_streaming())
+			throw std::runtime_error("LlamaTensorParallel: streaming KV caches are not supported");
+		layers.push_back(layer);
+	}
+	final_norm = model.get_norm();
+	cos_cache = model.get_cos_cache().is_cpu() ? model.get_cos_cache() : model.get_cos_cache().cpu();
+	sin_cache = model.get_sin_cache().is_cpu() ? model.get_sin_cache() : model.get_sin_cache().cpu();
+
+	auto attn = layers[0]->get_self_attn();
+	num_heads = attn->get_num_heads();
+	num_kv_heads = attn->get_num_kv_heads();
+	head_dim = attn->get_head_dim();
+	max_seq_len = attn->get_max_seq_len();
+	kv_format = attn->get_kv_cache_format();
+	hidden_size = attn->get_o_proj()->get_packed()->get_rows();
+	intermediate_size = layers[0]->get_mlp()->get_gate_up_packed()->get_rows() / 2;
+	if (num_groups > num_kv_heads) {
+		throw std::runtime_error("LlamaTensorParallel: " + std::to_string(num_groups) + " groups for "
+								+ std::to_string(num_kv_heads) + " KV heads");
+	}
+
+	// Groups take the nodes round robin; groups sharing a node split its CPUs
+	std::vector<NumaNode> nodes = numa_nodes();
+	size_t inter_unit = intermediate_size % 32 == 0 ? 32 : 1;
+	for (size_t g = 0; g < num_groups; ++g) {
+		auto group = std::make_unique<Group>();
+		GroupInfo& info = group->info;
+		const NumaNode& node = nodes[g % nodes.size()];
+		size_t sharing = (num_groups - g % nodes.size() + nodes.size() - 1) / nodes.size();
+		size_t index = g / nodes.size();
+		info.node = node.id;
+		if (node.cpus.size() >= sharing) {
+			auto [first, last] = even_split(node.cpus.size(), sharing, index);
+			info.cpus.assign(node.cpus.begin() + first, node.cpus.begin() + last);
+		} else {
+			info.cpus = node.cpus;
+		}
+		std::tie(info.kv_head_begin, info.kv_head_end) = even_split(num_kv_heads, num_groups, g);
+		auto [unit_begin, unit_end] = even_split(intermediate_size / inter_unit, num_groups, g);
+		info.inter_begin = unit_begin * inter_unit;
+		info.inter_end = unit_end * inter_unit;
+		group->layers.resize(layers.size());
+		groups.push_back(std::move(group));
+	}
+
+	for (size_t g = 0; g < groups.size(); ++g)
+		groups[g]->thread = std::thread(&LlamaTensorParallel::worker, this, g);
+	try {
+		run(Job::Build);
+	} catch (...) {
+		stop();
+		throw;
+	}
+}
+
+LlamaTensorParallel::~LlamaTensorParallel() {
+	stop();
+}
+
+void LlamaTensorParallel::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = Job::Stop;
+		++generation;
+	}
+	cv.notify_all();
+	for (auto& group : groups)
+		if (group->thread.joinable()) group->thread.join();
+}
+
+void LlamaTensorParallel::run(Job what, size_t layer, size_t seq, size_t position, const float* input) {
+	std::unique_lock<std::mutex> lock(mutex);
+	job = what;
+	job_layer = layer;
+	job_seq = seq;
+	job_position = position;
+	job_input = input;
+	finished = 0;
+	error = nullptr;
+	++generation;
+	cv.notify_all();
+	cv.wait(lock, [&] { return finished == groups.size(); });
+	if (error) std::rethrow_exception(error);
+}
+
+void LlamaTensorParallel::worker(size_t g) {
+	Group& group = *groups[g];
+	// Before the first job: the shards this thread allocates land on its node
+	group.info.pinned = pin_current_thread(group.info.cpus);
+	omp_set_num_threads(static_cast<int>(std::max<size_t>(group.info.cpus.size(), 1)));
+
+	size_t seen = 0;
+	while (true) {
+		Job what;
+		size_t layer, seq, position;
+		const float* input;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [&] { return generation != seen; });
+			seen = generation;
+			what = job;
+			layer = job_layer;
+			seq = job_seq;
+			position = job_position;
+			input = job_input;
+		}
+		if (what == Job::Stop) return;
+
+		try {
+			switch (what) {
+				case Job::Build: build(group); break;
+				case Job::Attention: attention(group, layer, seq, position, input); break;
+				case Job::Mlp: mlp(group, layer, seq, input); break;
+				case Job::ResetCache:
+					for (LayerShard& shard : group.layers) {
+						shard.k_cache = KVCacheStore();
+						shard.v_cache = KVCacheStore();
+					}
+					break;
+				default: break;
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!error) error = std::current_exception();
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			++finished;
+		}
+		cv.notify_all();
+	}
+}
+
+void LlamaTensorParallel::build(Group& group) {
+	GroupInfo& info = group.info;
+	size_t q_per_kv = num_heads / num_kv_heads;
+	size_t q_dim = num_heads * head_dim, kv_dim = num_kv_heads * head_dim;
+	size_t q_begin = info.kv_head_begin * q_per_kv * head_dim, q_end = info.kv_head_end * q_per_kv * head_dim;
+	size_t kv_begin = info.kv_head_begin * head_dim, kv_end = info.kv_head_end * head_dim;
+
+	info.weight_bytes = 0;
+	for (size_t l = 0; l < layers.size(); ++l) {
+		auto attn = layers[l]->get_self_attn();
+		auto mlp = layers[l]->get_mlp();
+		const PackedTensor& qkv = *attn->get_qkv_packed();
+		const PackedTensor& gate_up = *mlp->get_gate_up_packed();
+
+		LayerShard& shard = group.layers[l];
+		shard.qkv = PackedTensor::concat_rows({qkv.row_slice(q_begin, q_end),
+											   qkv.row_slice(q_dim + kv_begin, q_dim + kv_end),
+											   qkv.row_slice(q_dim + kv_dim + kv_begin, q_dim + kv_dim + kv_end)});
+		shard.o = attn->get_o_proj()->get_packed()->column_slice(q_begin, q_end);
+		if (info.inter_end > info.inter_begin) {
+			shard.gate_up = PackedTensor::concat_rows(
+				{gate_up.row_slice(info.inter_begin, info.inter_end),
+				 gate_up.row_slice(intermediate_size + info.inter_begin, intermediate_size + info.inter_end)});
+			shard.down = mlp->get_down_proj()->get_packed()->column_slice(info.inter_begin, info.inter_end);
+		}
+		info.weight_bytes += shard.qkv.nbytes() + shard.o.nbytes() + shard.gate_up.nbytes() + shard.down.nbytes();
+	}
+}
+
+void LlamaTensorParallel::release_model_weights() {
+	for (auto& layer : layers) {
+		layer->get_self_attn()->release_weights();
+		layer->get_mlp()->release_weights();
+	}
+	holds_weights = true;
+}
+
+void LlamaTensorParallel::restore_model_weights() {
+	if (!holds_weights) return;
+	size_t q_per_kv = num_heads / num_kv_heads;
+	for (size_t l = 0; l < layers.size(); ++l) {
+		// qkv shards are [q; k; v] of the group's heads: regroup as all q, all k, all v
+		std::vector<PackedTensor> q, k, v, o, gate, up, down;
+		for (const auto& group : groups) {
+			const GroupInfo& info = group->info;
+			const LayerShard& shard = group->layers[l];
+			size_t kv_dim = (info.kv_head_end - info.kv_head_begin) * head_dim;
+			size_t q_dim = kv_dim * q_per_kv;
+			q.push_back(shard.qkv.row_slice(0, q_dim));
+			k.push_back(shard.qkv.row_slice(q_dim, q_dim + kv_dim));
+			v.push_back(shard.qkv.row_slice(q_dim + kv_dim, q_dim + 2 * kv_dim));
+			o.push_back(shard.o);
+			size_t width = info.inter_end - info.inter_begin;
+			if (width == 0) continue;  // no MLP share
+			gate.push_back(shard.gate_up.row_slice(0, width));
+			up.push_back(shard.gate_up.row_slice(width, 2 * width));
+			down.push_back(shard.down);
+		}
+		q.insert(q.end(), k.begin(), k.end());
+		q.insert(q.end(), v.begin(), v.end());
+		gate.insert(gate.end(), up.begin(), up.end());
+
+		auto attn = layers[l]->get_self_attn();
+		auto mlp = layers[l]->get_mlp();
+		attn->set_fused(std::make_shared<PackedTensor>(PackedTensor::concat_rows(q)));
+		attn->get_o_proj()->set_packed(std::make_shared<PackedTensor>(PackedTensor::concat_columns(o)));
+		mlp->set_fused(std::make_shared<PackedTensor>(PackedTensor::concat_rows(gate)));
+		mlp->get_down_proj()->set_packed(std::make_shared<PackedTensor>(PackedTensor::concat_columns(down)));
+	}
+	holds_weights = false;
+}
+
+void LlamaTensorParallel::attention(Group& group, size_t layer, size_t seq, size_t position, const float* input) {
+	LayerShard& shard = group.layers[layer];
+	size_t kv_heads = group.info.kv_head_end - group.info.kv_head_begin;
+	size_t heads = kv_heads * (num_heads / num_kv_heads);
+	size_t q_dim = heads * head_dim, kv_dim = kv_heads * head_dim;
+	size_t qkv_dim = q_dim + 2 * kv_dim;
+
+	// Grow like LlamaAttention (512 tokens first, then doubling); reallocated here so
+	// the rows stay on this group's node
+	size_t needed = cache_len + seq;
+	if (shard.k_cache.empty() || shard.k_cache.get_capacity() < needed) {
+		size_t capacity = std::max<size_t>(shard.k_cache.get_capacity(), std::min<size_t>(512, max_seq_len));
+		while (capacity < needed) capacity *= 2;
+		capacity = std::min(capacity, max_seq_len);
+		if (shard.k_cache.empty()) {
+			shard.k_cache = KVCacheStore(kv_format, 1, capacity, kv_heads, head_dim);
+			shard.v_cache = KVCacheStore(kv_format, 1, capacity, kv_heads, head_dim);
+		} else {
+			shard.k_cache.grow(capacity, cache_len);
+			shard.v_cache.grow(capacity, cache_len);
+		}
+	}
+
+	group.qkv.resize(seq * qkv_dim);
+	packed_matmul(input, seq, shard.qkv, group.qkv.data());
+
+	const float* cos_data = cos_cache.raw_data().data();
+	const float* sin_data = sin_cache.raw_data().data();
+	bool k_in_place = kv_format == KVCacheFormat::F32;
+	std::vector<float> k_rot(k_in_place ? 0 : seq * kv_dim);
+	group.q.resize(seq * q_dim);
+	#pragma omp parallel for schedule(static) if (seq > 1)
+	for (long s = 0; s < static_cast<long>(seq); ++s) {
+		const float* row = group.qkv.data() + s * qkv_dim;
+		const float* cos_row = cos_data + (position + s) * head_dim;
+		const float* sin_row = sin_data + (position + s) * head_dim;
+		rope_rotate_row(row, group.q.data() + s * q_dim, heads, head_dim, cos_row, sin_row);
+		size_t slot = cache_len + s;
+		float* k_dst = k_in_place ? shard.k_cache.f32_row(0, slot) : k_rot.data() + s * kv_dim;
+		rope_rotate_row(row + q_dim, k_dst, kv_heads, head_dim, cos_row, sin_row);
+		if (!k_in_place) shard.k_cache.write_row(0, slot, k_dst);
+		shard.v_cache.write_row(0, slot, row + q_dim + kv_dim);
+	}
+
+	group.attn.resize(seq * q_dim);
+	cached_attention_cpu(group.q.data(), shard.k_cache.view(0), shard.v_cache.view(0), group.attn.data(),
+						 seq, cache_len, heads, kv_heads, head_dim,
+						 1.0f / std::sqrt(static_cast<float>(head_dim)));
+
+	group.partial.resize(seq * hidden_size);
+	packed_matmul(group.attn.data(), seq, shard.o, group.partial.data());
+}
+
+void LlamaTensorParallel::mlp(Group& group, size_t layer, size_t seq, const float* input) {
+	LayerShard& shard = group.layers[layer];
+	size_t width = group.info.inter_end - group.info.inter_begin;
+	group.partial.assign(seq * hidden_size, 0.0f);
+	if (width == 0) return;
+
+	group.h.resize(seq * width);
+	packed_matmul_swiglu(input, seq, shard.gate_up, group.h.data());
+	packed_matmul(group.h.data(), seq, shard.down, group.partial.data());
+}
+
+Tensor<> LlamaTensorParallel::forward(const Tensor<>& embedded, size_t position_offset) {
+	auto shape = embedded.get_shape();
+	if (shape.size() != 3 || shape[0] != 1 || shape[2] != hidden_size)
+		throw std::runtime_error("LlamaTensorParallel::forward: expected hidden states [1, seq, hidden]");
+	size_t seq = shape[1];
+	if (cache_len + seq > max_seq_len || position_offset + seq > max_seq_len) {
+		throw std::runtime_error("LlamaTensorParallel: sequence length " + std::to_string(cache_len + seq)
+								+ " exceeds max_position_embeddings " + std::to_string(max_seq_len));
+	}
+
+	size_t n = seq * hidden_size;
+	Tensor<> input = embedded.contiguous();
+	std::vector<float> residual(input.raw_data().begin(), input.raw_data().begin() + n);
+	std::vector<float> normed(n), delta(n);
+
+	// Partials of all groups -> delta, in a fixed order
+	auto reduce = [&] {
+		#pragma omp parallel for schedule(static) if (n > 16384)
+		for (long i = 0; i < static_cast<long>(n); ++i) {
+			float sum = groups[0]->partial[i];
+			for (size_t g = 1; g < groups.size(); ++g) sum += groups[g]->partial[i];
+			delta[i] = sum;
+		}
+	};
+
+	layers[0]->get_input_layernorm()->forward_rows(residual.data(), normed.data(), seq);
+	for (size_t l = 0; l < layers.size(); ++l) {
+		run(Job::Attention, l, seq, position_offset, normed.data());
+		reduce();
+		layers[l]->get_post_attention_layernorm()->add_forward_rows(residual.data(), delta.data(), normed.data(), seq);
+
+		run(Job::Mlp, l, seq, 0, normed.data());
+		reduce();
+		const LlamaRMSNorm& next_norm = l + 1 < layers.size() ? *layers[l + 1]->get_input_layernorm() : *final_norm;
+		next_norm.add_forward_rows(residual.data(), delta.data(), normed.data(), seq);
+	}
+	cache_len += seq;
+	return Tensor<>({1, seq, hidden_size}, normed);
+}
+
+void LlamaTensorParallel::reset_cache() {
+	cache_len = 0;
+}
+
+void LlamaTensorParallel::truncate_cache(size_t len) {
+	cache_len = std::min(cache_len, len);
+}
+
+void LlamaTensorParallel::set_kv_cache_format(KVCacheFormat format) {
+	kv_format = format;
+	cache_len = 0;
+	run(Job::ResetCache);
+}
+
+} // namespace layer
@@ -0,0 +1,26 @@
+#include "container/layer/session.hpp"
+
+namespace layer {
+
+static thread_local InferenceSession* bound_session = nullptr;
+
+InferenceSession* InferenceSession::current() {
+	return bound_session;
+}
+
+void InferenceSession::bind(InferenceSession* session) {
+	bound_session = session;
+}
+
+UsingSession::UsingSession(InferenceSession& session)
+	: previous(InferenceSession::current()),
+	  train("train", session.train),
+	  enable_backprop("enable_backprop", session.enable_backprop) {
+	InferenceSession::bind(&session);
+}
+
+UsingSession::~UsingSession() {
+	InferenceSession::bind(previous);
+}
+
+} // namespace layer
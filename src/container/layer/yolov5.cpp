@@ -243,6 +243,12 @@ YOLOv5::YOLOv5(size_t num_classes, float depth_multiple, float width_multiple, b
 	}
 }
 
+std::vector<Variable>& YOLOv5::detection_state() const {
+	layer::InferenceSession* session = layer::InferenceSession::current();
+	if (session) return session->state<std::vector<Variable>>(this);
+	return const_cast<std::vector<Variable>&>(detection_outputs);
+}
+
 std::vector<Variable> YOLOv5::forward_detect(const Variable& x) {
 	// Backbone
 	Variable b0 = (*backbone_0)(x);    // /2
@@ -279,8 +285,9 @@ std::vector<Variable> YOLOv5::forward_detect(const Variable& x) {
 	Variable p4 = (*detect_p4)(n20);
 	Variable p5 = (*detect_p5)(n23);
 
-	detection_outputs = {p3, p4, p5};
-	return detection_outputs;
+	std::vector<Variable>& outputs = detection_state();
+	outputs = {p3, p4, p5};
+	return outputs;
 }
 
 Variable YOLOv5::forward(const std::vector<Variable>& xs) {
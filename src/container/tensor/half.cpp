@@ -0,0 +1,155 @@
+#include "container/tensor/half.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace tensor {
+
+// ============================================================
+// SIMD kernels
+// ============================================================
+
+#if defined(__x86_64__)
+// VCVTNEPS2BF16 rounds to nearest even like the scalar path, but treats
+// denormal inputs as zero (irrelevant for weights, which are all normal)
+__attribute__((target("avx512f,avx512bf16")))
+static size_t fp32_to_bf16_avx512(const float* src, bf16* dst, size_t n) {
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m256bh r = _mm512_cvtneps_pbh(_mm512_loadu_ps(src + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), reinterpret_cast<__m256i&>(r));
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static size_t fp32_to_bf16_avx2(const float* src, bf16* dst, size_t n) {
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i bias = _mm256_set1_epi32(0x7fff);
+	const __m256i quiet = _mm256_set1_epi32(0x40);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 v = _mm256_loadu_ps(src + i);
+		__m256i u = _mm256_castps_si256(v);
+		__m256i lsb = _mm256_and_si256(_mm256_srli_epi32(u, 16), one);
+		__m256i r = _mm256_srli_epi32(_mm256_add_epi32(u, _mm256_add_epi32(bias, lsb)), 16);
+		__m256i nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+		r = _mm256_blendv_epi8(r, _mm256_or_si256(_mm256_srli_epi32(u, 16), quiet), nan);
+		__m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static size_t bf16_to_fp32_avx2(const bf16* src, float* dst, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		__m256i u = _mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16);
+		_mm256_storeu_ps(dst + i, _mm256_castsi256_ps(u));
+	}
+	return i;
+}
+
+__attribute__((target("avx,f16c")))
+static size_t fp32_to_fp16_f16c(const float* src, fp16* dst, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+	}
+	return i;
+}
+
+__attribute__((target("avx,f16c")))
+static size_t fp16_to_fp32_f16c(const fp16* src, float* dst, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+	}
+	return i;
+}
+#endif
+
+// ============================================================
+// Bulk conversions
+// ============================================================
+
+void fp32_to_bf16_row(const float* src, bf16* dst, size_t n) {
+	size_t i = 0;
+#if defined(__x86_64__)
+	static const bool has_avx512_bf16 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bf16");
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+	if (has_avx512_bf16) i = fp32_to_bf16_avx512(src, dst, n);
+	else if (has_avx2) i = fp32_to_bf16_avx2(src, dst, n);
+#endif
+	for (; i < n; ++i) dst[i].bits = fp32_to_bf16(src[i]);
+}
+
+void bf16_to_fp32_row(const bf16* src, float* dst, size_t n) {
+	size_t i = 0;
+#if defined(__x86_64__)
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+	if (has_avx2) i = bf16_to_fp32_avx2(src, dst, n);
+#endif
+	for (; i < n; ++i) dst[i] = bf16_to_fp32(src[i].bits);
+}
+
+void fp32_to_fp16_row(const float* src, fp16* dst, size_t n) {
+	size_t i = 0;
+#if defined(__x86_64__)
+	static const bool has_f16c = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+	if (has_f16c) i = fp32_to_fp16_f16c(src, dst, n);
+#endif
+	for (; i < n; ++i) dst[i].bits = fp32_to_fp16(src[i]);
+}
+
+void fp16_to_fp32_row(const fp16* src, float* dst, size_t n) {
+	size_t i = 0;
+#if defined(__x86_64__)
+	static const bool has_f16c = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+	if (has_f16c) i = fp16_to_fp32_f16c(src, dst, n);
+#endif
+	for (; i < n; ++i) dst[i] = fp16_to_fp32(src[i].bits);
+}
+
+// ============================================================
+// Tensor conversions
+// ============================================================
+
+Tensor<bf16> to_bf16(const Tensor<>& x) {
+	Tensor<> c = x.is_device() ? x.cpu() : x.contiguous();
+	const auto& src = c.raw_data();
+	std::vector<bf16> dst(src.size());
+	fp32_to_bf16_row(src.data(), dst.data(), src.size());
+	return Tensor<bf16>(c.get_shape(), dst);
+}
+
+Tensor<fp16> to_fp16(const Tensor<>& x) {
+	Tensor<> c = x.is_device() ? x.cpu() : x.contiguous();
+	const auto& src = c.raw_data();
+	std::vector<fp16> dst(src.size());
+	fp32_to_fp16_row(src.data(), dst.data(), src.size());
+	return Tensor<fp16>(c.get_shape(), dst);
+}
+
+Tensor<> to_fp32(const Tensor<bf16>& x) {
+	Tensor<bf16> c = x.contiguous();
+	const auto& src = c.raw_data();
+	std::vector<float> dst(src.size());
+	bf16_to_fp32_row(src.data(), dst.data(), src.size());
+	return Tensor<>(c.get_shape(), dst);
+}
+
+Tensor<> to_fp32(const Tensor<fp16>& x) {
+	Tensor<fp16> c = x.contiguous();
+	const auto& src = c.raw_data();
+	std::vector<float> dst(src.size());
+	fp16_to_fp32_row(src.data(), dst.data(), src.size());
+	return Tensor<>(c.get_shape(), dst);
+}
+
+} // namespace tensor
@@ -0,0 +1,167 @@
+#include "container/tensor/layer_streamer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace tensor {
+
+static size_t page_size() {
+	static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return size;
+}
+
+static uintptr_t page_down(const uint8_t* p) {
+	return reinterpret_cast<uintptr_t>(p) / page_size() * page_size();
+}
+
+static uintptr_t page_up(const uint8_t* p) {
+	return (reinterpret_cast<uintptr_t>(p) + page_size() - 1) / page_size() * page_size();
+}
+
+LayerStreamer::LayerStreamer(std::shared_ptr<const TensorFile> file_, const std::vector<std::string>& layer_prefixes,
+							 size_t resident_layers_)
+	: file(std::move(file_)), layers(layer_prefixes.size()),
+	  resident_layers(std::min(std::max<size_t>(resident_layers_, 1), layer_prefixes.size())),
+	  state(layer_prefixes.size(), State::Released) {
+	if (!file) throw std::runtime_error("LayerStreamer: no tensor file");
+	if (layer_prefixes.empty()) throw std::runtime_error("LayerStreamer: no layers");
+
+	for (const auto& e : file->get_entries()) {
+		for (size_t i = 0; i < layer_prefixes.size(); ++i) {
+			const std::string& prefix = layer_prefixes[i];
+			if (e.name.size() > prefix.size() && e.name[prefix.size()] == '.'
+				&& e.name.compare(0, prefix.size(), prefix) == 0) {
+				const uint8_t* p = file->data(e);
+				layers[i].push_back({p, p + e.nbytes});
+				break;
+			}
+		}
+	}
+
+	// Merge ranges that share pages so each page is advised once
+	for (auto& ranges : layers) {
+		std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.begin < b.begin; });
+		std::vector<Range> merged;
+		for (const Range& r : ranges) {
+			if (!merged.empty() && page_down(r.begin) <= page_up(merged.back().end))
+				merged.back().end = std::max(merged.back().end, r.end);
+			else
+				merged.push_back(r);
+		}
+		ranges = std::move(merged);
+	}
+
+	reader = std::thread(&LayerStreamer::run, this);
+	std::lock_guard<std::mutex> lock(mutex);
+	for (size_t i = 0; i < resident_layers; ++i) enqueue(i);
+}
+
+LayerStreamer::~LayerStreamer() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	cv.notify_all();
+	reader.join();
+}
+
+size_t LayerStreamer::layer_bytes(size_t layer) const {
+	size_t bytes = 0;
+	for (const Range& r : layers.at(layer)) bytes += r.end - r.begin;
+	return bytes;
+}
+
+LayerStreamer::Stats LayerStreamer::get_stats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void LayerStreamer::enqueue(size_t layer) {
+	if (state[layer] != State::Released) return;
+	state[layer] = State::Queued;
+	queue.push_back(layer);
+	cv.notify_all();
+}
+
+void LayerStreamer::begin(size_t layer) {
+	auto t0 = std::chrono::high_resolution_clock::now();
+	std::unique_lock<std::mutex> lock(mutex);
+	bool waited = false;
+	if (state.at(layer) == State::Released || state[layer] == State::Queued) {
+		// Not read ahead (first call, or the reader is behind): fault it in here
+		if (state[layer] == State::Released) ++stats.cold_misses;
+		else queue.erase(std::find(queue.begin(), queue.end(), layer));
+		state[layer] = State::Loading;
+		lock.unlock();
+		load(layer);
+		lock.lock();
+		state[layer] = State::Resident;
+		waited = true;
+	} else if (state[layer] == State::Loading) {
+		cv.wait(lock, [&] { return state[layer] == State::Resident; });
+		waited = true;
+	}
+	if (waited) {
+		stats.stall_ms += std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - t0).count();
+	}
+
+	for (size_t ahead = 1; ahead < resident_layers; ++ahead)
+		enqueue((layer + ahead) % layers.size());
+}
+
+void LayerStreamer::end(size_t layer) {
+	if (resident_layers >= layers.size()) return;  // everything fits: keep it mapped in
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (state.at(layer) != State::Resident) return;
+		state[layer] = State::Released;
+		++stats.released;
+	}
+	release(layer);
+}
+
+void LayerStreamer::run() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		cv.wait(lock, [&] { return stopping || !queue.empty(); });
+		if (stopping) return;
+		size_t layer = queue.front();
+		queue.pop_front();
+		state[layer] = State::Loading;
+		lock.unlock();
+		load(layer);
+		lock.lock();
+		state[layer] = State::Resident;
+		++stats.prefetched;
+		cv.notify_all();
+	}
+}
+
+void LayerStreamer::load(size_t layer) const {
+	for (const Range& r : layers[layer]) {
+		uintptr_t begin = page_down(r.begin);
+		madvise(reinterpret_cast<void*>(begin), page_up(r.end) - begin, MADV_WILLNEED);
+		// WILLNEED only starts readahead; touching every page makes the layer resident
+		// before begin() hands it to the compute thread
+		volatile uint8_t sink = 0;
+		for (const uint8_t* p = r.begin; p < r.end; p += page_size()) sink = sink + *p;
+		if (r.end > r.begin) sink = sink + r.end[-1];
+		(void)sink;
+	}
+}
+
+void LayerStreamer::release(size_t layer) const {
+	for (const Range& r : layers[layer]) {
+		// Whole pages only: a page shared with another layer's tensor stays mapped
+		uintptr_t begin = page_up(r.begin);
+		uintptr_t end = page_down(r.end);
+		if (end > begin) madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+	}
+}
+
+} // namespace tensor
@@ -0,0 +1,859 @@
+#include "container/tensor/packed_tensor.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace tensor {
+
+static constexpr size_t QK = 32;  // weights per quantization block
+
+struct BlockQ8_0 {
+	uint16_t d;      // fp16 scale
+	int8_t qs[QK];
+};
+static_assert(sizeof(BlockQ8_0) == 34, "BlockQ8_0 must be packed");
+
+// qs[j] low nibble = weight j, high nibble = weight j + 16
+struct BlockQ4_0 {
+	uint16_t d;      // fp16 scale
+	uint8_t qs[QK / 2];
+};
+static_assert(sizeof(BlockQ4_0) == 18, "BlockQ4_0 must be packed");
+
+struct BlockQ4_1 {
+	uint16_t d;      // fp16 scale
+	uint16_t m;      // fp16 min
+	uint8_t qs[QK / 2];
+};
+static_assert(sizeof(BlockQ4_1) == 20, "BlockQ4_1 must be packed");
+
+// Activations quantized on the fly for the integer 4-bit kernels; s = d * sum(qs)
+struct BlockQ8X {
+	float d;
+	float s;
+	int8_t qs[QK];
+};
+
+// ============================================================
+// Format helpers
+// ============================================================
+
+const char* packed_format_name(PackedFormat format) {
+	switch (format) {
+		case PackedFormat::F32: return "f32";
+		case PackedFormat::BF16: return "bf16";
+		case PackedFormat::F16: return "f16";
+		case PackedFormat::Q8_0: return "q8_0";
+		case PackedFormat::Q4_0: return "q4_0";
+		case PackedFormat::Q4_1: return "q4_1";
+	}
+	return "unknown";
+}
+
+PackedFormat packed_format_from_name(const std::string& name) {
+	if (name == "f32") return PackedFormat::F32;
+	if (name == "bf16") return PackedFormat::BF16;
+	if (name == "f16" || name == "fp16") return PackedFormat::F16;
+	if (name == "q8_0" || name == "int8") return PackedFormat::Q8_0;
+	if (name == "q4_0" || name == "q4") return PackedFormat::Q4_0;
+	if (name == "q4_1") return PackedFormat::Q4_1;
+	throw std::runtime_error("Unknown packed format: " + name);
+}
+
+size_t PackedTensor::row_size(PackedFormat format, size_t cols) {
+	switch (format) {
+		case PackedFormat::F32:
+			return cols * sizeof(float);
+		case PackedFormat::BF16:
+		case PackedFormat::F16:
+			return cols * sizeof(uint16_t);
+		case PackedFormat::Q8_0:
+		case PackedFormat::Q4_0:
+		case PackedFormat::Q4_1:
+			break;
+	}
+	if (cols % QK != 0) {
+		throw std::runtime_error(std::string("PackedTensor: ") + packed_format_name(format)
+								+ " needs cols divisible by 32, got " + std::to_string(cols));
+	}
+	switch (format) {
+		case PackedFormat::Q8_0: return cols / QK * sizeof(BlockQ8_0);
+		case PackedFormat::Q4_0: return cols / QK * sizeof(BlockQ4_0);
+		case PackedFormat::Q4_1: return cols / QK * sizeof(BlockQ4_1);
+		default: break;
+	}
+	throw std::runtime_error("PackedTensor: unknown format");
+}
+
+size_t PackedTensor::cols_for_row_bytes(PackedFormat format, size_t row_bytes) {
+	switch (format) {
+		case PackedFormat::F32:
+		case PackedFormat::BF16:
+		case PackedFormat::F16:
+			return row_bytes / row_size(format, 1);
+		default:
+			return row_bytes / row_size(format, QK) * QK;
+	}
+}
+
+static void quantize_row_q8_0(const float* src, BlockQ8_0* dst, size_t cols) {
+	for (size_t b = 0; b < cols / QK; ++b) {
+		const float* x = src + b * QK;
+		float amax = 0.0f;
+		for (size_t j = 0; j < QK; ++j) amax = std::max(amax, std::abs(x[j]));
+		float d = amax / 127.0f;
+		float id = d > 0.0f ? 1.0f / d : 0.0f;
+		dst[b].d = fp32_to_fp16(d);
+		for (size_t j = 0; j < QK; ++j)
+			dst[b].qs[j] = static_cast<int8_t>(std::lround(x[j] * id));
+	}
+}
+
+// Scale from the signed value of largest magnitude so it maps to -8 exactly
+static void quantize_row_q4_0(const float* src, BlockQ4_0* dst, size_t cols) {
+	for (size_t b = 0; b < cols / QK; ++b) {
+		const float* x = src + b * QK;
+		float max = 0.0f;
+		for (size_t j = 0; j < QK; ++j)
+			if (std::abs(x[j]) > std::abs(max)) max = x[j];
+		float d = max / -8.0f;
+		float id = d != 0.0f ? 1.0f / d : 0.0f;
+		dst[b].d = fp32_to_fp16(d);
+		for (size_t j = 0; j < QK / 2; ++j) {
+			int q0 = std::min(15, static_cast<int>(x[j] * id + 8.5f));
+			int q1 = std::min(15, static_cast<int>(x[j + QK / 2] * id + 8.5f));
+			dst[b].qs[j] = static_cast<uint8_t>(q0 | (q1 << 4));
+		}
+	}
+}
+
+static void quantize_row_q4_1(const float* src, BlockQ4_1* dst, size_t cols) {
+	for (size_t b = 0; b < cols / QK; ++b) {
+		const float* x = src + b * QK;
+		float min = x[0], max = x[0];
+		for (size_t j = 1; j < QK; ++j) {
+			min = std::min(min, x[j]);
+			max = std::max(max, x[j]);
+		}
+		float d = (max - min) / 15.0f;
+		float id = d != 0.0f ? 1.0f / d : 0.0f;
+		dst[b].d = fp32_to_fp16(d);
+		dst[b].m = fp32_to_fp16(min);
+		for (size_t j = 0; j < QK / 2; ++j) {
+			int q0 = std::min(15, static_cast<int>((x[j] - min) * id + 0.5f));
+			int q1 = std::min(15, static_cast<int>((x[j + QK / 2] - min) * id + 0.5f));
+			dst[b].qs[j] = static_cast<uint8_t>(q0 | (q1 << 4));
+		}
+	}
+}
+
+PackedTensor PackedTensor::allocate(size_t rows, size_t cols, PackedFormat format, uint8_t*& data) {
+	PackedTensor t;
+	t.format = format;
+	t.rows = rows;
+	t.cols = cols;
+	t.row_bytes = row_size(format, cols);
+	auto buffer = std::make_shared<std::vector<uint8_t>>(rows * t.row_bytes);
+	data = buffer->data();
+	t.base = data;
+	t.owner = std::move(buffer);
+	return t;
+}
+
+PackedTensor PackedTensor::from_rows(const float* src, size_t rows, size_t cols, PackedFormat format) {
+	uint8_t* data = nullptr;
+	PackedTensor t = allocate(rows, cols, format, data);
+
+	const long n_rows = static_cast<long>(rows);
+	#pragma omp parallel for schedule(static)
+	for (long r = 0; r < n_rows; ++r) {
+		const float* row = src + r * cols;
+		uint8_t* dst = data + r * t.row_bytes;
+		switch (format) {
+			case PackedFormat::F32:
+				std::memcpy(dst, row, cols * sizeof(float));
+				break;
+			case PackedFormat::BF16:
+				fp32_to_bf16_row(row, reinterpret_cast<bf16*>(dst), cols);
+				break;
+			case PackedFormat::F16:
+				fp32_to_fp16_row(row, reinterpret_cast<fp16*>(dst), cols);
+				break;
+			case PackedFormat::Q8_0:
+				quantize_row_q8_0(row, reinterpret_cast<BlockQ8_0*>(dst), cols);
+				break;
+			case PackedFormat::Q4_0:
+				quantize_row_q4_0(row, reinterpret_cast<BlockQ4_0*>(dst), cols);
+				break;
+			case PackedFormat::Q4_1:
+				quantize_row_q4_1(row, reinterpret_cast<BlockQ4_1*>(dst), cols);
+				break;
+		}
+	}
+	return t;
+}
+
+template<typename H>
+static PackedTensor from_half_rows(const Tensor<H>& rows, PackedFormat format) {
+	if (rows.ndim() != 2)
+		throw std::runtime_error("PackedTensor::from_rows: expected [rows, cols]");
+	Tensor<H> c = rows.contiguous();
+	const auto& data = c.raw_data();
+	return PackedTensor::from_packed_bytes(reinterpret_cast<const uint8_t*>(data.data()),
+										   c.get_shape()[0], c.get_shape()[1], format);
+}
+
+PackedTensor PackedTensor::from_rows(const Tensor<bf16>& rows) {
+	return from_half_rows(rows, PackedFormat::BF16);
+}
+
+PackedTensor PackedTensor::from_rows(const Tensor<fp16>& rows) {
+	return from_half_rows(rows, PackedFormat::F16);
+}
+
+PackedTensor PackedTensor::from_packed_bytes(const uint8_t* src, size_t rows, size_t cols, PackedFormat format) {
+	uint8_t* data = nullptr;
+	PackedTensor t = allocate(rows, cols, format, data);
+	std::memcpy(data, src, t.nbytes());
+	return t;
+}
+
+PackedTensor PackedTensor::view(std::shared_ptr<const void> owner, const uint8_t* data,
+								size_t rows, size_t cols, PackedFormat format) {
+	PackedTensor t;
+	t.format = format;
+	t.rows = rows;
+	t.cols = cols;
+	t.row_bytes = row_size(format, cols);
+	t.base = data;
+	t.owner = std::move(owner);
+	return t;
+}
+
+PackedTensor PackedTensor::concat_rows(const std::vector<PackedTensor>& parts) {
+	if (parts.empty()) throw std::runtime_error("PackedTensor::concat_rows: no parts");
+	size_t rows = 0;
+	for (const auto& p : parts) {
+		if (p.format != parts[0].format || p.cols != parts[0].cols)
+			throw std::runtime_error("PackedTensor::concat_rows: parts differ in format or cols");
+		rows += p.rows;
+	}
+	uint8_t* data = nullptr;
+	PackedTensor t = allocate(rows, parts[0].cols, parts[0].format, data);
+	for (const auto& p : parts) {
+		std::memcpy(data, p.base, p.nbytes());
+		data += p.nbytes();
+	}
+	return t;
+}
+
+PackedTensor PackedTensor::concat_columns(const std::vector<PackedTensor>& parts) {
+	if (parts.empty()) throw std::runtime_error("PackedTensor::concat_columns: no parts");
+	size_t cols = 0, row_bytes = 0;
+	for (const auto& p : parts) {
+		if (p.format != parts[0].format || p.rows != parts[0].rows)
+			throw std::runtime_error("PackedTensor::concat_columns: parts differ in format or rows");
+		cols += p.cols;
+		row_bytes += p.row_bytes;
+	}
+	if (row_bytes != row_size(parts[0].format, cols))
+		throw std::runtime_error("PackedTensor::concat_columns: parts do not end on block boundaries");
+	uint8_t* data = nullptr;
+	PackedTensor t = allocate(parts[0].rows, cols, parts[0].format, data);
+	for (size_t r = 0; r < t.rows; ++r) {
+		uint8_t* dst = data + r * t.row_bytes;
+		for (const auto& p : parts) {
+			std::memcpy(dst, p.row_ptr(r), p.row_bytes);
+			dst += p.row_bytes;
+		}
+	}
+	return t;
+}
+
+PackedTensor PackedTensor::row_slice(size_t begin, size_t end) const {
+	if (begin > end || end > rows) throw std::runtime_error("PackedTensor::row_slice: out of range");
+	PackedTensor t = *this;
+	t.rows = end - begin;
+	t.base = base + begin * row_bytes;
+	return t;
+}
+
+PackedTensor PackedTensor::column_slice(size_t begin, size_t end) const {
+	if (begin > end || end > cols) throw std::runtime_error("PackedTensor::column_slice: out of range");
+	size_t offset = row_size(format, begin);
+	uint8_t* data = nullptr;
+	PackedTensor t = allocate(rows, end - begin, format, data);
+	for (size_t r = 0; r < rows; ++r)
+		std::memcpy(data + r * t.row_bytes, row_ptr(r) + offset, t.row_bytes);
+	return t;
+}
+
+PackedTensor PackedTensor::from_linear_weight(const Tensor<>& w, PackedFormat format) {
+	auto shape = w.get_shape();
+	if (shape.size() != 2)
+		throw std::runtime_error("PackedTensor::from_linear_weight: expected 2D weight");
+	// [in, out] -> [out, in]
+	Tensor<> rows = w.transpose({1, 0}).contiguous();
+	return from_rows(rows.raw_data().data(), shape[1], shape[0], format);
+}
+
+void PackedTensor::dequantize_row(size_t r, float* out) const {
+	const uint8_t* src = row_ptr(r);
+	switch (format) {
+		case PackedFormat::F32:
+			std::memcpy(out, src, cols * sizeof(float));
+			break;
+		case PackedFormat::BF16:
+			bf16_to_fp32_row(reinterpret_cast<const bf16*>(src), out, cols);
+			break;
+		case PackedFormat::F16:
+			fp16_to_fp32_row(reinterpret_cast<const fp16*>(src), out, cols);
+			break;
+		case PackedFormat::Q8_0: {
+			const BlockQ8_0* blocks = reinterpret_cast<const BlockQ8_0*>(src);
+			for (size_t b = 0; b < cols / QK; ++b) {
+				float d = fp16_to_fp32(blocks[b].d);
+				for (size_t j = 0; j < QK; ++j)
+					out[b * QK + j] = d * blocks[b].qs[j];
+			}
+			break;
+		}
+		case PackedFormat::Q4_0: {
+			const BlockQ4_0* blocks = reinterpret_cast<const BlockQ4_0*>(src);
+			for (size_t b = 0; b < cols / QK; ++b) {
+				float d = fp16_to_fp32(blocks[b].d);
+				for (size_t j = 0; j < QK / 2; ++j) {
+					out[b * QK + j] = d * ((blocks[b].qs[j] & 0x0f) - 8);
+					out[b * QK + j + QK / 2] = d * ((blocks[b].qs[j] >> 4) - 8);
+				}
+			}
+			break;
+		}
+		case PackedFormat::Q4_1: {
+			const BlockQ4_1* blocks = reinterpret_cast<const BlockQ4_1*>(src);
+			for (size_t b = 0; b < cols / QK; ++b) {
+				float d = fp16_to_fp32(blocks[b].d);
+				float m = fp16_to_fp32(blocks[b].m);
+				for (size_t j = 0; j < QK / 2; ++j) {
+					out[b * QK + j] = d * (blocks[b].qs[j] & 0x0f) + m;
+					out[b * QK + j + QK / 2] = d * (blocks[b].qs[j] >> 4) + m;
+				}
+			}
+			break;
+		}
+	}
+}
+
+Tensor<> PackedTensor::unpack() const {
+	std::vector<float> data(rows * cols);
+	for (size_t r = 0; r < rows; ++r)
+		dequantize_row(r, data.data() + r * cols);
+	return Tensor<>({rows, cols}, data);
+}
+
+// ============================================================
+// Row dot products: dot(W[r], x)
+// ============================================================
+
+static float dot_f32_scalar(const float* w, const float* x, size_t n) {
+	float sum = 0.0f;
+	#pragma omp simd reduction(+:sum)
+	for (size_t i = 0; i < n; ++i) sum += w[i] * x[i];
+	return sum;
+}
+
+static float dot_q8_0_scalar(const BlockQ8_0* w, const float* x, size_t n) {
+	float sum = 0.0f;
+	for (size_t b = 0; b < n / QK; ++b) {
+		float block_sum = 0.0f;
+		for (size_t j = 0; j < QK; ++j) block_sum += w[b].qs[j] * x[b * QK + j];
+		sum += fp16_to_fp32(w[b].d) * block_sum;
+	}
+	return sum;
+}
+
+static float dot_bf16_scalar(const uint16_t* w, const float* x, size_t n) {
+	float sum = 0.0f;
+	for (size_t i = 0; i < n; ++i) sum += bf16_to_fp32(w[i]) * x[i];
+	return sum;
+}
+
+static float dot_f16_scalar(const uint16_t* w, const float* x, size_t n) {
+	float sum = 0.0f;
+	for (size_t i = 0; i < n; ++i) sum += fp16_to_fp32(w[i]) * x[i];
+	return sum;
+}
+
+static float dot_q4_0_scalar(const BlockQ4_0* w, const float* x, size_t n) {
+	float sum = 0.0f;
+	for (size_t b = 0; b < n / QK; ++b) {
+		const float* xb = x + b * QK;
+		float block_sum = 0.0f;
+		for (size_t j = 0; j < QK / 2; ++j) {
+			block_sum += ((w[b].qs[j] & 0x0f) - 8) * xb[j];
+			block_sum += ((w[b].qs[j] >> 4) - 8) * xb[j + QK / 2];
+		}
+		sum += fp16_to_fp32(w[b].d) * block_sum;
+	}
+	return sum;
+}
+
+// sum(d * q * x + m * x) = d * sum(q * x) + m * sum(x)
+static float dot_q4_1_scalar(const BlockQ4_1* w, const float* x, size_t n) {
+	float sum = 0.0f;
+	for (size_t b = 0; b < n / QK; ++b) {
+		const float* xb = x + b * QK;
+		float qx = 0.0f, xs = 0.0f;
+		for (size_t j = 0; j < QK / 2; ++j) {
+			qx += (w[b].qs[j] & 0x0f) * xb[j] + (w[b].qs[j] >> 4) * xb[j + QK / 2];
+			xs += xb[j] + xb[j + QK / 2];
+		}
+		sum += fp16_to_fp32(w[b].d) * qx + fp16_to_fp32(w[b].m) * xs;
+	}
+	return sum;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma")))
+static inline float hsum256(__m256 v) {
+	__m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+	lo = _mm_add_ss(lo, _mm_movehdup_ps(lo));
+	return _mm_cvtss_f32(lo);
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_f32_avx2(const float* w, const float* x, size_t n) {
+	__m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+	__m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32) {
+		acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(w + i), _mm256_loadu_ps(x + i), acc0);
+		acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(w + i + 8), _mm256_loadu_ps(x + i + 8), acc1);
+		acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(w + i + 16), _mm256_loadu_ps(x + i + 16), acc2);
+		acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(w + i + 24), _mm256_loadu_ps(x + i + 24), acc3);
+	}
+	for (; i + 8 <= n; i += 8)
+		acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(w + i), _mm256_loadu_ps(x + i), acc0);
+	float sum = hsum256(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+	for (; i < n; ++i) sum += w[i] * x[i];
+	return sum;
+}
+
+// 16-bit weights widened in registers (bf16: shift into the fp32 high half,
+// f16: vcvtph2ps), fp32 FMA with the same 4-accumulator unroll as f32
+__attribute__((target("avx2,fma")))
+static inline __m256 load_bf16_ps(const uint16_t* w) {
+	__m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w));
+	return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static inline __m256 load_f16_ps(const uint16_t* w) {
+	return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w)));
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_bf16_avx2(const uint16_t* w, const float* x, size_t n) {
+	__m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+	__m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32) {
+		acc0 = _mm256_fmadd_ps(load_bf16_ps(w + i), _mm256_loadu_ps(x + i), acc0);
+		acc1 = _mm256_fmadd_ps(load_bf16_ps(w + i + 8), _mm256_loadu_ps(x + i + 8), acc1);
+		acc2 = _mm256_fmadd_ps(load_bf16_ps(w + i + 16), _mm256_loadu_ps(x + i + 16), acc2);
+		acc3 = _mm256_fmadd_ps(load_bf16_ps(w + i + 24), _mm256_loadu_ps(x + i + 24), acc3);
+	}
+	for (; i + 8 <= n; i += 8)
+		acc0 = _mm256_fmadd_ps(load_bf16_ps(w + i), _mm256_loadu_ps(x + i), acc0);
+	float sum = hsum256(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+	for (; i < n; ++i) sum += bf16_to_fp32(w[i]) * x[i];
+	return sum;
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static float dot_f16_avx2(const uint16_t* w, const float* x, size_t n) {
+	__m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+	__m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32) {
+		acc0 = _mm256_fmadd_ps(load_f16_ps(w + i), _mm256_loadu_ps(x + i), acc0);
+		acc1 = _mm256_fmadd_ps(load_f16_ps(w + i + 8), _mm256_loadu_ps(x + i + 8), acc1);
+		acc2 = _mm256_fmadd_ps(load_f16_ps(w + i + 16), _mm256_loadu_ps(x + i + 16), acc2);
+		acc3 = _mm256_fmadd_ps(load_f16_ps(w + i + 24), _mm256_loadu_ps(x + i + 24), acc3);
+	}
+	for (; i + 8 <= n; i += 8)
+		acc0 = _mm256_fmadd_ps(load_f16_ps(w + i), _mm256_loadu_ps(x + i), acc0);
+	float sum = hsum256(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+	for (; i < n; ++i) sum += fp16_to_fp32(w[i]) * x[i];
+	return sum;
+}
+
+// int8 -> fp32 in registers, fp32 FMA per block, then one FMA with the block scale
+__attribute__((target("avx2,fma,f16c")))
+static float dot_q8_0_avx2(const BlockQ8_0* w, const float* x, size_t n) {
+	__m256 acc = _mm256_setzero_ps();
+	for (size_t b = 0; b < n / QK; ++b) {
+		const int8_t* q = w[b].qs;
+		const float* xb = x + b * QK;
+		__m256 s0 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(q)))),
+								  _mm256_loadu_ps(xb));
+		__m256 s1 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(q + 8)))),
+								  _mm256_loadu_ps(xb + 8));
+		s0 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(q + 16)))),
+							 _mm256_loadu_ps(xb + 16), s0);
+		s1 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(q + 24)))),
+							 _mm256_loadu_ps(xb + 24), s1);
+		__m256 d = _mm256_set1_ps(_cvtsh_ss(w[b].d));
+		acc = _mm256_fmadd_ps(_mm256_add_ps(s0, s1), d, acc);
+	}
+	return hsum256(acc);
+}
+
+// 8 unsigned 4-bit values (in the low bytes of v) -> fp32
+__attribute__((target("avx2,fma")))
+static inline __m256 nibbles_to_ps(__m128i v) {
+	return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+}
+
+// Unpack 16 bytes into 32 nibbles in registers; fp32 FMA per block
+__attribute__((target("avx2,fma,f16c")))
+static float dot_q4_0_avx2(const BlockQ4_0* w, const float* x, size_t n) {
+	const __m128i mask = _mm_set1_epi8(0x0f);
+	const __m256 eight = _mm256_set1_ps(8.0f);
+	__m256 acc = _mm256_setzero_ps();
+	for (size_t b = 0; b < n / QK; ++b) {
+		const float* xb = x + b * QK;
+		__m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w[b].qs));
+		__m128i lo = _mm_and_si128(raw, mask);                      // weights 0..15
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(raw, 4), mask);   // weights 16..31
+
+		__m256 s0 = _mm256_mul_ps(_mm256_sub_ps(nibbles_to_ps(lo), eight), _mm256_loadu_ps(xb));
+		__m256 s1 = _mm256_mul_ps(_mm256_sub_ps(nibbles_to_ps(_mm_srli_si128(lo, 8)), eight), _mm256_loadu_ps(xb + 8));
+		s0 = _mm256_fmadd_ps(_mm256_sub_ps(nibbles_to_ps(hi), eight), _mm256_loadu_ps(xb + 16), s0);
+		s1 = _mm256_fmadd_ps(_mm256_sub_ps(nibbles_to_ps(_mm_srli_si128(hi, 8)), eight), _mm256_loadu_ps(xb + 24), s1);
+
+		__m256 d = _mm256_set1_ps(_cvtsh_ss(w[b].d));
+		acc = _mm256_fmadd_ps(_mm256_add_ps(s0, s1), d, acc);
+	}
+	return hsum256(acc);
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static float dot_q4_1_avx2(const BlockQ4_1* w, const float* x, size_t n) {
+	const __m128i mask = _mm_set1_epi8(0x0f);
+	__m256 acc = _mm256_setzero_ps();
+	for (size_t b = 0; b < n / QK; ++b) {
+		const float* xb = x + b * QK;
+		__m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w[b].qs));
+		__m128i lo = _mm_and_si128(raw, mask);
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(raw, 4), mask);
+
+		__m256 x0 = _mm256_loadu_ps(xb), x1 = _mm256_loadu_ps(xb + 8);
+		__m256 x2 = _mm256_loadu_ps(xb + 16), x3 = _mm256_loadu_ps(xb + 24);
+		__m256 qx = _mm256_mul_ps(nibbles_to_ps(lo), x0);
+		qx = _mm256_fmadd_ps(nibbles_to_ps(_mm_srli_si128(lo, 8)), x1, qx);
+		qx = _mm256_fmadd_ps(nibbles_to_ps(hi), x2, qx);
+		qx = _mm256_fmadd_ps(nibbles_to_ps(_mm_srli_si128(hi, 8)), x3, qx);
+		__m256 xs = _mm256_add_ps(_mm256_add_ps(x0, x1), _mm256_add_ps(x2, x3));
+
+		acc = _mm256_fmadd_ps(qx, _mm256_set1_ps(_cvtsh_ss(w[b].d)), acc);
+		acc = _mm256_fmadd_ps(xs, _mm256_set1_ps(_cvtsh_ss(w[b].m)), acc);
+	}
+	return hsum256(acc);
+}
+
+// 4-bit x 8-bit integer dot: nibbles become unsigned bytes, maddubs against the
+// quantized activations (|pair sum| <= 2 * 15 * 127 fits int16), one fp32 FMA per block.
+// The weight offset (-8 for q4_0, m for q4_1) is applied once per block through s.
+__attribute__((target("avx2,fma,f16c")))
+static float dot_q4_0_q8_avx2(const BlockQ4_0* w, const BlockQ8X* x, size_t nb) {
+	const __m256i mask = _mm256_set1_epi8(0x0f);
+	const __m256i ones = _mm256_set1_epi16(1);
+	__m256 acc = _mm256_setzero_ps();
+	float offset = 0.0f;
+	for (size_t b = 0; b < nb; ++b) {
+		__m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w[b].qs));
+		__m256i q = _mm256_and_si256(_mm256_set_m128i(_mm_srli_epi16(raw, 4), raw), mask);
+		__m256i xq = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x[b].qs));
+		__m256i p = _mm256_madd_epi16(_mm256_maddubs_epi16(q, xq), ones);
+		float d = _cvtsh_ss(w[b].d);
+		acc = _mm256_fmadd_ps(_mm256_cvtepi32_ps(p), _mm256_set1_ps(d * x[b].d), acc);
+		offset += d * x[b].s;
+	}
+	return hsum256(acc) - 8.0f * offset;
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static float dot_q4_1_q8_avx2(const BlockQ4_1* w, const BlockQ8X* x, size_t nb) {
+	const __m256i mask = _mm256_set1_epi8(0x0f);
+	const __m256i ones = _mm256_set1_epi16(1);
+	__m256 acc = _mm256_setzero_ps();
+	float offset = 0.0f;
+	for (size_t b = 0; b < nb; ++b) {
+		__m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w[b].qs));
+		__m256i q = _mm256_and_si256(_mm256_set_m128i(_mm_srli_epi16(raw, 4), raw), mask);
+		__m256i xq = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x[b].qs));
+		__m256i p = _mm256_madd_epi16(_mm256_maddubs_epi16(q, xq), ones);
+		acc = _mm256_fmadd_ps(_mm256_cvtepi32_ps(p), _mm256_set1_ps(_cvtsh_ss(w[b].d) * x[b].d), acc);
+		offset += _cvtsh_ss(w[b].m) * x[b].s;
+	}
+	return hsum256(acc) + offset;
+}
+#endif
+
+static bool cpu_has_avx2() {
+#if defined(__x86_64__)
+	static const bool has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")
+								 && __builtin_cpu_supports("f16c");
+	return has_avx2;
+#else
+	return false;
+#endif
+}
+
+static void quantize_row_q8x(const float* src, BlockQ8X* dst, size_t cols) {
+	for (size_t b = 0; b < cols / QK; ++b) {
+		const float* x = src + b * QK;
+		float amax = 0.0f;
+		for (size_t j = 0; j < QK; ++j) amax = std::max(amax, std::abs(x[j]));
+		float d = amax / 127.0f;
+		float id = d > 0.0f ? 1.0f / d : 0.0f;
+		int sum = 0;
+		for (size_t j = 0; j < QK; ++j) {
+			dst[b].qs[j] = static_cast<int8_t>(std::lround(x[j] * id));
+			sum += dst[b].qs[j];
+		}
+		dst[b].d = d;
+		dst[b].s = d * sum;
+	}
+}
+
+using RowDotQ8 = float (*)(const uint8_t* w, const BlockQ8X* x, size_t nb);
+
+// Integer kernels for the 4-bit formats; nullptr when the format/CPU has none
+static RowDotQ8 select_row_dot_q8(PackedFormat format) {
+#if defined(__x86_64__)
+	if (!cpu_has_avx2()) return nullptr;
+	switch (format) {
+		case PackedFormat::Q4_0:
+			return [](const uint8_t* w, const BlockQ8X* x, size_t nb) {
+				return dot_q4_0_q8_avx2(reinterpret_cast<const BlockQ4_0*>(w), x, nb);
+			};
+		case PackedFormat::Q4_1:
+			return [](const uint8_t* w, const BlockQ8X* x, size_t nb) {
+				return dot_q4_1_q8_avx2(reinterpret_cast<const BlockQ4_1*>(w), x, nb);
+			};
+		default:
+			break;
+	}
+#else
+	(void)format;
+#endif
+	return nullptr;
+}
+
+using RowDot = float (*)(const uint8_t* w, const float* x, size_t n);
+
+static RowDot select_row_dot(PackedFormat format) {
+	const bool has_avx2 = cpu_has_avx2();
+	switch (format) {
+		case PackedFormat::F32:
+#if defined(__x86_64__)
+			if (has_avx2)
+				return [](const uint8_t* w, const float* x, size_t n) {
+					return dot_f32_avx2(reinterpret_cast<const float*>(w), x, n);
+				};
+#endif
+			return [](const uint8_t* w, const float* x, size_t n) {
+				return dot_f32_scalar(reinterpret_cast<const float*>(w), x, n);
+			};
+		case PackedFormat::BF16:
+#if defined(__x86_64__)
+			if (has_avx2)
+				return [](const uint8_t* w, const float* x, size_t n) {
+					return dot_bf16_avx2(reinterpret_cast<const uint16_t*>(w), x, n);
+				};
+#endif
+			return [](const uint8_t* w, const float* x, size_t n) {
+				return dot_bf16_scalar(reinterpret_cast<const uint16_t*>(w), x, n);
+			};
+		case PackedFormat::F16:
+#if defined(__x86_64__)
+			if (has_avx2)
+				return [](const uint8_t* w, const float* x, size_t n) {
+					return dot_f16_avx2(reinterpret_cast<const uint16_t*>(w), x, n);
+				};
+#endif
+			return [](const uint8_t* w, const float* x, size_t n) {
+				return dot_f16_scalar(reinterpret_cast<const uint16_t*>(w), x, n);
+			};
+		case PackedFormat::Q8_0:
+#if defined(__x86_64__)
+			if (has_avx2)
+				return [](const uint8_t* w, const float* x, size_t n) {
+					return dot_q8_0_avx2(reinterpret_cast<const BlockQ8_0*>(w), x, n);
+				};
+#endif
+			return [](const uint8_t* w, const float* x, size_t n) {
+				return dot_q8_0_scalar(reinterpret_cast<const BlockQ8_0*>(w), x, n);
+			};
+		case PackedFormat::Q4_0:
+#if defined(__x86_64__)
+			if (has_avx2)
+				return [](const uint8_t* w, const float* x, size_t n) {
+					return dot_q4_0_avx2(reinterpret_cast<const BlockQ4_0*>(w), x, n);
+				};
+#endif
+			return [](const uint8_t* w, const float* x, size_t n) {
+				return dot_q4_0_scalar(reinterpret_cast<const BlockQ4_0*>(w), x, n);
+			};
+		case PackedFormat::Q4_1:
+#if defined(__x86_64__)
+			if (has_avx2)
+				return [](const uint8_t* w, const float* x, size_t n) {
+					return dot_q4_1_avx2(reinterpret_cast<const BlockQ4_1*>(w), x, n);
+				};
+#endif
+			return [](const uint8_t* w, const float* x, size_t n) {
+				return dot_q4_1_scalar(reinterpret_cast<const BlockQ4_1*>(w), x, n);
+			};
+	}
+	throw std::runtime_error("PackedTensor: unknown format");
+}
+
+// ============================================================
+// GEMV / GEMM
+// ============================================================
+
+// Shared driver: y is [m, n_out] with n_out = rows / K, and output r combines the
+// K row dots dot(W[r + k * n_out], x_i) through the epilogue. K = 1 is the plain
+// matmul; K = 2 lets SwiGLU read gate and up rows of one fused matrix in one pass.
+template<size_t K, typename Epilogue>
+static void packed_matmul_impl(const float* x, size_t m, const PackedTensor& w, float* y, Epilogue epilogue) {
+	const size_t cols = w.get_cols();
+	const size_t n_out = w.get_rows() / K;
+	const long n_rows = static_cast<long>(n_out);
+	constexpr long ROW_TILE = 16;
+
+	if (RowDotQ8 dot_q8 = select_row_dot_q8(w.get_format())) {
+		// 4-bit weights: quantize the activations once, then run integer dots on the
+		// packed rows directly; a tile of rows stays in L1 across the m inputs
+		const size_t nb = cols / QK;
+		std::vector<BlockQ8X> xq(m * nb);
+		const long n_inputs = static_cast<long>(m);
+		#pragma omp parallel for schedule(static)
+		for (long i = 0; i < n_inputs; ++i)
+			quantize_row_q8x(x + i * cols, xq.data() + i * nb, cols);
+
+		#pragma omp parallel for schedule(static)
+		for (long r0 = 0; r0 < n_rows; r0 += ROW_TILE) {
+			size_t nr = static_cast<size_t>(std::min(ROW_TILE, n_rows - r0));
+			for (size_t i = 0; i < m; ++i) {
+				float* yi = y + i * n_out + r0;
+				for (size_t j = 0; j < nr; ++j) {
+					float d[K];
+					for (size_t k = 0; k < K; ++k)
+						d[k] = dot_q8(w.row_ptr(r0 + j + k * n_out), xq.data() + i * nb, nb);
+					yi[j] = epilogue(d);
+				}
+			}
+		}
+		return;
+	}
+
+	if (m == 1) {
+		// Decode GEMV: every weight row is streamed once, dequantized in registers
+		RowDot dot = select_row_dot(w.get_format());
+		#pragma omp parallel for schedule(static)
+		for (long r = 0; r < n_rows; ++r) {
+			float d[K];
+			for (size_t k = 0; k < K; ++k)
+				d[k] = dot(w.row_ptr(r + k * n_out), x, cols);
+			y[r] = epilogue(d);
+		}
+		return;
+	}
+
+	// Prefill GEMM: a tile of weight rows (dequantized once into L2-sized scratch)
+	// is reused across all m input rows
+	const bool is_f32 = w.get_format() == PackedFormat::F32;
+	RowDot dot = select_row_dot(PackedFormat::F32);
+
+	#pragma omp parallel
+	{
+		std::vector<float> tile(is_f32 ? 0 : K * ROW_TILE * cols);
+		const uint8_t* tile_rows[K * ROW_TILE];
+
+		#pragma omp for schedule(static)
+		for (long r0 = 0; r0 < n_rows; r0 += ROW_TILE) {
+			size_t nr = static_cast<size_t>(std::min(ROW_TILE, n_rows - r0));
+			for (size_t k = 0; k < K; ++k) {
+				for (size_t j = 0; j < nr; ++j) {
+					size_t slot = k * ROW_TILE + j;
+					size_t r = r0 + j + k * n_out;
+					if (is_f32) {
+						tile_rows[slot] = w.row_ptr(r);
+					} else {
+						w.dequantize_row(r, tile.data() + slot * cols);
+						tile_rows[slot] = reinterpret_cast<const uint8_t*>(tile.data() + slot * cols);
+					}
+				}
+			}
+			for (size_t i = 0; i < m; ++i) {
+				const float* xi = x + i * cols;
+				float* yi = y + i * n_out + r0;
+				for (size_t j = 0; j < nr; ++j) {
+					float d[K];
+					for (size_t k = 0; k < K; ++k)
+						d[k] = dot(tile_rows[k * ROW_TILE + j], xi, cols);
+					yi[j] = epilogue(d);
+				}
+			}
+		}
+	}
+}
+
+void packed_matmul(const float* x, size_t m, const PackedTensor& w, float* y) {
+	packed_matmul_impl<1>(x, m, w, y, [](const float* d) { return d[0]; });
+}
+
+void packed_matmul_swiglu(const float* x, size_t m, const PackedTensor& gate_up, float* h) {
+	if (gate_up.get_rows() % 2 != 0)
+		throw std::runtime_error("packed_matmul_swiglu: gate_up needs an even number of rows");
+	packed_matmul_impl<2>(x, m, gate_up, h, [](const float* d) {
+		return d[0] / (1.0f + std::exp(-d[0])) * d[1];
+	});
+}
+
+Tensor<> packed_linear(const Tensor<>& x, const PackedTensor& w, const Tensor<>& bias) {
+	auto shape = x.get_shape();
+	if (shape.empty() || shape.back() != w.get_cols()) {
+		throw std::runtime_error("packed_linear: input features do not match weight cols");
+	}
+	Tensor<> x_c = x.contiguous();
+	size_t m = x_c.size() / w.get_cols();
+	size_t rows = w.get_rows();
+
+	std::vector<float> out(m * rows);
+	packed_matmul(x_c.raw_data().data(), m, w, out.data());
+
+	if (!bias.empty()) {
+		Tensor<> b_c = bias.contiguous();
+		const auto& b = b_c.raw_data();
+		for (size_t i = 0; i < m; ++i)
+			for (size_t r = 0; r < rows; ++r)
+				out[i * rows + r] += b[r];
+	}
+
+	shape.back() = rows;
+	return Tensor<>(shape, out);
+}
+
+} // namespace tensor
@@ -0,0 +1,399 @@
+#include "container/tensor/tensor_file.hpp"
+#include "container/tensor/half.hpp"
+#include "json.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+namespace tensor {
+
+static constexpr char MAGIC[4] = {'D', 'C', 'Z', 'T'};
+static constexpr uint32_t VERSION = 1;
+
+size_t dtype_size(DType dtype) {
+	switch (dtype) {
+		case DType::F32: return 4;
+		case DType::F16:
+		case DType::BF16: return 2;
+		case DType::U8: return 1;
+	}
+	throw std::runtime_error("Unknown tensor file dtype: " + std::to_string(static_cast<uint32_t>(dtype)));
+}
+
+const char* dtype_name(DType dtype) {
+	switch (dtype) {
+		case DType::F32: return "f32";
+		case DType::F16: return "f16";
+		case DType::BF16: return "bf16";
+		case DType::U8: return "u8";
+	}
+	return "unknown";
+}
+
+static size_t align_up(size_t n) {
+	return (n + TENSOR_FILE_ALIGN - 1) / TENSOR_FILE_ALIGN * TENSOR_FILE_ALIGN;
+}
+
+// ============================================================
+// TensorFile (reader)
+// ============================================================
+
+// Bounds-checked reads over the mapped index
+class IndexReader {
+public:
+	IndexReader(const uint8_t* data, size_t size, const std::string& path)
+		: data(data), size(size), path(path) {}
+
+	template<typename T>
+	T read() {
+		T v;
+		std::memcpy(&v, bytes(sizeof(T)), sizeof(T));
+		return v;
+	}
+
+	const uint8_t* bytes(size_t n) {
+		if (n > size - pos) throw std::runtime_error("Truncated tensor file index: " + path);
+		const uint8_t* p = data + pos;
+		pos += n;
+		return p;
+	}
+
+private:
+	const uint8_t* data;
+	size_t size;
+	size_t pos = 0;
+	const std::string& path;
+};
+
+void TensorFile::map_shard(const std::string& shard_path) {
+	int fd = ::open(shard_path.c_str(), O_RDONLY);
+	if (fd < 0) throw std::runtime_error("Cannot open tensor file: " + shard_path);
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		::close(fd);
+		throw std::runtime_error("Cannot stat tensor file: " + shard_path);
+	}
+	size_t size = static_cast<size_t>(st.st_size);
+	if (size < sizeof(uint64_t)) {
+		::close(fd);
+		throw std::runtime_error("Not a tensor file: " + shard_path);
+	}
+	void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);  // the mapping keeps the file referenced
+	if (map == MAP_FAILED) throw std::runtime_error("Cannot mmap tensor file: " + shard_path);
+	shards.push_back({static_cast<const uint8_t*>(map), size});
+}
+
+void TensorFile::add_entry(TensorFileEntry e) {
+	size_t numel = 1;
+	for (size_t d : e.shape) numel *= d;
+	size_t size = shards[e.shard].size;
+	if (e.nbytes != numel * dtype_size(e.dtype) || e.offset > size || e.nbytes > size - e.offset)
+		throw std::runtime_error("Corrupt tensor file entry " + e.name + ": " + path);
+	if (!index.emplace(e.name, entries.size()).second)
+		throw std::runtime_error("Duplicate tensor " + e.name + ": " + path);
+	entries.push_back(std::move(e));
+}
+
+std::shared_ptr<TensorFile> TensorFile::open(const std::string& path) {
+	std::shared_ptr<TensorFile> file(new TensorFile());
+	file->path = path;
+	file->map_shard(path);
+	const Mapping& m = file->shards[0];
+
+	IndexReader r(m.base, m.size, path);
+	if (std::memcmp(r.bytes(sizeof(MAGIC)), MAGIC, sizeof(MAGIC)) != 0)
+		throw std::runtime_error("Not a tensor file: " + path);
+	uint32_t version = r.read<uint32_t>();
+	if (version != VERSION)
+		throw std::runtime_error("Unsupported tensor file version " + std::to_string(version) + ": " + path);
+	uint64_t count = r.read<uint64_t>();
+	r.read<uint64_t>();  // data_offset
+
+	file->entries.reserve(count);
+	for (uint64_t i = 0; i < count; ++i) {
+		TensorFileEntry e;
+		uint32_t name_len = r.read<uint32_t>();
+		e.name.assign(reinterpret_cast<const char*>(r.bytes(name_len)), name_len);
+		e.dtype = static_cast<DType>(r.read<uint32_t>());
+		uint32_t ndim = r.read<uint32_t>();
+		for (uint32_t d = 0; d < ndim; ++d) e.shape.push_back(r.read<uint64_t>());
+		e.offset = r.read<uint64_t>();
+		e.nbytes = r.read<uint64_t>();
+		file->add_entry(std::move(e));
+	}
+	return file;
+}
+
+bool TensorFile::is_tensor_file(const std::string& path) {
+	std::ifstream in(path, std::ios::binary);
+	char magic[sizeof(MAGIC)] = {};
+	in.read(magic, sizeof(magic));
+	return in && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+// ------------------------------------------------------------
+// safetensors: uint64 header_len, JSON header, raw little-endian data.
+// Header: { name: {"dtype": "BF16", "shape": [...], "data_offsets": [begin, end]},
+//           "__metadata__": {...} }, offsets relative to the end of the header.
+// ------------------------------------------------------------
+
+static bool ends_with(const std::string& s, const std::string& suffix) {
+	return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void TensorFile::parse_safetensors(size_t shard, const std::string& shard_path) {
+	const Mapping& m = shards[shard];
+	IndexReader r(m.base, m.size, shard_path);
+	uint64_t header_len = r.read<uint64_t>();
+	if (header_len > m.size - sizeof(uint64_t))
+		throw std::runtime_error("Truncated safetensors header: " + shard_path);
+	const char* text = reinterpret_cast<const char*>(r.bytes(header_len));
+	size_t data_start = sizeof(uint64_t) + header_len;
+
+	json header;
+	try {
+		header = json::parse(text, text + header_len);
+	} catch (const json::exception& ex) {
+		throw std::runtime_error("Invalid safetensors header in " + shard_path + ": " + ex.what());
+	}
+	if (!header.is_object()) throw std::runtime_error("Invalid safetensors header: " + shard_path);
+
+	for (const auto& [name, info] : header.items()) {
+		if (name == "__metadata__") continue;
+		const std::string dtype = info.at("dtype").get<std::string>();
+		TensorFileEntry e;
+		e.name = name;
+		if (dtype == "F32") e.dtype = DType::F32;
+		else if (dtype == "F16") e.dtype = DType::F16;
+		else if (dtype == "BF16") e.dtype = DType::BF16;
+		else if (dtype == "U8") e.dtype = DType::U8;
+		else continue;  // I64 position ids etc. have no use here
+		e.shape = info.at("shape").get<std::vector<size_t>>();
+		auto offsets = info.at("data_offsets").get<std::vector<size_t>>();
+		if (offsets.size() != 2 || offsets[1] < offsets[0])
+			throw std::runtime_error("Corrupt safetensors entry " + name + ": " + shard_path);
+		e.offset = data_start + offsets[0];
+		e.nbytes = offsets[1] - offsets[0];
+		e.shard = shard;
+		add_entry(std::move(e));
+	}
+}
+
+std::shared_ptr<TensorFile> TensorFile::open_safetensors(const std::string& path) {
+	std::string index_path, single_path;
+	struct stat st;
+	if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+		std::string dir = ends_with(path, "/") ? path : path + "/";
+		if (stat((dir + "model.safetensors.index.json").c_str(), &st) == 0)
+			index_path = dir + "model.safetensors.index.json";
+		else
+			single_path = dir + "model.safetensors";
+	} else if (ends_with(path, ".json")) {
+		index_path = path;
+	} else {
+		single_path = path;
+	}
+
+	std::shared_ptr<TensorFile> file(new TensorFile());
+	file->path = path;
+	if (!single_path.empty()) {
+		file->map_shard(single_path);
+		file->parse_safetensors(0, single_path);
+		return file;
+	}
+
+	// Sharded checkpoint: weight_map lists the shard of every tensor
+	std::ifstream in(index_path);
+	if (!in) throw std::runtime_error("Cannot open safetensors index: " + index_path);
+	json index_json;
+	try {
+		index_json = json::parse(in);
+	} catch (const json::exception& ex) {
+		throw std::runtime_error("Invalid safetensors index " + index_path + ": " + ex.what());
+	}
+	std::string dir = index_path.substr(0, index_path.find_last_of('/') + 1);
+	std::vector<std::string> shard_names;
+	for (const auto& [name, shard] : index_json.at("weight_map").items()) {
+		std::string s = shard.get<std::string>();
+		if (std::find(shard_names.begin(), shard_names.end(), s) == shard_names.end())
+			shard_names.push_back(s);
+	}
+	std::sort(shard_names.begin(), shard_names.end());
+	for (const std::string& s : shard_names) {
+		file->map_shard(dir + s);
+		file->parse_safetensors(file->shards.size() - 1, dir + s);
+	}
+	return file;
+}
+
+bool TensorFile::is_safetensors(const std::string& path) {
+	struct stat st;
+	if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+		std::string dir = ends_with(path, "/") ? path : path + "/";
+		return stat((dir + "model.safetensors").c_str(), &st) == 0
+			|| stat((dir + "model.safetensors.index.json").c_str(), &st) == 0;
+	}
+	return ends_with(path, ".safetensors") || ends_with(path, ".safetensors.index.json");
+}
+
+TensorFile::~TensorFile() {
+	for (const Mapping& m : shards) munmap(const_cast<uint8_t*>(m.base), m.size);
+}
+
+size_t TensorFile::file_size() const {
+	size_t total = 0;
+	for (const Mapping& m : shards) total += m.size;
+	return total;
+}
+
+void TensorFile::add_alias(const std::string& alias, const std::string& name) {
+	auto it = index.find(name);
+	if (it == index.end()) throw std::runtime_error("Tensor not found in " + path + ": " + name);
+	index[alias] = it->second;
+}
+
+const TensorFileEntry* TensorFile::find(const std::string& name) const {
+	auto it = index.find(name);
+	return it == index.end() ? nullptr : &entries[it->second];
+}
+
+std::shared_ptr<const void> TensorFile::share(const TensorFileEntry& e) const {
+	return std::shared_ptr<const void>(shared_from_this(), data(e));
+}
+
+Tensor<> TensorFile::to_tensor(const TensorFileEntry& e) const {
+	size_t n = e.nbytes / dtype_size(e.dtype);
+	std::vector<float> out(n);
+	switch (e.dtype) {
+		case DType::F32:
+			std::memcpy(out.data(), data(e), e.nbytes);
+			break;
+		case DType::BF16:
+			bf16_to_fp32_row(reinterpret_cast<const bf16*>(data(e)), out.data(), n);
+			break;
+		case DType::F16:
+			fp16_to_fp32_row(reinterpret_cast<const fp16*>(data(e)), out.data(), n);
+			break;
+		default:
+			throw std::runtime_error("TensorFile::to_tensor: " + e.name + " is "
+									+ dtype_name(e.dtype) + ", not a float type");
+	}
+	return Tensor<>(e.shape, out);
+}
+
+Tensor<> TensorFile::to_tensor(const std::string& name) const {
+	const TensorFileEntry* e = find(name);
+	if (!e) throw std::runtime_error("Tensor not found in " + path + ": " + name);
+	return to_tensor(*e);
+}
+
+std::shared_ptr<PackedTensor> TensorFile::packed_weight(const std::string& layer_name) const {
+	for (PackedFormat format : {PackedFormat::F32, PackedFormat::BF16, PackedFormat::F16,
+								PackedFormat::Q8_0, PackedFormat::Q4_0, PackedFormat::Q4_1}) {
+		const TensorFileEntry* e = find(layer_name + ".W_" + packed_format_name(format));
+		if (!e) continue;
+
+		DType expected = format == PackedFormat::F32 ? DType::F32
+					   : format == PackedFormat::BF16 ? DType::BF16
+					   : format == PackedFormat::F16 ? DType::F16 : DType::U8;
+		if (e->dtype != expected || e->shape.size() != 2)
+			throw std::runtime_error("TensorFile: " + e->name + " must be a 2D " + dtype_name(expected) + " array");
+		size_t rows = e->shape[0];
+		size_t cols = expected == DType::U8 ? PackedTensor::cols_for_row_bytes(format, e->shape[1]) : e->shape[1];
+		return std::make_shared<PackedTensor>(PackedTensor::view(share(*e), data(*e), rows, cols, format));
+	}
+	return nullptr;
+}
+
+// ============================================================
+// TensorFileWriter
+// ============================================================
+
+void TensorFileWriter::add(const std::string& name, DType dtype, const std::vector<size_t>& shape,
+						   const void* data) {
+	Pending p;
+	p.entry.name = name;
+	p.entry.dtype = dtype;
+	p.entry.shape = shape;
+	size_t numel = 1;
+	for (size_t d : shape) numel *= d;
+	p.entry.nbytes = numel * dtype_size(dtype);
+	p.data = data;
+	pending.push_back(std::move(p));
+}
+
+void TensorFileWriter::add(const std::string& name, const Tensor<>& t) {
+	Tensor<> c = t.is_device() ? t.cpu() : t.contiguous();
+	add(name, DType::F32, c.get_shape(), c.raw_data().data());
+	pending.back().keep = c.shared_data();
+}
+
+void TensorFileWriter::add(const std::string& name, const PackedTensor& w) {
+	std::vector<size_t> shape = {w.get_rows(), w.get_cols()};
+	DType dtype = DType::U8;
+	switch (w.get_format()) {
+		case PackedFormat::F32: dtype = DType::F32; break;
+		case PackedFormat::BF16: dtype = DType::BF16; break;
+		case PackedFormat::F16: dtype = DType::F16; break;
+		default: shape[1] = PackedTensor::row_size(w.get_format(), w.get_cols()); break;
+	}
+	add(name, dtype, shape, w.row_ptr(0));
+	pending.back().keep = std::make_shared<PackedTensor>(w);
+}
+
+size_t TensorFileWriter::save(const std::string& path) const {
+	size_t header = sizeof(MAGIC) + sizeof(uint32_t) + 2 * sizeof(uint64_t);
+	for (const auto& p : pending)
+		header += 3 * sizeof(uint32_t) + p.entry.name.size()
+				+ (p.entry.shape.size() + 2) * sizeof(uint64_t);
+	uint64_t data_offset = align_up(header);
+
+	std::vector<uint64_t> offsets;
+	uint64_t end = data_offset;
+	for (const auto& p : pending) {
+		offsets.push_back(end);
+		end = align_up(end + p.entry.nbytes);
+	}
+
+	std::ofstream out(path, std::ios::binary);
+	if (!out) throw std::runtime_error("Cannot write tensor file: " + path);
+	auto put = [&](const auto& v) { out.write(reinterpret_cast<const char*>(&v), sizeof(v)); };
+
+	out.write(MAGIC, sizeof(MAGIC));
+	put(VERSION);
+	put(static_cast<uint64_t>(pending.size()));
+	put(data_offset);
+	for (size_t i = 0; i < pending.size(); ++i) {
+		const TensorFileEntry& e = pending[i].entry;
+		put(static_cast<uint32_t>(e.name.size()));
+		out.write(e.name.data(), e.name.size());
+		put(static_cast<uint32_t>(e.dtype));
+		put(static_cast<uint32_t>(e.shape.size()));
+		for (size_t d : e.shape) put(static_cast<uint64_t>(d));
+		put(offsets[i]);
+		put(static_cast<uint64_t>(e.nbytes));
+	}
+
+	static const char zeros[TENSOR_FILE_ALIGN] = {};
+	uint64_t pos = header;
+	for (size_t i = 0; i < pending.size(); ++i) {
+		out.write(zeros, offsets[i] - pos);
+		out.write(static_cast<const char*>(pending[i].data), pending[i].entry.nbytes);
+		pos = offsets[i] + pending[i].entry.nbytes;
+	}
+	out.write(zeros, end - pos);
+	if (!out) throw std::runtime_error("Failed writing tensor file: " + path);
+	return end;
+}
+
+} // namespace tensor
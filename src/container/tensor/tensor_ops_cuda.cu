@@ -170,6 +170,23 @@ void cuda_gemm_f(const float* a, const float* b, float* c,
 	CUDA_CHECK(cudaDeviceSynchronize());
 }
 
+void cuda_gemm_nt_f(const float* a, const float* b, float* c,
+					 size_t M, size_t N, size_t K,
+					 float alpha, float beta) {
+	cublasHandle_t handle = get_cublas_handle();
+	// C = A * B^T (row-major, B [N, K]) == C^T = B * A^T (col-major), where the
+	// row-major B reads as B^T in column-major: transpose it back with CUBLAS_OP_T
+	CUBLAS_CHECK(cublasSgemm(handle,
+		CUBLAS_OP_T, CUBLAS_OP_N,
+		static_cast<int>(N), static_cast<int>(M), static_cast<int>(K),
+		&alpha,
+		b, static_cast<int>(K),
+		a, static_cast<int>(K),
+		&beta,
+		c, static_cast<int>(N)));
+	CUDA_CHECK(cudaDeviceSynchronize());
+}
+
 } // extern "C"
 
 #endif // USE_CUDA
@@ -8,13 +8,14 @@
 #include <memory>
 
 Variable Function::operator()(const std::vector<Variable>& inputs) {
-	this->inputs.clear();
+	// Without a graph nothing is recorded, so a function object shared by a layer
+	// (e.g. MLP's activation) can run on several threads at once
+	if (!dcz::Config::get().enable_backprop) return forward(inputs);
 
-	if (dcz::Config::get().enable_backprop) {
-		for (const auto& input : inputs) {
-			std::shared_ptr<VariableImpl<>> impl = input.get_impl();
-			this->inputs.push_back(impl);
-		}
+	this->inputs.clear();
+	for (const auto& input : inputs) {
+		std::shared_ptr<VariableImpl<>> impl = input.get_impl();
+		this->inputs.push_back(impl);
 	}
 	Variable ys = forward(inputs);
 	
@@ -26,8 +27,7 @@ Variable Function::operator()(const std::vector<Variable>& inputs) {
 	}
 	*/ 
 	auto out = ys.get_impl();
-	if (dcz::Config::get().enable_backprop) 
-		out->creator = shared_from_this();
+	out->creator = shared_from_this();
 
 	output = out;
 	return ys;
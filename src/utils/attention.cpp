@@ -0,0 +1,183 @@
+#include "utils/attention.hpp"
+#include "container/tensor/half.hpp"
+
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+namespace {
+
+// Storage row of key j: j itself, or j of the batch entry that owns it
+struct RowIndex {
+	const uint32_t* owners = nullptr;
+	size_t entry_stride = 0;
+	size_t operator()(size_t j) const { return owners ? owners[j] * entry_stride + j : j; }
+};
+
+// Row access per cache format: row(j, kv_h, tmp, scale) returns the head's
+// head_dim elements of key j (widened into tmp if needed) and their scale
+struct F32Rows {
+	const float* data;
+	size_t kv_stride, head_dim;
+	RowIndex index = {};
+	const float* row(size_t j, size_t kv_h, float*, float& scale) const {
+		scale = 1.0f;
+		return data + index(j) * kv_stride + kv_h * head_dim;
+	}
+};
+
+struct F16Rows {
+	const tensor::fp16* data;
+	size_t kv_stride, head_dim;
+	RowIndex index = {};
+	const float* row(size_t j, size_t kv_h, float* tmp, float& scale) const {
+		scale = 1.0f;
+		tensor::fp16_to_fp32_row(data + index(j) * kv_stride + kv_h * head_dim, tmp, head_dim);
+		return tmp;
+	}
+};
+
+struct Int8Rows {
+	const int8_t* data;
+	const float* scales;
+	size_t kv_stride, head_dim, num_kv_heads;
+	RowIndex index = {};
+	const int8_t* row(size_t j, size_t kv_h, float*, float& scale) const {
+		size_t r = index(j);
+		scale = scales[r * num_kv_heads + kv_h];
+		return data + r * kv_stride + kv_h * head_dim;
+	}
+};
+
+template<typename KRows, typename VRows>
+void attention_kernel(const float* q, const KRows& k, const VRows& v, float* out,
+					  size_t seq_len, size_t position_offset,
+					  size_t num_heads, size_t num_kv_heads, size_t head_dim,
+					  float scale) {
+	const size_t num_kv_groups = num_heads / num_kv_heads;
+	// Scores are computed a tile of keys at a time, then folded into the running softmax
+	constexpr size_t KEY_TILE = 64;
+	const long total = static_cast<long>(seq_len * num_heads);
+
+	#pragma omp parallel
+	{
+		std::vector<float> acc(head_dim), tmp(head_dim);
+		float scores[KEY_TILE];
+
+		#pragma omp for schedule(dynamic, 1)
+		for (long idx = 0; idx < total; ++idx) {
+			size_t i = static_cast<size_t>(idx) / num_heads;
+			size_t h = static_cast<size_t>(idx) % num_heads;
+			size_t kv_h = h / num_kv_groups;
+			size_t num_keys = position_offset + i + 1;
+
+			const float* qi = q + (i * num_heads + h) * head_dim;
+
+			std::fill(acc.begin(), acc.end(), 0.0f);
+			float running_max = -std::numeric_limits<float>::infinity();
+			float running_sum = 0.0f;
+
+			for (size_t j0 = 0; j0 < num_keys; j0 += KEY_TILE) {
+				size_t tile = std::min(KEY_TILE, num_keys - j0);
+
+				// scores = q . k_j * scale
+				float tile_max = -std::numeric_limits<float>::infinity();
+				for (size_t t = 0; t < tile; ++t) {
+					float k_scale;
+					const auto* kj = k.row(j0 + t, kv_h, tmp.data(), k_scale);
+					float s = 0.0f;
+					#pragma omp simd reduction(+:s)
+					for (size_t d = 0; d < head_dim; ++d)
+						s += qi[d] * static_cast<float>(kj[d]);
+					scores[t] = s * k_scale * scale;
+					tile_max = std::max(tile_max, scores[t]);
+				}
+
+				// Rescale the running accumulator if the max grew
+				float new_max = std::max(running_max, tile_max);
+				float correction = std::exp(running_max - new_max);
+				running_sum *= correction;
+				#pragma omp simd
+				for (size_t d = 0; d < head_dim; ++d)
+					acc[d] *= correction;
+				running_max = new_max;
+
+				for (size_t t = 0; t < tile; ++t) {
+					float p = std::exp(scores[t] - running_max);
+					running_sum += p;
+					float v_scale;
+					const auto* vj = v.row(j0 + t, kv_h, tmp.data(), v_scale);
+					float w = p * v_scale;
+					float* a = acc.data();
+					#pragma omp simd
+					for (size_t d = 0; d < head_dim; ++d)
+						a[d] += w * static_cast<float>(vj[d]);
+				}
+			}
+
+			float inv_sum = 1.0f / running_sum;
+			float* oi = out + (i * num_heads + h) * head_dim;
+			for (size_t d = 0; d < head_dim; ++d)
+				oi[d] = acc[d] * inv_sum;
+		}
+	}
+}
+
+// Dispatch on the V format once K's row type is fixed
+template<typename KRows>
+void attention_with_k(const float* q, const KRows& k, const KVCacheView& v, float* out,
+					  size_t seq_len, size_t position_offset,
+					  size_t num_heads, size_t num_kv_heads, size_t head_dim, float scale) {
+	size_t kv_stride = num_kv_heads * head_dim;
+	RowIndex index{v.owners, v.entry_stride};
+	switch (v.format) {
+		case KVCacheFormat::F32:
+			attention_kernel(q, k, F32Rows{static_cast<const float*>(v.data), kv_stride, head_dim, index}, out,
+							 seq_len, position_offset, num_heads, num_kv_heads, head_dim, scale);
+			break;
+		case KVCacheFormat::F16:
+			attention_kernel(q, k, F16Rows{static_cast<const tensor::fp16*>(v.data), kv_stride, head_dim, index}, out,
+							 seq_len, position_offset, num_heads, num_kv_heads, head_dim, scale);
+			break;
+		case KVCacheFormat::INT8:
+			attention_kernel(q, k, Int8Rows{static_cast<const int8_t*>(v.data), v.scales, kv_stride, head_dim,
+											num_kv_heads, index}, out,
+							 seq_len, position_offset, num_heads, num_kv_heads, head_dim, scale);
+			break;
+	}
+}
+
+} // namespace
+
+void cached_attention_cpu(const float* q, const float* k, const float* v, float* out,
+						  size_t seq_len, size_t position_offset,
+						  size_t num_heads, size_t num_kv_heads, size_t head_dim,
+						  float scale) {
+	size_t kv_stride = num_kv_heads * head_dim;
+	attention_kernel(q, F32Rows{k, kv_stride, head_dim}, F32Rows{v, kv_stride, head_dim}, out,
+					 seq_len, position_offset, num_heads, num_kv_heads, head_dim, scale);
+}
+
+void cached_attention_cpu(const float* q, const KVCacheView& k, const KVCacheView& v, float* out,
+						  size_t seq_len, size_t position_offset,
+						  size_t num_heads, size_t num_kv_heads, size_t head_dim,
+						  float scale) {
+	size_t kv_stride = num_kv_heads * head_dim;
+	RowIndex index{k.owners, k.entry_stride};
+	switch (k.format) {
+		case KVCacheFormat::F32:
+			attention_with_k(q, F32Rows{static_cast<const float*>(k.data), kv_stride, head_dim, index}, v, out,
+							 seq_len, position_offset, num_heads, num_kv_heads, head_dim, scale);
+			break;
+		case KVCacheFormat::F16:
+			attention_with_k(q, F16Rows{static_cast<const tensor::fp16*>(k.data), kv_stride, head_dim, index}, v, out,
+							 seq_len, position_offset, num_heads, num_kv_heads, head_dim, scale);
+			break;
+		case KVCacheFormat::INT8:
+			attention_with_k(q, Int8Rows{static_cast<const int8_t*>(k.data), k.scales, kv_stride, head_dim,
+										 num_kv_heads, index}, v, out,
+							 seq_len, position_offset, num_heads, num_kv_heads, head_dim, scale);
+			break;
+	}
+}
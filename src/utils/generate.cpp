@@ -1,106 +1,377 @@
 #include "utils/generate.hpp"
+#include "utils/prefix_cache.hpp"
+#include "utils/sampler.hpp"
 
 #include <iostream>
-#include <random>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsed_ms(Clock::time_point since) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+// Host pointer to logits [1, seq, vocab] (device tensors are copied into host)
+static const float* host_logits(const Variable& logits, Tensor<>& host) {
+	host = logits.data().is_device() ? logits.data().cpu() : logits.data().contiguous();
+	return host.raw_data().data();
+}
+
+// Restore cached prompt prefix (keep at least one token to produce logits) and
+// prefill the rest in chunks; returns logits of the last prompt position
+static Variable prefill_prompt(LlamaForCausalLM& model, const std::vector<int>& prompt_ids,
+							   const GenerationConfig& config, size_t* prefilled = nullptr) {
+	if (config.kv_cache_format) model.set_kv_cache_format(*config.kv_cache_format);
+	if (config.streaming_window > 0) model.set_streaming(config.attention_sinks, config.streaming_window);
+	size_t cached_len = 0;
+	if (config.prefix_cache) {
+		cached_len = config.prefix_cache->restore(model, prompt_ids, prompt_ids.size() - 1);
+	} else {
+		model.reset_cache();
+	}
+
+	std::vector<int> suffix(prompt_ids.begin() + cached_len, prompt_ids.end());
+	if (prefilled) *prefilled = suffix.size();
+	return model.prefill(suffix, cached_len, config.prefill_chunk_size);
+}
+
+static void insert_history(LlamaForCausalLM& model, const std::vector<int>& prompt_ids,
+						   const std::vector<int>& generated, PrefixCache* prefix_cache) {
+	if (!prefix_cache) return;
+	std::vector<int> history(prompt_ids);
+	history.insert(history.end(), generated.begin(), generated.end());
+	// A streaming window that has evicted tokens no longer holds the history's prefix
+	if (model.is_streaming() && model.cache_len() + 1 < history.size()) return;
+	prefix_cache->insert(model, history);
+}
+
+double GenerationStats::latency_percentile(double p) const {
+	if (token_latencies_ms.empty()) return 0.0;
+	std::vector<double> sorted(token_latencies_ms);
+	std::sort(sorted.begin(), sorted.end());
+	double rank = std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * sorted.size());
+	return sorted[std::max<size_t>(static_cast<size_t>(rank), 1) - 1];
+}
 
 std::vector<int> generate(LlamaForCausalLM& model,
 						  const std::vector<int>& prompt_ids,
 						  const GenerationConfig& config) {
-	model.reset_cache();
+	if (config.draft_model)
+		return generate_speculative(model, *config.draft_model, prompt_ids, config);
+	if (config.num_beams > 1) {
+		std::vector<BeamHypothesis> best = beam_search(model, prompt_ids, config);
+		return best.empty() ? std::vector<int>() : best.front().tokens;
+	}
+	return generate_stream(model, prompt_ids, nullptr, config);
+}
+
+std::vector<int> generate_stream(LlamaForCausalLM& model,
+								 const std::vector<int>& prompt_ids,
+								 const TokenCallback& on_token,
+								 const GenerationConfig& config,
+								 GenerationStats* stats) {
+	if (config.draft_model)
+		throw std::runtime_error("generate_stream: speculative decoding is not supported");
+	if (config.num_beams > 1)
+		throw std::runtime_error("generate_stream: beam search is not supported");
 
 	std::vector<int> generated;
 	size_t prompt_len = prompt_ids.size();
+	GenerationStats local_stats;
+	local_stats.prompt_tokens = prompt_len;
 
-	std::mt19937 rng(42);
-
-	// 1. Process the full prompt (prefill)
-	Variable logits = model.forward_ids(prompt_ids, 0);
-
-	// Get logits for the last position: [1, seq_len, vocab_size] -> last position
-	auto logits_shape = logits.shape();
-	size_t vocab_size = logits_shape[2];
-	size_t seq_len = logits_shape[1];
-
-	// Extract last position logits (CPU fallback for device tensors)
-	Tensor<> logits_cpu = logits.data().is_device() ? logits.data().cpu() : logits.data();
-	const auto& logits_data = logits_cpu.raw_data();
-	size_t last_offset = (seq_len - 1) * vocab_size;
-
-	int next_token;
-	if (!config.do_sample || config.temperature <= 0.0f) {
-		// Greedy: argmax
-		float max_val = logits_data[last_offset];
-		next_token = 0;
-		for (size_t i = 1; i < vocab_size; ++i) {
-			if (logits_data[last_offset + i] > max_val) {
-				max_val = logits_data[last_offset + i];
-				next_token = static_cast<int>(i);
-			}
-		}
-	} else {
-		// Temperature sampling
-		std::vector<float> probs(vocab_size);
-		float max_logit = *std::max_element(
-			logits_data.begin() + last_offset,
-			logits_data.begin() + last_offset + vocab_size);
-
-		float sum_exp = 0.0f;
-		for (size_t i = 0; i < vocab_size; ++i) {
-			probs[i] = std::exp((logits_data[last_offset + i] - max_logit) / config.temperature);
-			sum_exp += probs[i];
-		}
-		for (size_t i = 0; i < vocab_size; ++i) {
-			probs[i] /= sum_exp;
-		}
-
-		std::discrete_distribution<int> dist(probs.begin(), probs.end());
-		next_token = dist(rng);
-	}
+	Sampler sampler(config);
+	for (int t : prompt_ids) sampler.accept(t);
+	Tensor<> host;
 
+	// 1-2. Prefix cache restore + chunked prefill
+	auto start = Clock::now();
+	Variable logits = prefill_prompt(model, prompt_ids, config, &local_stats.prefill_tokens);
+	size_t vocab_size = logits.shape()[2];
+	int next_token = sampler.sample(host_logits(logits, host), vocab_size);
+	local_stats.time_to_first_token_ms = elapsed_ms(start);
+	sampler.accept(next_token);
 	generated.push_back(next_token);
+	bool keep_going = !on_token || on_token(next_token);
 
-	// 2. Autoregressive generation loop
-	for (size_t step = 1; step < config.max_new_tokens; ++step) {
+	// 3. Autoregressive generation loop
+	for (size_t step = 1; step < config.max_new_tokens && keep_going; ++step) {
 		if (next_token == config.eos_token_id) break;
 
 		// Forward with single token, KV cache handles context
+		auto step_start = Clock::now();
 		size_t pos_offset = prompt_len + step - 1;
 		Variable step_logits = model.forward_ids({next_token}, pos_offset);
 
-		Tensor<> step_cpu = step_logits.data().is_device() ? step_logits.data().cpu() : step_logits.data();
-		const auto& step_data = step_cpu.raw_data();
-		// logits shape: [1, 1, vocab_size], offset is 0
-
-		if (!config.do_sample || config.temperature <= 0.0f) {
-			float max_val = step_data[0];
-			next_token = 0;
-			for (size_t i = 1; i < vocab_size; ++i) {
-				if (step_data[i] > max_val) {
-					max_val = step_data[i];
-					next_token = static_cast<int>(i);
+		next_token = sampler.sample(host_logits(step_logits, host), vocab_size);
+		local_stats.token_latencies_ms.push_back(elapsed_ms(step_start));
+		local_stats.decode_ms += local_stats.token_latencies_ms.back();
+		sampler.accept(next_token);
+		generated.push_back(next_token);
+		keep_going = !on_token || on_token(next_token);
+	}
+	local_stats.cancelled = !keep_going;
+	local_stats.generated_tokens = generated.size();
+
+	// 4. Cache KV of prompt + generated tokens for the next turn
+	insert_history(model, prompt_ids, generated, config.prefix_cache);
+
+	if (stats) *stats = std::move(local_stats);
+	return generated;
+}
+
+std::vector<int> generate_speculative(LlamaForCausalLM& target,
+									  LlamaForCausalLM& draft,
+									  const std::vector<int>& prompt_ids,
+									  const GenerationConfig& config,
+									  SpeculativeStats* stats) {
+	std::vector<int> generated;
+	if (config.max_new_tokens == 0) return generated;
+
+	size_t prompt_len = prompt_ids.size();
+	size_t k = std::max<size_t>(config.num_draft_tokens, 1);
+
+	// One sampler for both models: penalties depend only on the token history,
+	// which is advanced over drafted tokens and rewound with forget()
+	Sampler sampler(config);
+	for (int t : prompt_ids) sampler.accept(t);
+	bool greedy = sampler.is_greedy();
+	Tensor<> host;
+	SpeculativeStats local_stats;
+
+	// 1. Prefill: target (prefix cache aware) picks the first token, draft only builds its cache
+	Variable logits = prefill_prompt(target, prompt_ids, config);
+	local_stats.target_forwards++;
+	size_t vocab_size = logits.shape()[2];
+
+	if (config.kv_cache_format) draft.set_kv_cache_format(*config.kv_cache_format);
+	draft.reset_cache();
+	Variable draft_logits = draft.prefill(prompt_ids, 0, config.prefill_chunk_size);
+	if (draft_logits.shape()[2] != vocab_size)
+		throw std::runtime_error("generate_speculative: draft and target vocab sizes differ");
+
+	int next_token = sampler.sample(host_logits(logits, host), vocab_size);
+	sampler.accept(next_token);
+	generated.push_back(next_token);
+
+	// Tokens already accepted but not yet forwarded through the draft
+	std::vector<int> draft_pending = {next_token};
+	std::vector<std::vector<float>> draft_probs;  // q(x) per drafted position (sampling only)
+	std::vector<float> p, residual;
+
+	// 2. Draft k tokens -> verify with one target forward -> roll back rejected KV
+	while (generated.size() < config.max_new_tokens && next_token != config.eos_token_id) {
+		size_t n = target.cache_len();  // == prompt_len + generated.size() - 1
+		size_t num_draft = std::min(k, config.max_new_tokens - generated.size());
+
+		std::vector<int> drafted;
+		draft_probs.resize(num_draft);
+		std::vector<int> feed = draft_pending;
+		for (size_t i = 0; i < num_draft; ++i) {
+			Variable dl = draft.forward_ids(feed, draft.cache_len(), {feed.size() - 1});
+			const float* row = host_logits(dl, host);
+			int token;
+			if (greedy) {
+				token = sampler.sample(row, vocab_size);
+			} else {
+				sampler.distribution(row, vocab_size, draft_probs[i]);
+				token = sampler.sample_from(draft_probs[i]);
+			}
+			sampler.accept(token);
+			drafted.push_back(token);
+			feed = {token};
+		}
+		for (size_t i = num_draft; i-- > 0;) sampler.forget(drafted[i]);
+
+		// Target scores [next_token, d1..dk] in one pass: row j predicts the token after d_j
+		std::vector<int> verify = {next_token};
+		verify.insert(verify.end(), drafted.begin(), drafted.end());
+		Variable target_logits = target.forward_ids(verify, n);
+		local_stats.target_forwards++;
+		const float* target_rows = host_logits(target_logits, host);
+
+		size_t accepted = 0;
+		int correction = -1;
+		for (; accepted < num_draft; ++accepted) {
+			const float* row = target_rows + accepted * vocab_size;
+			int d = drafted[accepted];
+			if (greedy) {
+				int t = sampler.sample(row, vocab_size);
+				if (t != d) { correction = t; break; }
+			} else {
+				// Accept with min(1, p/q); otherwise resample from max(0, p - q)
+				sampler.distribution(row, vocab_size, p);
+				const std::vector<float>& q = draft_probs[accepted];
+				if (sampler.uniform() * q[d] >= p[d]) {
+					residual.resize(vocab_size);
+					float residual_sum = 0.0f;
+					for (size_t i = 0; i < vocab_size; ++i) {
+						residual[i] = std::max(0.0f, p[i] - q[i]);
+						residual_sum += residual[i];
+					}
+					correction = sampler.sample_from(residual_sum > 0.0f ? residual : p);
+					break;
 				}
 			}
-		} else {
-			std::vector<float> probs(vocab_size);
-			float max_logit = *std::max_element(step_data.begin(), step_data.begin() + vocab_size);
-
-			float sum_exp = 0.0f;
-			for (size_t i = 0; i < vocab_size; ++i) {
-				probs[i] = std::exp((step_data[i] - max_logit) / config.temperature);
-				sum_exp += probs[i];
+			sampler.accept(d);
+		}
+		// Every draft accepted: bonus token from the last target row
+		if (correction < 0)
+			correction = sampler.sample(target_rows + num_draft * vocab_size, vocab_size);
+
+		local_stats.draft_tokens += num_draft;
+		local_stats.accepted_tokens += accepted;
+
+		bool stop = false;
+		for (size_t i = 0; i < accepted; ++i) {
+			generated.push_back(drafted[i]);
+			if (drafted[i] == config.eos_token_id || generated.size() >= config.max_new_tokens) {
+				stop = true;
+				break;
 			}
-			for (size_t i = 0; i < vocab_size; ++i) {
-				probs[i] /= sum_exp;
+		}
+		if (!stop) {
+			generated.push_back(correction);
+			sampler.accept(correction);
+		}
+		next_token = generated.back();
+
+		// Roll back: keep KV for prompt + generated[:-1] (the last token is forwarded next round)
+		size_t valid_len = prompt_len + generated.size() - 1;
+		target.truncate_cache(valid_len);
+		draft.truncate_cache(valid_len);
+		draft_pending.assign(generated.begin() + (draft.cache_len() - prompt_len), generated.end());
+	}
+
+	insert_history(target, prompt_ids, generated, config.prefix_cache);
+
+	if (stats) *stats = local_stats;
+	return generated;
+}
+
+// The k largest log-probabilities of one row of logits, appended as (log prob, token)
+static void top_log_probs(const float* logits, size_t vocab_size, size_t k,
+						  std::vector<std::pair<double, int>>& out) {
+	float max_logit = logits[0];
+	for (size_t i = 1; i < vocab_size; ++i) max_logit = std::max(max_logit, logits[i]);
+	double sum = 0.0;
+	for (size_t i = 0; i < vocab_size; ++i) sum += std::exp(logits[i] - max_logit);
+	double log_norm = max_logit + std::log(sum);
+
+	// Min-heap of the k best (logit, token) seen so far
+	std::vector<std::pair<float, int>> heap;
+	auto greater = [](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; };
+	for (size_t i = 0; i < vocab_size; ++i) {
+		if (heap.size() < k) {
+			heap.emplace_back(logits[i], static_cast<int>(i));
+			std::push_heap(heap.begin(), heap.end(), greater);
+		} else if (logits[i] > heap.front().first) {
+			std::pop_heap(heap.begin(), heap.end(), greater);
+			heap.back() = {logits[i], static_cast<int>(i)};
+			std::push_heap(heap.begin(), heap.end(), greater);
+		}
+	}
+	for (const auto& [logit, token] : heap) out.emplace_back(logit - log_norm, token);
+}
+
+std::vector<BeamHypothesis> beam_search(LlamaForCausalLM& model,
+										const std::vector<int>& prompt_ids,
+										const GenerationConfig& config) {
+	size_t num_beams = config.num_beams;
+	if (num_beams == 0 || config.num_return_sequences == 0 || config.num_return_sequences > num_beams)
+		throw std::runtime_error("beam_search: need 0 < num_return_sequences <= num_beams");
+	if (config.draft_model)
+		throw std::runtime_error("beam_search: speculative decoding is not supported");
+
+	auto score_of = [&](double log_prob, size_t len) {
+		return log_prob / std::pow(static_cast<double>(std::max<size_t>(len, 1)), config.length_penalty);
+	};
+	// Finished hypotheses, best first, at most num_beams
+	std::vector<BeamHypothesis> finished;
+	auto add_hypothesis = [&](std::vector<int> tokens, double log_prob) {
+		double score = score_of(log_prob, tokens.size());
+		if (finished.size() == num_beams && score <= finished.back().score) return;
+		BeamHypothesis hyp{std::move(tokens), log_prob, score};
+		auto at = std::upper_bound(finished.begin(), finished.end(), hyp.score,
+								   [](double s, const BeamHypothesis& h) { return s > h.score; });
+		finished.insert(at, std::move(hyp));
+		if (finished.size() > num_beams) finished.pop_back();
+	};
+
+	struct Beam {
+		std::vector<int> tokens;
+		double log_prob;
+	};
+	struct Candidate {
+		double log_prob;
+		size_t beam;
+		int token;
+	};
+
+	size_t prompt_len = prompt_ids.size();
+	Tensor<> host;
+	Variable logits = prefill_prompt(model, prompt_ids, config);
+	size_t vocab_size = logits.shape()[2];
+	if (vocab_size < 2 * num_beams)
+		throw std::runtime_error("beam_search: vocab smaller than 2 * num_beams");
+	const float* rows = host_logits(logits, host);
+
+	// A single live beam until the first step fans it out
+	std::vector<Beam> beams = {{{}, 0.0}};
+	std::vector<std::pair<double, int>> top;
+	std::vector<Candidate> candidates;
+	for (size_t step = 0; step < config.max_new_tokens; ++step) {
+		// 1. Pool the top 2 * num_beams continuations of every beam
+		candidates.clear();
+		for (size_t b = 0; b < beams.size(); ++b) {
+			top.clear();
+			top_log_probs(rows + b * vocab_size, vocab_size, 2 * num_beams, top);
+			for (const auto& [log_prob, token] : top)
+				candidates.push_back({beams[b].log_prob + log_prob, b, token});
+		}
+		size_t pool = std::min(candidates.size(), 2 * num_beams);
+		std::partial_sort(candidates.begin(), candidates.begin() + pool, candidates.end(),
+						  [](const Candidate& a, const Candidate& c) { return a.log_prob > c.log_prob; });
+
+		// 2. eos among the best num_beams finishes a hypothesis; the rest continue
+		std::vector<Beam> next;
+		std::vector<size_t> parents;
+		std::vector<int> next_tokens;
+		for (size_t rank = 0; rank < pool && next.size() < num_beams; ++rank) {
+			const Candidate& c = candidates[rank];
+			std::vector<int> tokens = beams[c.beam].tokens;
+			tokens.push_back(c.token);
+			if (c.token == config.eos_token_id) {
+				if (rank < num_beams) add_hypothesis(std::move(tokens), c.log_prob);
+			} else {
+				next.push_back({std::move(tokens), c.log_prob});
+				parents.push_back(c.beam);
+				next_tokens.push_back(c.token);
 			}
+		}
+		beams = std::move(next);
 
-			std::discrete_distribution<int> dist(probs.begin(), probs.end());
-			next_token = dist(rng);
+		// 3. Done when enough hypotheses finished and no running beam can overtake them
+		if (finished.size() == num_beams) {
+			if (config.early_stopping) break;
+			if (finished.back().score >= score_of(beams.front().log_prob, step + 1)) break;
+		}
+		if (step + 1 == config.max_new_tokens) {
+			for (auto& beam : beams) add_hypothesis(std::move(beam.tokens), beam.log_prob);
+			break;
 		}
 
-		generated.push_back(next_token);
+		// 4. Re-point the cache entries at their parents and run all beams in one forward
+		if (step == 0) model.fork_cache(num_beams);
+		model.reorder_cache(parents);
+		logits = model.forward_step(next_tokens, prompt_len + step);
+		rows = host_logits(logits, host);
 	}
+	model.reset_cache();
 
-	return generated;
+	if (finished.size() > config.num_return_sequences) finished.resize(config.num_return_sequences);
+	return finished;
 }
@@ -0,0 +1,138 @@
+#include "utils/kv_cache.hpp"
+#include "container/tensor/half.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using tensor::fp16;
+
+const char* kv_cache_format_name(KVCacheFormat format) {
+	switch (format) {
+		case KVCacheFormat::F32: return "f32";
+		case KVCacheFormat::F16: return "f16";
+		case KVCacheFormat::INT8: return "int8";
+	}
+	return "unknown";
+}
+
+KVCacheFormat parse_kv_cache_format(const std::string& name) {
+	for (KVCacheFormat format : {KVCacheFormat::F32, KVCacheFormat::F16, KVCacheFormat::INT8}) {
+		if (name == kv_cache_format_name(format)) return format;
+	}
+	throw std::runtime_error("Unknown KV cache format: " + name);
+}
+
+static size_t element_size(KVCacheFormat format) {
+	switch (format) {
+		case KVCacheFormat::F32: return sizeof(float);
+		case KVCacheFormat::F16: return sizeof(fp16);
+		case KVCacheFormat::INT8: return sizeof(int8_t);
+	}
+	return 0;
+}
+
+KVCacheStore::KVCacheStore(KVCacheFormat format, size_t batch, size_t capacity,
+						   size_t num_kv_heads, size_t head_dim)
+	: format(format), batch(batch), capacity(capacity), num_kv_heads(num_kv_heads), head_dim(head_dim),
+	  data(batch * capacity * num_kv_heads * head_dim * element_size(format)) {
+	if (format == KVCacheFormat::INT8) scales.resize(batch * capacity * num_kv_heads);
+}
+
+size_t KVCacheStore::bytes_per_token(KVCacheFormat format, size_t num_kv_heads, size_t head_dim) {
+	size_t bytes = num_kv_heads * head_dim * element_size(format);
+	if (format == KVCacheFormat::INT8) bytes += num_kv_heads * sizeof(float);
+	return bytes;
+}
+
+size_t KVCacheStore::bytes_per_token() const {
+	return bytes_per_token(format, num_kv_heads, head_dim);
+}
+
+void KVCacheStore::resize(size_t new_batch, size_t new_capacity, size_t len) {
+	KVCacheStore grown(format, new_batch, new_capacity, num_kv_heads, head_dim);
+	size_t row_bytes = num_kv_heads * head_dim * element_size(format);
+	len = std::min({len, capacity, new_capacity});
+	for (size_t b = 0; b < std::min(batch, new_batch) && len > 0; ++b) {
+		std::memcpy(grown.data.data() + grown.row_index(b, 0) * row_bytes,
+					data.data() + row_index(b, 0) * row_bytes, len * row_bytes);
+		if (!scales.empty()) {
+			std::copy(scales.begin() + row_index(b, 0) * num_kv_heads,
+					  scales.begin() + row_index(b, len) * num_kv_heads,
+					  grown.scales.begin() + grown.row_index(b, 0) * num_kv_heads);
+		}
+	}
+	*this = std::move(grown);
+}
+
+void KVCacheStore::write_row(size_t b, size_t pos, const float* row) {
+	size_t row_elems = num_kv_heads * head_dim;
+	size_t r = row_index(b, pos);
+	switch (format) {
+		case KVCacheFormat::F32:
+			std::memcpy(data.data() + r * row_elems * sizeof(float), row, row_elems * sizeof(float));
+			break;
+		case KVCacheFormat::F16:
+			tensor::fp32_to_fp16_row(row, reinterpret_cast<fp16*>(data.data()) + r * row_elems, row_elems);
+			break;
+		case KVCacheFormat::INT8: {
+			int8_t* q = reinterpret_cast<int8_t*>(data.data()) + r * row_elems;
+			for (size_t h = 0; h < num_kv_heads; ++h) {
+				const float* x = row + h * head_dim;
+				float amax = 0.0f;
+				for (size_t d = 0; d < head_dim; ++d) amax = std::max(amax, std::abs(x[d]));
+				float scale = amax / 127.0f;
+				float inv = amax > 0.0f ? 127.0f / amax : 0.0f;
+				for (size_t d = 0; d < head_dim; ++d)
+					q[h * head_dim + d] = static_cast<int8_t>(std::lround(x[d] * inv));
+				scales[r * num_kv_heads + h] = scale;
+			}
+			break;
+		}
+	}
+}
+
+void KVCacheStore::read_rows(size_t b, size_t start, size_t len, float* out) const {
+	size_t row_elems = num_kv_heads * head_dim;
+	size_t r = row_index(b, start);
+	switch (format) {
+		case KVCacheFormat::F32:
+			std::memcpy(out, data.data() + r * row_elems * sizeof(float), len * row_elems * sizeof(float));
+			break;
+		case KVCacheFormat::F16:
+			tensor::fp16_to_fp32_row(reinterpret_cast<const fp16*>(data.data()) + r * row_elems, out,
+									 len * row_elems);
+			break;
+		case KVCacheFormat::INT8: {
+			const int8_t* q = reinterpret_cast<const int8_t*>(data.data()) + r * row_elems;
+			for (size_t i = 0; i < len * num_kv_heads; ++i) {
+				float scale = scales[r * num_kv_heads + i];
+				for (size_t d = 0; d < head_dim; ++d)
+					out[i * head_dim + d] = q[i * head_dim + d] * scale;
+			}
+			break;
+		}
+	}
+}
+
+float* KVCacheStore::f32_row(size_t b, size_t pos) {
+	if (format != KVCacheFormat::F32)
+		throw std::runtime_error("KVCacheStore::f32_row: cache is " + std::string(kv_cache_format_name(format)));
+	return reinterpret_cast<float*>(data.data()) + row_index(b, pos) * num_kv_heads * head_dim;
+}
+
+KVCacheView KVCacheStore::view(size_t b, size_t start) const {
+	KVCacheView v;
+	v.format = format;
+	v.data = data.data() + row_index(b, start) * num_kv_heads * head_dim * element_size(format);
+	v.scales = scales.empty() ? nullptr : scales.data() + row_index(b, start) * num_kv_heads;
+	return v;
+}
+
+KVCacheView KVCacheStore::shared_view(const uint32_t* owners) const {
+	KVCacheView v = view(0);
+	v.owners = owners;
+	v.entry_stride = capacity;
+	return v;
+}
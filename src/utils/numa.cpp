@@ -0,0 +1,78 @@
+#include "utils/numa.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+
+std::vector<int> parse_cpu_list(const std::string& list) {
+	std::vector<int> cpus;
+	std::stringstream ss(list);
+	std::string range;
+	while (std::getline(ss, range, ',')) {
+		range.erase(std::remove_if(range.begin(), range.end(), ::isspace), range.end());
+		if (range.empty()) continue;
+		size_t dash = range.find('-');
+		try {
+			int first = std::stoi(range.substr(0, dash));
+			int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+			for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+		} catch (const std::exception&) {
+			throw std::runtime_error("parse_cpu_list: bad range \"" + range + "\"");
+		}
+	}
+	return cpus;
+}
+
+static std::vector<int> allowed_cpus() {
+	std::vector<int> cpus;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+		for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+			if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+	}
+	if (cpus.empty()) cpus.push_back(0);
+	return cpus;
+}
+
+std::vector<NumaNode> numa_nodes() {
+	std::vector<int> allowed = allowed_cpus();
+	std::vector<NumaNode> nodes;
+
+	const std::string root = "/sys/devices/system/node/";
+	if (DIR* dir = opendir(root.c_str())) {
+		while (dirent* entry = readdir(dir)) {
+			std::string name = entry->d_name;
+			if (name.rfind("node", 0) != 0 || name.size() == 4
+				|| !std::all_of(name.begin() + 4, name.end(), ::isdigit))
+				continue;
+			std::ifstream in(root + name + "/cpulist");
+			std::string list;
+			if (!std::getline(in, list)) continue;
+
+			NumaNode node;
+			node.id = std::stoi(name.substr(4));
+			for (int cpu : parse_cpu_list(list))
+				if (std::binary_search(allowed.begin(), allowed.end(), cpu)) node.cpus.push_back(cpu);
+			if (!node.cpus.empty()) nodes.push_back(node);  // memory-only nodes have no CPUs
+		}
+		closedir(dir);
+	}
+	std::sort(nodes.begin(), nodes.end(), [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+
+	if (nodes.empty()) nodes.push_back({0, allowed});
+	return nodes;
+}
+
+bool pin_current_thread(const std::vector<int>& cpus) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int cpu : cpus)
+		if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
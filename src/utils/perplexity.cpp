@@ -0,0 +1,118 @@
+#include "utils/perplexity.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+double PerplexityResult::perplexity() const {
+	return std::exp(mean_nll());
+}
+
+double target_log_prob(const float* logits, size_t vocab_size, int target) {
+	if (target < 0 || static_cast<size_t>(target) >= vocab_size) {
+		throw std::runtime_error("target_log_prob: token " + std::to_string(target) + " out of vocab range");
+	}
+	float max_logit = logits[0];
+	#pragma omp simd reduction(max:max_logit)
+	for (size_t i = 0; i < vocab_size; ++i) max_logit = std::max(max_logit, logits[i]);
+
+	double sum = 0.0;
+	#pragma omp simd reduction(+:sum)
+	for (size_t i = 0; i < vocab_size; ++i) sum += std::exp(logits[i] - max_logit);
+
+	return static_cast<double>(logits[target] - max_logit) - std::log(sum);
+}
+
+// Negative log-likelihood of tokens[target_begin + i] given hidden row first_row + i,
+// for the rows [first_row, num_rows) of a window's hidden states [1, num_rows, hidden]
+static double score_rows(LlamaForCausalLM& model, const Tensor<>& hidden, size_t first_row,
+						 const std::vector<int>& tokens, size_t target_begin, size_t lm_head_rows) {
+	auto shape = hidden.get_shape();
+	size_t num_rows = shape[1];
+	size_t hidden_size = shape[2];
+	Tensor<> rows2d = hidden.reshape({num_rows, hidden_size});
+
+	double nll = 0.0;
+	for (size_t first = first_row; first < num_rows; first += lm_head_rows) {
+		size_t count = std::min(lm_head_rows, num_rows - first);
+		std::vector<size_t> idx(count);
+		for (size_t i = 0; i < count; ++i) idx[i] = first + i;
+		Tensor<> h = rows2d.gather_rows(idx).contiguous().reshape({1, count, hidden_size});
+
+		Tensor<> logits = model.lm_head(Variable(h)).data();
+		if (logits.is_device()) logits = logits.cpu();
+		const float* data = logits.raw_data().data();
+		size_t vocab = logits.get_shape().back();
+
+		size_t target0 = target_begin + (first - first_row);
+		for (size_t i = 0; i < count; ++i) {
+			int target = tokens[target0 + i];
+			if (target < 0 || static_cast<size_t>(target) >= vocab)
+				throw std::runtime_error("evaluate_perplexity: token " + std::to_string(target) + " out of vocab range");
+		}
+		double chunk_nll = 0.0;
+		#pragma omp parallel for schedule(static) reduction(+:chunk_nll) if (count > 1)
+		for (long i = 0; i < static_cast<long>(count); ++i)
+			chunk_nll -= target_log_prob(data + i * vocab, vocab, tokens[target0 + i]);
+		nll += chunk_nll;
+	}
+	return nll;
+}
+
+PerplexityResult evaluate_perplexity(LlamaForCausalLM& model, const std::vector<int>& tokens,
+									 const PerplexityConfig& config,
+									 const PerplexityCallback& on_window) {
+	size_t context_len = config.context_len;
+	size_t stride = config.stride;
+	if (context_len == 0 || stride == 0 || stride > context_len) {
+		throw std::runtime_error("evaluate_perplexity: need 0 < stride <= context_len");
+	}
+	if (config.lm_head_rows == 0) {
+		throw std::runtime_error("evaluate_perplexity: lm_head_rows must be positive");
+	}
+	size_t n = config.max_tokens ? std::min(config.max_tokens, tokens.size()) : tokens.size();
+	if (n < 2) {
+		throw std::runtime_error("evaluate_perplexity: need at least 2 tokens");
+	}
+
+	PerplexityResult result;
+	auto start = Clock::now();
+	model.reset_cache();
+
+	// Position p predicts token p + 1, so the last token is only ever a target.
+	// Tokens [0, done) have been run through the model and their successors scored.
+	size_t last = n - 1;
+	for (size_t done = 0; done < last;) {
+		size_t end = std::min(last, done == 0 ? context_len : done + stride);
+
+		size_t begin;  // first token of this forward pass
+		size_t position_offset;
+		if (config.reuse_cache) {
+			// Make room in the cache for the new tokens, keeping the most recent ones
+			size_t cached = model.cache_len();
+			if (cached + (end - done) > context_len) model.shift_cache(cached + (end - done) - context_len);
+			begin = done;
+			position_offset = model.cache_len();
+		} else {
+			begin = end > context_len ? end - context_len : 0;
+			position_offset = 0;
+			model.reset_cache();
+		}
+
+		std::vector<int> window(tokens.begin() + begin, tokens.begin() + end);
+		Tensor<> hidden = model.get_model()->forward_ids(window, position_offset).data();
+		result.nll += score_rows(model, hidden, done - begin, tokens, done + 1, config.lm_head_rows);
+		result.scored_tokens += end - done;
+		result.forwarded_tokens += window.size();
+		result.windows++;
+		result.elapsed_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		if (on_window) on_window(result);
+
+		done = end;
+	}
+	return result;
+}
@@ -0,0 +1,129 @@
+#include "utils/prefix_cache.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+PrefixCache::PrefixCache(size_t block_size, size_t memory_budget)
+	: block_size(block_size), memory_budget(memory_budget) {
+	if (block_size == 0) {
+		throw std::invalid_argument("PrefixCache: block_size must be positive");
+	}
+}
+
+uint64_t PrefixCache::hash_block(const int* ids) const {
+	// FNV-1a over the block's token ids
+	uint64_t h = 1469598103934665603ull;
+	for (size_t i = 0; i < block_size; ++i) {
+		h ^= static_cast<uint32_t>(ids[i]);
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+PrefixCache::Node* PrefixCache::find_child(Node* node, const int* ids) const {
+	auto it = node->children.find(hash_block(ids));
+	if (it == node->children.end()) return nullptr;
+	// Guard against hash collisions
+	if (!std::equal(ids, ids + block_size, it->second->tokens.begin())) return nullptr;
+	return it->second.get();
+}
+
+size_t PrefixCache::restore(LlamaForCausalLM& model, const std::vector<int>& token_ids,
+							size_t max_tokens) {
+	model.reset_cache();
+
+	auto llama = model.get_model();
+	size_t num_layers = llama->get_num_layers();
+	// The tensor-parallel engine keeps its own sharded cache
+	if (llama->get_tensor_parallel()) return 0;
+	size_t limit = std::min(max_tokens, token_ids.size());
+
+	// Walk the tree as far as the blocks match
+	std::vector<Node*> path;
+	Node* node = &root;
+	size_t matched = 0;
+	while (matched + block_size <= limit) {
+		Node* child = find_child(node, token_ids.data() + matched);
+		if (!child) break;
+		path.push_back(child);
+		node = child;
+		matched += block_size;
+	}
+
+	++use_tick;
+	for (size_t b = 0; b < path.size(); ++b) {
+		path[b]->last_used = use_tick;
+		for (size_t l = 0; l < num_layers; ++l) {
+			llama->get_layer(l)->get_self_attn()->import_kv(
+				b * block_size, block_size, path[b]->k[l].data(), path[b]->v[l].data());
+		}
+	}
+	return matched;
+}
+
+void PrefixCache::insert(const LlamaForCausalLM& model, const std::vector<int>& token_ids) {
+	auto llama = model.get_model();
+	size_t num_layers = llama->get_num_layers();
+	if (llama->get_tensor_parallel()) return;
+	size_t valid = std::min(token_ids.size(), model.cache_len());
+	size_t num_full = valid / block_size;
+
+	++use_tick;
+	Node* node = &root;
+	for (size_t b = 0; b < num_full; ++b) {
+		const int* ids = token_ids.data() + b * block_size;
+		Node* child = find_child(node, ids);
+		if (!child) {
+			uint64_t key = hash_block(ids);
+			if (node->children.count(key)) break;  // collision with a different block
+
+			auto fresh = std::make_unique<Node>();
+			fresh->tokens.assign(ids, ids + block_size);
+			fresh->k.resize(num_layers);
+			fresh->v.resize(num_layers);
+			for (size_t l = 0; l < num_layers; ++l) {
+				llama->get_layer(l)->get_self_attn()->export_kv(
+					b * block_size, block_size, fresh->k[l], fresh->v[l]);
+				fresh->bytes += (fresh->k[l].size() + fresh->v[l].size()) * sizeof(float);
+			}
+			fresh->parent = node;
+			fresh->key = key;
+			memory_used += fresh->bytes;
+			++block_count;
+
+			child = fresh.get();
+			node->children.emplace(key, std::move(fresh));
+		}
+		child->last_used = use_tick;
+		node = child;
+	}
+
+	evict();
+}
+
+void PrefixCache::evict() {
+	while (memory_used > memory_budget && block_count > 0) {
+		// Find least recently used leaf
+		Node* victim = nullptr;
+		std::vector<Node*> stack = {&root};
+		while (!stack.empty()) {
+			Node* n = stack.back();
+			stack.pop_back();
+			if (n != &root && n->children.empty()) {
+				if (!victim || n->last_used < victim->last_used) victim = n;
+			}
+			for (auto& [key, child] : n->children) stack.push_back(child.get());
+		}
+		if (!victim) break;
+
+		memory_used -= victim->bytes;
+		--block_count;
+		victim->parent->children.erase(victim->key);
+	}
+}
+
+void PrefixCache::clear() {
+	root.children.clear();
+	memory_used = 0;
+	block_count = 0;
+}
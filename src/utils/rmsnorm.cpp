@@ -0,0 +1,41 @@
+#include "utils/rmsnorm.hpp"
+
+#include <cmath>
+
+static inline void scale_row(const float* x, const float* weight, float* out,
+							 size_t hidden, float sum_sq, float eps) {
+	float inv_rms = 1.0f / std::sqrt(sum_sq / static_cast<float>(hidden) + eps);
+	#pragma omp simd
+	for (size_t h = 0; h < hidden; ++h)
+		out[h] = x[h] * inv_rms * weight[h];
+}
+
+void rmsnorm_cpu(const float* x, const float* weight, float* out,
+				 size_t rows, size_t hidden, float eps) {
+	#pragma omp parallel for schedule(static) if (rows > 1)
+	for (long r = 0; r < static_cast<long>(rows); ++r) {
+		const float* xr = x + r * hidden;
+		float sum_sq = 0.0f;
+		#pragma omp simd reduction(+:sum_sq)
+		for (size_t h = 0; h < hidden; ++h)
+			sum_sq += xr[h] * xr[h];
+		scale_row(xr, weight, out + r * hidden, hidden, sum_sq, eps);
+	}
+}
+
+void add_rmsnorm_cpu(float* residual, const float* delta, const float* weight, float* out,
+					 size_t rows, size_t hidden, float eps) {
+	#pragma omp parallel for schedule(static) if (rows > 1)
+	for (long r = 0; r < static_cast<long>(rows); ++r) {
+		float* xr = residual + r * hidden;
+		const float* dr = delta + r * hidden;
+		float sum_sq = 0.0f;
+		#pragma omp simd reduction(+:sum_sq)
+		for (size_t h = 0; h < hidden; ++h) {
+			float v = xr[h] + dr[h];
+			xr[h] = v;
+			sum_sq += v * v;
+		}
+		scale_row(xr, weight, out + r * hidden, hidden, sum_sq, eps);
+	}
+}
@@ -40,6 +40,17 @@ std::pair<Tensor<>, Tensor<>> precompute_rope_frequencies(
 	return {cos_table, sin_table};
 }
 
+void rope_frequencies_row(double position, size_t head_dim, float theta,
+						  float* cos_row, float* sin_row) {
+	for (size_t i = 0; i < head_dim / 2; ++i) {
+		double inv_freq = 1.0 / std::pow(static_cast<double>(theta),
+										 static_cast<double>(2 * i) / static_cast<double>(head_dim));
+		double angle = position * inv_freq;
+		cos_row[2 * i] = cos_row[2 * i + 1] = static_cast<float>(std::cos(angle));
+		sin_row[2 * i] = sin_row[2 * i + 1] = static_cast<float>(std::sin(angle));
+	}
+}
+
 Variable apply_rope(const Variable& x,
 					const Tensor<>& cos_cache,
 					const Tensor<>& sin_cache,
@@ -52,7 +63,6 @@ Variable apply_rope(const Variable& x,
 	size_t seq_len = shape[1];
 	size_t num_heads = shape[2];
 	size_t head_dim = shape[3];
-	size_t half_dim = head_dim / 2;
 
 	// CPU fallback: raw_data() not available on device tensors
 	// Must store CPU copies in locals to avoid dangling references from temporaries
@@ -65,30 +75,36 @@ Variable apply_rope(const Variable& x,
 
 	std::vector<float> out_data(batch * seq_len * num_heads * head_dim);
 
-	for (size_t b = 0; b < batch; ++b) {
-		for (size_t s = 0; s < seq_len; ++s) {
-			size_t pos = position_offset + s;
-			size_t cos_offset = pos * head_dim;
-
-			for (size_t h = 0; h < num_heads; ++h) {
-				size_t x_offset = ((b * seq_len + s) * num_heads + h) * head_dim;
-
-				// Apply rotation to each pair (x_even, x_odd)
-				for (size_t i = 0; i < half_dim; ++i) {
-					float x_even = x_data[x_offset + 2 * i];
-					float x_odd  = x_data[x_offset + 2 * i + 1];
-					float cos_val = cos_data[cos_offset + 2 * i];
-					float sin_val = sin_data[cos_offset + 2 * i];
-
-					// Rotation: [cos -sin; sin cos] * [x_even; x_odd]
-					out_data[x_offset + 2 * i]     = x_even * cos_val - x_odd * sin_val;
-					out_data[x_offset + 2 * i + 1] = x_even * sin_val + x_odd * cos_val;
-				}
-			}
-		}
+	#pragma omp parallel for schedule(static) if (batch * seq_len > 1)
+	for (long t = 0; t < static_cast<long>(batch * seq_len); ++t) {
+		size_t pos = position_offset + static_cast<size_t>(t) % seq_len;
+		size_t x_offset = t * num_heads * head_dim;
+		rope_rotate_row(x_data.data() + x_offset, out_data.data() + x_offset, num_heads, head_dim,
+						cos_data.data() + pos * head_dim, sin_data.data() + pos * head_dim);
 	}
 
 	Tensor<> result(shape, out_data);
 	if (!orig_device.is_cpu()) result = result.to(orig_device);
 	return Variable(result);
 }
+
+void rope_rotate_row(const float* x, float* out, size_t num_heads, size_t head_dim,
+					 const float* cos_row, const float* sin_row) {
+	size_t half_dim = head_dim / 2;
+	for (size_t h = 0; h < num_heads; ++h) {
+		const float* xh = x + h * head_dim;
+		float* oh = out + h * head_dim;
+		// Each iteration only touches its own (even, odd) pair, so aliasing is fine
+		#pragma omp simd
+		for (size_t i = 0; i < half_dim; ++i) {
+			float x_even = xh[2 * i];
+			float x_odd  = xh[2 * i + 1];
+			float cos_val = cos_row[2 * i];
+			float sin_val = sin_row[2 * i];
+
+			// Rotation: [cos -sin; sin cos] * [x_even; x_odd]
+			oh[2 * i]     = x_even * cos_val - x_odd * sin_val;
+			oh[2 * i + 1] = x_even * sin_val + x_odd * cos_val;
+		}
+	}
+}
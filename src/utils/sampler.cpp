@@ -0,0 +1,330 @@
+#include "utils/sampler.hpp"
+#include "utils/generate.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+// Two passes: vector max, then first lane equal to it
+__attribute__((target("avx2")))
+static int argmax_avx2(const float* x, size_t n) {
+	float best = x[0];
+	size_t i = 0;
+	if (n >= 8) {
+		__m256 vmax = _mm256_loadu_ps(x);
+		for (i = 8; i + 8 <= n; i += 8)
+			vmax = _mm256_max_ps(vmax, _mm256_loadu_ps(x + i));
+		float lanes[8];
+		_mm256_storeu_ps(lanes, vmax);
+		best = *std::max_element(lanes, lanes + 8);
+	}
+	for (; i < n; ++i)
+		if (x[i] > best) best = x[i];
+
+	__m256 vbest = _mm256_set1_ps(best);
+	size_t j = 0;
+	for (; j + 8 <= n; j += 8) {
+		int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(x + j), vbest, _CMP_EQ_OQ));
+		if (mask) return static_cast<int>(j + __builtin_ctz(mask));
+	}
+	for (; j < n; ++j)
+		if (x[j] == best) return static_cast<int>(j);
+	return 0;
+}
+
+// Cephes-style exp: 2^n * p(r), max relative error ~1e-7
+__attribute__((target("avx2,fma")))
+static void exp_shifted_avx2(const float* x, float max, float scale, float* out, size_t n) {
+	const __m256 vmax = _mm256_set1_ps(max);
+	const __m256 vscale = _mm256_set1_ps(scale);
+	const __m256 hi = _mm256_set1_ps(88.3762626647949f);
+	const __m256 lo = _mm256_set1_ps(-88.3762626647949f);
+	const __m256 log2e = _mm256_set1_ps(1.44269504088896341f);
+	const __m256 c1 = _mm256_set1_ps(0.693359375f);
+	const __m256 c2 = _mm256_set1_ps(-2.12194440e-4f);
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 v = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(x + i), vmax), vscale);
+		v = _mm256_max_ps(_mm256_min_ps(v, hi), lo);
+
+		__m256 fx = _mm256_floor_ps(_mm256_fmadd_ps(v, log2e, half));
+		v = _mm256_fnmadd_ps(fx, c1, v);
+		v = _mm256_fnmadd_ps(fx, c2, v);
+
+		__m256 y = _mm256_set1_ps(1.9875691500e-4f);
+		y = _mm256_fmadd_ps(y, v, _mm256_set1_ps(1.3981999507e-3f));
+		y = _mm256_fmadd_ps(y, v, _mm256_set1_ps(8.3334519073e-3f));
+		y = _mm256_fmadd_ps(y, v, _mm256_set1_ps(4.1665795894e-2f));
+		y = _mm256_fmadd_ps(y, v, _mm256_set1_ps(1.6666665459e-1f));
+		y = _mm256_fmadd_ps(y, v, half);
+		y = _mm256_fmadd_ps(y, _mm256_mul_ps(v, v), _mm256_add_ps(v, one));
+
+		__m256i e = _mm256_add_epi32(_mm256_cvttps_epi32(fx), _mm256_set1_epi32(127));
+		y = _mm256_mul_ps(y, _mm256_castsi256_ps(_mm256_slli_epi32(e, 23)));
+		_mm256_storeu_ps(out + i, y);
+	}
+	for (; i < n; ++i)
+		out[i] = std::exp((x[i] - max) * scale);
+}
+#endif
+
+static int argmax_scalar(const float* x, size_t n) {
+	size_t best = 0;
+	for (size_t i = 1; i < n; ++i)
+		if (x[i] > x[best]) best = i;
+	return static_cast<int>(best);
+}
+
+int argmax_f32(const float* x, size_t n) {
+	if (n == 0) return -1;
+#if defined(__x86_64__)
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+	if (has_avx2) return argmax_avx2(x, n);
+#endif
+	return argmax_scalar(x, n);
+}
+
+void exp_shifted_f32(const float* x, float max, float scale, float* out, size_t n) {
+#if defined(__x86_64__)
+	static const bool has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	if (has_avx2) {
+		exp_shifted_avx2(x, max, scale, out, n);
+		return;
+	}
+#endif
+	for (size_t i = 0; i < n; ++i)
+		out[i] = std::exp((x[i] - max) * scale);
+}
+
+// ============================================================
+// Sampler
+// ============================================================
+
+Sampler::Sampler(const GenerationConfig& config)
+	: temperature(config.temperature),
+	  greedy(!config.do_sample || config.temperature <= 0.0f),
+	  top_k(config.top_k), top_p(config.top_p), min_p(config.min_p),
+	  repetition_penalty(config.repetition_penalty),
+	  frequency_penalty(config.frequency_penalty),
+	  presence_penalty(config.presence_penalty),
+	  rng(static_cast<std::mt19937::result_type>(config.seed)) {}
+
+bool Sampler::has_penalties() const {
+	return repetition_penalty != 1.0f || frequency_penalty != 0.0f || presence_penalty != 0.0f;
+}
+
+const float* Sampler::apply_penalties(const float* logits, size_t vocab_size) {
+	if (seen.empty() || !has_penalties()) return logits;
+
+	// Only tokens in the history change; the copy is a plain memcpy
+	penalized.assign(logits, logits + vocab_size);
+	for (int t : seen) {
+		if (static_cast<size_t>(t) >= vocab_size) continue;
+		float& l = penalized[t];
+		if (repetition_penalty != 1.0f)
+			l = l > 0.0f ? l / repetition_penalty : l * repetition_penalty;
+		l -= frequency_penalty * static_cast<float>(counts[t]) + presence_penalty;
+	}
+	return penalized.data();
+}
+
+float Sampler::build_candidates(const float* logits, size_t vocab_size) {
+	const float max_logit = logits[argmax_f32(logits, vocab_size)];
+	const float inv_temp = 1.0f / temperature;
+	auto by_logit_desc = [logits](int a, int b) { return logits[a] > logits[b]; };
+
+	candidates.clear();
+	weights.clear();
+	const float* w = nullptr;  // weights of the whole vocab, when computed
+
+	if (top_k > 0 && top_k < vocab_size) {
+		// Top-k: size-k min-heap over the logits (one compare per token), exp only for k
+		candidates.resize(top_k);
+		for (size_t i = 0; i < top_k; ++i) candidates[i] = static_cast<int>(i);
+		std::make_heap(candidates.begin(), candidates.end(), by_logit_desc);
+		for (size_t i = top_k; i < vocab_size; ++i) {
+			if (logits[i] > logits[candidates.front()]) {
+				std::pop_heap(candidates.begin(), candidates.end(), by_logit_desc);
+				candidates.back() = static_cast<int>(i);
+				std::push_heap(candidates.begin(), candidates.end(), by_logit_desc);
+			}
+		}
+		std::sort_heap(candidates.begin(), candidates.end(), by_logit_desc);
+
+		float mass = 0.0f;
+		for (int t : candidates) {
+			weights.push_back(std::exp((logits[t] - max_logit) * inv_temp));
+			mass += weights.back();
+		}
+
+		// Top-p relative to the renormalized top-k set
+		if (top_p < 1.0f) {
+			float cumulative = 0.0f;
+			size_t keep = 0;
+			while (keep < weights.size()) {
+				cumulative += weights[keep++];
+				if (cumulative >= top_p * mass) break;
+			}
+			candidates.resize(keep);
+			weights.resize(keep);
+		}
+	} else {
+		all_weights.resize(vocab_size);
+		exp_shifted_f32(logits, max_logit, inv_temp, all_weights.data(), vocab_size);
+		w = all_weights.data();
+	}
+
+	if (w && top_p < 1.0f) {
+		// Top-p over the full vocab: histogram over the scaled distance from the max logit.
+		// Buckets are ordered by logit, so the nucleus keeps whole buckets and only the
+		// bucket the cut falls in is sorted -> O(V) instead of sorting the vocab.
+		constexpr int NUM_BUCKETS = 512;
+		constexpr float RANGE = 32.0f;  // exp(-32): beyond this everything shares the last bucket
+		const float bucket_scale = NUM_BUCKETS / RANGE * inv_temp;
+		auto bucket_of = [&](size_t i) {
+			float d = (max_logit - logits[i]) * bucket_scale;
+			return d >= NUM_BUCKETS ? NUM_BUCKETS : static_cast<int>(d);
+		};
+
+		bucket_mass.assign(NUM_BUCKETS + 1, 0.0f);
+		float total = 0.0f;
+		for (size_t i = 0; i < vocab_size; ++i) {
+			bucket_mass[bucket_of(i)] += w[i];
+			total += w[i];
+		}
+
+		int cut = 0;
+		float kept_mass = 0.0f;
+		for (; cut < NUM_BUCKETS && kept_mass + bucket_mass[cut] < top_p * total; ++cut)
+			kept_mass += bucket_mass[cut];
+
+		boundary.clear();
+		for (size_t i = 0; i < vocab_size; ++i) {
+			int b = bucket_of(i);
+			if (b < cut) candidates.push_back(static_cast<int>(i));
+			else if (b == cut) boundary.push_back(static_cast<int>(i));
+		}
+
+		// Boundary tokens in descending order until the mass is reached
+		std::sort(boundary.begin(), boundary.end(), by_logit_desc);
+		for (size_t j = 0; j < boundary.size(); ++j) {
+			if (kept_mass >= top_p * total && !candidates.empty()) break;
+			candidates.push_back(boundary[j]);
+			kept_mass += w[boundary[j]];
+		}
+
+		for (int t : candidates) weights.push_back(w[t]);
+	}
+
+	// Min-p: drop tokens below min_p * p_max (the max token has weight 1)
+	if (min_p > 0.0f) {
+		if (candidates.empty()) {
+			for (size_t i = 0; i < vocab_size; ++i) {
+				if (w[i] >= min_p) {
+					candidates.push_back(static_cast<int>(i));
+					weights.push_back(w[i]);
+				}
+			}
+		} else {
+			size_t kept = 0;
+			for (size_t i = 0; i < weights.size(); ++i) {
+				if (weights[i] >= min_p) {
+					candidates[kept] = candidates[i];
+					weights[kept] = weights[i];
+					++kept;
+				}
+			}
+			candidates.resize(kept);
+			weights.resize(kept);
+		}
+	}
+
+	// No filter: the whole vocab, weights stay in all_weights
+	if (candidates.empty()) {
+		float sum = 0.0f;
+		#pragma omp simd reduction(+:sum)
+		for (size_t i = 0; i < vocab_size; ++i) sum += w[i];
+		return sum;
+	}
+
+	float sum = 0.0f;
+	for (float x : weights) sum += x;
+	return sum;
+}
+
+int Sampler::sample(const float* logits, size_t vocab_size) {
+	const float* l = apply_penalties(logits, vocab_size);
+	if (greedy) return argmax_f32(l, vocab_size);
+
+	float sum = build_candidates(l, vocab_size);
+	float r = uniform() * sum;
+	if (candidates.empty()) {
+		for (size_t i = 0; i < vocab_size; ++i) {
+			r -= all_weights[i];
+			if (r < 0.0f) return static_cast<int>(i);
+		}
+		return argmax_f32(l, vocab_size);  // rounding
+	}
+	for (size_t i = 0; i < weights.size(); ++i) {
+		r -= weights[i];
+		if (r < 0.0f) return candidates[i];
+	}
+	return candidates.front();  // rounding
+}
+
+void Sampler::distribution(const float* logits, size_t vocab_size, std::vector<float>& probs) {
+	const float* l = apply_penalties(logits, vocab_size);
+	float sum = build_candidates(l, vocab_size);
+	if (candidates.empty()) {
+		probs.resize(vocab_size);
+		for (size_t i = 0; i < vocab_size; ++i)
+			probs[i] = all_weights[i] / sum;
+		return;
+	}
+	probs.assign(vocab_size, 0.0f);
+	for (size_t i = 0; i < candidates.size(); ++i)
+		probs[candidates[i]] = weights[i] / sum;
+}
+
+int Sampler::sample_from(const std::vector<float>& probs) {
+	float total = 0.0f;
+	for (float p : probs) total += p;
+	float r = uniform() * total;
+	int last = 0;
+	for (size_t i = 0; i < probs.size(); ++i) {
+		if (probs[i] <= 0.0f) continue;
+		last = static_cast<int>(i);
+		r -= probs[i];
+		if (r < 0.0f) return last;
+	}
+	return last;
+}
+
+float Sampler::uniform() {
+	return std::uniform_real_distribution<float>(0.0f, 1.0f)(rng);
+}
+
+void Sampler::accept(int token) {
+	if (token < 0) return;
+	if (static_cast<size_t>(token) >= counts.size()) counts.resize(token + 1, 0);
+	if (counts[token]++ == 0) seen.push_back(token);
+}
+
+void Sampler::forget(int token) {
+	if (token < 0 || static_cast<size_t>(token) >= counts.size() || counts[token] == 0) return;
+	if (--counts[token] == 0) {
+		auto it = std::find(seen.begin(), seen.end(), token);
+		*it = seen.back();
+		seen.pop_back();
+	}
+}
+
+void Sampler::reset() {
+	counts.clear();
+	seen.clear();
+}
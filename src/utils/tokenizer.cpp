@@ -4,10 +4,16 @@
 #include <fstream>
 #include <iostream>
 #include <algorithm>
-#include <sstream>
-#include <regex>
+#include <cstdio>
+#include <cstring>
+#include <queue>
 #include <stdexcept>
-#include <limits>
+#include <unordered_set>
+#include <fcntl.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using json = nlohmann::json;
 
@@ -52,77 +58,253 @@ void LlamaTokenizer::init_byte_to_token() {
 	}
 }
 
-std::string LlamaTokenizer::merge_key(const std::string& a, const std::string& b) const {
-	return a + " " + b;
+namespace {
+
+// Binary cache layout: ImageHeader, then 8-byte aligned sections
+//   MergeEntry merges[merge_slots]
+//   uint32_t   token_offsets[num_tokens + 1]
+//   int32_t    vocab_table[vocab_slots]
+//   int32_t    byte_ids[256]
+//   char       arena[arena_bytes]
+constexpr char IMAGE_MAGIC[8] = {'D', 'C', 'Z', 'T', 'O', 'K', '\0', '\1'};
+constexpr size_t MERGE_ENTRY_BYTES = 16;
+constexpr uint64_t EMPTY_KEY = ~uint64_t(0);
+
+struct ImageHeader {
+	char magic[8];
+	uint32_t num_tokens;
+	uint32_t vocab_slots;   // power of two
+	uint32_t merge_slots;   // power of two
+	uint32_t num_merges;
+	int32_t bos_token_id;
+	int32_t eos_token_id;
+	int32_t eot_token_id;
+	uint32_t reserved;
+	uint64_t arena_bytes;
+	// tokenizer.json the image was built from, for load_cached
+	uint64_t source_size;
+	int64_t source_mtime;
+};
+
+struct ImageLayout {
+	size_t merges;
+	size_t offsets;
+	size_t vocab;
+	size_t byte_ids;
+	size_t arena;
+	size_t total;
+};
+
+size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+ImageLayout image_layout(const ImageHeader& h) {
+	ImageLayout l;
+	l.merges = align8(sizeof(ImageHeader));
+	l.offsets = align8(l.merges + size_t(h.merge_slots) * MERGE_ENTRY_BYTES);
+	l.vocab = align8(l.offsets + (size_t(h.num_tokens) + 1) * sizeof(uint32_t));
+	l.byte_ids = align8(l.vocab + size_t(h.vocab_slots) * sizeof(int32_t));
+	l.arena = align8(l.byte_ids + 256 * sizeof(int32_t));
+	l.total = l.arena + h.arena_bytes;
+	return l;
 }
 
-std::vector<std::string> LlamaTokenizer::bpe(const std::vector<std::string>& tokens) const {
-	if (tokens.size() <= 1) return tokens;
+size_t table_slots(size_t entries) {
+	size_t slots = 16;
+	while (slots < 2 * entries) slots *= 2;
+	return slots;
+}
 
-	std::vector<std::string> word(tokens);
+// FNV-1a; part of the file format, since vocab_table is stored hashed
+uint64_t hash_token(std::string_view s) {
+	uint64_t h = 0xCBF29CE484222325ull;
+	for (unsigned char c : s) h = (h ^ c) * 0x100000001B3ull;
+	return h;
+}
 
-	while (word.size() > 1) {
-		// Find the pair with lowest merge rank
-		int best_rank = std::numeric_limits<int>::max();
-		size_t best_pos = 0;
-		bool found = false;
+uint64_t pair_key(int left, int right) {
+	return (static_cast<uint64_t>(static_cast<uint32_t>(left)) << 32) | static_cast<uint32_t>(right);
+}
 
-		for (size_t i = 0; i < word.size() - 1; ++i) {
-			std::string key = merge_key(word[i], word[i + 1]);
-			auto it = merge_ranks.find(key);
-			if (it != merge_ranks.end() && it->second < best_rank) {
-				best_rank = it->second;
-				best_pos = i;
-				found = true;
-			}
-		}
+size_t pair_slot(uint64_t key, size_t mask) {
+	// Fibonacci hashing: the high bits of the product mix both ids
+	return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+bool file_stat(const std::string& path, uint64_t& size, int64_t& mtime) {
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0) return false;
+	size = static_cast<uint64_t>(st.st_size);
+	mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+	return true;
+}
 
-		if (!found) break;
+}  // namespace
 
-		// Merge the best pair
-		std::vector<std::string> new_word;
-		for (size_t i = 0; i < word.size(); ++i) {
-			if (i == best_pos) {
-				new_word.push_back(word[i] + word[i + 1]);
-				++i;  // Skip next token
-			} else {
-				new_word.push_back(word[i]);
-			}
+LlamaTokenizer::~LlamaTokenizer() {
+	release_image();
+}
+
+void LlamaTokenizer::release_image() {
+	if (mapped_image) munmap(const_cast<uint8_t*>(mapped_image), mapped_size);
+	mapped_image = nullptr;
+	mapped_size = 0;
+	owned_image.clear();
+	owned_image.shrink_to_fit();
+	num_tokens = 0;
+	token_offsets = nullptr;
+	arena = nullptr;
+	vocab_table = nullptr;
+	vocab_mask = 0;
+	merge_table = nullptr;
+	merge_mask = 0;
+	num_merges = 0;
+	byte_ids = nullptr;
+	bos_token_id = eos_token_id = eot_token_id = -1;
+}
+
+void LlamaTokenizer::attach_image(const uint8_t* image, size_t size, const std::string& source) {
+	static_assert(sizeof(MergeEntry) == MERGE_ENTRY_BYTES, "MergeEntry is stored as is");
+	ImageHeader h;
+	if (size < sizeof(h)) throw std::runtime_error("Truncated tokenizer cache: " + source);
+	std::memcpy(&h, image, sizeof(h));
+	if (std::memcmp(h.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0)
+		throw std::runtime_error("Not a tokenizer cache: " + source);
+	ImageLayout l = image_layout(h);
+	if (size < l.total || (h.vocab_slots & (h.vocab_slots - 1)) || (h.merge_slots & (h.merge_slots - 1)) ||
+		h.vocab_slots == 0 || h.merge_slots == 0)
+		throw std::runtime_error("Corrupt tokenizer cache: " + source);
+
+	const uint32_t* offsets = reinterpret_cast<const uint32_t*>(image + l.offsets);
+	for (size_t i = 0; i < h.num_tokens; ++i) {
+		if (offsets[i] > offsets[i + 1]) throw std::runtime_error("Corrupt tokenizer cache: " + source);
+	}
+	if (offsets[h.num_tokens] != h.arena_bytes) throw std::runtime_error("Corrupt tokenizer cache: " + source);
+
+	num_tokens = h.num_tokens;
+	token_offsets = offsets;
+	arena = reinterpret_cast<const char*>(image + l.arena);
+	vocab_table = reinterpret_cast<const int32_t*>(image + l.vocab);
+	vocab_mask = h.vocab_slots - 1;
+	merge_table = reinterpret_cast<const MergeEntry*>(image + l.merges);
+	merge_mask = h.merge_slots - 1;
+	num_merges = h.num_merges;
+	byte_ids = reinterpret_cast<const int32_t*>(image + l.byte_ids);
+	bos_token_id = h.bos_token_id;
+	eos_token_id = h.eos_token_id;
+	eot_token_id = h.eot_token_id;
+
+	if (byte_to_token.empty()) init_byte_to_token();
+	clear_cache();
+}
+
+std::string_view LlamaTokenizer::token_string(int id) const {
+	if (id < 0 || static_cast<size_t>(id) >= num_tokens) return {};
+	return std::string_view(arena + token_offsets[id], token_offsets[id + 1] - token_offsets[id]);
+}
+
+int LlamaTokenizer::find_token(std::string_view token) const {
+	if (!vocab_table) return -1;
+	for (size_t slot = hash_token(token) & vocab_mask;; slot = (slot + 1) & vocab_mask) {
+		int id = vocab_table[slot];
+		if (id < 0) return -1;
+		if (token_string(id) == token) return id;
+	}
+}
+
+const LlamaTokenizer::MergeEntry* LlamaTokenizer::find_merge(int left, int right) const {
+	if (!merge_table) return nullptr;
+	uint64_t key = pair_key(left, right);
+	for (size_t slot = pair_slot(key, merge_mask);; slot = (slot + 1) & merge_mask) {
+		const MergeEntry& entry = merge_table[slot];
+		if (entry.key == key) return &entry;
+		if (entry.key == EMPTY_KEY) return nullptr;
+	}
+}
+
+void LlamaTokenizer::bpe(std::string_view pretoken, std::vector<int>& out) const {
+	// Symbols form a doubly linked list over the pre-token's bytes; a merge folds the
+	// right symbol into the left one, so a symbol's index is its original position
+	struct Symbol {
+		int id;
+		int prev;
+		int next;
+	};
+	// Candidate merge of the pair starting at symbol pos. Entries go stale when either
+	// side is merged away; they are checked against the list when popped.
+	struct Candidate {
+		int rank;
+		int pos;
+		int left;
+		int right;
+		bool operator>(const Candidate& o) const {
+			return rank != o.rank ? rank > o.rank : pos > o.pos;
 		}
-		word = std::move(new_word);
+	};
+
+	std::vector<Symbol> symbols;
+	symbols.reserve(pretoken.size());
+	for (unsigned char byte : pretoken) {
+		int id = byte_ids[byte];
+		if (id < 0) continue;  // byte missing from the vocab
+		int n = static_cast<int>(symbols.size());
+		symbols.push_back({id, n - 1, -1});
+		if (n > 0) symbols[n - 1].next = n;
+	}
+	if (symbols.empty()) return;
+
+	std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+	auto push_pair = [&](int pos) {
+		if (pos < 0) return;
+		int next = symbols[pos].next;
+		if (next < 0) return;
+		if (const MergeEntry* merge = find_merge(symbols[pos].id, symbols[next].id))
+			queue.push({merge->rank, pos, symbols[pos].id, symbols[next].id});
+	};
+	for (int i = 0; i + 1 < static_cast<int>(symbols.size()); ++i) push_pair(i);
+
+	// Lowest rank first, leftmost among equal ranks: the same order as repeatedly
+	// rescanning the word for its best pair
+	while (!queue.empty()) {
+		Candidate c = queue.top();
+		queue.pop();
+		Symbol& left = symbols[c.pos];
+		if (left.id != c.left || left.next < 0) continue;
+		Symbol& right = symbols[left.next];
+		if (right.id != c.right) continue;
+
+		left.id = find_merge(c.left, c.right)->merged_id;
+		left.next = right.next;
+		if (right.next >= 0) symbols[right.next].prev = c.pos;
+		right.id = -1;
+
+		push_pair(left.prev);
+		push_pair(c.pos);
 	}
 
-	return word;
+	for (int i = 0; i >= 0; i = symbols[i].next) out.push_back(symbols[i].id);
 }
 
-void LlamaTokenizer::load(const std::string& tokenizer_json_path) {
+void LlamaTokenizer::load_json(const std::string& tokenizer_json_path) {
 	std::ifstream f(tokenizer_json_path);
 	if (!f.is_open()) {
 		throw std::runtime_error("Cannot open tokenizer file: " + tokenizer_json_path);
 	}
-
-	std::cout << "Loading tokenizer from: " << tokenizer_json_path << std::endl;
 	json data = json::parse(f);
 
 	// Load vocabulary from model.vocab
 	const auto& model = data["model"];
 	const auto& vocab_data = model["vocab"];
 
-	// Find max id to size the id_to_token vector
-	int max_id = 0;
-	for (auto& [token, id] : vocab_data.items()) {
-		int token_id = id.get<int>();
-		if (token_id > max_id) max_id = token_id;
-	}
-
-	id_to_token.resize(max_id + 1);
-
+	std::unordered_map<std::string, int> vocab;
+	std::vector<std::string> id_to_token;
 	for (auto& [token, id] : vocab_data.items()) {
 		int token_id = id.get<int>();
+		if (token_id >= static_cast<int>(id_to_token.size())) id_to_token.resize(token_id + 1);
 		vocab[token] = token_id;
 		id_to_token[token_id] = token;
 	}
 
+	int bos = -1, eos = -1, eot = -1;
 	// Also load added_tokens (special tokens like <|begin_of_text|>)
 	if (data.contains("added_tokens")) {
 		for (const auto& added : data["added_tokens"]) {
@@ -138,13 +320,16 @@ void LlamaTokenizer::load(const std::string& tokenizer_json_path) {
 			id_to_token[id] = content;
 
 			// Identify special tokens
-			if (content == "<|begin_of_text|>") bos_token_id = id;
-			else if (content == "<|end_of_text|>") eos_token_id = id;
-			else if (content == "<|eot_id|>") eot_token_id = id;
+			if (content == "<|begin_of_text|>") bos = id;
+			else if (content == "<|end_of_text|>") eos = id;
+			else if (content == "<|eot_id|>") eot = id;
 		}
 	}
 
-	// Load merge rules
+	// Load merge rules. Both halves and the merged token must be in the vocab;
+	// a repeated pair keeps its first (best) rank.
+	std::vector<MergeEntry> merges;
+	std::unordered_set<uint64_t> seen;
 	if (model.contains("merges")) {
 		const auto& merges_data = model["merges"];
 		for (size_t i = 0; i < merges_data.size(); ++i) {
@@ -161,83 +346,414 @@ void LlamaTokenizer::load(const std::string& tokenizer_json_path) {
 				a = merge_str.substr(0, space);
 				b = merge_str.substr(space + 1);
 			}
-			merges.push_back({a, b});
-			merge_ranks[merge_key(a, b)] = static_cast<int>(i);
+			auto left = vocab.find(a), right = vocab.find(b), merged = vocab.find(a + b);
+			if (left == vocab.end() || right == vocab.end() || merged == vocab.end()) continue;
+			uint64_t key = pair_key(left->second, right->second);
+			if (!seen.insert(key).second) continue;
+			merges.push_back({key, static_cast<int32_t>(i), merged->second});
 		}
 	}
 
-	init_byte_to_token();
+	// Lay everything out as the binary image
+	ImageHeader h = {};
+	std::memcpy(h.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+	h.num_tokens = static_cast<uint32_t>(id_to_token.size());
+	h.vocab_slots = static_cast<uint32_t>(table_slots(vocab.size()));
+	h.merge_slots = static_cast<uint32_t>(table_slots(merges.size()));
+	h.num_merges = static_cast<uint32_t>(merges.size());
+	h.bos_token_id = bos;
+	h.eos_token_id = eos;
+	h.eot_token_id = eot;
+	for (const auto& token : id_to_token) h.arena_bytes += token.size();
+	file_stat(tokenizer_json_path, h.source_size, h.source_mtime);
+
+	ImageLayout l = image_layout(h);
+	std::vector<uint8_t> image(l.total, 0);
+	std::memcpy(image.data(), &h, sizeof(h));
+
+	MergeEntry* table = reinterpret_cast<MergeEntry*>(image.data() + l.merges);
+	std::fill(table, table + h.merge_slots, MergeEntry{EMPTY_KEY, 0, 0});
+	for (const MergeEntry& m : merges) {
+		size_t slot = pair_slot(m.key, h.merge_slots - 1);
+		while (table[slot].key != EMPTY_KEY) slot = (slot + 1) & (h.merge_slots - 1);
+		table[slot] = m;
+	}
+
+	uint32_t* offsets = reinterpret_cast<uint32_t*>(image.data() + l.offsets);
+	char* text = reinterpret_cast<char*>(image.data() + l.arena);
+	for (size_t i = 0, pos = 0; i <= id_to_token.size(); ++i) {
+		offsets[i] = static_cast<uint32_t>(pos);
+		if (i == id_to_token.size()) break;
+		std::memcpy(text + pos, id_to_token[i].data(), id_to_token[i].size());
+		pos += id_to_token[i].size();
+	}
 
-	std::cout << "Tokenizer loaded: vocab_size=" << id_to_token.size()
-			  << ", merges=" << merges.size()
+	int32_t* ids = reinterpret_cast<int32_t*>(image.data() + l.vocab);
+	std::fill(ids, ids + h.vocab_slots, -1);
+	for (const auto& [token, id] : vocab) {
+		size_t slot = hash_token(token) & (h.vocab_slots - 1);
+		while (ids[slot] >= 0) slot = (slot + 1) & (h.vocab_slots - 1);
+		ids[slot] = id;
+	}
+
+	if (byte_to_token.empty()) init_byte_to_token();
+	int32_t* bytes = reinterpret_cast<int32_t*>(image.data() + l.byte_ids);
+	for (int b = 0; b < 256; ++b) {
+		auto it = vocab.find(byte_to_token[static_cast<unsigned char>(b)]);
+		bytes[b] = it != vocab.end() ? it->second : -1;
+	}
+
+	release_image();
+	owned_image = std::move(image);
+	attach_image(owned_image.data(), owned_image.size(), tokenizer_json_path);
+}
+
+void LlamaTokenizer::load_binary(const std::string& path) {
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) throw std::runtime_error("Cannot open tokenizer cache: " + path);
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		throw std::runtime_error("Cannot stat tokenizer cache: " + path);
+	}
+	size_t size = static_cast<size_t>(st.st_size);
+	void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);  // the mapping keeps the file referenced
+	if (map == MAP_FAILED) throw std::runtime_error("Cannot mmap tokenizer cache: " + path);
+
+	release_image();
+	mapped_image = static_cast<const uint8_t*>(map);
+	mapped_size = size;
+	try {
+		attach_image(mapped_image, mapped_size, path);
+	} catch (...) {
+		release_image();
+		throw;
+	}
+}
+
+void LlamaTokenizer::load(const std::string& path) {
+	std::cout << "Loading tokenizer from: " << path << std::endl;
+
+	char magic[sizeof(IMAGE_MAGIC)] = {};
+	std::ifstream(path, std::ios::binary).read(magic, sizeof(magic));
+	if (std::memcmp(magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) == 0) load_binary(path);
+	else load_json(path);
+
+	std::cout << "Tokenizer loaded: vocab_size=" << num_tokens
+			  << ", merges=" << num_merges
 			  << ", bos=" << bos_token_id
 			  << ", eos=" << eos_token_id
 			  << ", eot=" << eot_token_id
+			  << (is_mapped() ? " (binary cache)" : "")
 			  << std::endl;
 }
 
-std::vector<int> LlamaTokenizer::encode(const std::string& text) const {
-	if (text.empty()) return {};
+void LlamaTokenizer::load_cached(const std::string& tokenizer_json_path, const std::string& cache_path) {
+	std::string cache = cache_path.empty() ? tokenizer_json_path + ".bin" : cache_path;
+
+	uint64_t json_size = 0;
+	int64_t json_mtime = 0;
+	bool have_json = file_stat(tokenizer_json_path, json_size, json_mtime);
+	if (std::ifstream(cache).good()) {
+		try {
+			load_binary(cache);
+			ImageHeader h;
+			std::memcpy(&h, mapped_image, sizeof(h));
+			// Without the json the cache is all there is
+			if (!have_json || (h.source_size == json_size && h.source_mtime == json_mtime)) {
+				std::cout << "Tokenizer loaded from cache: " << cache << " (vocab_size=" << num_tokens
+						  << ", merges=" << num_merges << ")" << std::endl;
+				return;
+			}
+		} catch (const std::runtime_error& e) {
+			std::cerr << "Ignoring tokenizer cache: " << e.what() << std::endl;
+		}
+	}
 
-	std::vector<int> result;
+	load(tokenizer_json_path);
+	try {
+		save_binary(cache);
+	} catch (const std::runtime_error& e) {
+		std::cerr << "Warning: " << e.what() << std::endl;
+	}
+}
 
-	// Llama 3 tokenizer uses a regex-based pre-tokenization pattern
-	// The pattern splits on whitespace boundaries, numbers, special chars, etc.
-	// Simplified approach: split text into chunks, then BPE each chunk
+void LlamaTokenizer::save_binary(const std::string& path) const {
+	const uint8_t* image = mapped_image ? mapped_image : owned_image.data();
+	size_t size = mapped_image ? mapped_size : owned_image.size();
+	if (size == 0) throw std::runtime_error("save_binary: no tokenizer loaded");
+
+	// Written aside and renamed, so a reader never maps a half-written cache
+	std::string tmp = path + ".tmp";
+	{
+		std::ofstream out(tmp, std::ios::binary);
+		if (!out) throw std::runtime_error("Cannot write tokenizer cache: " + tmp);
+		out.write(reinterpret_cast<const char*>(image), static_cast<std::streamsize>(size));
+		if (!out) throw std::runtime_error("Cannot write tokenizer cache: " + tmp);
+	}
+	if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+		std::remove(tmp.c_str());
+		throw std::runtime_error("Cannot write tokenizer cache: " + path);
+	}
+}
 
-	// Pre-tokenization: split text into words/subwords
-	// Llama 3 pattern (simplified): split before/after spaces, keeping spaces attached
-	std::vector<std::string> pretokens;
-	std::string current;
+namespace {
+
+enum CharClass : uint8_t { LETTER, NUMBER, SPACE, OTHER };
+
+struct CharRange {
+	uint32_t lo;
+	uint32_t hi;
+	CharClass cls;
+};
+
+// Non-letter code points above ASCII, sorted. Anything not listed is taken as
+// \p{L}: the table covers white space (Unicode White_Space), numbers (Nd / Nl / No)
+// and the punctuation, symbol, mark and control blocks of the common scripts.
+const CharRange NON_LETTER_RANGES[] = {
+	{0x0080, 0x0084, OTHER}, {0x0085, 0x0085, SPACE}, {0x0086, 0x009F, OTHER}, {0x00A0, 0x00A0, SPACE},
+	{0x00A1, 0x00A9, OTHER}, {0x00AB, 0x00B1, OTHER}, {0x00B2, 0x00B3, NUMBER}, {0x00B4, 0x00B4, OTHER},
+	{0x00B6, 0x00B8, OTHER}, {0x00B9, 0x00B9, NUMBER}, {0x00BB, 0x00BB, OTHER}, {0x00BC, 0x00BE, NUMBER},
+	{0x00BF, 0x00BF, OTHER}, {0x00D7, 0x00D7, OTHER}, {0x00F7, 0x00F7, OTHER},
+	{0x02C2, 0x02C5, OTHER}, {0x02D2, 0x02DF, OTHER}, {0x02E5, 0x02EB, OTHER}, {0x02ED, 0x02ED, OTHER},
+	{0x02EF, 0x036F, OTHER}, {0x0375, 0x0375, OTHER}, {0x037E, 0x037E, OTHER}, {0x0384, 0x0385, OTHER},
+	{0x0387, 0x0387, OTHER}, {0x03F6, 0x03F6, OTHER}, {0x0482, 0x0489, OTHER}, {0x055A, 0x055F, OTHER},
+	{0x0589, 0x058F, OTHER}, {0x0591, 0x05CF, OTHER}, {0x05F3, 0x05FF, OTHER}, {0x0600, 0x061F, OTHER},
+	{0x064B, 0x065F, OTHER}, {0x0660, 0x0669, NUMBER}, {0x066A, 0x066D, OTHER}, {0x0670, 0x0670, OTHER},
+	{0x06D4, 0x06D4, OTHER}, {0x06D6, 0x06E4, OTHER}, {0x06E7, 0x06ED, OTHER}, {0x06F0, 0x06F9, NUMBER},
+	{0x06FD, 0x06FE, OTHER}, {0x0700, 0x070F, OTHER}, {0x07C0, 0x07C9, NUMBER},
+	{0x0900, 0x0903, OTHER}, {0x093A, 0x093C, OTHER}, {0x093E, 0x094F, OTHER}, {0x0951, 0x0957, OTHER},
+	{0x0962, 0x0965, OTHER}, {0x0966, 0x096F, NUMBER}, {0x0970, 0x0970, OTHER},
+	{0x0981, 0x0983, OTHER}, {0x09BC, 0x09BC, OTHER}, {0x09BE, 0x09CD, OTHER}, {0x09D7, 0x09D7, OTHER},
+	{0x09E2, 0x09E3, OTHER}, {0x09E6, 0x09EF, NUMBER}, {0x09F2, 0x09F3, OTHER}, {0x09F4, 0x09F9, NUMBER},
+	{0x09FA, 0x09FB, OTHER}, {0x0A66, 0x0A6F, NUMBER}, {0x0AE6, 0x0AEF, NUMBER}, {0x0B66, 0x0B6F, NUMBER},
+	{0x0BE6, 0x0BF2, NUMBER}, {0x0C66, 0x0C6F, NUMBER}, {0x0CE6, 0x0CEF, NUMBER}, {0x0D66, 0x0D78, NUMBER},
+	{0x0DE6, 0x0DEF, NUMBER}, {0x0E31, 0x0E31, OTHER}, {0x0E34, 0x0E3F, OTHER}, {0x0E47, 0x0E4F, OTHER},
+	{0x0E50, 0x0E59, NUMBER}, {0x0E5A, 0x0E5B, OTHER}, {0x0ED0, 0x0ED9, NUMBER}, {0x0F20, 0x0F33, NUMBER},
+	{0x1040, 0x1049, NUMBER}, {0x1360, 0x1368, OTHER}, {0x1369, 0x137C, NUMBER}, {0x1680, 0x1680, SPACE},
+	{0x16EE, 0x16F0, NUMBER}, {0x17E0, 0x17E9, NUMBER}, {0x1810, 0x1819, NUMBER}, {0x1AB0, 0x1AFF, OTHER},
+	{0x1DC0, 0x1DFF, OTHER},
+	{0x2000, 0x200A, SPACE}, {0x200B, 0x2027, OTHER}, {0x2028, 0x2029, SPACE}, {0x202A, 0x202E, OTHER},
+	{0x202F, 0x202F, SPACE}, {0x2030, 0x205E, OTHER}, {0x205F, 0x205F, SPACE}, {0x2060, 0x206F, OTHER},
+	{0x2070, 0x2070, NUMBER}, {0x2074, 0x2079, NUMBER}, {0x207A, 0x207E, OTHER}, {0x2080, 0x2089, NUMBER},
+	{0x208A, 0x208E, OTHER}, {0x20A0, 0x20FF, OTHER}, {0x2100, 0x2101, OTHER}, {0x2103, 0x2106, OTHER},
+	{0x2108, 0x2109, OTHER}, {0x2114, 0x2114, OTHER}, {0x2116, 0x2118, OTHER}, {0x211E, 0x2123, OTHER},
+	{0x2125, 0x2125, OTHER}, {0x2127, 0x2127, OTHER}, {0x2129, 0x2129, OTHER}, {0x212E, 0x212E, OTHER},
+	{0x213A, 0x213B, OTHER}, {0x2140, 0x2144, OTHER}, {0x214A, 0x214D, OTHER}, {0x214F, 0x214F, OTHER},
+	{0x2150, 0x2182, NUMBER}, {0x2185, 0x2189, NUMBER}, {0x218A, 0x245F, OTHER}, {0x2460, 0x249B, NUMBER},
+	{0x249C, 0x24E9, OTHER}, {0x24EA, 0x24FF, NUMBER}, {0x2500, 0x2775, OTHER}, {0x2776, 0x2793, NUMBER},
+	{0x2794, 0x2BFF, OTHER}, {0x2CE5, 0x2CEA, OTHER}, {0x2CEF, 0x2CF1, OTHER}, {0x2CF9, 0x2CFF, OTHER},
+	{0x2E00, 0x2FFF, OTHER},
+	{0x3000, 0x3000, SPACE}, {0x3001, 0x3004, OTHER}, {0x3007, 0x3007, NUMBER}, {0x3008, 0x3020, OTHER},
+	{0x3021, 0x3029, NUMBER}, {0x302A, 0x3030, OTHER}, {0x3036, 0x3037, OTHER}, {0x3038, 0x303A, NUMBER},
+	{0x303D, 0x303F, OTHER}, {0x3099, 0x309C, OTHER}, {0x30A0, 0x30A0, OTHER}, {0x30FB, 0x30FB, OTHER},
+	{0x3190, 0x3191, OTHER}, {0x3192, 0x3195, NUMBER}, {0x3196, 0x319F, OTHER}, {0x31C0, 0x31E3, OTHER},
+	{0x3200, 0x321E, OTHER}, {0x3220, 0x3229, NUMBER}, {0x322A, 0x3247, OTHER}, {0x3248, 0x324F, NUMBER},
+	{0x3250, 0x3250, OTHER}, {0x3251, 0x325F, NUMBER}, {0x3260, 0x327F, OTHER}, {0x3280, 0x3289, NUMBER},
+	{0x328A, 0x32B0, OTHER}, {0x32B1, 0x32BF, NUMBER}, {0x32C0, 0x33FF, OTHER}, {0x4DC0, 0x4DFF, OTHER},
+	{0xA490, 0xA4C6, OTHER}, {0xD800, 0xF8FF, OTHER}, {0xFB29, 0xFB29, OTHER}, {0xFD3E, 0xFD3F, OTHER},
+	{0xFE00, 0xFE6F, OTHER}, {0xFEFF, 0xFEFF, OTHER}, {0xFF01, 0xFF0F, OTHER}, {0xFF10, 0xFF19, NUMBER},
+	{0xFF1A, 0xFF20, OTHER}, {0xFF3B, 0xFF40, OTHER}, {0xFF5B, 0xFF65, OTHER}, {0xFFE0, 0xFFFF, OTHER},
+	{0x1D7CE, 0x1D7FF, NUMBER}, {0x1F000, 0x1F0FF, OTHER}, {0x1F100, 0x1F10C, NUMBER}, {0x1F10D, 0x1FAFF, OTHER},
+	{0xE0000, 0xE01EF, OTHER}, {0xF0000, 0x10FFFF, OTHER},
+};
+
+CharClass classify(uint32_t cp) {
+	if (cp < 0x80) {
+		if ((cp | 0x20) >= 'a' && (cp | 0x20) <= 'z') return LETTER;
+		if (cp >= '0' && cp <= '9') return NUMBER;
+		if (cp == ' ' || (cp >= '\t' && cp <= '\r')) return SPACE;
+		return OTHER;
+	}
+	const CharRange* end = std::end(NON_LETTER_RANGES);
+	const CharRange* it = std::upper_bound(std::begin(NON_LETTER_RANGES), end, cp,
+		[](uint32_t c, const CharRange& r) { return c < r.lo; });
+	if (it != std::begin(NON_LETTER_RANGES) && cp <= (it - 1)->hi) return (it - 1)->cls;
+	return LETTER;
+}
 
-	for (size_t i = 0; i < text.size(); ++i) {
-		char c = text[i];
+// Decode the code point at text[pos]; a malformed sequence is one U+FFFD byte
+uint32_t decode_utf8(std::string_view text, size_t pos, size_t& len) {
+	unsigned char c = static_cast<unsigned char>(text[pos]);
+	len = 1;
+	if (c < 0x80) return c;
+	size_t n = (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 0;
+	if (n == 0 || pos + n > text.size()) return 0xFFFD;
+	uint32_t cp = c & (0x7F >> n);
+	for (size_t i = 1; i < n; ++i) {
+		unsigned char cc = static_cast<unsigned char>(text[pos + i]);
+		if ((cc & 0xC0) != 0x80) return 0xFFFD;
+		cp = (cp << 6) | (cc & 0x3F);
+	}
+	len = n;
+	return cp;
+}
 
-		if (c == ' ' && !current.empty()) {
-			pretokens.push_back(current);
-			current.clear();
-		}
-		current += c;
-	}
-	if (!current.empty()) {
-		pretokens.push_back(current);
-	}
-
-	// BPE encode each pretoken
-	for (const auto& pretoken : pretokens) {
-		// Convert raw bytes to GPT-2 unicode tokens
-		std::string unicode_pretoken;
-		std::vector<std::string> byte_tokens;
-		for (unsigned char byte : pretoken) {
-			auto map_it = byte_to_token.find(byte);
-			const std::string& unicode_byte = (map_it != byte_to_token.end())
-				? map_it->second : std::string(1, static_cast<char>(byte));
-			unicode_pretoken += unicode_byte;
-			byte_tokens.push_back(unicode_byte);
-		}
+}  // namespace
+
+std::vector<std::string_view> LlamaTokenizer::pretokenize(std::string_view text) {
+	// Code points with their class and byte offset (offsets has one extra entry: the end)
+	std::vector<uint32_t> cps;
+	std::vector<CharClass> cls;
+	std::vector<size_t> offsets;
+	cps.reserve(text.size());
+	cls.reserve(text.size());
+	offsets.reserve(text.size() + 1);
+	for (size_t pos = 0, len = 0; pos < text.size(); pos += len) {
+		uint32_t cp = decode_utf8(text, pos, len);
+		cps.push_back(cp);
+		cls.push_back(classify(cp));
+		offsets.push_back(pos);
+	}
+	offsets.push_back(text.size());
 
-		// Check if the whole unicode pretoken is a known token
-		auto whole_it = vocab.find(unicode_pretoken);
-		if (whole_it != vocab.end()) {
-			result.push_back(whole_it->second);
-			continue;
+	const size_t n = cps.size();
+	auto is_newline = [&](size_t k) { return cps[k] == '\r' || cps[k] == '\n'; };
+	auto lower = [&](size_t k) { return k < n && cps[k] < 0x80 ? cps[k] | 0x20 : 0u; };
+
+	std::vector<std::string_view> pieces;
+	size_t i = 0;
+	while (i < n) {
+		size_t j = i;
+		// (?i:'s|'t|'re|'ve|'m|'ll|'d)
+		if (cps[i] == '\'') {
+			uint32_t a = lower(i + 1), b = lower(i + 2);
+			if (a == 's' || a == 't' || a == 'm' || a == 'd') j = i + 2;
+			else if ((a == 'r' && b == 'e') || (a == 'v' && b == 'e') || (a == 'l' && b == 'l')) j = i + 3;
 		}
+		if (j > i) {
+			// contraction
+		} else if (cls[i] == LETTER ||
+				   (!is_newline(i) && cls[i] != NUMBER && i + 1 < n && cls[i + 1] == LETTER)) {
+			// [^\r\n\p{L}\p{N}]?\p{L}+
+			j = cls[i] == LETTER ? i : i + 1;
+			while (j < n && cls[j] == LETTER) ++j;
+		} else if (cls[i] == NUMBER) {
+			// \p{N}{1,3}
+			while (j < n && j - i < 3 && cls[j] == NUMBER) ++j;
+		} else if (cls[i] == OTHER || (cps[i] == ' ' && i + 1 < n && cls[i + 1] == OTHER)) {
+			// ' '?[^\s\p{L}\p{N}]+[\r\n]*
+			j = cps[i] == ' ' ? i + 1 : i;
+			while (j < n && cls[j] == OTHER) ++j;
+			while (j < n && is_newline(j)) ++j;
+		} else {
+			size_t end = i;
+			size_t last_newline = n;
+			for (; end < n && cls[end] == SPACE; ++end) {
+				if (is_newline(end)) last_newline = end;
+			}
+			if (last_newline < n) j = last_newline + 1;  // \s*[\r\n]+
+			else if (end == n || end - i == 1) j = end;  // \s+(?!\S) at the end, or \s+
+			else j = end - 1;                            // \s+(?!\S): leave one for the next word
+		}
+		pieces.push_back(text.substr(offsets[i], offsets[j] - offsets[i]));
+		i = j;
+	}
+	return pieces;
+}
 
-		// Apply BPE merges
-		auto merged = bpe(byte_tokens);
+// Drop least recently used entries of one cache shard down to capacity
+template <typename List, typename Index>
+static void evict_to(List& lru, Index& index, size_t capacity) {
+	while (lru.size() > capacity) {
+		index.erase(lru.back().first);
+		lru.pop_back();
+	}
+}
 
-		// Convert merged tokens to IDs
-		for (const auto& token : merged) {
-			auto it = vocab.find(token);
-			if (it != vocab.end()) {
-				result.push_back(it->second);
-			}
+void LlamaTokenizer::encode_pretoken(std::string_view pretoken, std::vector<int>& out) const {
+	if (!byte_ids) return;  // nothing loaded
+
+	CacheShard* shard = nullptr;
+	if (cache_capacity > 0) {
+		shard = &cache[std::hash<std::string_view>()(pretoken) % CACHE_SHARDS];
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		auto it = shard->index.find(pretoken);
+		if (it != shard->index.end()) {
+			shard->lru.splice(shard->lru.begin(), shard->lru, it->second);
+			out.insert(out.end(), it->second->second.begin(), it->second->second.end());
+			++shard->hits;
+			return;
 		}
+		++shard->misses;
 	}
 
+	std::vector<int> ids;
+	// A pre-token that is itself in the vocab is emitted whole (Llama 3 ignore_merges)
+	std::string unicode_pretoken;
+	for (unsigned char byte : pretoken) unicode_pretoken += byte_to_token.at(byte);
+	int whole_id = find_token(unicode_pretoken);
+	if (whole_id >= 0) {
+		ids.push_back(whole_id);
+	} else {
+		bpe(pretoken, ids);
+	}
+	out.insert(out.end(), ids.begin(), ids.end());
+
+	if (shard) {
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		if (shard->index.count(pretoken)) return;  // another thread got here first
+		shard->lru.emplace_front(std::string(pretoken), std::move(ids));
+		shard->index.emplace(shard->lru.front().first, shard->lru.begin());
+		evict_to(shard->lru, shard->index, (cache_capacity + CACHE_SHARDS - 1) / CACHE_SHARDS);
+	}
+}
+
+std::vector<int> LlamaTokenizer::encode(const std::string& text) const {
+	std::vector<int> result;
+	for (std::string_view pretoken : pretokenize(text)) encode_pretoken(pretoken, result);
 	return result;
 }
 
+std::vector<std::vector<int>> LlamaTokenizer::encode_batch(const std::vector<std::string>& texts,
+														   int num_threads) const {
+	std::vector<std::vector<int>> result(texts.size());
+	int threads = num_threads > 0 ? num_threads : omp_get_max_threads();
+	// Texts vary in length: hand them out one at a time
+	#pragma omp parallel for schedule(dynamic, 1) num_threads(threads) if (texts.size() > 1)
+	for (size_t i = 0; i < texts.size(); ++i) {
+		result[i] = encode(texts[i]);
+	}
+	return result;
+}
+
+void LlamaTokenizer::set_cache_capacity(size_t capacity) {
+	cache_capacity = capacity;
+	for (CacheShard& shard : cache) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		evict_to(shard.lru, shard.index, (capacity + CACHE_SHARDS - 1) / CACHE_SHARDS);
+	}
+}
+
+size_t LlamaTokenizer::get_cache_hits() const {
+	size_t hits = 0;
+	for (CacheShard& shard : cache) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		hits += shard.hits;
+	}
+	return hits;
+}
+
+size_t LlamaTokenizer::get_cache_misses() const {
+	size_t misses = 0;
+	for (CacheShard& shard : cache) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		misses += shard.misses;
+	}
+	return misses;
+}
+
+void LlamaTokenizer::clear_cache() {
+	for (CacheShard& shard : cache) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.index.clear();
+		shard.lru.clear();
+		shard.hits = 0;
+		shard.misses = 0;
+	}
+}
+
 std::string LlamaTokenizer::decode(const std::vector<int>& ids) const {
 	std::string result;
 	for (int id : ids) {
@@ -247,10 +763,7 @@ std::string LlamaTokenizer::decode(const std::vector<int>& ids) const {
 }
 
 std::string LlamaTokenizer::decode_token(int id) const {
-	if (id < 0 || id >= static_cast<int>(id_to_token.size())) {
-		return "";
-	}
-	const std::string& token = id_to_token[id];
+	std::string_view token = token_string(id);
 
 	// Skip special tokens in output
 	if (!token.empty() && token[0] == '<' && token.back() == '>') {
@@ -270,7 +783,7 @@ std::string LlamaTokenizer::decode_token(int id) const {
 
 		if (i + char_len > token.size()) break;
 
-		std::string utf8_char = token.substr(i, char_len);
+		std::string utf8_char(token.substr(i, char_len));
 		auto map_it = token_to_byte.find(utf8_char);
 		if (map_it != token_to_byte.end()) {
 			result += static_cast<char>(map_it->second);
@@ -289,9 +802,9 @@ std::vector<int> LlamaTokenizer::apply_chat_template(const std::string& user_mes
 
 	// Helper to add a special token by name
 	auto add_special = [&](const std::string& name) {
-		auto it = vocab.find(name);
-		if (it != vocab.end()) {
-			tokens.push_back(it->second);
+		int id = find_token(name);
+		if (id >= 0) {
+			tokens.push_back(id);
 		}
 	};
 
@@ -334,3 +847,36 @@ std::vector<int> LlamaTokenizer::apply_chat_template(const std::string& user_mes
 
 	return tokens;
 }
+
+// Length of the UTF-8 sequence a lead byte starts; 0 for a continuation or invalid byte
+static size_t utf8_sequence_length(unsigned char c) {
+	if (c < 0x80) return 1;
+	if ((c & 0xE0) == 0xC0) return 2;
+	if ((c & 0xF0) == 0xE0) return 3;
+	if ((c & 0xF8) == 0xF0) return 4;
+	return 0;
+}
+
+std::string IncrementalDetokenizer::push(int id) {
+	pending += tokenizer.decode_token(id);
+
+	// Hold back from the last lead byte if its sequence is still missing bytes. Stray
+	// continuation and invalid bytes go out as they are rather than stalling the stream.
+	size_t keep_from = pending.size();
+	for (size_t back = 1; back <= std::min<size_t>(3, pending.size()); ++back) {
+		size_t i = pending.size() - back;
+		size_t len = utf8_sequence_length(static_cast<unsigned char>(pending[i]));
+		if (len == 0) continue;
+		if (len > back) keep_from = i;
+		break;
+	}
+	std::string ready = pending.substr(0, keep_from);
+	pending.erase(0, keep_from);
+	return ready;
+}
+
+std::string IncrementalDetokenizer::flush() {
+	std::string rest = pending.empty() ? "" : "\xEF\xBF\xBD";
+	pending.clear();
+	return rest;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+// Helpers shared by the Llama benchmarks.
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <malloc.h>
+
+// VmRSS / VmHWM of this process in MB; freed heap is trimmed first
+inline double status_mb(const std::string& field) {
+    malloc_trim(0);
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind(field + ":", 0) == 0)
+            return std::stod(line.substr(field.size() + 1)) / 1024.0;
+    }
+    return 0.0;
+}
+
+// Reset VmHWM so the peak of each run is measured on its own
+inline void reset_peak_rss() {
+    std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+// Median wall time of fn over reps runs, in ms
+inline double median_ms(size_t reps, const std::function<void()>& fn) {
+    using namespace std::chrono;
+    std::vector<double> times;
+    for (size_t r = 0; r < reps; ++r) {
+        auto t0 = high_resolution_clock::now();
+        fn();
+        times.push_back(duration<double, std::milli>(high_resolution_clock::now() - t0).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Deterministic prompt of len token ids below vocab; seed shifts the sequence
+inline std::vector<int> make_prompt(size_t len, size_t vocab, size_t seed = 0) {
+    std::vector<int> ids(len);
+    for (size_t i = 0; i < len; ++i) ids[i] = static_cast<int>((seed + i * 37 + 11) % vocab);
+    return ids;
+}
@@ -0,0 +1,100 @@
+#include "deepczero.hpp"
+#include <iostream>
+#include <chrono>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+using namespace tensor;
+using namespace std::chrono;
+
+// Prompts of uneven length (base_len .. 2 * base_len - 1) so batches carry padding
+static std::vector<std::vector<int>> make_prompts(size_t count, size_t base_len, size_t vocab) {
+    std::vector<std::vector<int>> prompts;
+    for (size_t p = 0; p < count; ++p) {
+        size_t len = base_len + (p * 7919) % base_len;
+        std::vector<int> ids(len);
+        for (size_t i = 0; i < len; ++i) ids[i] = static_cast<int>((p * 131 + i * 37 + 11) % vocab);
+        prompts.push_back(ids);
+    }
+    return prompts;
+}
+
+void benchmark_batch_prefill(size_t base_len) {
+    std::cout << "\n=== Batched prefill: prompts of " << base_len << "-" << 2 * base_len - 1
+              << " tokens (512 hidden, 4 layers, bf16 weights) ===" << std::endl;
+
+    dcz::UsingConfig eval_mode("train", false);
+    dcz::UsingConfig no_grad("enable_backprop", false);
+
+    const size_t vocab = 8000;
+    LlamaForCausalLM model(vocab, 512, 4, 8, 2, 1408, 2048, 500000.0f, 1e-5f);
+    model.pack_weights(PackedFormat::BF16);
+
+    const size_t num_prompts = 32;
+    auto prompts = make_prompts(num_prompts, base_len, vocab);
+    size_t total_tokens = 0;
+    for (const auto& p : prompts) total_tokens += p.size();
+
+    // Baseline: one prompt at a time
+    auto t0 = high_resolution_clock::now();
+    for (const auto& p : prompts) {
+        model.reset_cache();
+        model.prefill(p, 0, 0);
+    }
+    double serial_ms = duration<double, std::milli>(high_resolution_clock::now() - t0).count();
+
+    std::cout << std::setw(8) << "Batch"
+              << std::setw(10) << "Side"
+              << std::setw(12) << "KV padding"
+              << std::setw(14) << "Time (ms)"
+              << std::setw(14) << "Tokens/s"
+              << std::setw(12) << "Speedup" << std::endl;
+    std::cout << std::string(70, '-') << std::endl;
+    std::cout << std::setw(8) << "serial" << std::setw(10) << "-" << std::setw(12) << "-"
+              << std::setw(14) << std::fixed << std::setprecision(1) << serial_ms
+              << std::setw(14) << std::setprecision(0) << total_tokens * 1000.0 / serial_ms
+              << std::setw(11) << std::setprecision(2) << 1.0 << "x" << std::endl;
+
+    for (size_t batch : {1, 2, 4, 8, 16, 32}) {
+        for (layer::PaddingSide side : {layer::PaddingSide::Right, layer::PaddingSide::Left}) {
+            size_t padded = 0;
+            auto t1 = high_resolution_clock::now();
+            for (size_t first = 0; first < num_prompts; first += batch) {
+                std::vector<std::vector<int>> group(prompts.begin() + first,
+                                                    prompts.begin() + std::min(first + batch, num_prompts));
+                size_t longest = 0;
+                for (const auto& p : group) longest = std::max(longest, p.size());
+                padded += longest * group.size();
+                model.prefill_batch(group, side);
+            }
+            double ms = duration<double, std::milli>(high_resolution_clock::now() - t1).count();
+            model.reset_cache();
+
+            std::cout << std::setw(8) << batch
+                      << std::setw(10) << (side == layer::PaddingSide::Left ? "left" : "right")
+                      << std::setw(11) << std::setprecision(1)
+                      << 100.0 * (padded - total_tokens) / padded << "%"
+                      << std::setw(14) << std::setprecision(1) << ms
+                      << std::setw(14) << std::setprecision(0) << total_tokens * 1000.0 / ms
+                      << std::setw(11) << std::setprecision(2) << serial_ms / ms << "x" << std::endl;
+        }
+    }
+    std::cout << std::defaultfloat;
+}
+
+int main() {
+    std::cout << "==================================================" << std::endl;
+    std::cout << "      DeepCZero Llama Batched Prefill Benchmark   " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    benchmark_batch_prefill(8);
+    benchmark_batch_prefill(32);
+
+    std::cout << "\n==================================================" << std::endl;
+    std::cout << "                Benchmark Complete                " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    return 0;
+}
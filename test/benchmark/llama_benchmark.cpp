@@ -0,0 +1,293 @@
+#include "deepczero.hpp"
+#include "utils/rope.hpp"
+#include "utils/sampler.hpp"
+#include "json.hpp"
+#include "bench_util.hpp"
+#include <iostream>
+#include <chrono>
+#include <iomanip>
+#include <vector>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <omp.h>
+
+using namespace tensor;
+using namespace std::chrono;
+using json = nlohmann::json;
+
+// Usage: llama_benchmark [tiny|small|1b [results.json]]
+//   End-to-end Llama inference on random weights (no download): prefill and decode
+//   throughput, a per-component breakdown of one decode step, memory and thread
+//   scaling. Results are also written as JSON (to results.json, or stdout without it);
+//   set GIT_COMMIT to tag them with the commit under test.
+
+struct LlamaShape {
+    std::string name;
+    size_t vocab, hidden, layers, heads, kv_heads, intermediate, max_positions;
+};
+
+static const LlamaShape SHAPES[] = {
+    {"tiny", 2000, 256, 2, 4, 2, 704, 1024},
+    {"small", 8000, 512, 4, 8, 2, 1408, 2048},
+    {"1b", 128256, 2048, 16, 32, 8, 8192, 2048},  // Llama 3.2 1B
+};
+
+static double prefill_ms(LlamaForCausalLM& model, const std::vector<int>& prompt, size_t reps) {
+    return median_ms(reps, [&] {
+        model.reset_cache();
+        model.prefill(prompt, 0, 0);
+    });
+}
+
+// Mean ms per decode step (forward + lm_head of one token) after a context_len prompt
+static double decode_ms(LlamaForCausalLM& model, const LlamaShape& shape, size_t context_len, size_t steps) {
+    model.reset_cache();
+    model.prefill(make_prompt(context_len, shape.vocab), 0, 256);
+    auto t0 = high_resolution_clock::now();
+    for (size_t i = 0; i < steps; ++i)
+        model.forward_ids({static_cast<int>((i * 13 + 5) % shape.vocab)}, context_len + i, {0});
+    return duration<double, std::milli>(high_resolution_clock::now() - t0).count() / steps;
+}
+
+static json benchmark_prefill(LlamaForCausalLM& model, const LlamaShape& shape) {
+    std::cout << "\n=== Prefill throughput ===" << std::endl;
+    std::cout << std::setw(12) << "Prompt" << std::setw(14) << "Time (ms)" << std::setw(14) << "Tokens/s" << std::endl;
+    std::cout << std::string(40, '-') << std::endl;
+
+    json rows = json::array();
+    for (size_t len : {32, 128, 512, 1024}) {
+        if (len > shape.max_positions) break;
+        double ms = prefill_ms(model, make_prompt(len, shape.vocab), 3);
+        double tps = len * 1000.0 / ms;
+        std::cout << std::setw(12) << len << std::setw(14) << std::fixed << std::setprecision(1) << ms
+                  << std::setw(14) << tps << std::endl;
+        rows.push_back({{"prompt_len", len}, {"ms", ms}, {"tokens_per_sec", tps}});
+    }
+    std::cout << std::defaultfloat;
+    return rows;
+}
+
+static json benchmark_decode(LlamaForCausalLM& model, const LlamaShape& shape) {
+    std::cout << "\n=== Decode throughput vs context length ===" << std::endl;
+    std::cout << std::setw(12) << "Context" << std::setw(14) << "ms/token" << std::setw(14) << "Tokens/s" << std::endl;
+    std::cout << std::string(40, '-') << std::endl;
+
+    const size_t steps = 32;
+    json rows = json::array();
+    for (size_t context : {16, 128, 512, 1024}) {
+        if (context + steps > shape.max_positions) break;
+        double ms = decode_ms(model, shape, context, steps);
+        std::cout << std::setw(12) << context << std::setw(14) << std::fixed << std::setprecision(2) << ms
+                  << std::setw(14) << std::setprecision(1) << 1000.0 / ms << std::endl;
+        rows.push_back({{"context_len", context}, {"ms_per_token", ms}, {"tokens_per_sec", 1000.0 / ms}});
+    }
+    std::cout << std::defaultfloat;
+    return rows;
+}
+
+// Times the pieces of one decode step separately: every layer's attention (fused qkv
+// GEMM, RoPE, cached attention, o_proj) and MLP, the fused add + RMSNorm pairs, the
+// lm_head and sampling. "other" is what a full step spends beyond them (embedding,
+// glue); each piece carries its own timer and call overhead, so it is clamped at 0.
+static json benchmark_components(LlamaForCausalLM& model, const LlamaShape& shape) {
+    size_t context = std::min<size_t>(512, shape.max_positions - 1);
+    std::cout << "\n=== Decode step breakdown at context " << context << " ===" << std::endl;
+
+    auto llama = model.get_model();
+    size_t head_dim = shape.hidden / shape.heads;
+    auto [cos_table, sin_table] = precompute_rope_frequencies(head_dim, shape.max_positions, 500000.0f);
+
+    std::vector<float> x_data(shape.hidden);
+    for (size_t i = 0; i < shape.hidden; ++i) x_data[i] = 0.1f * std::sin(0.37f * i);
+    Variable x(Tensor<>({1, 1, shape.hidden}, x_data));
+    std::vector<float> residual(x_data), delta(x_data), normed(shape.hidden);
+
+    model.reset_cache();
+    model.prefill(make_prompt(context, shape.vocab), 0, 256);
+
+    // Components run in step order (layer by layer) so weights come from memory as in
+    // a real step, not from caches warmed by repeating one component
+    const size_t reps = 15;
+    std::vector<double> attention_t, mlp_t, norm_t, lm_head_t, greedy_t, sampling_t;
+    std::vector<float> logits;
+    GenerationConfig greedy_config;
+    GenerationConfig sample_config;
+    sample_config.do_sample = true;
+    sample_config.temperature = 0.8f;
+    sample_config.top_p = 0.9f;
+    Sampler greedy(greedy_config), sampler(sample_config);
+    auto timed = [](double& total, const std::function<void()>& fn) {
+        auto t0 = high_resolution_clock::now();
+        fn();
+        total += duration<double, std::milli>(high_resolution_clock::now() - t0).count();
+    };
+    for (size_t r = 0; r < reps; ++r) {
+        double attention = 0.0, mlp = 0.0, norm = 0.0, lm_head = 0.0, greedy_ms = 0.0, sampling = 0.0;
+        for (size_t l = 0; l < llama->get_num_layers(); ++l) {
+            auto layer = llama->get_layer(l);
+            auto attn = layer->get_self_attn();
+            // Two residual add + norm pairs per layer
+            timed(norm, [&] {
+                layer->get_input_layernorm()->add_forward_rows(residual.data(), delta.data(), normed.data(), 1);
+            });
+            timed(attention, [&] { attn->forward_attn(x, cos_table, sin_table, context); });
+            attn->truncate_cache(context);
+            timed(norm, [&] {
+                layer->get_post_attention_layernorm()->add_forward_rows(residual.data(), delta.data(), normed.data(), 1);
+            });
+            timed(mlp, [&] { layer->get_mlp()->forward({x}); });
+        }
+        timed(lm_head, [&] { logits = model.lm_head(x).data().raw_data(); });
+        timed(greedy_ms, [&] { greedy.sample(logits.data(), logits.size()); });
+        timed(sampling, [&] { sampler.sample(logits.data(), logits.size()); });
+        attention_t.push_back(attention);
+        mlp_t.push_back(mlp);
+        norm_t.push_back(norm);
+        lm_head_t.push_back(lm_head);
+        greedy_t.push_back(greedy_ms);
+        sampling_t.push_back(sampling);
+    }
+    auto median = [](std::vector<double> v) {
+        std::sort(v.begin(), v.end());
+        return v[v.size() / 2];
+    };
+    double attention = median(attention_t), mlp = median(mlp_t), norm = median(norm_t);
+    double lm_head = median(lm_head_t), greedy_ms = median(greedy_t), sampling = median(sampling_t);
+
+    double step = median_ms(reps, [&] {
+        model.forward_ids({7}, context, {0});
+        model.truncate_cache(context);
+    }) + sampling;
+    double other = std::max(0.0, step - attention - mlp - norm - lm_head - sampling);
+
+    std::cout << std::setw(22) << "Component" << std::setw(12) << "ms/token" << std::setw(10) << "Share" << std::endl;
+    std::cout << std::string(44, '-') << std::endl;
+    std::vector<std::pair<std::string, double>> parts = {
+        {"attention", attention}, {"mlp", mlp}, {"norm", norm}, {"lm_head", lm_head},
+        {"sampling (top-p)", sampling}, {"other", other}};
+    for (const auto& [name, ms] : parts) {
+        std::cout << std::setw(22) << name << std::setw(12) << std::fixed << std::setprecision(3) << ms
+                  << std::setw(9) << std::setprecision(1) << 100.0 * ms / step << "%" << std::endl;
+    }
+    std::cout << std::setw(22) << "step" << std::setw(12) << std::setprecision(3) << step << std::endl;
+    std::cout << std::setw(22) << "(greedy argmax)" << std::setw(12) << greedy_ms << std::endl;
+    std::cout << std::defaultfloat;
+
+    return {{"context_len", context}, {"attention_ms", attention}, {"mlp_ms", mlp}, {"norm_ms", norm},
+            {"lm_head_ms", lm_head}, {"sampling_ms", sampling}, {"greedy_sampling_ms", greedy_ms},
+            {"other_ms", other}, {"step_ms", step}};
+}
+
+static json benchmark_threads(LlamaForCausalLM& model, const LlamaShape& shape) {
+    std::cout << "\n=== Thread scaling (prefill 128 tokens, decode at context 128) ===" << std::endl;
+    std::cout << std::setw(10) << "Threads" << std::setw(18) << "Prefill tok/s" << std::setw(12) << "Speedup"
+              << std::setw(18) << "Decode tok/s" << std::setw(12) << "Speedup" << std::endl;
+    std::cout << std::string(70, '-') << std::endl;
+
+    int max_threads = omp_get_max_threads();
+    std::vector<int> counts;
+    for (int t = 1; t < max_threads; t *= 2) counts.push_back(t);
+    counts.push_back(max_threads);
+
+    std::vector<int> prompt = make_prompt(128, shape.vocab);
+    json rows = json::array();
+    double prefill_base = 0.0, decode_base = 0.0;
+    for (int threads : counts) {
+        omp_set_num_threads(threads);
+        double prefill_tps = 128 * 1000.0 / prefill_ms(model, prompt, 3);
+        double decode_tps = 1000.0 / decode_ms(model, shape, 128, 16);
+        if (threads == 1) {
+            prefill_base = prefill_tps;
+            decode_base = decode_tps;
+        }
+        std::cout << std::setw(10) << threads
+                  << std::setw(18) << std::fixed << std::setprecision(1) << prefill_tps
+                  << std::setw(11) << std::setprecision(2) << prefill_tps / prefill_base << "x"
+                  << std::setw(18) << std::setprecision(1) << decode_tps
+                  << std::setw(11) << std::setprecision(2) << decode_tps / decode_base << "x" << std::endl;
+        rows.push_back({{"threads", threads}, {"prefill_tokens_per_sec", prefill_tps},
+                        {"decode_tokens_per_sec", decode_tps}});
+    }
+    omp_set_num_threads(max_threads);
+    std::cout << std::defaultfloat;
+    return rows;
+}
+
+int main(int argc, char** argv) {
+    std::cout << "==================================================" << std::endl;
+    std::cout << "          DeepCZero Llama Benchmark Suite         " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    std::string shape_name = argc > 1 ? argv[1] : "small";
+    const LlamaShape* shape = nullptr;
+    for (const LlamaShape& s : SHAPES)
+        if (s.name == shape_name) shape = &s;
+    if (!shape) {
+        std::cerr << "Unknown config " << shape_name << " (tiny, small, 1b)" << std::endl;
+        return 1;
+    }
+
+    dcz::UsingConfig eval_mode("train", false);
+    dcz::UsingConfig no_grad("enable_backprop", false);
+
+    const PackedFormat weight_format = PackedFormat::BF16;
+    double rss_start = status_mb("VmRSS");
+    LlamaForCausalLM model(shape->vocab, shape->hidden, shape->layers, shape->heads, shape->kv_heads,
+                           shape->intermediate, shape->max_positions, 500000.0f, 1e-5f);
+    model.pack_weights(weight_format);
+    double weights_mb = status_mb("VmRSS") - rss_start;
+    // Reset VmHWM so the peak below covers the runs, not the f32 weights before packing
+    bool peak_reset = static_cast<bool>(std::ofstream("/proc/self/clear_refs") << "5");
+
+    std::cout << "\nConfig " << shape->name << ": vocab " << shape->vocab << ", hidden " << shape->hidden
+              << ", " << shape->layers << " layers, " << shape->heads << "/" << shape->kv_heads << " heads, "
+              << packed_format_name(weight_format) << " weights, " << omp_get_max_threads() << " threads" << std::endl;
+
+    json results;
+    results["benchmark"] = "llama";
+    results["commit"] = std::getenv("GIT_COMMIT") ? std::getenv("GIT_COMMIT") : "";
+    results["timestamp"] = static_cast<long long>(std::time(nullptr));
+    results["config"] = {{"name", shape->name}, {"vocab_size", shape->vocab}, {"hidden_size", shape->hidden},
+                         {"num_layers", shape->layers}, {"num_heads", shape->heads},
+                         {"num_kv_heads", shape->kv_heads}, {"intermediate_size", shape->intermediate},
+                         {"max_position_embeddings", shape->max_positions},
+                         {"weight_format", packed_format_name(weight_format)},
+                         {"kv_cache_format", kv_cache_format_name(model.get_kv_cache_format())},
+                         {"threads", omp_get_max_threads()}};
+
+    results["prefill"] = benchmark_prefill(model, *shape);
+    results["decode"] = benchmark_decode(model, *shape);
+    results["components"] = benchmark_components(model, *shape);
+    results["thread_scaling"] = benchmark_threads(model, *shape);
+    model.reset_cache();
+
+    double peak_mb = status_mb("VmHWM");
+    double kv_mb = model.kv_cache_bytes_per_token() * shape->max_positions / (1024.0 * 1024.0);
+    results["memory"] = {{"weights_mb", weights_mb}, {"kv_cache_mb_at_max_positions", kv_mb},
+                         {"peak_rss_mb", peak_mb}, {"peak_rss_includes_load", !peak_reset}};
+    std::cout << "\n=== Memory ===" << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+              << "Weights (RSS growth): " << weights_mb << " MB" << std::endl
+              << "KV cache at " << shape->max_positions << " positions: " << kv_mb << " MB" << std::endl
+              << "Peak RSS: " << peak_mb << " MB"
+              << (peak_reset ? " (after packing)" : " (including the f32 load)") << std::endl;
+    std::cout << std::defaultfloat;
+
+    if (argc > 2) {
+        std::ofstream(argv[2]) << results.dump(2) << std::endl;
+        std::cout << "\nResults written to " << argv[2] << std::endl;
+    } else {
+        std::cout << "\n" << results.dump(2) << std::endl;
+    }
+
+    std::cout << "\n==================================================" << std::endl;
+    std::cout << "                Benchmark Complete                " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "deepczero.hpp"
+#include <iostream>
+#include <chrono>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+
+using namespace tensor;
+using namespace std::chrono;
+
+// Timing utility
+template<typename Func>
+double measure_time_ms(Func&& func, int warmup = 1, int iterations = 5) {
+    for (int i = 0; i < warmup; ++i) {
+        func();
+    }
+
+    auto start = high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        func();
+    }
+    auto end = high_resolution_clock::now();
+
+    double total_ms = duration_cast<microseconds>(end - start).count() / 1000.0;
+    return total_ms / iterations;
+}
+
+// lm_head for one decode step:
+//   old: hidden @ W^T with W^T kept as a second [hidden, vocab] copy
+//   new: dot_nt(hidden, W) on the tied [vocab, hidden] embedding
+void benchmark_lm_head() {
+    std::cout << "\n=== lm_head: transposed copy vs tied transposed-B GEMV ===" << std::endl;
+
+#ifdef USE_MKL
+    std::cout << "MKL is ENABLED" << std::endl;
+#else
+    std::cout << "MKL is DISABLED (using naive implementation)" << std::endl;
+#endif
+
+    std::cout << std::setw(10) << "Vocab"
+              << std::setw(10) << "Hidden"
+              << std::setw(10) << "Rows"
+              << std::setw(15) << "Copy (ms)"
+              << std::setw(15) << "Tied (ms)"
+              << std::setw(12) << "Speedup"
+              << std::setw(16) << "Saved (MB)"
+              << std::setw(12) << "MaxDiff" << std::endl;
+    std::cout << std::string(100, '-') << std::endl;
+
+    std::vector<std::tuple<size_t, size_t, size_t>> sizes = {
+        {32000, 1024, 1},
+        {32000, 2048, 1},
+        {128256, 2048, 1},
+        {128256, 2048, 4},
+    };
+
+    for (const auto& [vocab, hidden, rows] : sizes) {
+        Tensor<float> W({vocab, hidden});
+        Tensor<float> h({1, rows, hidden});
+        auto& W_data = W.raw_data();
+        auto& h_data = h.raw_data();
+        for (size_t i = 0; i < W_data.size(); ++i) W_data[i] = static_cast<float>(rand()) / RAND_MAX - 0.5f;
+        for (size_t i = 0; i < h_data.size(); ++i) h_data[i] = static_cast<float>(rand()) / RAND_MAX - 0.5f;
+
+        // Both paths: same warmup and iteration count
+        const int warmup = 1, iterations = 3;
+        Tensor<float> tied;
+        double time_tied = measure_time_ms([&]() {
+            tied = dot_nt(h, W);
+        }, warmup, iterations);
+
+        Tensor<float> copied;
+        double time_copy;
+        {
+            Tensor<float> W_T = W.transpose({1, 0}).contiguous();
+            time_copy = measure_time_ms([&]() {
+                copied = dot(h, W_T);
+            }, warmup, iterations);
+        }
+
+        float max_diff = 0.0f;
+        const auto& a = tied.raw_data();
+        const auto& b = copied.raw_data();
+        for (size_t i = 0; i < a.size(); ++i)
+            max_diff = std::max(max_diff, std::abs(a[i] - b[i]));
+
+        double saved_mb = static_cast<double>(vocab * hidden * sizeof(float)) / (1024.0 * 1024.0);
+
+        std::cout << std::setw(10) << vocab
+                  << std::setw(10) << hidden
+                  << std::setw(10) << rows
+                  << std::setw(15) << std::fixed << std::setprecision(2) << time_copy
+                  << std::setw(15) << std::fixed << std::setprecision(2) << time_tied
+                  << std::setw(11) << std::fixed << std::setprecision(2) << time_copy / time_tied << "x"
+                  << std::setw(16) << std::fixed << std::setprecision(1) << saved_mb
+                  << std::setw(12) << std::scientific << std::setprecision(1) << max_diff
+                  << std::defaultfloat << std::endl;
+
+        if (time_copy > 5000.0) {
+            std::cout << "(Skipping larger sizes due to time)" << std::endl;
+            break;
+        }
+    }
+}
+
+// End-to-end decode step of a small LlamaForCausalLM (lm_head dominates at large vocab)
+void benchmark_decode() {
+    std::cout << "\n=== LlamaForCausalLM decode step (tied lm_head) ===" << std::endl;
+
+    dcz::UsingConfig eval_mode("train", false);
+    dcz::UsingConfig no_grad("enable_backprop", false);
+
+    size_t vocab = 32000, hidden = 256;
+    LlamaForCausalLM model(vocab, hidden, 2, 8, 4, 512, 128, 500000.0f, 1e-5f);
+
+    std::vector<int> prompt = {1, 2, 3, 4, 5, 6, 7, 8};
+    model.forward_ids(prompt, 0, {prompt.size() - 1});
+
+    size_t pos = prompt.size();
+    double time_ms = measure_time_ms([&]() {
+        model.forward_ids({42}, pos++);
+    }, 1, 10);
+
+    std::cout << "vocab=" << vocab << " hidden=" << hidden
+              << "  decode step: " << std::fixed << std::setprecision(2) << time_ms << " ms"
+              << " (" << 1000.0 / time_ms << " tok/s)" << std::endl;
+}
+
+int main() {
+    std::cout << "==================================================" << std::endl;
+    std::cout << "         DeepCZero Llama lm_head Benchmark        " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    benchmark_lm_head();
+    benchmark_decode();
+
+    std::cout << "\n==================================================" << std::endl;
+    std::cout << "                Benchmark Complete                " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,179 @@
+#include "deepczero.hpp"
+#include "cnpy.h"
+#include "json.hpp"
+#include "bench_util.hpp"
+#include <iostream>
+#include <chrono>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <optional>
+
+using namespace tensor;
+using namespace std::chrono;
+
+static std::unique_ptr<LlamaForCausalLM> make_model() {
+    // Small Llama-shaped model (~50M params, ~200 MB fp32) so the benchmark fits in CI memory
+    return std::make_unique<LlamaForCausalLM>(32000, 768, 4, 12, 4, 2048, 128, 500000.0f, 1e-5f);
+}
+
+// Same key layout as scripts/convert_llama_weights.py ("model.layers.0.mlp.up_proj.W")
+static void save_npz(LlamaForCausalLM& model, const std::string& path) {
+    std::string mode = "w";
+    for (auto& [name, param] : model.flatten_params()) {
+        const Tensor<>& data = param.data();
+        if (data.empty()) continue;
+        std::string key = name;
+        std::replace(key.begin(), key.end(), '/', '.');
+        cnpy::npz_save(path, key, data.raw_data().data(), data.get_shape(), mode);
+        mode = "a";
+    }
+}
+
+// HuggingFace layout: "<name>.weight", projections/embedding as bf16 [out, in] rows
+static void save_safetensors(LlamaForCausalLM& model, const std::string& path) {
+    nlohmann::json header;
+    std::vector<std::vector<uint8_t>> blobs;
+    size_t offset = 0;
+    for (auto& [name, param] : model.flatten_params()) {
+        Tensor<> data = param.data().contiguous();
+        if (data.empty()) continue;
+        std::string key = name;
+        std::replace(key.begin(), key.end(), '/', '.');
+        std::vector<uint8_t> bytes;
+        bool matrix = key.size() > 2 && key.compare(key.size() - 2, 2, ".W") == 0;
+        if (matrix && key.find("_proj.") != std::string::npos) {
+            data = data.transpose({1, 0}).contiguous();
+        }
+        const std::vector<float>& v = data.raw_data();
+        if (matrix) {
+            bytes.resize(v.size() * sizeof(bf16));
+            fp32_to_bf16_row(v.data(), reinterpret_cast<bf16*>(bytes.data()), v.size());
+            key = key.substr(0, key.size() - 2) + ".weight";
+        } else {
+            // Norm scales stay fp32
+            bytes.resize(v.size() * sizeof(float));
+            std::memcpy(bytes.data(), v.data(), bytes.size());
+        }
+        header[key] = {{"dtype", matrix ? "BF16" : "F32"}, {"shape", data.get_shape()},
+                       {"data_offsets", {offset, offset + bytes.size()}}};
+        offset += bytes.size();
+        blobs.push_back(std::move(bytes));
+    }
+    std::string text = header.dump();
+    uint64_t len = text.size();
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&len), sizeof(len));
+    out.write(text.data(), text.size());
+    for (const auto& blob : blobs) out.write(reinterpret_cast<const char*>(blob.data()), blob.size());
+}
+
+static size_t file_bytes(const std::string& path) {
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    return static_cast<size_t>(f.tellg());
+}
+
+void benchmark_load() {
+    std::cout << "\n=== Llama weight loading: npz vs memory-mapped tensor file / safetensors ===" << std::endl;
+
+    dcz::UsingConfig eval_mode("train", false);
+    dcz::UsingConfig no_grad("enable_backprop", false);
+
+    const std::string npz_path = "/tmp/dcz_load_benchmark.npz";
+    const std::string f32_path = "/tmp/dcz_load_benchmark_f32.dczt";
+    const std::string bf16_path = "/tmp/dcz_load_benchmark_bf16.dczt";
+    const std::string st_path = "/tmp/dcz_load_benchmark.safetensors";
+    std::vector<int> prompt = {1, 2, 3, 4, 5, 6, 7, 8};
+
+    {
+        auto src = make_model();
+        src->forward_ids({1}, 0);  // materialize the lazily initialized projections
+        save_npz(*src, npz_path);
+        save_safetensors(*src, st_path);
+        src->pack_weights(PackedFormat::F32);
+        src->get_model()->get_embed_tokens()->pack_weight(PackedFormat::F32);
+        src->save_weights_file(f32_path);
+        src->pack_weights(PackedFormat::BF16);
+        src->get_model()->get_embed_tokens()->pack_weight(PackedFormat::BF16);
+        src->save_weights_file(bf16_path);
+    }
+
+    std::cout << std::setw(18) << "File"
+              << std::setw(12) << "Size (MB)"
+              << std::setw(12) << "Load (ms)"
+              << std::setw(14) << "Peak RSS (MB)"
+              << std::setw(14) << "RSS (MB)"
+              << std::setw(16) << "1st fwd (ms)"
+              << std::setw(16) << "RSS fwd (MB)" << std::endl;
+    std::cout << std::string(102, '-') << std::endl;
+
+    // The npz model is packed to f32 rows while loading so it runs the same kernels as
+    // f32.dczt; safetensors keeps separate bf16 q/k/v and gate/up rows (no fusing copy)
+    struct Source { std::string label, path; std::optional<PackedFormat> format; };
+    std::vector<Source> files = {
+        {"bf16.dczt", bf16_path, std::nullopt},
+        {"bf16.safetensors", st_path, std::nullopt},
+        {"f32.dczt", f32_path, std::nullopt},
+        {"f32.npz", npz_path, PackedFormat::F32},
+    };
+
+    for (const auto& [label, path, format] : files) {
+        // RSS is measured from before construction: the constructor's random
+        // embedding is replaced by the loaded one in every case
+        double rss_base = status_mb("VmRSS");
+        reset_peak_rss();
+        auto model = make_model();
+
+        // load_weights reports progress on stdout; keep the table readable
+        std::ostringstream sink;
+        std::streambuf* old = std::cout.rdbuf(sink.rdbuf());
+        auto t0 = high_resolution_clock::now();
+        model->load_weights(path, format);
+        auto t1 = high_resolution_clock::now();
+        std::cout.rdbuf(old);
+
+        double peak = status_mb("VmHWM") - rss_base;
+        double rss_load = status_mb("VmRSS") - rss_base;
+
+        // The first forward faults the mapped pages in
+        auto t2 = high_resolution_clock::now();
+        model->forward_ids(prompt, 0, {prompt.size() - 1});
+        auto t3 = high_resolution_clock::now();
+        double rss_fwd = status_mb("VmRSS") - rss_base;
+
+        std::cout << std::setw(18) << label
+                  << std::setw(12) << std::fixed << std::setprecision(1) << file_bytes(path) / (1024.0 * 1024.0)
+                  << std::setw(12) << std::fixed << std::setprecision(1)
+                  << duration_cast<microseconds>(t1 - t0).count() / 1000.0
+                  << std::setw(14) << std::fixed << std::setprecision(1) << peak
+                  << std::setw(14) << std::fixed << std::setprecision(1) << rss_load
+                  << std::setw(16) << std::fixed << std::setprecision(1)
+                  << duration_cast<microseconds>(t3 - t2).count() / 1000.0
+                  << std::setw(16) << std::fixed << std::setprecision(1) << rss_fwd << std::endl;
+    }
+
+    std::cout << "(mapped pages count toward RSS once touched but are shared page cache,\n"
+                 " not private heap: other processes mapping the same file reuse them)" << std::endl;
+
+    for (const auto& source : files) std::remove(source.path.c_str());
+}
+
+int main() {
+    std::cout << "==================================================" << std::endl;
+    std::cout << "          DeepCZero Llama Load Benchmark          " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    benchmark_load();
+
+    std::cout << "\n==================================================" << std::endl;
+    std::cout << "                Benchmark Complete                " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    return 0;
+}
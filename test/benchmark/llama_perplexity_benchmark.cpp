@@ -0,0 +1,130 @@
+#include "deepczero.hpp"
+#include "utils/perplexity.hpp"
+#include "utils/tokenizer.hpp"
+#include "bench_util.hpp"
+#include <iostream>
+#include <chrono>
+#include <iomanip>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdlib>
+#include <sys/stat.h>
+
+using namespace tensor;
+using namespace std::chrono;
+
+// Usage: llama_perplexity_benchmark [text_file [context_len [stride]]]
+//   With a text file and the Llama 3.2 1B weights + tokenizer under ~/.deepczero/weights,
+//   reports the model's perplexity on that text. Without them, a small random model on
+//   a synthetic token stream times the evaluation loop (regression benchmark).
+
+static bool file_exists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+static void print_header() {
+    std::cout << std::setw(12) << "Mode"
+              << std::setw(8) << "KV"
+              << std::setw(12) << "PPL"
+              << std::setw(10) << "Windows"
+              << std::setw(12) << "Run tok"
+              << std::setw(12) << "Time (s)"
+              << std::setw(12) << "Tokens/s"
+              << std::setw(14) << "Peak (MB)" << std::endl;
+    std::cout << std::string(92, '-') << std::endl;
+}
+
+static void run(LlamaForCausalLM& model, const std::vector<int>& tokens, PerplexityConfig config,
+                bool reuse_cache, KVCacheFormat format) {
+    config.reuse_cache = reuse_cache;
+    model.set_kv_cache_format(format);
+
+    double rss_base = status_mb("VmRSS");
+    reset_peak_rss();
+    PerplexityResult r = evaluate_perplexity(model, tokens, config);
+    double peak = status_mb("VmHWM") - rss_base;
+    model.reset_cache();
+
+    std::cout << std::setw(12) << (reuse_cache ? "reuse KV" : "recompute")
+              << std::setw(8) << kv_cache_format_name(format)
+              << std::setw(12) << std::fixed << std::setprecision(4) << r.perplexity()
+              << std::setw(10) << r.windows
+              << std::setw(12) << r.forwarded_tokens
+              << std::setw(12) << std::setprecision(2) << r.elapsed_ms / 1000.0
+              << std::setw(12) << std::setprecision(1) << r.tokens_per_sec()
+              << std::setw(14) << std::setprecision(1) << peak << std::endl;
+    std::cout << std::defaultfloat;
+}
+
+static void benchmark_synthetic(const PerplexityConfig& config) {
+    std::cout << "\n=== Synthetic: random 4-layer model (8K vocab, 512 hidden), 4096 tokens, context "
+              << config.context_len << ", stride " << config.stride << " ===" << std::endl;
+
+    LlamaForCausalLM model(8000, 512, 4, 8, 2, 1408, 2048, 500000.0f, 1e-5f);
+    model.pack_weights(PackedFormat::BF16);
+
+    // Token stream with some structure (a repeated phrase every 64 tokens)
+    std::vector<int> tokens(4096);
+    for (size_t i = 0; i < tokens.size(); ++i)
+        tokens[i] = static_cast<int>(i % 64 < 16 ? (i % 16) * 11 + 3 : (i * 2654435761u) % 8000);
+
+    print_header();
+    run(model, tokens, config, false, KVCacheFormat::F32);
+    run(model, tokens, config, true, KVCacheFormat::F32);
+    run(model, tokens, config, true, KVCacheFormat::INT8);
+}
+
+static void benchmark_text(const std::string& text_path, const PerplexityConfig& config) {
+    std::string weights = std::string(std::getenv("HOME")) + "/.deepczero/weights/";
+    std::cout << "\n=== Llama 3.2 1B on " << text_path << ", context " << config.context_len
+              << ", stride " << config.stride << " ===" << std::endl;
+
+    LlamaTokenizer tokenizer;
+    tokenizer.load_cached(weights + "tokenizer.json");
+    std::ifstream in(text_path);
+    std::stringstream text;
+    text << in.rdbuf();
+    std::vector<int> tokens = {tokenizer.get_bos_token_id()};
+    std::vector<int> body = tokenizer.encode(text.str());
+    tokens.insert(tokens.end(), body.begin(), body.end());
+    std::cout << "Tokens: " << tokens.size() << std::endl;
+
+    LlamaForCausalLM model(128256, 2048, 16, 32, 8, 8192, std::max<size_t>(512, config.context_len),
+                           500000.0f, 1e-5f);
+    model.load_weights(weights + "llama-3.2-1b-instruct.npz");
+
+    print_header();
+    run(model, tokens, config, true, KVCacheFormat::F32);
+    run(model, tokens, config, true, KVCacheFormat::INT8);
+}
+
+int main(int argc, char** argv) {
+    std::cout << "==================================================" << std::endl;
+    std::cout << "        DeepCZero Llama Perplexity Benchmark      " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    dcz::UsingConfig eval_mode("train", false);
+    dcz::UsingConfig no_grad("enable_backprop", false);
+
+    PerplexityConfig config;
+    config.context_len = argc > 2 ? std::stoul(argv[2]) : 512;
+    config.stride = argc > 3 ? std::stoul(argv[3]) : config.context_len / 2;
+
+    std::string weights = std::string(std::getenv("HOME")) + "/.deepczero/weights/";
+    if (argc > 1 && file_exists(argv[1]) && file_exists(weights + "tokenizer.json")
+        && file_exists(weights + "llama-3.2-1b-instruct.npz")) {
+        benchmark_text(argv[1], config);
+    } else {
+        if (argc > 1) std::cout << "\nText file or Llama weights not found, running the synthetic benchmark" << std::endl;
+        benchmark_synthetic(config);
+    }
+
+    std::cout << "\n==================================================" << std::endl;
+    std::cout << "                Benchmark Complete                " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    return 0;
+}
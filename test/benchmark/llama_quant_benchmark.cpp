@@ -0,0 +1,213 @@
+#include "deepczero.hpp"
+#include "bench_util.hpp"
+#include <iostream>
+#include <chrono>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+#include <functional>
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+using namespace tensor;
+using namespace std::chrono;
+
+// Timing utility
+template<typename Func>
+double measure_time_ms(Func&& func, int warmup = 1, int iterations = 5) {
+    for (int i = 0; i < warmup; ++i) {
+        func();
+    }
+
+    auto start = high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        func();
+    }
+    auto end = high_resolution_clock::now();
+
+    double total_ms = duration_cast<microseconds>(end - start).count() / 1000.0;
+    return total_ms / iterations;
+}
+
+static std::vector<PackedFormat> packed_formats() {
+    return {PackedFormat::F32, PackedFormat::BF16, PackedFormat::F16,
+            PackedFormat::Q8_0, PackedFormat::Q4_0, PackedFormat::Q4_1};
+}
+
+// Decode GEMV y = x @ W for Llama 3.2 1B projection shapes
+void benchmark_gemv() {
+    std::cout << "\n=== Decode GEMV: fp32 dot vs packed formats ===" << std::endl;
+
+    std::cout << std::setw(8) << "In"
+              << std::setw(8) << "Out"
+              << std::setw(10) << "Format"
+              << std::setw(14) << "Weight (MB)"
+              << std::setw(12) << "Time (ms)"
+              << std::setw(12) << "GB/s"
+              << std::setw(12) << "MaxDiff" << std::endl;
+    std::cout << std::string(76, '-') << std::endl;
+
+    std::vector<std::pair<size_t, size_t>> shapes = {{2048, 2048}, {2048, 8192}, {8192, 2048}};
+
+    for (const auto& [in, out] : shapes) {
+        Tensor<float> W({in, out});
+        Tensor<float> x({1, 1, in});
+        auto& W_data = W.raw_data();
+        auto& x_data = x.raw_data();
+        for (size_t i = 0; i < W_data.size(); ++i) W_data[i] = static_cast<float>(rand()) / RAND_MAX - 0.5f;
+        for (size_t i = 0; i < x_data.size(); ++i) x_data[i] = static_cast<float>(rand()) / RAND_MAX - 0.5f;
+
+        // Unpacked dot() only for the first shape: it is orders of magnitude slower
+        Tensor<float> ref;
+        if (in == shapes[0].first && out == shapes[0].second) {
+            double fp32_mb = in * out * sizeof(float) / (1024.0 * 1024.0);
+            double t_ref = measure_time_ms([&]() { ref = dot(x, W); }, 0, 1);
+            std::cout << std::setw(8) << in << std::setw(8) << out << std::setw(10) << "dot"
+                      << std::setw(14) << std::fixed << std::setprecision(1) << fp32_mb
+                      << std::setw(12) << std::setprecision(3) << t_ref
+                      << std::setw(12) << std::setprecision(2) << fp32_mb / 1024.0 / (t_ref / 1000.0)
+                      << std::setw(12) << "-" << std::endl;
+        } else {
+            ref = packed_linear(x, PackedTensor::from_linear_weight(W, PackedFormat::F32));
+        }
+
+        for (PackedFormat format : packed_formats()) {
+            PackedTensor p = PackedTensor::from_linear_weight(W, format);
+            Tensor<float> y;
+            double t = measure_time_ms([&]() { y = packed_linear(x, p); }, 2, 20);
+
+            float max_diff = 0.0f;
+            for (size_t i = 0; i < y.raw_data().size(); ++i)
+                max_diff = std::max(max_diff, std::abs(y.raw_data()[i] - ref.raw_data()[i]));
+
+            double mb = p.nbytes() / (1024.0 * 1024.0);
+            std::cout << std::setw(8) << in << std::setw(8) << out << std::setw(10) << packed_format_name(format)
+                      << std::setw(14) << std::fixed << std::setprecision(1) << mb
+                      << std::setw(12) << std::setprecision(3) << t
+                      << std::setw(12) << std::setprecision(2) << mb / 1024.0 / (t / 1000.0)
+                      << std::setw(12) << std::scientific << std::setprecision(1) << max_diff
+                      << std::defaultfloat << std::endl;
+        }
+    }
+}
+
+// Teacher-forced logits [1, n, vocab] for every position of tokens
+static Tensor<float> all_logits(LlamaForCausalLM& model, const std::vector<int>& tokens) {
+    model.reset_cache();
+    return model.forward_ids(tokens, 0).data();
+}
+
+// Perplexity of tokens[1..] given tokens[..n-1]
+static double perplexity(const Tensor<float>& logits, const std::vector<int>& tokens) {
+    const auto& data = logits.raw_data();
+    size_t vocab = logits.get_shape()[2];
+
+    double nll = 0.0;
+    for (size_t t = 0; t + 1 < tokens.size(); ++t) {
+        const float* row = data.data() + t * vocab;
+        float max_logit = *std::max_element(row, row + vocab);
+        double sum = 0.0;
+        for (size_t i = 0; i < vocab; ++i) sum += std::exp(row[i] - max_logit);
+        nll -= row[tokens[t + 1]] - max_logit - std::log(sum);
+    }
+    return std::exp(nll / (tokens.size() - 1));
+}
+
+// Small Llama: decode tokens/sec, decoder weight memory, perplexity drift
+void benchmark_decode() {
+    std::cout << "\n=== LlamaForCausalLM decode: packed fp32 vs quantized weights ===" << std::endl;
+
+    dcz::UsingConfig eval_mode("train", false);
+    dcz::UsingConfig no_grad("enable_backprop", false);
+
+    size_t vocab = 4096;
+    auto make_model = []() {
+        return std::make_unique<LlamaForCausalLM>(4096, 512, 4, 8, 4, 1536, 512, 500000.0f, 1e-5f);
+    };
+
+    // Reference weights: one model, copied into the others.
+    // (Unpacked fp32 Linear goes through dot() and is far too slow to time here.)
+    auto reference = make_model();
+    reference->forward_ids({1}, 0);
+    auto ref_params = reference->flatten_params();
+
+    std::vector<int> text;
+    for (int i = 0; i < 64; ++i) text.push_back((i * 131 + 7) % static_cast<int>(vocab));
+    double ref_ppl = 0.0;
+    Tensor<float> ref_logits;
+
+    std::cout << std::setw(10) << "Weights"
+              << std::setw(16) << "Decoder (MB)"
+              << std::setw(12) << "RSS (MB)"
+              << std::setw(14) << "Decode (ms)"
+              << std::setw(10) << "tok/s"
+              << std::setw(12) << "PPL"
+              << std::setw(12) << "dPPL (%)"
+              << std::setw(14) << "MaxLogitDiff"
+              << std::setw(12) << "Top1 (%)" << std::endl;
+    std::cout << std::string(112, '-') << std::endl;
+
+    auto run = [&](const char* name, LlamaForCausalLM& model, double mb, double rss) {
+        std::vector<int> prompt(text.begin(), text.begin() + 16);
+        model.reset_cache();
+        model.prefill(prompt, 0, 0);
+        size_t pos = prompt.size();
+        double ms = measure_time_ms([&]() { model.forward_ids({42}, pos++, {0}); }, 1, 8);
+        Tensor<float> logits = all_logits(model, text);
+        double ppl = perplexity(logits, text);
+
+        // Output drift against the packed fp32 model: worst logit and argmax agreement
+        const auto& a = logits.raw_data();
+        const auto& b = ref_logits.raw_data();
+        float max_diff = 0.0f;
+        size_t agree = 0;
+        for (size_t t = 0; t < text.size(); ++t) {
+            const float* ra = a.data() + t * vocab;
+            const float* rb = b.data() + t * vocab;
+            for (size_t i = 0; i < vocab; ++i) max_diff = std::max(max_diff, std::abs(ra[i] - rb[i]));
+            agree += std::max_element(ra, ra + vocab) - ra == std::max_element(rb, rb + vocab) - rb;
+        }
+        std::cout << std::setw(10) << name
+                  << std::setw(16) << std::fixed << std::setprecision(1) << mb
+                  << std::setw(12) << std::setprecision(1) << rss
+                  << std::setw(14) << std::setprecision(2) << ms
+                  << std::setw(10) << std::setprecision(1) << 1000.0 / ms
+                  << std::setw(12) << std::setprecision(2) << ppl
+                  << std::setw(12) << std::setprecision(3) << 100.0 * (ppl - ref_ppl) / ref_ppl
+                  << std::setw(14) << std::scientific << std::setprecision(1) << max_diff
+                  << std::setw(12) << std::fixed << std::setprecision(1) << 100.0 * agree / text.size()
+                  << std::defaultfloat << std::endl;
+    };
+
+    // RSS: growth of the process for one model (embedding + packed decoder + KV cache)
+    for (PackedFormat format : packed_formats()) {
+        double rss_before = status_mb("VmRSS");
+        auto model = make_model();
+        model->forward_ids({1}, 0);
+        for (auto& [name, param] : model->flatten_params())
+            param.data() = ref_params.at(name).data().clone();
+        size_t bytes = model->pack_weights(format);
+        double rss = status_mb("VmRSS") - rss_before;
+        if (format == PackedFormat::F32) {
+            ref_logits = all_logits(*model, text);
+            ref_ppl = perplexity(ref_logits, text);
+        }
+        run(packed_format_name(format), *model, bytes / (1024.0 * 1024.0), rss);
+    }
+}
+
+int main() {
+    std::cout << "==================================================" << std::endl;
+    std::cout << "      DeepCZero Llama Quantized Weights Benchmark  " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    benchmark_gemv();
+    benchmark_decode();
+
+    std::cout << "\n==================================================" << std::endl;
+    std::cout << "                Benchmark Complete                " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "deepczero.hpp"
+#include "utils/generate.hpp"
+#include "bench_util.hpp"
+#include <iostream>
+#include <chrono>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+
+using namespace tensor;
+using namespace std::chrono;
+
+void benchmark_shared_weights() {
+    std::cout << "\n=== Concurrent sessions on one model (512 hidden, 4 layers, bf16 weights) ===" << std::endl;
+
+    dcz::UsingConfig eval_mode("train", false);
+    dcz::UsingConfig no_grad("enable_backprop", false);
+
+    double rss_start = status_mb("VmRSS");
+    LlamaForCausalLM model(8000, 512, 4, 8, 2, 1408, 2048, 500000.0f, 1e-5f);
+    model.pack_weights(PackedFormat::BF16);
+    double weights_mb = status_mb("VmRSS") - rss_start;
+
+    const size_t prompt_len = 64;
+    GenerationConfig config;
+    config.max_new_tokens = 32;
+    config.eos_token_id = -1;
+
+    auto prompt_of = [&](size_t w) { return make_prompt(prompt_len, 8000, w * 997); };
+    generate(model, prompt_of(0), config);  // warm-up
+
+    std::cout << std::setw(10) << "Workers"
+              << std::setw(14) << "Time (ms)"
+              << std::setw(16) << "Total tok/s"
+              << std::setw(18) << "Session RSS (MB)"
+              << std::setw(22) << "N copies would add" << std::endl;
+    std::cout << std::string(80, '-') << std::endl;
+
+    unsigned max_workers = std::max(4u, std::thread::hardware_concurrency());
+    for (unsigned workers = 1; workers <= max_workers; workers *= 2) {
+        double rss_before = status_mb("VmRSS");
+        std::vector<layer::InferenceSession> sessions(workers);
+        std::vector<std::thread> threads;
+        auto t0 = high_resolution_clock::now();
+        for (unsigned w = 0; w < workers; ++w) {
+            threads.emplace_back([&, w] {
+                layer::UsingSession use(sessions[w]);
+                generate(model, prompt_of(w), config);
+            });
+        }
+        for (auto& t : threads) t.join();
+        double ms = duration<double, std::milli>(high_resolution_clock::now() - t0).count();
+        // Caches stay in the sessions until they go away
+        double session_mb = status_mb("VmRSS") - rss_before;
+
+        std::cout << std::setw(10) << workers
+                  << std::setw(14) << std::fixed << std::setprecision(1) << ms
+                  << std::setw(16) << std::setprecision(1) << workers * config.max_new_tokens * 1000.0 / ms
+                  << std::setw(18) << std::setprecision(1) << session_mb
+                  << std::setw(22) << std::setprecision(1) << (workers - 1) * weights_mb << std::endl;
+    }
+    std::cout << "(weights: " << std::fixed << std::setprecision(1) << weights_mb
+              << " MB, loaded once; each worker's session holds only its KV cache)" << std::endl;
+    std::cout << std::defaultfloat;
+}
+
+int main() {
+    std::cout << "==================================================" << std::endl;
+    std::cout << "      DeepCZero Llama Inference Session Benchmark " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    benchmark_shared_weights();
+
+    std::cout << "\n==================================================" << std::endl;
+    std::cout << "                Benchmark Complete                " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    return 0;
+}
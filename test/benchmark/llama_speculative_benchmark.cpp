@@ -0,0 +1,115 @@
+#include "deepczero.hpp"
+#include "utils/generate.hpp"
+#include "bench_util.hpp"
+#include <iostream>
+#include <chrono>
+#include <iomanip>
+#include <vector>
+
+using namespace std::chrono;
+
+// Share weights of matching parameters (same name and shape) from src into dst.
+// One forward first so the lazily created Linear weights exist.
+static void share_weights(LlamaForCausalLM& dst, LlamaForCausalLM& src) {
+    dst.forward_ids({1}, 0);
+    src.forward_ids({1}, 0);
+    auto src_params = src.flatten_params();
+    for (auto& [name, param] : dst.flatten_params()) {
+        auto it = src_params.find(name);
+        if (it != src_params.end() && it->second.shape() == param.shape())
+            param.data() = it->second.data();
+    }
+}
+
+template<typename Func>
+double measure_once_ms(Func&& func) {
+    auto start = high_resolution_clock::now();
+    func();
+    auto end = high_resolution_clock::now();
+    return duration_cast<microseconds>(end - start).count() / 1000.0;
+}
+
+// Target: 4 layers. Drafts:
+//   self      - identical weights (upper bound, every draft accepted)
+//   truncated - first layer + embedding/norm of the target (cheap, partially agrees)
+//   random    - unrelated 1-layer model (lower bound, nothing accepted)
+void benchmark_speculative() {
+    std::cout << "\n=== Speculative decoding: acceptance rate and speedup ===" << std::endl;
+
+    size_t vocab = 512, hidden = 128, inter = 256;
+    LlamaForCausalLM target(vocab, hidden, 4, 4, 2, inter, 512, 500000.0f, 1e-5f);
+    LlamaForCausalLM self_draft(vocab, hidden, 4, 4, 2, inter, 512, 500000.0f, 1e-5f);
+    LlamaForCausalLM truncated_draft(vocab, hidden, 1, 4, 2, inter, 512, 500000.0f, 1e-5f);
+    LlamaForCausalLM random_draft(vocab, hidden, 1, 4, 2, inter, 512, 500000.0f, 1e-5f);
+    share_weights(self_draft, target);
+    share_weights(truncated_draft, target);
+    random_draft.forward_ids({1}, 0);
+
+    std::vector<int> prompt = make_prompt(32, vocab);
+
+    GenerationConfig config;
+    config.max_new_tokens = 16;
+    config.eos_token_id = -1;
+
+    std::vector<int> reference;
+    double base_ms = measure_once_ms([&]() { reference = generate(target, prompt, config); });
+    std::cout << "baseline (target only): " << std::fixed << std::setprecision(2) << base_ms << " ms, "
+              << config.max_new_tokens * 1000.0 / base_ms << " tok/s" << std::endl;
+
+    std::cout << std::setw(12) << "Draft"
+              << std::setw(5) << "k"
+              << std::setw(14) << "Accept rate"
+              << std::setw(16) << "Target fwds"
+              << std::setw(12) << "Time (ms)"
+              << std::setw(10) << "Speedup"
+              << std::setw(10) << "Match" << std::endl;
+    std::cout << std::string(79, '-') << std::endl;
+
+    std::vector<std::pair<const char*, LlamaForCausalLM*>> drafts = {
+        {"self", &self_draft}, {"truncated", &truncated_draft}, {"random", &random_draft}};
+
+    for (const auto& [name, draft] : drafts) {
+        for (size_t k : {2, 4}) {
+            config.num_draft_tokens = k;
+            SpeculativeStats stats;
+            std::vector<int> out;
+            double ms = measure_once_ms([&]() {
+                out = generate_speculative(target, *draft, prompt, config, &stats);
+            });
+
+            std::cout << std::setw(12) << name
+                      << std::setw(5) << k
+                      << std::setw(14) << std::fixed << std::setprecision(3) << stats.acceptance_rate()
+                      << std::setw(16) << stats.target_forwards
+                      << std::setw(12) << std::setprecision(2) << ms
+                      << std::setw(9) << std::setprecision(2) << base_ms / ms << "x"
+                      << std::setw(10) << (out == reference ? "yes" : "NO") << std::endl;
+        }
+    }
+
+    // Sampling: acceptance under the min(1, p/q) rule
+    config.do_sample = true;
+    config.temperature = 0.8f;
+    config.num_draft_tokens = 4;
+    SpeculativeStats stats;
+    generate_speculative(target, truncated_draft, prompt, config, &stats);
+    std::cout << "sampling (T=0.8, truncated draft, k=4): acceptance "
+              << std::setprecision(3) << stats.acceptance_rate() << std::endl;
+}
+
+int main() {
+    std::cout << "==================================================" << std::endl;
+    std::cout << "      DeepCZero Llama Speculative Decoding        " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    dcz::UsingConfig eval_mode("train", false);
+    dcz::UsingConfig no_grad("enable_backprop", false);
+
+    benchmark_speculative();
+
+    std::cout << "\n==================================================" << std::endl;
+    std::cout << "                Benchmark Complete                " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,431 @@
+#include "deepczero.hpp"
+#include "json.hpp"
+#include <iostream>
+#include <chrono>
+#include <iomanip>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <random>
+#include <limits>
+#include <unordered_map>
+#include <algorithm>
+#include <omp.h>
+
+using json = nlohmann::json;
+using namespace std::chrono;
+
+// GPT-2 bytes_to_unicode spelling of one raw byte
+static std::string byte_unicode(unsigned char b) {
+    auto direct = [](int i) { return (i >= 33 && i <= 126) || (i >= 161 && i <= 172) || i >= 174; };
+    uint32_t cp = b;
+    if (!direct(b)) {
+        cp = 256;
+        for (int i = 0; i < b; ++i) cp += !direct(i);
+    }
+    std::string s;
+    if (cp < 0x80) {
+        s += static_cast<char>(cp);
+    } else {
+        s += static_cast<char>(0xC0 | (cp >> 6));
+        s += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    return s;
+}
+
+// Multi-MB pseudo-English: Zipf-distributed words over a syllable lexicon, with
+// capitals, contractions, numbers, punctuation, paragraphs and some non-ASCII words
+static std::string make_corpus(size_t bytes) {
+    std::mt19937 rng(1234);
+    const std::vector<std::string> syllables = {
+        "the", "an", "in", "er", "on", "at", "re", "es", "st", "ing", "ti", "or", "al", "ed", "ou",
+        "ar", "is", "it", "te", "co", "de", "ra", "li", "ma", "pro", "ver", "sion", "ment", "ly", "un",
+    };
+    const std::vector<std::string> extras = {
+        "caf\xC3\xA9", "na\xC3\xAFve", "\xC3\xBC" "ber", "\xE6\x97\xA5\xE6\x9C\xAC", "\xD0\xBC\xD0\xB8\xD1\x80",
+    };
+    std::vector<std::string> lexicon;
+    for (size_t i = 0; i < 20000; ++i) {
+        std::string w;
+        for (size_t s = 0, n = 1 + rng() % 4; s < n; ++s) w += syllables[rng() % syllables.size()];
+        lexicon.push_back(w);
+    }
+    std::vector<double> weights(lexicon.size());
+    for (size_t i = 0; i < weights.size(); ++i) weights[i] = 1.0 / (i + 1);
+    std::discrete_distribution<size_t> zipf(weights.begin(), weights.end());
+
+    std::string text;
+    text.reserve(bytes + 256);
+    bool sentence_start = true;
+    while (text.size() < bytes) {
+        std::string w = lexicon[zipf(rng)];
+        if (rng() % 200 == 0) w = extras[rng() % extras.size()];
+        if (sentence_start) w[0] = static_cast<char>(std::toupper(w[0]));
+        text += (sentence_start && (text.empty() || text.back() == '\n')) ? "" : " ";
+        text += w;
+        sentence_start = false;
+        unsigned r = rng() % 100;
+        if (r < 3) text += "'s";
+        else if (r < 5) text += " " + std::to_string(rng() % 100000);
+        else if (r < 12) text += ",";
+        else if (r < 20) {
+            text += rng() % 5 ? "." : "?";
+            sentence_start = true;
+            if (rng() % 8 == 0) text += "\n\n";
+        }
+    }
+    return text;
+}
+
+// Byte-level BPE trained on the corpus' pre-tokens, written as a tokenizer.json
+static void write_synthetic_tokenizer(const std::string& corpus, size_t num_merges, const std::string& path) {
+    std::unordered_map<std::string, size_t> counts;
+    for (std::string_view piece : LlamaTokenizer::pretokenize(std::string_view(corpus).substr(0, 1 << 19)))
+        ++counts[std::string(piece)];
+
+    std::vector<std::string> tokens;
+    for (int b = 0; b < 256; ++b) tokens.push_back(byte_unicode(static_cast<unsigned char>(b)));
+    std::vector<std::vector<int>> words;
+    std::vector<size_t> freq;
+    for (const auto& [word, count] : counts) {
+        words.emplace_back(word.begin(), word.end());
+        for (int& id : words.back()) id &= 0xFF;
+        freq.push_back(count);
+    }
+
+    json merges = json::array();
+    for (size_t m = 0; m < num_merges; ++m) {
+        std::unordered_map<uint64_t, size_t> pairs;
+        for (size_t w = 0; w < words.size(); ++w)
+            for (size_t i = 0; i + 1 < words[w].size(); ++i)
+                pairs[(uint64_t(words[w][i]) << 32) | uint32_t(words[w][i + 1])] += freq[w];
+        if (pairs.empty()) break;
+        auto best = std::max_element(pairs.begin(), pairs.end(),
+            [](const auto& a, const auto& b) { return a.second < b.second || (a.second == b.second && a.first > b.first); });
+        int left = static_cast<int>(best->first >> 32), right = static_cast<int>(best->first & 0xFFFFFFFF);
+        int merged = static_cast<int>(tokens.size());
+        merges.push_back(tokens[left] + " " + tokens[right]);
+        tokens.push_back(tokens[left] + tokens[right]);
+        for (auto& word : words) {
+            for (size_t i = 0; i + 1 < word.size(); ++i) {
+                if (word[i] == left && word[i + 1] == right) {
+                    word[i] = merged;
+                    word.erase(word.begin() + i + 1);
+                }
+            }
+        }
+    }
+    json vocab;
+    for (size_t i = 0; i < tokens.size(); ++i) vocab[tokens[i]] = static_cast<int>(i);
+    json data;
+    data["model"]["vocab"] = vocab;
+    data["model"]["merges"] = merges;
+    data["added_tokens"] = json::array({{{"content", "<|begin_of_text|>"}, {"id", static_cast<int>(vocab.size())}}});
+    std::ofstream(path) << data.dump();
+}
+
+// The previous encoder: string merge keys, rescan of every pair per merge, no cache
+class StringBPE {
+public:
+    explicit StringBPE(const std::string& path) {
+        json data = json::parse(std::ifstream(path));
+        for (auto& [token, id] : data["model"]["vocab"].items()) vocab[token] = id.get<int>();
+        int rank = 0;
+        for (const auto& m : data["model"]["merges"]) {
+            std::string s = m.is_array() ? m[0].get<std::string>() + " " + m[1].get<std::string>() : m.get<std::string>();
+            merge_ranks.emplace(s, rank++);
+        }
+        for (int b = 0; b < 256; ++b) byte_to_token[b] = byte_unicode(static_cast<unsigned char>(b));
+    }
+
+    void encode(const std::vector<std::string_view>& pretokens, std::vector<int>& out) const {
+        for (std::string_view pretoken : pretokens) {
+            std::string whole;
+            std::vector<std::string> word;
+            for (unsigned char b : pretoken) {
+                whole += byte_to_token[b];
+                word.push_back(byte_to_token[b]);
+            }
+            auto it = vocab.find(whole);
+            if (it != vocab.end()) {
+                out.push_back(it->second);
+                continue;
+            }
+            while (word.size() > 1) {
+                int best_rank = std::numeric_limits<int>::max();
+                size_t best_pos = 0;
+                for (size_t i = 0; i + 1 < word.size(); ++i) {
+                    auto r = merge_ranks.find(word[i] + " " + word[i + 1]);
+                    if (r != merge_ranks.end() && r->second < best_rank) {
+                        best_rank = r->second;
+                        best_pos = i;
+                    }
+                }
+                if (best_rank == std::numeric_limits<int>::max()) break;
+                std::vector<std::string> merged;
+                for (size_t i = 0; i < word.size(); ++i) {
+                    if (i == best_pos) {
+                        merged.push_back(word[i] + word[i + 1]);
+                        ++i;
+                    } else {
+                        merged.push_back(word[i]);
+                    }
+                }
+                word = std::move(merged);
+            }
+            for (const auto& t : word) out.push_back(vocab.at(t));
+        }
+    }
+
+private:
+    std::unordered_map<std::string, int> vocab;
+    std::unordered_map<std::string, int> merge_ranks;
+    std::string byte_to_token[256];
+};
+
+static void print_row(const std::string& name, double mb, size_t tokens, double seconds, double baseline_tps) {
+    double tps = tokens / seconds;
+    std::cout << std::setw(28) << std::left << name << std::right
+              << std::setw(10) << std::fixed << std::setprecision(2) << mb
+              << std::setw(12) << std::fixed << std::setprecision(2) << mb / seconds
+              << std::setw(16) << std::fixed << std::setprecision(0) << tps
+              << std::setw(11) << std::fixed << std::setprecision(1) << (baseline_tps > 0 ? tps / baseline_tps : 1.0)
+              << "x" << std::endl;
+}
+
+void benchmark_encode() {
+    std::cout << "\n=== Encode throughput ===" << std::endl;
+
+    const std::string corpus = make_corpus(8 << 20);
+    const double mb = corpus.size() / (1024.0 * 1024.0);
+
+    // The real Llama 3 tokenizer when present, else one trained here on the corpus
+    std::string path = std::string(std::getenv("HOME") ? std::getenv("HOME") : "") + "/.deepczero/weights/tokenizer.json";
+    bool synthetic = !std::ifstream(path).good();
+    if (synthetic) {
+        path = "/tmp/dcz_tokenizer_benchmark.json";
+        write_synthetic_tokenizer(corpus, 2000, path);
+    }
+    LlamaTokenizer tokenizer;
+    {
+        std::ostringstream sink;
+        std::streambuf* old = std::cout.rdbuf(sink.rdbuf());
+        tokenizer.load(path);
+        std::cout.rdbuf(old);
+    }
+    std::cout << (synthetic ? "synthetic" : "Llama 3") << " tokenizer: vocab " << tokenizer.vocab_size()
+              << ", merges " << tokenizer.merges_size() << "; corpus " << std::fixed << std::setprecision(2)
+              << mb << " MB" << std::endl;
+
+    std::cout << std::setw(28) << std::left << "Encoder" << std::right
+              << std::setw(10) << "MB"
+              << std::setw(12) << "MB/s"
+              << std::setw(16) << "Tokens/s"
+              << std::setw(12) << "Speedup" << std::endl;
+    std::cout << std::string(78, '-') << std::endl;
+
+    auto t0 = high_resolution_clock::now();
+    auto pieces = LlamaTokenizer::pretokenize(corpus);
+    double pretok_s = duration<double>(high_resolution_clock::now() - t0).count();
+
+    // The string encoder gets an eighth of the corpus (same pre-tokens) to bound its runtime
+    size_t ref_pieces = pieces.size() / 8;
+    std::vector<std::string_view> ref_input(pieces.begin(), pieces.begin() + ref_pieces);
+    double ref_mb = (ref_input.back().data() + ref_input.back().size() - corpus.data()) / (1024.0 * 1024.0);
+    StringBPE reference(path);
+    std::vector<int> ref_ids;
+    t0 = high_resolution_clock::now();
+    reference.encode(ref_input, ref_ids);
+    double ref_s = duration<double>(high_resolution_clock::now() - t0).count();
+    double ref_tps = ref_ids.size() / ref_s;
+    print_row("string BPE (previous)", ref_mb, ref_ids.size(), ref_s, ref_tps);
+
+    tokenizer.set_cache_capacity(0);
+    t0 = high_resolution_clock::now();
+    std::vector<int> ids = tokenizer.encode(corpus);
+    double nocache_s = duration<double>(high_resolution_clock::now() - t0).count();
+    print_row("integer BPE, no cache", mb, ids.size(), nocache_s, ref_tps);
+    if (!std::equal(ref_ids.begin(), ref_ids.end(), ids.begin()))
+        std::cout << "WARNING: integer BPE disagrees with the string encoder" << std::endl;
+
+    tokenizer.set_cache_capacity(16384);
+    t0 = high_resolution_clock::now();
+    std::vector<int> cached_ids = tokenizer.encode(corpus);
+    double cache_s = duration<double>(high_resolution_clock::now() - t0).count();
+    print_row("integer BPE + LRU cache", mb, cached_ids.size(), cache_s, ref_tps);
+    if (cached_ids != ids) std::cout << "WARNING: cached encode differs" << std::endl;
+
+    size_t hits = tokenizer.get_cache_hits(), misses = tokenizer.get_cache_misses();
+    std::cout << "pre-tokenizer alone: " << std::fixed << std::setprecision(1) << mb / pretok_s << " MB/s ("
+              << pieces.size() << " pre-tokens); cache hit rate "
+              << std::setprecision(1) << 100.0 * hits / (hits + misses) << "%" << std::endl;
+
+    if (synthetic) std::remove(path.c_str());
+}
+
+// Llama 3 sized tokenizer.json (128K vocab) of random byte strings: each token is made
+// by one merge, and every other split into two vocab tokens is a merge too
+static void write_large_tokenizer(const std::string& path) {
+    std::mt19937 rng(99);
+    std::vector<std::string> tokens;
+    std::unordered_map<std::string, int> vocab;
+    for (int b = 0; b < 256; ++b) {
+        tokens.push_back(byte_unicode(static_cast<unsigned char>(b)));
+        vocab[tokens.back()] = b;
+    }
+    while (tokens.size() < 128000) {
+        std::string merged = tokens[rng() % tokens.size()] + tokens[rng() % tokens.size()];
+        if (merged.size() > 24 || vocab.count(merged)) continue;
+        vocab[merged] = static_cast<int>(tokens.size());
+        tokens.push_back(merged);
+    }
+    // Split points must fall on whole byte spellings (1 or 2 UTF-8 bytes each)
+    json merges = json::array();
+    for (size_t t = 256; t < tokens.size() && merges.size() < 280000; ++t) {
+        const std::string& token = tokens[t];
+        for (size_t split = 1; split < token.size(); ++split) {
+            if ((static_cast<unsigned char>(token[split]) & 0xC0) == 0x80) continue;
+            std::string a = token.substr(0, split), b = token.substr(split);
+            if (vocab.count(a) && vocab.count(b)) merges.push_back(a + " " + b);
+        }
+    }
+    json data;
+    data["model"]["vocab"] = vocab;
+    data["model"]["merges"] = merges;
+    data["added_tokens"] = json::array({{{"content", "<|begin_of_text|>"}, {"id", 128000}},
+                                        {{"content", "<|end_of_text|>"}, {"id", 128001}},
+                                        {{"content", "<|eot_id|>"}, {"id", 128009}}});
+    std::ofstream(path) << data.dump();
+}
+
+template <typename F>
+static double time_ms(F&& f) {
+    auto t0 = high_resolution_clock::now();
+    f();
+    return duration<double, std::milli>(high_resolution_clock::now() - t0).count();
+}
+
+void benchmark_load() {
+    std::cout << "\n=== Tokenizer load: tokenizer.json vs binary cache ===" << std::endl;
+
+    std::string path = std::string(std::getenv("HOME") ? std::getenv("HOME") : "") + "/.deepczero/weights/tokenizer.json";
+    bool synthetic = !std::ifstream(path).good();
+    if (synthetic) {
+        path = "/tmp/dcz_tokenizer_benchmark_large.json";
+        write_large_tokenizer(path);
+    }
+    const std::string cache = "/tmp/dcz_tokenizer_benchmark.bin";
+
+    std::ostringstream sink;
+    std::streambuf* old = std::cout.rdbuf(sink.rdbuf());
+    std::vector<std::vector<int>> encoded(2);
+    const std::string probe = "The quick brown fox jumps over the lazy dog, 12345 times!";
+    double json_ms = 0.0, save_ms = 0.0, mapped_ms = 0.0;
+    size_t vocab = 0, merges = 0, cache_bytes = 0;
+    {
+        LlamaTokenizer tok;
+        json_ms = time_ms([&] { tok.load(path); });
+        save_ms = time_ms([&] { tok.save_binary(cache); });
+        encoded[0] = tok.encode(probe);
+        vocab = tok.vocab_size();
+        merges = tok.merges_size();
+    }
+    {
+        LlamaTokenizer tok;
+        mapped_ms = time_ms([&] { tok.load(cache); });
+        encoded[1] = tok.encode(probe);
+    }
+    std::cout.rdbuf(old);
+    cache_bytes = std::ifstream(cache, std::ios::binary | std::ios::ate).tellg();
+
+    std::cout << (synthetic ? "synthetic" : "Llama 3") << " tokenizer: vocab " << vocab << ", merges " << merges
+              << "; json " << std::fixed << std::setprecision(1)
+              << std::ifstream(path, std::ios::binary | std::ios::ate).tellg() / (1024.0 * 1024.0)
+              << " MB, cache " << cache_bytes / (1024.0 * 1024.0) << " MB" << std::endl;
+    std::cout << std::setw(28) << std::left << "Load" << std::right << std::setw(14) << "ms" << std::endl;
+    std::cout << std::string(42, '-') << std::endl;
+    std::cout << std::setw(28) << std::left << "tokenizer.json (parse)" << std::right
+              << std::setw(14) << std::fixed << std::setprecision(2) << json_ms << std::endl;
+    std::cout << std::setw(28) << std::left << "save_binary" << std::right
+              << std::setw(14) << std::fixed << std::setprecision(2) << save_ms << std::endl;
+    std::cout << std::setw(28) << std::left << "binary cache (mmap)" << std::right
+              << std::setw(14) << std::fixed << std::setprecision(2) << mapped_ms << std::endl;
+    if (encoded[0] != encoded[1]) std::cout << "WARNING: cached tokenizer encodes differently" << std::endl;
+
+    std::remove(cache.c_str());
+    if (synthetic) std::remove(path.c_str());
+}
+
+void benchmark_batch() {
+    std::cout << "\n=== encode_batch throughput ===" << std::endl;
+
+    const std::string corpus = make_corpus(8 << 20);
+    // ~4 KB documents cut at spaces
+    std::vector<std::string> docs;
+    for (size_t pos = 0; pos < corpus.size();) {
+        size_t end = std::min(corpus.size(), pos + 4096);
+        while (end < corpus.size() && corpus[end] != ' ') ++end;
+        docs.push_back(corpus.substr(pos, end - pos));
+        pos = end;
+    }
+
+    const std::string path = "/tmp/dcz_tokenizer_benchmark.json";
+    write_synthetic_tokenizer(corpus, 2000, path);
+    LlamaTokenizer tokenizer;
+    {
+        std::ostringstream sink;
+        std::streambuf* old = std::cout.rdbuf(sink.rdbuf());
+        tokenizer.load(path);
+        std::cout.rdbuf(old);
+    }
+    std::remove(path.c_str());
+
+    const double mb = corpus.size() / (1024.0 * 1024.0);
+    std::cout << docs.size() << " documents, " << std::fixed << std::setprecision(2) << mb << " MB; "
+              << omp_get_num_procs() << " cores" << std::endl;
+    std::cout << std::setw(28) << std::left << "Encoder" << std::right
+              << std::setw(10) << "MB"
+              << std::setw(12) << "MB/s"
+              << std::setw(16) << "Tokens/s"
+              << std::setw(12) << "Speedup" << std::endl;
+    std::cout << std::string(78, '-') << std::endl;
+
+    // Each row starts from a cold cache so every configuration does the same work
+    size_t tokens = 0;
+    double seq_ms = time_ms([&] {
+        for (const auto& doc : docs) tokens += tokenizer.encode(doc).size();
+    });
+    double seq_tps = tokens / (seq_ms / 1000.0);
+    print_row("encode() loop", mb, tokens, seq_ms / 1000.0, seq_tps);
+
+    int max_threads = std::max(4, omp_get_num_procs());
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        tokenizer.clear_cache();
+        std::vector<std::vector<int>> out;
+        double ms = time_ms([&] { out = tokenizer.encode_batch(docs, threads); });
+        size_t batch_tokens = 0;
+        for (const auto& ids : out) batch_tokens += ids.size();
+        print_row("encode_batch, " + std::to_string(threads) + " thread" + (threads > 1 ? "s" : ""),
+                  mb, batch_tokens, ms / 1000.0, seq_tps);
+    }
+}
+
+int main() {
+    std::cout << "==================================================" << std::endl;
+    std::cout << "          DeepCZero Tokenizer Benchmark           " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    benchmark_encode();
+    benchmark_load();
+    benchmark_batch();
+
+    std::cout << "\n==================================================" << std::endl;
+    std::cout << "                Benchmark Complete                " << std::endl;
+    std::cout << "==================================================" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "deepczero.hpp"
+#include "utils/generate.hpp"
+#include "../../llama_test_util.hpp"
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+void test_config_per_thread() {
+	std::cout << "=== Test config flags are per thread ===" << std::endl;
+
+	dcz::UsingConfig no_grad("enable_backprop", false);
+	bool other_backprop = false, bound_backprop = true, restored = false;
+	std::thread worker([&] {
+		other_backprop = dcz::Config::get().enable_backprop;
+		layer::InferenceSession session;
+		{
+			layer::UsingSession use(session);
+			bound_backprop = dcz::Config::get().enable_backprop || dcz::Config::get().train;
+			assert(layer::InferenceSession::current() == &session);
+		}
+		restored = dcz::Config::get().enable_backprop && !layer::InferenceSession::current();
+	});
+	worker.join();
+	assert(other_backprop);   // the main thread's no_grad does not leak
+	assert(!bound_backprop);  // sessions default to inference
+	assert(restored);
+	assert(!dcz::Config::get().enable_backprop);
+
+	std::cout << "Config test PASSED" << std::endl << std::endl;
+}
+
+void test_llama_threads_share_weights() {
+	std::cout << "=== Test concurrent Llama sessions on one model ===" << std::endl;
+
+	dcz::UsingConfig eval_mode("train", false);
+	dcz::UsingConfig no_grad("enable_backprop", false);
+
+	LlamaForCausalLM model = tiny_llama();
+	model.pack_weights(PackedFormat::BF16);
+
+	const size_t num_threads = 4;
+	GenerationConfig config;
+	config.max_new_tokens = 20;
+	config.eos_token_id = -1;
+	config.prefill_chunk_size = 7;
+
+	std::vector<std::vector<int>> prompts;
+	for (size_t t = 0; t < num_threads; ++t)
+		prompts.push_back(make_tokens(12 + 5 * t, static_cast<int>(t)));
+
+	// Sessions start with the model's KV format: f32, then int8
+	std::vector<float> f32_logits;
+	for (KVCacheFormat format : {KVCacheFormat::F32, KVCacheFormat::INT8}) {
+		model.set_kv_cache_format(format);
+		std::vector<std::vector<int>> expected;
+		std::vector<std::vector<float>> expected_logits;
+		for (size_t t = 0; t < num_threads; ++t) {
+			expected.push_back(generate(model, prompts[t], config));
+			model.reset_cache();
+			expected_logits.push_back(model.forward_ids(prompts[t], 0).data().raw_data());
+		}
+		// int8 K/V gives other logits: the workers really run the inherited format
+		if (format == KVCacheFormat::F32) f32_logits = expected_logits[0];
+		else assert(max_diff(f32_logits, expected_logits[0]) > 1e-4f);
+
+		// The model's own cache (used without a session) is left alone by the workers
+		model.reset_cache();
+		model.forward_ids(prompts[0], 0);
+		size_t own_len = model.cache_len();
+
+		std::vector<std::vector<int>> outputs(num_threads);
+		std::vector<float> worst(num_threads, 0.0f);
+		std::vector<KVCacheFormat> formats(num_threads);
+		std::vector<std::thread> workers;
+		for (size_t t = 0; t < num_threads; ++t) {
+			workers.emplace_back([&, t] {
+				layer::InferenceSession session;
+				layer::UsingSession use(session);
+				formats[t] = model.get_kv_cache_format();
+				for (int round = 0; round < 3; ++round) {
+					model.reset_cache();
+					std::vector<float> logits = model.forward_ids(prompts[t], 0).data().raw_data();
+					worst[t] = std::max(worst[t], max_diff(logits, expected_logits[t]));
+					assert(model.cache_len() == prompts[t].size());
+					outputs[t] = generate(model, prompts[t], config);
+				}
+			});
+		}
+		for (auto& w : workers) w.join();
+
+		for (size_t t = 0; t < num_threads; ++t) {
+			assert(formats[t] == format);
+			assert(outputs[t] == expected[t]);
+			assert(worst[t] < 1e-5f);
+		}
+		assert(model.cache_len() == own_len);
+		assert(model.get_kv_cache_format() == format);
+	}
+	model.set_kv_cache_format(KVCacheFormat::F32);
+
+	// Streaming settings carry over as well
+	model.set_streaming(4, 16);
+	{
+		layer::InferenceSession session;
+		layer::UsingSession use(session);
+		assert(model.is_streaming());
+		assert(model.get_model()->get_layer(0)->get_self_attn()->stream_capacity() == 20);
+	}
+	model.set_streaming(0, 0);
+
+	// Tensor parallelism keeps one cache per model
+	model.enable_tensor_parallel(2);
+	layer::InferenceSession session;
+	bool thrown = false;
+	try {
+		layer::UsingSession use(session);
+		model.forward_ids(prompts[0], 0);
+	} catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+	model.enable_tensor_parallel(0);
+
+	std::cout << "Llama sessions test PASSED" << std::endl << std::endl;
+}
+
+void test_yolov5_threads_share_weights() {
+	std::cout << "=== Test concurrent YOLOv5 sessions on one model ===" << std::endl;
+
+	dcz::UsingConfig eval_mode("train", false);
+	dcz::UsingConfig no_grad("enable_backprop", false);
+
+	YOLOv5 model(80, 0.33f, 0.25f);
+	const size_t num_threads = 3;
+	std::vector<Variable> images;
+	std::vector<std::vector<std::vector<float>>> expected;
+	for (size_t t = 0; t < num_threads; ++t) {
+		images.emplace_back(rand({1, 3, 64, 64}));
+		std::vector<std::vector<float>> outs;
+		for (const Variable& v : model.forward_detect(images[t])) outs.push_back(v.data().raw_data());
+		expected.push_back(outs);
+	}
+
+	std::vector<float> worst(num_threads, 0.0f);
+	std::vector<std::thread> workers;
+	for (size_t t = 0; t < num_threads; ++t) {
+		workers.emplace_back([&, t] {
+			layer::InferenceSession session;
+			layer::UsingSession use(session);
+			for (int round = 0; round < 2; ++round) {
+				model.forward_detect(images[t]);
+				const std::vector<Variable>& outs = model.get_detection_outputs();
+				assert(outs.size() == 3);
+				for (size_t i = 0; i < 3; ++i)
+					worst[t] = std::max(worst[t], max_diff(outs[i].data().raw_data(), expected[t][i]));
+			}
+		});
+	}
+	for (auto& w : workers) w.join();
+	for (size_t t = 0; t < num_threads; ++t) assert(worst[t] == 0.0f);
+
+	// Outside the sessions, the model still holds the last detections of this thread
+	std::vector<float> last = model.get_detection_outputs()[0].data().raw_data();
+	assert(max_diff(last, expected[num_threads - 1][0]) == 0.0f);
+
+	std::cout << "YOLOv5 sessions test PASSED" << std::endl << std::endl;
+}
+
+int main() {
+	test_config_per_thread();
+	test_llama_threads_share_weights();
+	test_yolov5_threads_share_weights();
+
+	std::cout << "All inference session tests PASSED!" << std::endl;
+	return 0;
+}
@@ -72,5 +72,19 @@ int main() {
 		std::string output = tokenizer.decode(generated);
 		std::cout << "\nOutput: " << output << std::endl;
 	}
+
+	// 7. Same prompt streamed: text is printed as tokens arrive
+	std::cout << "\nStreaming: " << std::flush;
+	IncrementalDetokenizer detok(tokenizer);
+	GenerationStats stats;
+	generate_stream(model, token_ids, [&](int token) {
+		std::cout << detok.push(token) << std::flush;
+		return true;
+	}, config, &stats);
+	std::cout << detok.flush() << std::endl;
+	std::cout << "TTFT " << stats.time_to_first_token_ms << " ms, prefill "
+			  << stats.prefill_tokens_per_sec() << " tok/s, decode " << stats.decode_tokens_per_sec()
+			  << " tok/s, p50 / p99 " << stats.latency_percentile(50) << " / "
+			  << stats.latency_percentile(99) << " ms" << std::endl;
 	return 0;
 }
@@ -1,5 +1,6 @@
 #include "deepczero.hpp"
 #include "utils/rope.hpp"
+#include "utils/rmsnorm.hpp"
 
 #include <iostream>
 #include <cmath>
@@ -206,6 +207,48 @@ void test_llama_rmsnorm_layer() {
 	std::cout << "LlamaRMSNorm layer test PASSED" << std::endl << std::endl;
 }
 
+void test_fused_add_rmsnorm_and_rope() {
+	std::cout << "=== Test fused add+RMSNorm and in-place RoPE kernels ===" << std::endl;
+
+	// Odd hidden size exercises the vector body and the remainder
+	size_t rows = 5, hidden = 37;
+	std::vector<float> x(rows * hidden), d(rows * hidden), w(hidden);
+	for (size_t i = 0; i < x.size(); ++i) {
+		x[i] = std::sin(0.37f * i);
+		d[i] = 0.5f * std::cos(0.11f * i);
+	}
+	for (size_t h = 0; h < hidden; ++h) w[h] = 0.5f + 0.03f * h;
+
+	std::vector<float> sum(x.size());
+	for (size_t i = 0; i < x.size(); ++i) sum[i] = x[i] + d[i];
+	auto f = std::make_shared<function::RMSNorm>(1e-5f);
+	Variable ref = (*f)({Variable(Tensor<>({1, rows, hidden}, sum)), Variable(Tensor<>({hidden}, w))});
+
+	std::vector<float> residual = x, out(x.size());
+	add_rmsnorm_cpu(residual.data(), d.data(), w.data(), out.data(), rows, hidden, 1e-5f);
+	for (size_t i = 0; i < x.size(); ++i) {
+		assert(residual[i] == sum[i]);
+		assert(std::abs(out[i] - ref.data().raw_data()[i]) < 1e-5f);
+	}
+
+	// rope_rotate_row in place == apply_rope
+	size_t seq = 3, heads = 2, head_dim = 8, offset = 4;
+	auto [cos_t, sin_t] = precompute_rope_frequencies(head_dim, 16, 10000.0f);
+	std::vector<float> q(seq * heads * head_dim);
+	for (size_t i = 0; i < q.size(); ++i) q[i] = std::cos(0.7f * i);
+	Variable expected = apply_rope(Variable(Tensor<>({1, seq, heads, head_dim}, q)), cos_t, sin_t, offset);
+	for (size_t s = 0; s < seq; ++s) {
+		float* row = q.data() + s * heads * head_dim;
+		rope_rotate_row(row, row, heads, head_dim,
+						cos_t.raw_data().data() + (offset + s) * head_dim,
+						sin_t.raw_data().data() + (offset + s) * head_dim);
+	}
+	for (size_t i = 0; i < q.size(); ++i)
+		assert(std::abs(q[i] - expected.data().raw_data()[i]) < 1e-6f);
+
+	std::cout << "Fused add+RMSNorm and RoPE kernels test PASSED" << std::endl << std::endl;
+}
+
 int main() {
 	dcz::UsingConfig no_grad("enable_backprop", false);
 
@@ -214,6 +257,7 @@ int main() {
 	test_embedding();
 	test_rope();
 	test_llama_rmsnorm_layer();
+	test_fused_add_rmsnorm_and_rope();
 
 	std::cout << "All Phase 1 tests PASSED!" << std::endl;
 	return 0;
@@ -0,0 +1,181 @@
+#include "deepczero.hpp"
+#include "utils/generate.hpp"
+#include "utils/numa.hpp"
+#include "../../llama_test_util.hpp"
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+
+void test_cpu_list() {
+	std::cout << "=== Test cpulist parsing and node discovery ===" << std::endl;
+
+	assert(parse_cpu_list("") == std::vector<int>());
+	assert(parse_cpu_list("5\n") == std::vector<int>({5}));
+	assert(parse_cpu_list("0-3,8,10-11") == std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+
+	std::vector<NumaNode> nodes = numa_nodes();
+	assert(!nodes.empty());
+	for (const NumaNode& node : nodes) {
+		assert(!node.cpus.empty());
+		std::cout << "node " << node.id << ": " << node.cpus.size() << " CPUs" << std::endl;
+	}
+
+	std::cout << "cpulist test PASSED" << std::endl << std::endl;
+}
+
+// Prefill + decode steps with and without the groups; same weights, same tokens
+void check_matches(LlamaForCausalLM& model, size_t num_groups, float tolerance) {
+	std::vector<int> prompt = make_tokens(20, 2);
+	std::vector<int> steps = make_tokens(6, 9);
+
+	auto run = [&] {
+		model.reset_cache();
+		std::vector<float> logits = model.forward_ids(prompt, 0).data().raw_data();
+		for (size_t t = 0; t < steps.size(); ++t) {
+			std::vector<float> step = model.forward_ids({steps[t]}, prompt.size() + t).data().raw_data();
+			logits.insert(logits.end(), step.begin(), step.end());
+		}
+		assert(model.cache_len() == prompt.size() + steps.size());
+		return logits;
+	};
+
+	model.enable_tensor_parallel(0);
+	std::vector<float> reference = run();
+	// Installed directly: enable_tensor_parallel(1) stays in-thread
+	auto llama = model.get_model();
+	llama->set_tensor_parallel(std::make_shared<layer::LlamaTensorParallel>(*llama, num_groups));
+	// The groups hold the only copy of the projection weights
+	for (size_t l = 0; l < llama->get_num_layers(); ++l) {
+		assert(!llama->get_layer(l)->get_self_attn()->is_fused());
+		assert(!llama->get_layer(l)->get_self_attn()->get_o_proj()->is_packed());
+		assert(!llama->get_layer(l)->get_mlp()->is_fused());
+		assert(!llama->get_layer(l)->get_mlp()->get_down_proj()->is_packed());
+	}
+	std::vector<float> sharded = run();
+	model.enable_tensor_parallel(0);
+	// and hand them back byte for byte
+	assert(llama->get_layer(0)->get_self_attn()->is_fused() && llama->get_layer(0)->get_mlp()->is_fused());
+	assert(run() == reference);
+
+	float worst = max_diff(reference, sharded);
+	std::cout << num_groups << " groups, " << kv_cache_format_name(model.get_kv_cache_format())
+			  << " cache: max logit difference " << worst << std::endl;
+	assert(worst < tolerance);
+}
+
+void test_matches_single_group() {
+	std::cout << "=== Test sharded layers == unsharded forward ===" << std::endl;
+
+	LlamaForCausalLM model = tiny_llama();
+	model.pack_weights(PackedFormat::BF16);
+	for (size_t groups : {1, 2}) check_matches(model, groups, 1e-3f);
+
+	// 4 KV heads over 3 groups (2 + 1 + 1); 96 intermediate = 3 units of 32, so with
+	// 4 groups one of them has no MLP share
+	LlamaForCausalLM uneven(100, 64, 2, 4, 4, 96, 128, 500000.0f, 1e-5f);
+	uneven.pack_weights(PackedFormat::BF16);
+	for (size_t groups : {3, 4}) check_matches(uneven, groups, 1e-3f);
+
+	// Quantized caches: each group quantizes its own heads the same way
+	model.set_kv_cache_format(KVCacheFormat::INT8);
+	check_matches(model, 2, 1e-3f);
+	model.set_kv_cache_format(KVCacheFormat::F32);
+
+	std::cout << "Sharded forward test PASSED" << std::endl << std::endl;
+}
+
+void test_cache_operations() {
+	std::cout << "=== Test cache operations and generation with groups ===" << std::endl;
+
+	LlamaForCausalLM model = tiny_llama();
+	model.pack_weights(PackedFormat::BF16);
+	std::vector<int> prompt = make_tokens(16, 5);
+
+	GenerationConfig config;
+	config.max_new_tokens = 24;
+	config.eos_token_id = -1;
+	config.prefill_chunk_size = 5;
+	std::vector<int> expected = generate(model, prompt, config);
+
+	model.enable_tensor_parallel(2);
+	assert(model.get_model()->get_tensor_parallel()->num_groups() == 2);
+	for (size_t g = 0; g < 2; ++g) {
+		const auto& info = model.get_model()->get_tensor_parallel()->group_info(g);
+		assert(info.kv_head_end - info.kv_head_begin == 1);
+		assert(info.inter_end - info.inter_begin == 64);
+		assert(info.weight_bytes > 0);
+	}
+	std::vector<int> out = generate(model, prompt, config);
+	assert(out == expected);
+
+	// Truncating rolls the sharded caches back like the unsharded ones
+	model.reset_cache();
+	std::vector<float> full = model.forward_ids(prompt, 0).data().raw_data();
+	model.reset_cache();
+	model.forward_ids(prompt, 0);
+	model.truncate_cache(10);
+	assert(model.cache_len() == 10);
+	std::vector<int> tail(prompt.begin() + 10, prompt.end());
+	std::vector<float> redo = model.forward_ids(tail, 10).data().raw_data();
+	std::vector<float> full_tail(full.begin() + 10 * 100, full.end());
+	assert(max_diff(redo, full_tail) < 1e-4f);
+
+	for (int op = 0; op < 3; ++op) {
+		bool thrown = false;
+		try {
+			if (op == 0) model.fork_cache(2);
+			if (op == 1) model.shift_cache(4);
+			if (op == 2) model.set_streaming(4, 16);
+		} catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+	// The model cannot repack or save weights it does not hold
+	bool repacked = false;
+	try {
+		model.pack_weights(PackedFormat::BF16);
+		repacked = true;
+	} catch (const std::runtime_error&) {}
+	assert(!repacked);
+	model.enable_tensor_parallel(0);
+	assert(!model.get_model()->get_tensor_parallel());
+	assert(model.cache_len() == 0);
+
+	// A single group falls back to the in-thread path
+	model.enable_tensor_parallel(1);
+	assert(!model.get_model()->get_tensor_parallel());
+	assert(generate(model, prompt, config) == expected);
+
+	bool thrown = false;
+	try {
+		model.enable_tensor_parallel(3);  // only 2 KV heads
+	} catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	LlamaForCausalLM unpacked = tiny_llama();
+	thrown = false;
+	try {
+		unpacked.enable_tensor_parallel(2);
+	} catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	std::cout << "Cache operations test PASSED" << std::endl << std::endl;
+}
+
+int main() {
+	dcz::UsingConfig eval_mode("train", false);
+	dcz::UsingConfig no_grad("enable_backprop", false);
+
+	test_cpu_list();
+	test_matches_single_group();
+	test_cache_operations();
+
+	std::cout << "All tensor parallel tests PASSED!" << std::endl;
+	return 0;
+}
@@ -0,0 +1,131 @@
+#include "deepczero.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+using namespace tensor;
+
+static uint32_t float_bits(float f) {
+	uint32_t u;
+	std::memcpy(&u, &f, sizeof(u));
+	return u;
+}
+
+static float bits_float(uint32_t u) {
+	float f;
+	std::memcpy(&f, &u, sizeof(f));
+	return f;
+}
+
+static std::vector<float> make_values(size_t n) {
+	std::vector<float> v(n);
+	for (size_t i = 0; i < n; ++i)
+		v[i] = std::sin(0.91f * i) * std::exp(0.01f * static_cast<float>(i % 300) - 1.5f);
+	return v;
+}
+
+void test_scalar_conversions() {
+	std::cout << "=== Test scalar bf16 / fp16 conversions ===" << std::endl;
+
+	// bf16: round to nearest even on the dropped 16 bits
+	assert(fp32_to_bf16(1.0f) == 0x3f80);
+	assert(fp32_to_bf16(bits_float(0x3f808000)) == 0x3f80);  // tie, even stays
+	assert(fp32_to_bf16(bits_float(0x3f818000)) == 0x3f82);  // tie, odd rounds up
+	assert(fp32_to_bf16(bits_float(0x3f808001)) == 0x3f81);
+	assert(fp32_to_bf16(-2.5f) == 0xc020);
+	assert(bf16_to_fp32(0x3f80) == 1.0f);
+	assert(std::isinf(bf16_to_fp32(fp32_to_bf16(std::numeric_limits<float>::infinity()))));
+	assert(std::isnan(bf16_to_fp32(fp32_to_bf16(std::numeric_limits<float>::quiet_NaN()))));
+	// NaN with payload only in the low bits must not turn into inf
+	assert(std::isnan(bf16_to_fp32(fp32_to_bf16(bits_float(0x7f800001)))));
+
+	// fp16
+	assert(fp32_to_fp16(1.0f) == 0x3c00);
+	assert(fp32_to_fp16(65504.0f) == 0x7bff);
+	assert(fp32_to_fp16(1e5f) == 0x7c00);
+	assert(fp32_to_fp16(std::ldexp(1.0f, -24)) == 0x0001);
+	assert(fp16_to_fp32(0x0001) == std::ldexp(1.0f, -24));
+	assert(fp16_to_fp32(0xc000) == -2.0f);
+
+	// Storage types convert implicitly through float
+	bf16 b = 3.0f;
+	fp16 h = 0.5f;
+	assert(static_cast<float>(b) == 3.0f && b.bits == 0x4040);
+	assert(static_cast<float>(h) == 0.5f && h.bits == 0x3800);
+
+	std::cout << "Scalar conversions test PASSED" << std::endl << std::endl;
+}
+
+void test_bulk_conversions() {
+	std::cout << "=== Test bulk conversions match scalar ===" << std::endl;
+
+	// Odd length exercises the SIMD body and the scalar tail
+	std::vector<float> src = make_values(1037);
+	size_t n = src.size();
+
+	std::vector<bf16> b(n);
+	std::vector<fp16> h(n);
+	fp32_to_bf16_row(src.data(), b.data(), n);
+	fp32_to_fp16_row(src.data(), h.data(), n);
+	for (size_t i = 0; i < n; ++i) {
+		assert(b[i].bits == fp32_to_bf16(src[i]));
+		assert(h[i].bits == fp32_to_fp16(src[i]));
+	}
+
+	std::vector<float> back_b(n), back_h(n);
+	bf16_to_fp32_row(b.data(), back_b.data(), n);
+	fp16_to_fp32_row(h.data(), back_h.data(), n);
+	for (size_t i = 0; i < n; ++i) {
+		assert(float_bits(back_b[i]) == float_bits(bf16_to_fp32(b[i].bits)));
+		assert(float_bits(back_h[i]) == float_bits(fp16_to_fp32(h[i].bits)));
+		// bf16 keeps 8 mantissa bits, fp16 keeps 11
+		assert(std::abs(back_b[i] - src[i]) <= std::abs(src[i]) * std::ldexp(1.0f, -8));
+		assert(std::abs(back_h[i] - src[i]) <= std::abs(src[i]) * std::ldexp(1.0f, -11) + std::ldexp(1.0f, -25));
+	}
+
+	std::cout << "Bulk conversions test PASSED" << std::endl << std::endl;
+}
+
+void test_half_tensor() {
+	std::cout << "=== Test Tensor<bf16> / Tensor<fp16> ===" << std::endl;
+
+	Tensor<> x({6, 10}, make_values(60));
+
+	Tensor<bf16> xb = to_bf16(x);
+	Tensor<fp16> xh = to_fp16(x);
+	assert(xb.get_shape() == x.get_shape());
+	assert(xb.raw_data().size() * sizeof(bf16) == x.raw_data().size() * sizeof(float) / 2);
+
+	Tensor<> rb = to_fp32(xb);
+	Tensor<> rh = to_fp32(xh);
+	for (size_t i = 0; i < 60; ++i) {
+		float v = x.raw_data()[i];
+		assert(std::abs(rb.raw_data()[i] - v) <= std::abs(v) * std::ldexp(1.0f, -8));
+		assert(std::abs(rh.raw_data()[i] - v) <= std::abs(v) * std::ldexp(1.0f, -11) + std::ldexp(1.0f, -25));
+	}
+
+	// Views work on 16-bit storage like on float
+	Tensor<> t = to_fp32(xb.transpose({1, 0}).contiguous());
+	assert(t.get_shape() == std::vector<size_t>({10, 6}));
+	for (size_t i = 0; i < 6; ++i)
+		for (size_t j = 0; j < 10; ++j)
+			assert(t({j, i}) == rb({i, j}));
+
+	Tensor<bf16> rows = xb.slice(0, 2, 4);
+	assert(to_fp32(rows).get_shape() == std::vector<size_t>({2, 10}));
+	assert(to_fp32(rows)({1, 3}) == rb({3, 3}));
+
+	std::cout << "Tensor<bf16> / Tensor<fp16> test PASSED" << std::endl << std::endl;
+}
+
+int main() {
+	test_scalar_conversions();
+	test_bulk_conversions();
+	test_half_tensor();
+
+	std::cout << "All half precision tests PASSED!" << std::endl;
+	return 0;
+}
@@ -0,0 +1,328 @@
+#include "deepczero.hpp"
+#include "cnpy.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+using namespace tensor;
+
+static Tensor<> make_weight(size_t in, size_t out, int seed) {
+	std::vector<float> data(in * out);
+	for (size_t i = 0; i < data.size(); ++i)
+		data[i] = std::sin(0.37f * i + seed) * 0.5f;
+	return Tensor<>({in, out}, data);
+}
+
+static Tensor<> make_input(size_t m, size_t in) {
+	std::vector<float> data(m * in);
+	for (size_t i = 0; i < data.size(); ++i)
+		data[i] = std::cos(0.11f * i) - 0.2f;
+	return Tensor<>({1, m, in}, data);
+}
+
+static float max_abs_diff(const Tensor<>& a, const Tensor<>& b) {
+	const auto& x = a.raw_data();
+	const auto& y = b.raw_data();
+	assert(x.size() == y.size());
+	float d = 0.0f;
+	for (size_t i = 0; i < x.size(); ++i) d = std::max(d, std::abs(x[i] - y[i]));
+	return d;
+}
+
+void test_packed_f32() {
+	std::cout << "=== Test PackedTensor f32 ===" << std::endl;
+
+	Tensor<> W = make_weight(96, 40, 1);
+	PackedTensor p = PackedTensor::from_linear_weight(W, PackedFormat::F32);
+	assert(p.get_rows() == 40 && p.get_cols() == 96);
+	assert(p.nbytes() == 40 * 96 * sizeof(float));
+	assert(max_abs_diff(p.unpack(), W.transpose({1, 0}).contiguous()) == 0.0f);
+
+	// GEMV and GEMM against dot(x, W)
+	for (size_t m : {1, 5, 33}) {
+		Tensor<> x = make_input(m, 96);
+		Tensor<> ref = dot(x, W);
+		Tensor<> y = packed_linear(x, p);
+		assert(y.get_shape() == ref.get_shape());
+		assert(max_abs_diff(y, ref) < 1e-4f);
+	}
+
+	// Bias
+	Tensor<> bias({40}, 0.5f);
+	Tensor<> x = make_input(3, 96);
+	Tensor<> y = packed_linear(x, p, bias);
+	Tensor<> ref = dot(x, W);
+	for (size_t i = 0; i < ref.raw_data().size(); ++i)
+		assert(std::abs(y.raw_data()[i] - ref.raw_data()[i] - 0.5f) < 1e-4f);
+
+	std::cout << "PackedTensor f32 test PASSED" << std::endl << std::endl;
+}
+
+void test_packed_q8_0() {
+	std::cout << "=== Test PackedTensor q8_0 ===" << std::endl;
+
+	Tensor<> W = make_weight(128, 48, 2);
+	PackedTensor p = PackedTensor::from_linear_weight(W, PackedFormat::Q8_0);
+	// 34 bytes per 32 weights
+	assert(p.nbytes() == 48 * 128 / 32 * 34);
+
+	// Round trip error: half a quantization step (amax / 254) + fp16 scale rounding (amax * 2^-11)
+	float err = max_abs_diff(p.unpack(), W.transpose({1, 0}).contiguous());
+	std::cout << "q8_0 max dequant error: " << err << std::endl;
+	assert(err < 0.5f / 254.0f + 0.5f / 2048.0f);
+
+	// Kernels match the dequantized matrix exactly up to fp32 rounding
+	Tensor<> W_deq = p.unpack().transpose({1, 0}).contiguous();
+	for (size_t m : {1, 4, 17}) {
+		Tensor<> x = make_input(m, 128);
+		Tensor<> y = packed_linear(x, p);
+		assert(max_abs_diff(y, dot(x, W_deq)) < 1e-4f);
+		std::cout << "m=" << m << " drift vs fp32: " << max_abs_diff(y, dot(x, W)) << std::endl;
+	}
+
+	// cols must be a multiple of the block size
+	bool thrown = false;
+	try {
+		PackedTensor::from_linear_weight(make_weight(40, 8, 0), PackedFormat::Q8_0);
+	} catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	std::cout << "PackedTensor q8_0 test PASSED" << std::endl << std::endl;
+}
+
+void test_packed_16bit() {
+	std::cout << "=== Test PackedTensor bf16 / f16 ===" << std::endl;
+
+	// 100 cols: 16-bit rows have no block constraint and exercise the kernel tails
+	Tensor<> W = make_weight(100, 36, 4);
+	Tensor<> W_t = W.transpose({1, 0}).contiguous();
+
+	for (PackedFormat format : {PackedFormat::BF16, PackedFormat::F16}) {
+		PackedTensor p = PackedTensor::from_linear_weight(W, format);
+		assert(p.nbytes() == 36 * 100 * 2);
+
+		// Storage rounding only: 2^-9 (bf16) / 2^-12 (f16) relative
+		float rel = format == PackedFormat::BF16 ? std::ldexp(1.0f, -9) : std::ldexp(1.0f, -12);
+		float err = max_abs_diff(p.unpack(), W_t);
+		std::cout << packed_format_name(format) << " max storage error: " << err << std::endl;
+		assert(err <= 0.5f * rel * 1.0001f);
+
+		// fp32 accumulation over the widened weights (GEMV and tiled GEMM)
+		Tensor<> W_deq = p.unpack().transpose({1, 0}).contiguous();
+		for (size_t m : {1, 7}) {
+			Tensor<> x = make_input(m, 100);
+			assert(max_abs_diff(packed_linear(x, p), dot(x, W_deq)) < 1e-4f);
+		}
+	}
+
+	// Tensor<bf16> rows pack without going through fp32
+	PackedTensor from_bf16 = PackedTensor::from_rows(to_bf16(W_t));
+	PackedTensor from_f32 = PackedTensor::from_linear_weight(W, PackedFormat::BF16);
+	assert(from_bf16.get_format() == PackedFormat::BF16);
+	assert(std::memcmp(from_bf16.row_ptr(0), from_f32.row_ptr(0), from_f32.nbytes()) == 0);
+	PackedTensor from_f16 = PackedTensor::from_rows(to_fp16(W_t));
+	assert(from_f16.get_format() == PackedFormat::F16 && from_f16.get_cols() == 100);
+
+	std::cout << "PackedTensor bf16 / f16 test PASSED" << std::endl << std::endl;
+}
+
+void test_packed_q4() {
+	std::cout << "=== Test PackedTensor q4_0 / q4_1 ===" << std::endl;
+
+	Tensor<> W = make_weight(160, 24, 3);
+	Tensor<> W_t = W.transpose({1, 0}).contiguous();
+
+	for (PackedFormat format : {PackedFormat::Q4_0, PackedFormat::Q4_1}) {
+		PackedTensor p = PackedTensor::from_linear_weight(W, format);
+		size_t block_bytes = format == PackedFormat::Q4_0 ? 18 : 20;
+		assert(p.nbytes() == 24 * 160 / 32 * block_bytes);
+
+		// q4_0: step amax / 8, and a full step on the side opposite the max (q = 16 clamps to 15)
+		// q4_1: half of range / 15 (range <= 2 * amax)
+		float bound = format == PackedFormat::Q4_0 ? 0.5f / 8.0f : 0.5f * 1.0f / 15.0f;
+		float err = max_abs_diff(p.unpack(), W_t);
+		std::cout << packed_format_name(format) << " max dequant error: " << err << std::endl;
+		assert(err < bound + 0.5f / 1024.0f);
+
+		// Kernels match the dequantized matrix (GEMV and tiled GEMM); the AVX2 path
+		// also rounds activations to int8 blocks (half a step, amax / 254, per element)
+		Tensor<> W_deq = p.unpack().transpose({1, 0}).contiguous();
+		for (size_t m : {1, 3, 20}) {
+			Tensor<> x = make_input(m, 160);
+			Tensor<> y = packed_linear(x, p);
+			float kernel_err = max_abs_diff(y, dot(x, W_deq));
+			assert(kernel_err < 5e-2f);
+			std::cout << "m=" << m << " kernel error: " << kernel_err
+					  << ", drift vs fp32: " << max_abs_diff(y, dot(x, W)) << std::endl;
+		}
+
+		// Loading the raw bytes back gives an identical tensor
+		PackedTensor q = PackedTensor::from_packed_bytes(p.row_ptr(0), p.get_rows(), p.get_cols(), format);
+		assert(max_abs_diff(q.unpack(), p.unpack()) == 0.0f);
+	}
+
+	// All-zero blocks quantize to exact zeros
+	Tensor<> zeros({32, 4}, 0.0f);
+	for (PackedFormat format : {PackedFormat::Q4_0, PackedFormat::Q4_1})
+		assert(max_abs_diff(PackedTensor::from_linear_weight(zeros, format).unpack(), Tensor<>({4, 32}, 0.0f)) == 0.0f);
+
+	assert(packed_format_from_name("q4") == PackedFormat::Q4_0);
+	assert(packed_format_from_name("q4_1") == PackedFormat::Q4_1);
+
+	std::cout << "PackedTensor q4 test PASSED" << std::endl << std::endl;
+}
+
+void test_packed_concat_and_swiglu() {
+	std::cout << "=== Test PackedTensor concat_rows / concat_columns / swiglu epilogue ===" << std::endl;
+
+	Tensor<> W_gate = make_weight(64, 40, 6);
+	Tensor<> W_up = make_weight(64, 40, 7);
+
+	for (PackedFormat format : {PackedFormat::F32, PackedFormat::BF16, PackedFormat::Q8_0, PackedFormat::Q4_0}) {
+		PackedTensor gate = PackedTensor::from_linear_weight(W_gate, format);
+		PackedTensor up = PackedTensor::from_linear_weight(W_up, format);
+		PackedTensor gate_up = PackedTensor::concat_rows({gate, up});
+		assert(gate_up.get_rows() == 80 && gate_up.nbytes() == gate.nbytes() + up.nbytes());
+
+		// Row slices are views into the fused storage
+		PackedTensor up_view = gate_up.row_slice(40, 80);
+		assert(up_view.row_ptr(0) == gate_up.row_ptr(40));
+		assert(max_abs_diff(up_view.unpack(), up.unpack()) == 0.0f);
+
+		// Column blocks joined back are the original rows
+		PackedTensor joined = PackedTensor::concat_columns({gate.column_slice(0, 32), gate.column_slice(32, 64)});
+		assert(joined.get_cols() == 64 && joined.nbytes() == gate.nbytes());
+		assert(std::memcmp(joined.row_ptr(0), gate.row_ptr(0), gate.nbytes()) == 0);
+
+		// Fused epilogue == silu(x @ gate) * (x @ up) from two separate GEMMs
+		for (size_t m : {1, 6}) {
+			Tensor<> x = make_input(m, 64);
+			Tensor<> g = packed_linear(x, gate);
+			Tensor<> u = packed_linear(x, up);
+			std::vector<float> h(m * 40);
+			packed_matmul_swiglu(x.raw_data().data(), m, gate_up, h.data());
+			for (size_t i = 0; i < h.size(); ++i) {
+				float gi = g.raw_data()[i];
+				float ref = gi / (1.0f + std::exp(-gi)) * u.raw_data()[i];
+				assert(std::abs(h[i] - ref) < 1e-5f);
+			}
+		}
+	}
+
+	std::cout << "PackedTensor concat_rows / swiglu test PASSED" << std::endl << std::endl;
+}
+
+void test_linear_load_packed() {
+	std::cout << "=== Test Linear::load_packed_from_npz ===" << std::endl;
+
+	dcz::UsingConfig no_grad("enable_backprop", false);
+
+	layer::Linear fc(32, /*nobias=*/true, 64);
+	Variable x(make_input(2, 64));
+	fc(x);
+	PackedTensor p = PackedTensor::from_linear_weight(fc.get_param("W").data(), PackedFormat::Q4_0);
+
+	// Same layout scripts/quantize_llama_weights.py writes: uint8 [out, row_bytes]
+	size_t row_bytes = p.nbytes() / p.get_rows();
+	cnpy::NpyArray arr({p.get_rows(), row_bytes}, 1, false);
+	std::copy(p.row_ptr(0), p.row_ptr(0) + p.nbytes(), arr.data<uint8_t>());
+	cnpy::npz_t npz;
+	npz["fc.W_q4_0"] = arr;
+
+	layer::Linear loaded(32, /*nobias=*/true);
+	assert(loaded.load_packed_from_npz(npz, "fc"));
+	assert(!loaded.load_packed_from_npz(npz, "missing"));
+	assert(loaded.is_packed());
+	assert(loaded.get_packed()->get_format() == PackedFormat::Q4_0);
+	assert(loaded.get_packed()->get_cols() == 64);
+
+	Tensor<> ref = packed_linear(x.data(), p);
+	assert(max_abs_diff(loaded(x).data(), ref) == 0.0f);
+
+	// A layer that already knows its input size rejects a weight of another width
+	layer::Linear narrow(32, /*nobias=*/true, 48);
+	bool thrown = false;
+	try {
+		narrow.load_packed_from_npz(npz, "fc");
+	} catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+	assert(!narrow.is_packed());
+
+	// Repacking an already packed weight converts between formats
+	size_t bytes = loaded.pack_weight(PackedFormat::F32);
+	assert(bytes == 32 * 64 * sizeof(float));
+	Tensor<> W_deq = p.unpack().transpose({1, 0}).contiguous();
+	assert(max_abs_diff(loaded(x).data(), dot(x.data(), W_deq)) < 1e-4f);
+
+	std::cout << "Linear::load_packed_from_npz test PASSED" << std::endl << std::endl;
+}
+
+void test_linear_load_bf16() {
+	std::cout << "=== Test Linear::load_params_from_npz with bf16 weights ===" << std::endl;
+
+	dcz::UsingConfig no_grad("enable_backprop", false);
+
+	// convert_llama_weights.py --dtype bf16: HF [out, in] rows as raw uint16 bits
+	Tensor<> W = make_weight(64, 48, 5);
+	Tensor<bf16> rows = to_bf16(W.transpose({1, 0}).contiguous());
+	cnpy::NpyArray arr({48, 64}, sizeof(uint16_t), false);
+	std::copy(rows.raw_data().begin(), rows.raw_data().end(), arr.data<bf16>());
+	cnpy::npz_t npz;
+	npz["fc.W_bf16"] = arr;
+
+	layer::Linear fc(48, /*nobias=*/true);
+	fc.load_params_from_npz(npz, "fc");
+	assert(fc.is_packed());
+	assert(fc.get_packed()->get_format() == PackedFormat::BF16);
+	assert(fc.get_packed()->nbytes() == 48 * 64 * 2);
+	assert(fc.get_param("W").data().empty());
+
+	Variable x(make_input(3, 64));
+	Tensor<> ref = dot(x.data(), to_fp32(rows).transpose({1, 0}).contiguous());
+	assert(max_abs_diff(fc(x).data(), ref) < 1e-4f);
+
+	std::cout << "Linear bf16 load test PASSED" << std::endl << std::endl;
+}
+
+void test_linear_pack_weight() {
+	std::cout << "=== Test Linear::pack_weight ===" << std::endl;
+
+	dcz::UsingConfig no_grad("enable_backprop", false);
+
+	layer::Linear fc(64, /*nobias=*/true, 128);
+	Variable x(make_input(2, 128));
+	Variable ref = fc(x);
+
+	size_t bytes = fc.pack_weight(PackedFormat::Q8_0);
+	assert(fc.is_packed());
+	assert(bytes == 64 * 128 / 32 * 34);
+	assert(fc.get_param("W").data().empty());
+
+	Variable y = fc(x);
+	float drift = max_abs_diff(y.data(), ref.data());
+	std::cout << "Linear q8_0 drift: " << drift << std::endl;
+	assert(drift < 0.05f);
+
+	std::cout << "Linear::pack_weight test PASSED" << std::endl << std::endl;
+}
+
+int main() {
+	test_packed_f32();
+	test_packed_q8_0();
+	test_packed_16bit();
+	test_packed_q4();
+	test_packed_concat_and_swiglu();
+	test_linear_load_packed();
+	test_linear_load_bf16();
+	test_linear_pack_weight();
+
+	std::cout << "All packed tensor tests PASSED!" << std::endl;
+	return 0;
+}
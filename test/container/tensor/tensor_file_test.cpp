@@ -0,0 +1,237 @@
+#include "deepczero.hpp"
+#include "json.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace tensor;
+using json = nlohmann::json;
+
+static std::vector<float> make_values(size_t n) {
+	std::vector<float> v(n);
+	for (size_t i = 0; i < n; ++i)
+		v[i] = std::sin(0.37f * i) * (1.0f + 0.01f * static_cast<float>(i % 17));
+	return v;
+}
+
+void test_roundtrip() {
+	std::cout << "=== Test tensor file round trip ===" << std::endl;
+
+	const std::string path = "/tmp/dcz_tensor_file_test.dczt";
+	Tensor<> norm({48}, make_values(48));
+	std::vector<float> w = make_values(64 * 64);
+	PackedTensor q8 = PackedTensor::from_rows(w.data(), 64, 64, PackedFormat::Q8_0);
+	PackedTensor bf = PackedTensor::from_rows(w.data(), 64, 48, PackedFormat::BF16);
+
+	TensorFileWriter writer;
+	writer.add("norm.weight", norm);
+	writer.add("proj.W_q8_0", q8);
+	writer.add("proj2.W_bf16", bf);
+	size_t bytes = writer.save(path);
+
+	auto file = TensorFile::open(path);
+	assert(TensorFile::is_tensor_file(path));
+	assert(file->file_size() == bytes);
+	assert(file->get_entries().size() == 3);
+
+	// Every tensor is aligned in the mapping
+	for (const auto& e : file->get_entries())
+		assert(reinterpret_cast<uintptr_t>(file->data(e)) % TENSOR_FILE_ALIGN == 0);
+
+	// Float entries are copied out
+	Tensor<> n = file->to_tensor("norm.weight");
+	assert(n.get_shape() == norm.get_shape());
+	for (size_t i = 0; i < 48; ++i) assert(n.raw_data()[i] == norm.raw_data()[i]);
+
+	// Packed weights alias the mapping and match the originals byte for byte
+	auto p = file->packed_weight("proj");
+	assert(p && p->get_format() == PackedFormat::Q8_0);
+	assert(p->get_rows() == q8.get_rows() && p->get_cols() == q8.get_cols());
+	assert(p->row_ptr(0) == file->data(*file->find("proj.W_q8_0")));
+	assert(std::memcmp(p->row_ptr(0), q8.row_ptr(0), q8.nbytes()) == 0);
+
+	auto p2 = file->packed_weight("proj2");
+	assert(p2 && p2->get_format() == PackedFormat::BF16 && p2->get_cols() == 48);
+	std::vector<float> a(48), b(48);
+	p2->dequantize_row(5, a.data());
+	bf.dequantize_row(5, b.data());
+	assert(a == b);
+	assert(!file->packed_weight("missing"));
+
+	// Views keep the mapping alive after the file handle is dropped
+	file.reset();
+	std::vector<float> y(64);
+	std::vector<float> x(p->get_cols(), 0.5f);
+	packed_matmul(x.data(), 1, *p, y.data());
+	std::vector<float> y_ref(64);
+	packed_matmul(x.data(), 1, q8, y_ref.data());
+	assert(y == y_ref);
+
+	std::remove(path.c_str());
+	std::cout << "Tensor file round trip test PASSED" << std::endl << std::endl;
+}
+
+void test_rejects_bad_files() {
+	std::cout << "=== Test tensor file validation ===" << std::endl;
+
+	const std::string path = "/tmp/dcz_tensor_file_bad.dczt";
+	{
+		std::ofstream out(path, std::ios::binary);
+		out << "not a tensor file";
+	}
+	assert(!TensorFile::is_tensor_file(path));
+	bool thrown = false;
+	try { TensorFile::open(path); } catch (const std::runtime_error&) { thrown = true; }
+	assert(thrown);
+
+	// Truncated data section
+	TensorFileWriter writer;
+	Tensor<> t({256}, make_values(256));
+	writer.add("t", t);
+	size_t bytes = writer.save(path);
+	{
+		std::ifstream in(path, std::ios::binary);
+		std::vector<char> data(bytes);
+		in.read(data.data(), bytes);
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(data.data(), bytes - 512);
+	}
+	thrown = false;
+	try { TensorFile::open(path); } catch (const std::runtime_error&) { thrown = true; }
+	assert(thrown);
+
+	std::remove(path.c_str());
+	std::cout << "Tensor file validation test PASSED" << std::endl << std::endl;
+}
+
+struct SafetensorsEntry {
+	std::string name;
+	std::string dtype;
+	std::vector<size_t> shape;
+	std::vector<uint8_t> bytes;
+};
+
+// Minimal safetensors writer: uint64 header length, JSON header, packed data
+static void write_safetensors(const std::string& path, const std::vector<SafetensorsEntry>& tensors) {
+	json header;
+	header["__metadata__"] = {{"format", "pt"}};
+	size_t offset = 0;
+	for (const auto& t : tensors) {
+		header[t.name] = {{"dtype", t.dtype}, {"shape", t.shape},
+						  {"data_offsets", {offset, offset + t.bytes.size()}}};
+		offset += t.bytes.size();
+	}
+	std::string text = header.dump();
+	uint64_t len = text.size();
+	std::ofstream out(path, std::ios::binary);
+	out.write(reinterpret_cast<const char*>(&len), sizeof(len));
+	out.write(text.data(), text.size());
+	for (const auto& t : tensors) out.write(reinterpret_cast<const char*>(t.bytes.data()), t.bytes.size());
+}
+
+template<typename T>
+static std::vector<uint8_t> as_bytes(const std::vector<T>& v) {
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(v.data());
+	return std::vector<uint8_t>(p, p + v.size() * sizeof(T));
+}
+
+void test_safetensors() {
+	std::cout << "=== Test safetensors reader ===" << std::endl;
+
+	const std::string path = "/tmp/dcz_tensor_file_test.safetensors";
+	std::vector<float> w = make_values(24 * 40);
+	std::vector<bf16> w_bf16(w.size());
+	fp32_to_bf16_row(w.data(), w_bf16.data(), w.size());
+	std::vector<float> norm = make_values(40);
+	std::vector<int64_t> ids = {0, 1, 2, 3};
+
+	write_safetensors(path, {
+		{"proj.weight", "BF16", {24, 40}, as_bytes(w_bf16)},
+		{"norm.weight", "F32", {40}, as_bytes(norm)},
+		{"position_ids", "I64", {4}, as_bytes(ids)},
+	});
+	assert(TensorFile::is_safetensors(path));
+	assert(!TensorFile::is_tensor_file(path));
+
+	auto file = TensorFile::open_safetensors(path);
+	// Unsupported dtypes are skipped
+	assert(file->get_entries().size() == 2);
+	assert(!file->contains("position_ids"));
+
+	const TensorFileEntry* e = file->find("proj.weight");
+	assert(e && e->dtype == DType::BF16 && e->shape == std::vector<size_t>({24, 40}));
+	assert(std::memcmp(file->data(*e), w_bf16.data(), e->nbytes) == 0);
+
+	Tensor<> n = file->to_tensor("norm.weight");
+	for (size_t i = 0; i < 40; ++i) assert(n.raw_data()[i] == norm[i]);
+
+	// [out, in] weights are packed rows as stored: aliasing exposes them zero-copy
+	assert(!file->packed_weight("proj"));
+	file->add_alias("proj.W_bf16", "proj.weight");
+	auto p = file->packed_weight("proj");
+	assert(p && p->get_format() == PackedFormat::BF16);
+	assert(p->get_rows() == 24 && p->get_cols() == 40);
+	assert(p->row_ptr(0) == file->data(*e));
+
+	// y = x W^T straight from the mapped rows
+	file.reset();
+	std::vector<float> x = make_values(40), y(24);
+	packed_matmul(x.data(), 1, *p, y.data());
+	for (size_t o = 0; o < 24; ++o) {
+		float ref = 0.0f;
+		for (size_t i = 0; i < 40; ++i) ref += x[i] * static_cast<float>(w_bf16[o * 40 + i]);
+		assert(std::abs(y[o] - ref) < 1e-4f);
+	}
+
+	// Shape disagreeing with data_offsets
+	write_safetensors(path, {{"t", "F32", {64}, as_bytes(make_values(32))}});
+	bool thrown = false;
+	try { TensorFile::open_safetensors(path); } catch (const std::runtime_error&) { thrown = true; }
+	assert(thrown);
+
+	std::remove(path.c_str());
+	std::cout << "Safetensors reader test PASSED" << std::endl << std::endl;
+}
+
+void test_safetensors_sharded() {
+	std::cout << "=== Test sharded safetensors checkpoint ===" << std::endl;
+
+	const std::string dir = "/tmp/";
+	const std::string index_path = dir + "dcz_tensor_file_test.safetensors.index.json";
+	std::vector<float> a = make_values(16), b = make_values(32);
+	write_safetensors(dir + "dcz_shard-00001-of-00002.safetensors", {{"a.weight", "F32", {16}, as_bytes(a)}});
+	write_safetensors(dir + "dcz_shard-00002-of-00002.safetensors", {{"b.weight", "F32", {4, 8}, as_bytes(b)}});
+	{
+		json index;
+		index["weight_map"] = {{"a.weight", "dcz_shard-00001-of-00002.safetensors"},
+							   {"b.weight", "dcz_shard-00002-of-00002.safetensors"}};
+		std::ofstream(index_path) << index.dump();
+	}
+
+	auto file = TensorFile::open_safetensors(index_path);
+	assert(file->get_entries().size() == 2);
+	assert(file->find("a.weight")->shard != file->find("b.weight")->shard);
+	Tensor<> ta = file->to_tensor("a.weight");
+	Tensor<> tb = file->to_tensor("b.weight");
+	assert(ta.raw_data() == a && tb.raw_data() == b);
+	assert(tb.get_shape() == std::vector<size_t>({4, 8}));
+
+	std::remove(index_path.c_str());
+	std::remove((dir + "dcz_shard-00001-of-00002.safetensors").c_str());
+	std::remove((dir + "dcz_shard-00002-of-00002.safetensors").c_str());
+	std::cout << "Sharded safetensors test PASSED" << std::endl << std::endl;
+}
+
+int main() {
+	test_roundtrip();
+	test_rejects_bad_files();
+	test_safetensors();
+	test_safetensors_sharded();
+
+	std::cout << "All tensor file tests PASSED!" << std::endl;
+	return 0;
+}
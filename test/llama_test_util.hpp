@@ -0,0 +1,43 @@
+#pragma once
+
+// Shared fixtures for the Llama tests under test/utils and test/container/layer.
+
+#include "deepczero.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+// Deterministic token ids in [0, 100) for the tiny model's vocabulary.
+inline std::vector<int> make_prompt(size_t len, int seed) {
+	std::vector<int> ids(len);
+	for (size_t i = 0; i < len; ++i)
+		ids[i] = static_cast<int>((i * 7 + seed) % 100);
+	return ids;
+}
+
+// Like make_prompt, with a quadratic term so long sequences do not repeat.
+inline std::vector<int> make_tokens(size_t len, int seed) {
+	std::vector<int> ids(len);
+	for (size_t i = 0; i < len; ++i)
+		ids[i] = static_cast<int>((i * 7 + i * i + seed) % 100);
+	return ids;
+}
+
+inline float max_diff(const float* a, const float* b, size_t n) {
+	float d = 0.0f;
+	for (size_t i = 0; i < n; ++i) d = std::max(d, std::abs(a[i] - b[i]));
+	return d;
+}
+
+inline float max_diff(const std::vector<float>& a, const std::vector<float>& b) {
+	assert(a.size() == b.size());
+	return max_diff(a.data(), b.data(), a.size());
+}
+
+// Randomly initialized 2-layer model: vocab 100, hidden 64, 4 heads / 2 KV heads, context 128.
+inline LlamaForCausalLM tiny_llama() {
+	return LlamaForCausalLM(100, 64, 2, 4, 2, 128, 128, 500000.0f, 1e-5f);
+}
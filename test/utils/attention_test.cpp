@@ -0,0 +1,150 @@
+#include "deepczero.hpp"
+#include "utils/attention.hpp"
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+// Reference: explicit scores + causal mask + softmax, GQA by head index
+static std::vector<float> reference_attention(const std::vector<float>& q, const std::vector<float>& k,
+											  const std::vector<float>& v, size_t seq_len, size_t offset,
+											  size_t num_heads, size_t num_kv_heads, size_t head_dim) {
+	size_t groups = num_heads / num_kv_heads;
+	size_t total = offset + seq_len;
+	float scale = 1.0f / std::sqrt(static_cast<float>(head_dim));
+	std::vector<float> out(seq_len * num_heads * head_dim, 0.0f);
+
+	for (size_t i = 0; i < seq_len; ++i) {
+		for (size_t h = 0; h < num_heads; ++h) {
+			size_t kv_h = h / groups;
+			std::vector<float> scores(total);
+			for (size_t j = 0; j < total; ++j) {
+				float s = 0.0f;
+				for (size_t d = 0; d < head_dim; ++d)
+					s += q[(i * num_heads + h) * head_dim + d] * k[(j * num_kv_heads + kv_h) * head_dim + d];
+				scores[j] = (j > offset + i) ? -1e9f : s * scale;
+			}
+			float max_s = *std::max_element(scores.begin(), scores.end());
+			float sum = 0.0f;
+			for (float& s : scores) { s = std::exp(s - max_s); sum += s; }
+			for (size_t j = 0; j < total; ++j)
+				for (size_t d = 0; d < head_dim; ++d)
+					out[(i * num_heads + h) * head_dim + d] += scores[j] / sum * v[(j * num_kv_heads + kv_h) * head_dim + d];
+		}
+	}
+	return out;
+}
+
+void test_cached_attention(size_t seq_len, size_t offset, size_t num_heads, size_t num_kv_heads, size_t head_dim) {
+	size_t total = offset + seq_len;
+	std::vector<float> q(seq_len * num_heads * head_dim);
+	std::vector<float> k(total * num_kv_heads * head_dim);
+	std::vector<float> v(total * num_kv_heads * head_dim);
+	for (size_t i = 0; i < q.size(); ++i) q[i] = std::sin(0.37f * i);
+	for (size_t i = 0; i < k.size(); ++i) k[i] = std::cos(0.11f * i) * 2.0f;
+	for (size_t i = 0; i < v.size(); ++i) v[i] = std::sin(0.05f * i + 1.0f);
+
+	std::vector<float> out(q.size());
+	cached_attention_cpu(q.data(), k.data(), v.data(), out.data(), seq_len, offset,
+						 num_heads, num_kv_heads, head_dim, 1.0f / std::sqrt(static_cast<float>(head_dim)));
+	std::vector<float> ref = reference_attention(q, k, v, seq_len, offset, num_heads, num_kv_heads, head_dim);
+
+	float max_diff = 0.0f;
+	for (size_t i = 0; i < out.size(); ++i)
+		max_diff = std::max(max_diff, std::abs(out[i] - ref[i]));
+	std::cout << "seq=" << seq_len << " offset=" << offset << " heads=" << num_heads << "/" << num_kv_heads
+			  << " head_dim=" << head_dim << " max diff " << max_diff << std::endl;
+	assert(max_diff < 1e-4f);
+}
+
+void test_kv_cache_store() {
+	std::cout << "=== Test KVCacheStore formats ===" << std::endl;
+
+	const size_t kv_heads = 2, head_dim = 16, stride = kv_heads * head_dim;
+	std::vector<float> rows(5 * stride);
+	for (size_t i = 0; i < rows.size(); ++i) rows[i] = std::sin(0.7f * i) * (1.0f + (i / head_dim) % 3);
+
+	for (KVCacheFormat format : {KVCacheFormat::F32, KVCacheFormat::F16, KVCacheFormat::INT8}) {
+		KVCacheStore store(format, 2, 4, kv_heads, head_dim);
+		for (size_t t = 0; t < 4; ++t) store.write_row(1, t, rows.data() + t * stride);
+		// Growing keeps the cached rows
+		store.grow(8, 4);
+		assert(store.get_capacity() == 8);
+		store.write_row(1, 4, rows.data() + 4 * stride);
+
+		std::vector<float> back(5 * stride);
+		store.read_rows(1, 0, 5, back.data());
+		float max_err = 0.0f;
+		for (size_t i = 0; i < rows.size(); ++i) max_err = std::max(max_err, std::abs(back[i] - rows[i]));
+		// int8: half a quantization step of the head's absmax (<= 3) / 127
+		float tol = format == KVCacheFormat::F32 ? 0.0f : format == KVCacheFormat::F16 ? 2e-3f : 3.0f / 254.0f + 1e-6f;
+		assert(max_err <= tol);
+
+		size_t expected = format == KVCacheFormat::F32 ? stride * 4
+						: format == KVCacheFormat::F16 ? stride * 2 : stride + kv_heads * 4;
+		assert(store.bytes_per_token() == expected);
+		std::cout << kv_cache_format_name(format) << ": " << store.bytes_per_token()
+				  << " bytes/token, max error " << max_err << std::endl;
+	}
+	assert(parse_kv_cache_format("int8") == KVCacheFormat::INT8);
+
+	std::cout << "KVCacheStore test PASSED" << std::endl << std::endl;
+}
+
+// Attention over compressed rows equals attention over their dequantized values
+void test_compressed_attention(KVCacheFormat format, size_t seq_len, size_t offset,
+							   size_t num_heads, size_t num_kv_heads, size_t head_dim) {
+	size_t total = offset + seq_len;
+	size_t stride = num_kv_heads * head_dim;
+	std::vector<float> q(seq_len * num_heads * head_dim), k(total * stride), v(total * stride);
+	for (size_t i = 0; i < q.size(); ++i) q[i] = std::sin(0.37f * i);
+	for (size_t i = 0; i < k.size(); ++i) k[i] = std::cos(0.11f * i) * 2.0f;
+	for (size_t i = 0; i < v.size(); ++i) v[i] = std::sin(0.05f * i + 1.0f);
+
+	KVCacheStore k_store(format, 1, total, num_kv_heads, head_dim);
+	KVCacheStore v_store(format, 1, total, num_kv_heads, head_dim);
+	for (size_t t = 0; t < total; ++t) {
+		k_store.write_row(0, t, k.data() + t * stride);
+		v_store.write_row(0, t, v.data() + t * stride);
+	}
+	std::vector<float> k_deq(k.size()), v_deq(v.size());
+	k_store.read_rows(0, 0, total, k_deq.data());
+	v_store.read_rows(0, 0, total, v_deq.data());
+
+	float scale = 1.0f / std::sqrt(static_cast<float>(head_dim));
+	std::vector<float> out(q.size());
+	cached_attention_cpu(q.data(), k_store.view(0), v_store.view(0), out.data(), seq_len, offset,
+						 num_heads, num_kv_heads, head_dim, scale);
+	std::vector<float> ref = reference_attention(q, k_deq, v_deq, seq_len, offset, num_heads, num_kv_heads, head_dim);
+	std::vector<float> exact = reference_attention(q, k, v, seq_len, offset, num_heads, num_kv_heads, head_dim);
+
+	float max_diff = 0.0f, drift = 0.0f;
+	for (size_t i = 0; i < out.size(); ++i) {
+		max_diff = std::max(max_diff, std::abs(out[i] - ref[i]));
+		drift = std::max(drift, std::abs(out[i] - exact[i]));
+	}
+	std::cout << kv_cache_format_name(format) << " seq=" << seq_len << " offset=" << offset
+			  << " max diff " << max_diff << ", drift vs f32 " << drift << std::endl;
+	assert(max_diff < 1e-4f);
+	assert(drift < (format == KVCacheFormat::INT8 ? 0.05f : 5e-3f));
+}
+
+int main() {
+	std::cout << "=== Test cached_attention_cpu vs reference ===" << std::endl;
+
+	test_cached_attention(1, 0, 2, 2, 8);      // first token
+	test_cached_attention(5, 0, 4, 2, 16);     // prefill, GQA
+	test_cached_attention(1, 100, 4, 1, 16);   // decode, MQA, multiple key tiles
+	test_cached_attention(7, 130, 8, 2, 32);   // chunk after cached prefix
+	std::cout << std::endl;
+
+	test_kv_cache_store();
+	for (KVCacheFormat format : {KVCacheFormat::F32, KVCacheFormat::F16, KVCacheFormat::INT8}) {
+		test_compressed_attention(format, 5, 0, 4, 2, 16);
+		test_compressed_attention(format, 3, 140, 8, 2, 32);
+	}
+
+	std::cout << "All attention tests PASSED!" << std::endl;
+	return 0;
+}
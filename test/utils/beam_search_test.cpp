@@ -0,0 +1,186 @@
+#include "deepczero.hpp"
+#include "utils/generate.hpp"
+#include "../llama_test_util.hpp"
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+// Log-softmax of the next token after `context`, recomputed from scratch
+static std::vector<double> next_log_probs(LlamaForCausalLM& model, const std::vector<int>& context) {
+	model.reset_cache();
+	std::vector<float> logits = model.forward_ids(context, 0, {context.size() - 1}).data().raw_data();
+	double max_logit = *std::max_element(logits.begin(), logits.end());
+	double sum = 0.0;
+	for (float x : logits) sum += std::exp(x - max_logit);
+	std::vector<double> out(logits.size());
+	for (size_t i = 0; i < logits.size(); ++i) out[i] = logits[i] - max_logit - std::log(sum);
+	return out;
+}
+
+// Reference beam search without a KV cache: every beam's history is re-run each step.
+// Same selection rules as beam_search.
+static std::vector<BeamHypothesis> reference_beam_search(LlamaForCausalLM& model, const std::vector<int>& prompt,
+														 const GenerationConfig& config) {
+	size_t W = config.num_beams;
+	auto score_of = [&](double lp, size_t len) { return lp / std::pow(static_cast<double>(len), config.length_penalty); };
+	std::vector<BeamHypothesis> finished;
+	auto add = [&](const std::vector<int>& tokens, double lp) {
+		finished.push_back({tokens, lp, score_of(lp, tokens.size())});
+		std::stable_sort(finished.begin(), finished.end(),
+						 [](const BeamHypothesis& a, const BeamHypothesis& b) { return a.score > b.score; });
+		if (finished.size() > W) finished.pop_back();
+	};
+
+	std::vector<std::pair<std::vector<int>, double>> beams = {{{}, 0.0}};
+	for (size_t step = 0; step < config.max_new_tokens; ++step) {
+		std::vector<std::tuple<double, size_t, int>> cands;
+		for (size_t b = 0; b < beams.size(); ++b) {
+			std::vector<int> context(prompt);
+			context.insert(context.end(), beams[b].first.begin(), beams[b].first.end());
+			std::vector<double> lp = next_log_probs(model, context);
+			for (size_t t = 0; t < lp.size(); ++t) cands.emplace_back(beams[b].second + lp[t], b, static_cast<int>(t));
+		}
+		std::stable_sort(cands.begin(), cands.end(),
+						 [](const auto& a, const auto& b) { return std::get<0>(a) > std::get<0>(b); });
+
+		std::vector<std::pair<std::vector<int>, double>> next;
+		for (size_t rank = 0; rank < 2 * W && next.size() < W; ++rank) {
+			auto [lp, b, token] = cands[rank];
+			std::vector<int> tokens = beams[b].first;
+			tokens.push_back(token);
+			if (token == config.eos_token_id) {
+				if (rank < W) add(tokens, lp);
+			} else {
+				next.emplace_back(tokens, lp);
+			}
+		}
+		beams = next;
+		if (finished.size() == W) {
+			if (config.early_stopping) break;
+			if (finished.back().score >= score_of(beams.front().second, step + 1)) break;
+		}
+		if (step + 1 == config.max_new_tokens) {
+			for (auto& [tokens, lp] : beams) add(tokens, lp);
+			break;
+		}
+	}
+	finished.resize(std::min(finished.size(), config.num_return_sequences));
+	return finished;
+}
+
+static void assert_same(const std::vector<BeamHypothesis>& a, const std::vector<BeamHypothesis>& b) {
+	assert(a.size() == b.size());
+	for (size_t i = 0; i < a.size(); ++i) {
+		assert(a[i].tokens == b[i].tokens);
+		assert(std::abs(a[i].log_prob - b[i].log_prob) < 1e-3);
+		assert(std::abs(a[i].score - b[i].score) < 1e-3);
+	}
+}
+
+void test_beam_search_matches_reference() {
+	std::cout << "=== Test beam search over a shared KV cache == recomputed reference ===" << std::endl;
+
+	LlamaForCausalLM model = tiny_llama();
+	std::vector<int> prompt = make_prompt(9, 5);
+
+	GenerationConfig config;
+	config.max_new_tokens = 6;
+	config.eos_token_id = -1;
+	config.num_return_sequences = 3;
+	for (size_t beams : {3, 5}) {
+		config.num_beams = beams;
+		std::vector<BeamHypothesis> got = beam_search(model, prompt, config);
+		assert(model.cache_len() == 0);
+		assert_same(got, reference_beam_search(model, prompt, config));
+		assert(got.size() == 3 && got[0].tokens.size() == 6);
+		assert(got[0].score >= got[1].score && got[1].score >= got[2].score);
+	}
+
+	// eos: use the reference's most likely first token so hypotheses finish early
+	config.num_beams = 4;
+	config.eos_token_id = reference_beam_search(model, prompt, config)[0].tokens[1];
+	for (bool early : {false, true}) {
+		config.early_stopping = early;
+		for (float penalty : {1.0f, 0.0f, 2.0f}) {
+			config.length_penalty = penalty;
+			assert_same(beam_search(model, prompt, config), reference_beam_search(model, prompt, config));
+		}
+	}
+
+	std::cout << "Beam search reference test PASSED" << std::endl << std::endl;
+}
+
+void test_single_beam_is_greedy() {
+	std::cout << "=== Test beam search with one beam == greedy ===" << std::endl;
+
+	LlamaForCausalLM model = tiny_llama();
+	std::vector<int> prompt = make_prompt(12, 1);
+
+	GenerationConfig config;
+	config.max_new_tokens = 10;
+	config.eos_token_id = -1;
+	std::vector<int> greedy = generate(model, prompt, config);
+
+	config.num_beams = 1;
+	std::vector<BeamHypothesis> beam = beam_search(model, prompt, config);
+	assert(beam.size() == 1 && beam[0].tokens == greedy);
+
+	// generate() dispatches to beam search for several beams
+	config.num_beams = 4;
+	assert(generate(model, prompt, config) == beam_search(model, prompt, config)[0].tokens);
+
+	bool thrown = false;
+	try {
+		generate_stream(model, prompt, nullptr, config);
+	} catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	std::cout << "Single beam test PASSED" << std::endl << std::endl;
+}
+
+void test_reorder_cache_shares_rows() {
+	std::cout << "=== Test reorder_cache ===" << std::endl;
+
+	LlamaForCausalLM model = tiny_llama();
+	std::vector<int> prompt = make_prompt(7, 2);
+
+	for (KVCacheFormat format : {KVCacheFormat::F32, KVCacheFormat::F16, KVCacheFormat::INT8}) {
+		model.set_kv_cache_format(format);
+
+		// Two entries diverge, then entry 1 takes over entry 0's history
+		model.reset_cache();
+		model.prefill(prompt, 0, 0);
+		model.fork_cache(2);
+		model.forward_step({11, 12}, prompt.size());
+		model.reorder_cache({0, 0});
+		std::vector<float> step = model.forward_step({13, 14}, prompt.size() + 1).data().raw_data();
+
+		for (size_t b = 0; b < 2; ++b) {
+			std::vector<int> history(prompt);
+			history.push_back(11);
+			history.push_back(b == 0 ? 13 : 14);
+			model.reset_cache();
+			std::vector<float> ref = model.forward_ids(history, 0, {history.size() - 1}).data().raw_data();
+			for (size_t i = 0; i < ref.size(); ++i)
+				assert(std::abs(step[b * ref.size() + i] - ref[i]) < 1e-4f);
+		}
+	}
+
+	std::cout << "reorder_cache test PASSED" << std::endl << std::endl;
+}
+
+int main() {
+	dcz::UsingConfig eval_mode("train", false);
+	dcz::UsingConfig no_grad("enable_backprop", false);
+
+	test_beam_search_matches_reference();
+	test_single_beam_is_greedy();
+	test_reorder_cache_shares_rows();
+
+	std::cout << "All beam search tests PASSED!" << std::endl;
+	return 0;
+}
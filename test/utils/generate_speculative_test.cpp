@@ -0,0 +1,128 @@
+#include "deepczero.hpp"
+#include "utils/generate.hpp"
+#include "../llama_test_util.hpp"
+
+#include <iostream>
+#include <cassert>
+
+// Share weights of matching parameters (same name and shape) from src into dst.
+// One forward first so the lazily created Linear weights exist.
+static void share_weights(LlamaForCausalLM& dst, LlamaForCausalLM& src) {
+	dst.forward_ids({1}, 0);
+	src.forward_ids({1}, 0);
+	auto src_params = src.flatten_params();
+	for (auto& [name, param] : dst.flatten_params()) {
+		auto it = src_params.find(name);
+		if (it != src_params.end() && it->second.shape() == param.shape())
+			param.data() = it->second.data();
+	}
+}
+
+void test_speculative_greedy_matches_target() {
+	std::cout << "=== Test speculative greedy == target greedy ===" << std::endl;
+
+	LlamaForCausalLM target = tiny_llama();
+	LlamaForCausalLM random_draft(100, 32, 1, 2, 1, 64, 128, 500000.0f, 1e-5f);
+	LlamaForCausalLM self_draft = tiny_llama();
+	share_weights(self_draft, target);
+
+	GenerationConfig config;
+	config.max_new_tokens = 13;
+	config.eos_token_id = -1;
+
+	std::vector<int> prompt = make_prompt(10, 3);
+	std::vector<int> reference = generate(target, prompt, config);
+
+	for (size_t k : {1, 3, 4}) {
+		config.num_draft_tokens = k;
+
+		SpeculativeStats stats;
+		std::vector<int> out = generate_speculative(target, random_draft, prompt, config, &stats);
+		std::cout << "random draft k=" << k << " acceptance " << stats.acceptance_rate()
+				  << " target forwards " << stats.target_forwards << std::endl;
+		assert(out == reference);
+
+		out = generate_speculative(target, self_draft, prompt, config, &stats);
+		std::cout << "self draft   k=" << k << " acceptance " << stats.acceptance_rate()
+				  << " target forwards " << stats.target_forwards << std::endl;
+		assert(out == reference);
+		assert(stats.accepted_tokens == stats.draft_tokens);
+		// 1 prefill + ceil((13 - 1) / (k + 1)) verification rounds
+		assert(stats.target_forwards == 1 + (12 + k) / (k + 1));
+	}
+
+	// generate() dispatches to the speculative path via config.draft_model
+	config.draft_model = &random_draft;
+	assert(generate(target, prompt, config) == reference);
+
+	std::cout << "Speculative greedy test PASSED" << std::endl << std::endl;
+}
+
+void test_speculative_eos_and_rollback() {
+	std::cout << "=== Test speculative EOS stop and cache rollback ===" << std::endl;
+
+	LlamaForCausalLM target = tiny_llama();
+	LlamaForCausalLM draft(100, 32, 1, 2, 1, 64, 128, 500000.0f, 1e-5f);
+
+	GenerationConfig config;
+	config.max_new_tokens = 10;
+	config.eos_token_id = -1;
+	std::vector<int> prompt = make_prompt(8, 1);
+	std::vector<int> reference = generate(target, prompt, config);
+
+	// Stop at the 4th reference token
+	config.eos_token_id = reference[3];
+	std::vector<int> stopped = generate(target, prompt, config);
+	std::vector<int> out = generate_speculative(target, draft, prompt, config);
+	assert(out == stopped);
+
+	// Target cache holds exactly prompt + generated[:-1]
+	assert(target.cache_len() == prompt.size() + out.size() - 1);
+
+	std::cout << "Speculative EOS/rollback test PASSED" << std::endl << std::endl;
+}
+
+void test_speculative_sampling() {
+	std::cout << "=== Test speculative sampling ===" << std::endl;
+
+	LlamaForCausalLM target = tiny_llama();
+	LlamaForCausalLM draft(100, 32, 1, 2, 1, 64, 128, 500000.0f, 1e-5f);
+
+	GenerationConfig config;
+	config.max_new_tokens = 12;
+	config.eos_token_id = -1;
+	config.do_sample = true;
+	config.temperature = 0.8f;
+	config.num_draft_tokens = 3;
+
+	SpeculativeStats stats;
+	std::vector<int> out = generate_speculative(target, draft, make_prompt(6, 2), config, &stats);
+	assert(out.size() == config.max_new_tokens);
+	for (int t : out) assert(t >= 0 && t < 100);
+	assert(stats.accepted_tokens <= stats.draft_tokens);
+	std::cout << "sampling acceptance " << stats.acceptance_rate() << std::endl;
+
+	// Vocab mismatch is rejected
+	LlamaForCausalLM other_vocab(50, 32, 1, 2, 1, 64, 128, 500000.0f, 1e-5f);
+	bool thrown = false;
+	try {
+		generate_speculative(target, other_vocab, make_prompt(6, 2), config);
+	} catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	std::cout << "Speculative sampling test PASSED" << std::endl << std::endl;
+}
+
+int main() {
+	dcz::UsingConfig eval_mode("train", false);
+	dcz::UsingConfig no_grad("enable_backprop", false);
+
+	test_speculative_greedy_matches_target();
+	test_speculative_eos_and_rollback();
+	test_speculative_sampling();
+
+	std::cout << "All speculative decoding tests PASSED!" << std::endl;
+	return 0;
+}
@@ -0,0 +1,93 @@
+#include "deepczero.hpp"
+#include "utils/generate.hpp"
+#include "../llama_test_util.hpp"
+
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+
+void test_stream_matches_generate() {
+	std::cout << "=== Test generate_stream == generate ===" << std::endl;
+
+	LlamaForCausalLM model = tiny_llama();
+	GenerationConfig config;
+	config.max_new_tokens = 12;
+	config.eos_token_id = -1;
+	std::vector<int> prompt = make_prompt(10, 3);
+
+	std::vector<int> reference = generate(model, prompt, config);
+
+	std::vector<int> streamed;
+	GenerationStats stats;
+	std::vector<int> out = generate_stream(model, prompt, [&](int token) {
+		streamed.push_back(token);
+		return true;
+	}, config, &stats);
+	assert(out == reference && streamed == reference);
+
+	assert(stats.prompt_tokens == 10 && stats.prefill_tokens == 10);
+	assert(stats.generated_tokens == 12 && !stats.cancelled);
+	assert(stats.token_latencies_ms.size() == 11);
+	assert(stats.time_to_first_token_ms > 0.0 && stats.decode_ms > 0.0);
+	assert(stats.prefill_tokens_per_sec() > 0.0 && stats.decode_tokens_per_sec() > 0.0);
+	double p50 = stats.latency_percentile(50), p90 = stats.latency_percentile(90), p100 = stats.latency_percentile(100);
+	assert(p50 > 0.0 && p50 <= p90 && p90 <= p100);
+	assert(p100 == *std::max_element(stats.token_latencies_ms.begin(), stats.token_latencies_ms.end()));
+	assert(stats.latency_percentile(0) == *std::min_element(stats.token_latencies_ms.begin(), stats.token_latencies_ms.end()));
+
+	// No callback behaves like generate()
+	assert(generate_stream(model, prompt, nullptr, config) == reference);
+
+	std::cout << "generate_stream test PASSED" << std::endl << std::endl;
+}
+
+void test_stream_cancel_and_eos() {
+	std::cout << "=== Test generate_stream cancellation and eos ===" << std::endl;
+
+	LlamaForCausalLM model = tiny_llama();
+	GenerationConfig config;
+	config.max_new_tokens = 12;
+	config.eos_token_id = -1;
+	std::vector<int> prompt = make_prompt(8, 5);
+	std::vector<int> reference = generate(model, prompt, config);
+
+	// Stop after the third token: it is still returned, nothing after it is computed
+	size_t calls = 0;
+	GenerationStats stats;
+	std::vector<int> out = generate_stream(model, prompt, [&](int) { return ++calls < 3; }, config, &stats);
+	assert(calls == 3 && out.size() == 3);
+	assert(std::equal(out.begin(), out.end(), reference.begin()));
+	assert(stats.cancelled && stats.generated_tokens == 3 && stats.token_latencies_ms.size() == 2);
+	assert(model.cache_len() == prompt.size() + 2);
+
+	// eos ends the stream after being delivered
+	config.eos_token_id = reference[4];
+	std::vector<int> seen;
+	out = generate_stream(model, prompt, [&](int token) { seen.push_back(token); return true; }, config, &stats);
+	assert(out == seen && out.back() == reference[4]);
+	assert(out.size() <= 5 && !stats.cancelled);
+
+	// Speculative decoding has no streaming path
+	LlamaForCausalLM draft(100, 32, 1, 2, 1, 64, 128, 500000.0f, 1e-5f);
+	config.draft_model = &draft;
+	bool thrown = false;
+	try {
+		generate_stream(model, prompt, [](int) { return true; }, config);
+	} catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	std::cout << "Cancellation and eos test PASSED" << std::endl << std::endl;
+}
+
+int main() {
+	dcz::UsingConfig eval_mode("train", false);
+	dcz::UsingConfig no_grad("enable_backprop", false);
+
+	test_stream_matches_generate();
+	test_stream_cancel_and_eos();
+
+	std::cout << "All generate_stream tests PASSED!" << std::endl;
+	return 0;
+}
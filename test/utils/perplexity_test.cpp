@@ -0,0 +1,150 @@
+#include "deepczero.hpp"
+#include "utils/perplexity.hpp"
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+
+static std::vector<int> make_text(size_t len) {
+	std::vector<int> ids(len);
+	for (size_t i = 0; i < len; ++i)
+		ids[i] = static_cast<int>((i * i * 7 + i * 3 + 1) % 100);
+	return ids;
+}
+
+// Reference: log-softmax over the whole row, then pick the target
+static double naive_log_prob(const std::vector<float>& row, int target) {
+	double max_logit = row[0];
+	for (float x : row) max_logit = std::max(max_logit, static_cast<double>(x));
+	double sum = 0.0;
+	for (float x : row) sum += std::exp(x - max_logit);
+	return row[target] - max_logit - std::log(sum);
+}
+
+void test_target_log_prob() {
+	std::cout << "=== Test target_log_prob ===" << std::endl;
+
+	std::vector<float> row(1000);
+	for (size_t i = 0; i < row.size(); ++i)
+		row[i] = 30.0f * std::sin(static_cast<float>(i) * 0.37f);
+	for (int target : {0, 17, 999})
+		assert(std::abs(target_log_prob(row.data(), row.size(), target) - naive_log_prob(row, target)) < 1e-5);
+
+	// Probabilities of all targets sum to 1
+	double total = 0.0;
+	for (size_t t = 0; t < row.size(); ++t) total += std::exp(target_log_prob(row.data(), row.size(), static_cast<int>(t)));
+	assert(std::abs(total - 1.0) < 1e-6);
+
+	bool thrown = false;
+	try {
+		target_log_prob(row.data(), row.size(), 1000);
+	} catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	std::cout << "target_log_prob test PASSED" << std::endl << std::endl;
+}
+
+void test_perplexity_single_window() {
+	std::cout << "=== Test perplexity of text within one window ===" << std::endl;
+
+	LlamaForCausalLM model(100, 64, 2, 4, 2, 128, 128, 500000.0f, 1e-5f);
+	std::vector<int> text = make_text(50);
+
+	// Reference: all logits of one forward pass
+	model.reset_cache();
+	std::vector<float> logits = model.forward_ids(text, 0).data().raw_data();
+	double nll = 0.0;
+	for (size_t p = 0; p + 1 < text.size(); ++p) {
+		std::vector<float> row(logits.begin() + p * 100, logits.begin() + (p + 1) * 100);
+		nll -= naive_log_prob(row, text[p + 1]);
+	}
+
+	PerplexityConfig config;
+	config.context_len = 64;
+	config.stride = 16;
+	config.lm_head_rows = 7;  // several lm_head chunks
+	PerplexityResult result = evaluate_perplexity(model, text, config);
+	std::cout << "PPL: " << result.perplexity() << std::endl;
+	assert(result.windows == 1);
+	assert(result.scored_tokens == text.size() - 1);
+	assert(result.forwarded_tokens == text.size() - 1);
+	assert(std::abs(result.nll - nll) < 1e-3);
+	assert(std::abs(result.perplexity() - std::exp(nll / (text.size() - 1))) < 1e-3);
+
+	std::cout << "Single window perplexity test PASSED" << std::endl << std::endl;
+}
+
+void test_perplexity_sliding_window() {
+	std::cout << "=== Test sliding window perplexity ===" << std::endl;
+
+	std::vector<int> text = make_text(200);
+	PerplexityConfig config;
+	config.context_len = 48;
+	config.stride = 16;
+
+	// One layer: K/V of a token depend only on the token and its position, so the
+	// shifted cache equals a recomputed window
+	{
+		LlamaForCausalLM model(100, 64, 1, 4, 2, 128, 128, 500000.0f, 1e-5f);
+		config.reuse_cache = false;
+		PerplexityResult recompute = evaluate_perplexity(model, text, config);
+		config.reuse_cache = true;
+		size_t windows = 0;
+		PerplexityResult reuse = evaluate_perplexity(model, text, config,
+			[&](const PerplexityResult& r) { windows = r.windows; assert(model.cache_len() <= 48); });
+
+		std::cout << "Recompute PPL: " << recompute.perplexity() << " (" << recompute.forwarded_tokens
+				  << " tokens run), reuse PPL: " << reuse.perplexity() << " (" << reuse.forwarded_tokens
+				  << " tokens run)" << std::endl;
+		// 199 targets: a 48-token window, then 9 windows of 16 and one of 7
+		assert(reuse.windows == 11 && windows == 11);
+		assert(reuse.scored_tokens == 199 && recompute.scored_tokens == 199);
+		assert(reuse.forwarded_tokens == 199);
+		assert(recompute.forwarded_tokens == 11 * 48);
+		assert(std::abs(reuse.nll - recompute.nll) < 1e-2);
+	}
+
+	// Deeper models: without overlap (stride == context_len) both modes run the same
+	// windows, as long as the last one is full too (192 targets = 4 windows)
+	{
+		LlamaForCausalLM model(100, 64, 2, 4, 2, 128, 128, 500000.0f, 1e-5f);
+		config.stride = config.context_len;
+		config.max_tokens = 193;
+		config.reuse_cache = false;
+		PerplexityResult recompute = evaluate_perplexity(model, text, config);
+		config.reuse_cache = true;
+		PerplexityResult reuse = evaluate_perplexity(model, text, config);
+		assert(std::abs(reuse.nll - recompute.nll) < 1e-3);
+
+		// With overlap the deeper layers keep their earlier context: close, not equal
+		config.max_tokens = 0;
+		config.stride = 16;
+		config.reuse_cache = false;
+		recompute = evaluate_perplexity(model, text, config);
+		config.reuse_cache = true;
+		reuse = evaluate_perplexity(model, text, config);
+		std::cout << "2 layers: recompute PPL " << recompute.perplexity() << ", reuse PPL "
+				  << reuse.perplexity() << std::endl;
+		assert(std::isfinite(reuse.perplexity()));
+		assert(std::abs(reuse.mean_nll() - recompute.mean_nll()) < 0.1);
+
+		config.max_tokens = 60;
+		assert(evaluate_perplexity(model, text, config).scored_tokens == 59);
+	}
+
+	std::cout << "Sliding window perplexity test PASSED" << std::endl << std::endl;
+}
+
+int main() {
+	dcz::UsingConfig eval_mode("train", false);
+	dcz::UsingConfig no_grad("enable_backprop", false);
+
+	test_target_log_prob();
+	test_perplexity_single_window();
+	test_perplexity_sliding_window();
+
+	std::cout << "All perplexity tests PASSED!" << std::endl;
+	return 0;
+}
@@ -0,0 +1,127 @@
+#include "deepczero.hpp"
+#include "utils/generate.hpp"
+#include "../llama_test_util.hpp"
+#include "utils/prefix_cache.hpp"
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+
+void test_generate_with_prefix_cache() {
+	std::cout << "=== Test generate() with PrefixCache ===" << std::endl;
+
+	LlamaForCausalLM model = tiny_llama();
+
+	GenerationConfig config;
+	config.max_new_tokens = 8;
+	config.eos_token_id = -1;
+
+	std::vector<int> prompt = make_prompt(40, 3);
+	std::vector<int> reference = generate(model, prompt, config);
+
+	PrefixCache cache(16);
+	config.prefix_cache = &cache;
+
+	// First call: nothing cached, result must match
+	std::vector<int> first = generate(model, prompt, config);
+	assert(first == reference);
+	// prompt (40) + generated (8) - 1 unforwarded token = 47 cached -> 2 full blocks
+	std::cout << "Cached blocks after first call: " << cache.num_blocks() << std::endl;
+	assert(cache.num_blocks() == 2);
+
+	// Second call with the same prompt reuses 32 tokens and produces identical output
+	std::vector<int> second = generate(model, prompt, config);
+	assert(second == reference);
+
+	// Multi-turn: extend the history with the reply and a new user message
+	std::vector<int> turn2 = prompt;
+	turn2.insert(turn2.end(), first.begin(), first.end());
+	std::vector<int> user2 = make_prompt(12, 5);
+	turn2.insert(turn2.end(), user2.begin(), user2.end());
+
+	size_t restored = cache.restore(model, turn2, turn2.size() - 1);
+	std::cout << "Restored " << restored << " of " << turn2.size() << " tokens" << std::endl;
+	assert(restored == 32);
+	assert(model.cache_len() == 32);
+
+	config.prefix_cache = nullptr;
+	std::vector<int> turn2_ref = generate(model, turn2, config);
+	config.prefix_cache = &cache;
+	std::vector<int> turn2_cached = generate(model, turn2, config);
+	assert(turn2_cached == turn2_ref);
+
+	std::cout << "generate() with PrefixCache test PASSED" << std::endl << std::endl;
+}
+
+void test_prefix_cache_logits_match() {
+	std::cout << "=== Test PrefixCache logits match full prefill ===" << std::endl;
+
+	LlamaForCausalLM model = tiny_llama();
+	std::vector<int> prompt = make_prompt(20, 1);
+
+	model.reset_cache();
+	Variable full = model.forward_ids(prompt, 0);
+
+	PrefixCache cache(8);
+	cache.insert(model, prompt);
+	assert(cache.num_blocks() == 2);
+
+	size_t restored = cache.restore(model, prompt, prompt.size() - 1);
+	assert(restored == 16);
+	std::vector<int> suffix(prompt.begin() + restored, prompt.end());
+	Variable partial = model.forward_ids(suffix, restored);
+
+	const auto& a = full.data().raw_data();
+	const auto& b = partial.data().raw_data();
+	size_t vocab = 100;
+	size_t last_full = (prompt.size() - 1) * vocab;
+	size_t last_partial = (suffix.size() - 1) * vocab;
+	for (size_t i = 0; i < vocab; ++i) {
+		assert(std::abs(a[last_full + i] - b[last_partial + i]) < 1e-4f);
+	}
+
+	std::cout << "PrefixCache logits test PASSED" << std::endl << std::endl;
+}
+
+void test_prefix_cache_eviction() {
+	std::cout << "=== Test PrefixCache LRU eviction ===" << std::endl;
+
+	LlamaForCausalLM model = tiny_llama();
+
+	// One block: 2 layers * (K + V) * 8 tokens * 32 floats = 4 KB
+	size_t block_bytes = 2 * 2 * 8 * 32 * sizeof(float);
+	PrefixCache cache(8, 3 * block_bytes);
+
+	std::vector<int> a = make_prompt(16, 1);
+	std::vector<int> b = make_prompt(16, 2);
+
+	model.reset_cache();
+	model.forward_ids(a, 0);
+	cache.insert(model, a);
+	assert(cache.num_blocks() == 2);
+	assert(cache.memory_usage() == 2 * block_bytes);
+
+	model.reset_cache();
+	model.forward_ids(b, 0);
+	cache.insert(model, b);
+
+	// Budget holds 3 blocks: the oldest leaf (second block of a) is evicted
+	assert(cache.num_blocks() == 3);
+	assert(cache.memory_usage() <= 3 * block_bytes);
+	assert(cache.restore(model, b, b.size()) == 16);
+	assert(cache.restore(model, a, a.size()) == 8);
+
+	std::cout << "PrefixCache eviction test PASSED" << std::endl << std::endl;
+}
+
+int main() {
+	dcz::UsingConfig eval_mode("train", false);
+	dcz::UsingConfig no_grad("enable_backprop", false);
+
+	test_generate_with_prefix_cache();
+	test_prefix_cache_logits_match();
+	test_prefix_cache_eviction();
+
+	std::cout << "All prefix cache tests PASSED!" << std::endl;
+	return 0;
+}
@@ -0,0 +1,203 @@
+#include "deepczero.hpp"
+#include "utils/generate.hpp"
+#include "utils/sampler.hpp"
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <chrono>
+#include <set>
+
+static std::vector<float> make_logits(size_t vocab, int seed) {
+	std::vector<float> logits(vocab);
+	for (size_t i = 0; i < vocab; ++i)
+		logits[i] = std::sin(0.7f * i + seed) * 3.0f + std::cos(0.013f * i * seed);
+	return logits;
+}
+
+void test_argmax() {
+	std::cout << "=== Test argmax_f32 ===" << std::endl;
+
+	for (size_t n : {1, 7, 8, 9, 31, 1000, 128256}) {
+		std::vector<float> x = make_logits(n, 3);
+		size_t ref = 0;
+		for (size_t i = 1; i < n; ++i)
+			if (x[i] > x[ref]) ref = i;
+		assert(argmax_f32(x.data(), n) == static_cast<int>(ref));
+	}
+
+	// Ties resolve to the first index
+	std::vector<float> ties = {0.0f, 5.0f, 1.0f, 5.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 5.0f};
+	assert(argmax_f32(ties.data(), ties.size()) == 1);
+
+	std::cout << "argmax_f32 test PASSED" << std::endl << std::endl;
+}
+
+void test_filters() {
+	std::cout << "=== Test top-k / top-p / min-p ===" << std::endl;
+
+	// Probabilities (T=1): 0.5, 0.25, 0.125, 0.0625, 0.0625
+	std::vector<float> logits = {std::log(0.0625f), std::log(0.5f), std::log(0.125f),
+								 std::log(0.25f), std::log(0.0625f)};
+	GenerationConfig config;
+	config.do_sample = true;
+
+	std::vector<float> probs;
+	{
+		Sampler sampler(config);
+		sampler.distribution(logits.data(), logits.size(), probs);
+		float sum = 0.0f;
+		for (float p : probs) sum += p;
+		assert(std::abs(sum - 1.0f) < 1e-5f);
+		assert(std::abs(probs[1] - 0.5f) < 1e-5f);
+	}
+	{
+		config.top_k = 2;
+		Sampler sampler(config);
+		sampler.distribution(logits.data(), logits.size(), probs);
+		assert(std::abs(probs[1] - 2.0f / 3.0f) < 1e-5f);
+		assert(std::abs(probs[3] - 1.0f / 3.0f) < 1e-5f);
+		assert(probs[0] == 0.0f && probs[2] == 0.0f && probs[4] == 0.0f);
+		config.top_k = 0;
+	}
+	{
+		// 0.5 + 0.25 < 0.8 -> the third token is needed
+		config.top_p = 0.8f;
+		Sampler sampler(config);
+		sampler.distribution(logits.data(), logits.size(), probs);
+		assert(probs[1] > 0.0f && probs[3] > 0.0f && probs[2] > 0.0f);
+		assert(probs[0] == 0.0f && probs[4] == 0.0f);
+		config.top_p = 1.0f;
+	}
+	{
+		// Keep p >= 0.3 * 0.5
+		config.min_p = 0.3f;
+		Sampler sampler(config);
+		sampler.distribution(logits.data(), logits.size(), probs);
+		assert(probs[1] > 0.0f && probs[3] > 0.0f);
+		assert(probs[2] == 0.0f && probs[0] == 0.0f && probs[4] == 0.0f);
+		config.min_p = 0.0f;
+	}
+	{
+		// Samples stay inside the top-k set
+		config.top_k = 3;
+		Sampler sampler(config);
+		for (int i = 0; i < 200; ++i) {
+			int t = sampler.sample(logits.data(), logits.size());
+			assert(t == 1 || t == 3 || t == 2);
+		}
+		config.top_k = 1;
+		Sampler top1(config);
+		assert(top1.sample(logits.data(), logits.size()) == 1);
+		config.top_k = 0;
+	}
+
+	// Large vocab nucleus: kept set is exactly the sorted prefix reaching top_p
+	{
+		std::vector<float> big = make_logits(128256, 1);
+		config.top_p = 0.9f;
+		Sampler sampler(config);
+		sampler.distribution(big.data(), big.size(), probs);
+
+		config.top_p = 1.0f;
+		Sampler full_sampler(config);
+		std::vector<float> full;
+		full_sampler.distribution(big.data(), big.size(), full);
+		double kept_mass = 0.0, min_kept = 1.0, max_dropped = 0.0;
+		for (size_t i = 0; i < big.size(); ++i) {
+			if (probs[i] > 0.0f) { kept_mass += full[i]; min_kept = std::min(min_kept, (double)full[i]); }
+			else max_dropped = std::max(max_dropped, (double)full[i]);
+		}
+		assert(kept_mass >= 0.9 - 1e-3);
+		assert(max_dropped <= min_kept);
+	}
+
+	std::cout << "Filter test PASSED" << std::endl << std::endl;
+}
+
+void test_penalties_and_seed() {
+	std::cout << "=== Test penalties and seed ===" << std::endl;
+
+	std::vector<float> logits = {1.0f, 3.0f, 2.9f, -1.0f};
+	GenerationConfig config;
+
+	// Greedy with repetition penalty: token 1 seen -> 3 / 2 = 1.5 < 2.9
+	config.repetition_penalty = 2.0f;
+	Sampler sampler(config);
+	assert(sampler.sample(logits.data(), logits.size()) == 1);
+	sampler.accept(1);
+	assert(sampler.sample(logits.data(), logits.size()) == 2);
+	sampler.forget(1);
+	assert(sampler.sample(logits.data(), logits.size()) == 1);
+
+	// Frequency penalty grows with count
+	config.repetition_penalty = 1.0f;
+	config.frequency_penalty = 0.06f;
+	Sampler freq(config);
+	freq.accept(1);
+	assert(freq.sample(logits.data(), logits.size()) == 1);  // 2.94 > 2.9
+	freq.accept(1);
+	assert(freq.sample(logits.data(), logits.size()) == 2);  // 2.88 < 2.9
+
+	// Same seed -> same sequence, different seed -> (almost surely) different
+	config = GenerationConfig();
+	config.do_sample = true;
+	std::vector<float> big = make_logits(1000, 2);
+	auto draw = [&](uint64_t seed) {
+		config.seed = seed;
+		Sampler s(config);
+		std::vector<int> out;
+		for (int i = 0; i < 32; ++i) out.push_back(s.sample(big.data(), big.size()));
+		return out;
+	};
+	assert(draw(7) == draw(7));
+	assert(draw(7) != draw(8));
+
+	std::cout << "Penalty/seed test PASSED" << std::endl << std::endl;
+}
+
+void test_sampler_speed() {
+	std::cout << "=== Sampler cost per token (vocab 128256) ===" << std::endl;
+
+	std::vector<float> logits = make_logits(128256, 5);
+	GenerationConfig config;
+	config.do_sample = true;
+	config.temperature = 0.7f;
+
+	auto time_us = [&](const char* name) {
+		Sampler sampler(config);
+		for (int i = 0; i < 5; ++i) sampler.accept(i * 11);
+		sampler.sample(logits.data(), logits.size());
+		auto t0 = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < 50; ++i) sampler.sample(logits.data(), logits.size());
+		auto t1 = std::chrono::high_resolution_clock::now();
+		std::cout << name << ": "
+				  << std::chrono::duration<double, std::micro>(t1 - t0).count() / 50 << " us" << std::endl;
+	};
+
+	time_us("temperature");
+	config.top_k = 40;
+	time_us("top-k 40");
+	config.top_p = 0.9f;
+	time_us("top-k 40 + top-p 0.9");
+	config.top_k = 0;
+	time_us("top-p 0.9");
+	config.top_p = 1.0f;
+	config.min_p = 0.05f;
+	config.repetition_penalty = 1.1f;
+	time_us("min-p 0.05 + repetition");
+	config.do_sample = false;
+	time_us("greedy");
+
+	std::cout << std::endl;
+}
+
+int main() {
+	test_argmax();
+	test_filters();
+	test_penalties_and_seed();
+	test_sampler_speed();
+
+	std::cout << "All sampler tests PASSED!" << std::endl;
+	return 0;
+}
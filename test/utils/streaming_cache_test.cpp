@@ -0,0 +1,157 @@
+#include "deepczero.hpp"
+#include "utils/generate.hpp"
+#include "../llama_test_util.hpp"
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+
+void test_streaming_matches_sink_window_context() {
+	std::cout << "=== Test streaming cache == sinks + window recomputed ===" << std::endl;
+
+	// One layer: K/V of a token depend only on the token and its position, so every
+	// streamed step equals a fresh forward over the sinks followed by the window
+	const size_t sinks = 4, window = 12, n = 40;
+	LlamaForCausalLM model(100, 64, 1, 4, 2, 128, 128, 500000.0f, 1e-5f);
+	std::vector<int> tokens = make_tokens(n, 3);
+
+	model.set_streaming(sinks, window);
+	assert(model.is_streaming());
+	// Longer than the window: LlamaModel runs the overflow one token at a time
+	std::vector<float> streamed = model.forward_ids(tokens, 0).data().raw_data();
+	assert(model.cache_len() == sinks + window);
+
+	model.set_streaming(0, 0);
+	assert(!model.is_streaming());
+	float worst = 0.0f;
+	for (size_t t = 0; t < n; ++t) {
+		std::vector<int> context;
+		if (t < sinks + window) {
+			context.assign(tokens.begin(), tokens.begin() + t + 1);
+		} else {
+			context.assign(tokens.begin(), tokens.begin() + sinks);
+			context.insert(context.end(), tokens.begin() + t + 1 - window, tokens.begin() + t + 1);
+		}
+		model.reset_cache();
+		std::vector<float> ref = model.forward_ids(context, 0, {context.size() - 1}).data().raw_data();
+		worst = std::max(worst, max_diff(streamed.data() + t * 100, ref.data(), 100));
+	}
+	std::cout << "Max logit difference: " << worst << std::endl;
+	assert(worst < 1e-3f);
+
+	std::cout << "Streaming reference test PASSED" << std::endl << std::endl;
+}
+
+void test_streaming_steps_and_formats() {
+	std::cout << "=== Test streaming steps, positions past the RoPE tables, KV formats ===" << std::endl;
+
+	// max_position_embeddings 128, 300 tokens
+	const size_t sinks = 4, window = 28, n = 300;
+	LlamaForCausalLM model = tiny_llama();
+	std::vector<int> tokens = make_tokens(n, 8);
+
+	model.set_streaming(sinks, window);
+	std::vector<float> whole = model.forward_ids(tokens, 0).data().raw_data();
+	assert(model.cache_len() == sinks + window);
+
+	// Same tokens fed one forward at a time (a prefill chunk, then decode steps)
+	model.set_streaming(sinks, window);
+	std::vector<int> chunk(tokens.begin(), tokens.begin() + 20);
+	std::vector<float> stepped = model.forward_ids(chunk, 0).data().raw_data();
+	for (size_t t = 20; t < n; ++t) {
+		std::vector<float> step = model.forward_ids({tokens[t]}, t).data().raw_data();
+		stepped.insert(stepped.end(), step.begin(), step.end());
+		assert(model.cache_len() == std::min(t + 1, sinks + window));
+	}
+	assert(max_diff(whole.data(), stepped.data(), whole.size()) < 1e-3f);
+
+	for (KVCacheFormat format : {KVCacheFormat::F16, KVCacheFormat::INT8}) {
+		model.set_kv_cache_format(format);
+		model.set_streaming(sinks, window);
+		std::vector<float> logits = model.forward_ids(tokens, 0).data().raw_data();
+		float worst = max_diff(whole.data(), logits.data(), whole.size());
+		std::cout << kv_cache_format_name(format) << " max logit difference: " << worst << std::endl;
+		assert(std::isfinite(worst) && worst < 0.5f);
+	}
+	model.set_kv_cache_format(KVCacheFormat::F32);
+
+	// Evicted tokens cannot come back
+	model.set_streaming(sinks, window);
+	model.forward_ids(tokens, 0);
+	for (int op = 0; op < 3; ++op) {
+		bool thrown = false;
+		try {
+			if (op == 0) model.truncate_cache(10);
+			if (op == 1) model.shift_cache(4);
+			if (op == 2) model.fork_cache(2);
+		} catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+
+	// Before any eviction the cache can still roll back
+	model.set_streaming(sinks, window);
+	model.forward_ids(chunk, 0);
+	model.truncate_cache(10);
+	std::vector<float> redo = model.forward_ids(std::vector<int>(chunk.begin() + 10, chunk.end()), 10).data().raw_data();
+	assert(max_diff(redo.data() + 9 * 100, stepped.data() + 19 * 100, 100) < 1e-4f);
+
+	bool thrown = false;
+	try {
+		model.set_streaming(4, 125);  // exceeds max_position_embeddings
+	} catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	std::cout << "Streaming steps test PASSED" << std::endl << std::endl;
+}
+
+void test_streaming_generation() {
+	std::cout << "=== Test streaming generation past max_position_embeddings ===" << std::endl;
+
+	LlamaForCausalLM model = tiny_llama();
+	std::vector<int> prompt = make_tokens(50, 1);
+
+	GenerationConfig config;
+	config.max_new_tokens = 400;
+	config.eos_token_id = -1;
+	config.prefill_chunk_size = 16;
+	config.attention_sinks = 4;
+	config.streaming_window = 28;
+
+	size_t max_cached = 0;
+	std::vector<int> out = generate_stream(model, prompt, [&](int) {
+		max_cached = std::max(max_cached, model.cache_len());
+		return true;
+	}, config);
+	assert(out.size() == 400);
+	assert(max_cached == 32 && model.cache_len() == 32);
+	for (int t : out) assert(t >= 0 && t < 100);
+
+	// Without streaming the same request runs out of positions
+	model.set_streaming(0, 0);
+	config.streaming_window = 0;
+	bool thrown = false;
+	try {
+		generate(model, prompt, config);
+	} catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	std::cout << "Streaming generation test PASSED" << std::endl << std::endl;
+}
+
+int main() {
+	dcz::UsingConfig eval_mode("train", false);
+	dcz::UsingConfig no_grad("enable_backprop", false);
+
+	test_streaming_matches_sink_window_context();
+	test_streaming_steps_and_formats();
+	test_streaming_generation();
+
+	std::cout << "All streaming cache tests PASSED!" << std::endl;
+	return 0;
+}
@@ -0,0 +1,386 @@
+#include "deepczero.hpp"
+#include "json.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+
+// GPT-2 bytes_to_unicode: the vocab spells raw byte b as this UTF-8 string
+static std::string byte_unicode(unsigned char b) {
+	uint32_t cp = b;
+	if (!((b >= 33 && b <= 126) || (b >= 161 && b <= 172) || b >= 174)) {
+		int n = 0;
+		for (int i = 0; i < b; ++i)
+			if (!((i >= 33 && i <= 126) || (i >= 161 && i <= 172) || i >= 174)) ++n;
+		cp = 256 + n;
+	}
+	std::string s;
+	if (cp < 0x80) {
+		s += static_cast<char>(cp);
+	} else {
+		s += static_cast<char>(0xC0 | (cp >> 6));
+		s += static_cast<char>(0x80 | (cp & 0x3F));
+	}
+	return s;
+}
+
+static std::string to_unicode(const std::string& raw) {
+	std::string s;
+	for (unsigned char b : raw) s += byte_unicode(b);
+	return s;
+}
+
+// Byte-level vocab, merges given on raw strings, plus a whole-word token that no
+// merge produces and the Llama 3 special tokens
+struct SyntheticTokenizer {
+	std::unordered_map<std::string, int> vocab;
+	std::vector<std::pair<std::string, std::string>> merges;  // unicode form
+	std::string path = "/tmp/dcz_tokenizer_test.json";
+
+	SyntheticTokenizer() {
+		for (int b = 0; b < 256; ++b) vocab[byte_unicode(static_cast<unsigned char>(b))] = b;
+		const std::vector<std::pair<std::string, std::string>> raw = {
+			{"l", "l"}, {"h", "e"}, {"he", "ll"}, {"hell", "o"}, {" ", "w"}, {"o", "r"},
+			{" w", "or"}, {"l", "d"}, {" wor", "ld"}, {"a", "a"}, {"aa", "a"}, {"a", "aa"},
+			{"aa", "aa"}, {" ", "h"}, {" h", "ello"}, {"e", "l"}, {"el", "l"}, {"ell", "o"},
+			{"r", "e"}, {"\n", "\n"}, {"'", "re"}, {"o", "o"}, {"d", "o"},
+		};
+		for (const auto& [a, b] : raw) {
+			std::string ua = to_unicode(a), ub = to_unicode(b);
+			merges.push_back({ua, ub});
+			if (!vocab.count(ua + ub)) vocab[ua + ub] = static_cast<int>(vocab.size());
+		}
+		vocab[to_unicode(" xyz")] = static_cast<int>(vocab.size());
+
+		json j;
+		j["model"]["vocab"] = vocab;
+		j["model"]["merges"] = json::array();
+		for (size_t i = 0; i < merges.size(); ++i) {
+			// Both merge spellings HuggingFace writes
+			if (i % 2) j["model"]["merges"].push_back({merges[i].first, merges[i].second});
+			else j["model"]["merges"].push_back(merges[i].first + " " + merges[i].second);
+		}
+		int next_id = static_cast<int>(vocab.size());
+		for (const char* special : {"<|begin_of_text|>", "<|end_of_text|>", "<|eot_id|>"})
+			j["added_tokens"].push_back({{"content", special}, {"id", next_id++}});
+		std::ofstream(path) << j.dump();
+	}
+
+	~SyntheticTokenizer() { std::remove(path.c_str()); }
+
+	// Reference: rescan every adjacent pair, merge the best, repeat
+	std::vector<int> reference_encode(const std::vector<std::string_view>& pretokens) const {
+		std::vector<int> ids;
+		for (std::string_view pretoken : pretokens) {
+			std::string whole = to_unicode(std::string(pretoken));
+			if (vocab.count(whole)) {
+				ids.push_back(vocab.at(whole));
+				continue;
+			}
+			std::vector<std::string> word;
+			for (unsigned char b : pretoken) word.push_back(byte_unicode(b));
+			while (word.size() > 1) {
+				size_t best = std::numeric_limits<size_t>::max(), best_pos = 0;
+				for (size_t i = 0; i + 1 < word.size(); ++i) {
+					for (size_t r = 0; r < merges.size() && r < best; ++r) {
+						if (merges[r].first == word[i] && merges[r].second == word[i + 1]) {
+							best = r;
+							best_pos = i;
+						}
+					}
+				}
+				if (best == std::numeric_limits<size_t>::max()) break;
+				word[best_pos] += word[best_pos + 1];
+				word.erase(word.begin() + best_pos + 1);
+			}
+			for (const auto& t : word) ids.push_back(vocab.at(t));
+		}
+		return ids;
+	}
+};
+
+static void check_split(const std::string& text, const std::vector<std::string>& expected) {
+	auto pieces = LlamaTokenizer::pretokenize(text);
+	std::vector<std::string> got(pieces.begin(), pieces.end());
+	if (got != expected) {
+		std::cout << "pretokenize mismatch for \"" << text << "\":";
+		for (const auto& p : got) std::cout << " [" << p << "]";
+		std::cout << std::endl;
+	}
+	assert(got == expected);
+}
+
+void test_pretokenize() {
+	std::cout << "=== Test Llama 3 pre-tokenizer ===" << std::endl;
+
+	check_split("Hello world", {"Hello", " world"});
+	check_split("I'm sure they'RE done, can't we?", {"I", "'m", " sure", " they", "'RE", " done", ",", " can", "'t", " we", "?"});
+	check_split("'hello", {"'hello"});
+	check_split("12345 678", {"123", "45", " ", "678"});
+	check_split("$100.5", {"$", "100", ".", "5"});
+	check_split("a  b", {"a", " ", " b"});
+	check_split("end   ", {"end", "   "});
+	check_split("hi!!\n\nthere", {"hi", "!!\n\n", "there"});
+	check_split("x \n\n y", {"x", " \n\n", " y"});
+	check_split("\tfoo\n", {"\tfoo", "\n"});
+	check_split(" ...  (ok)", {" ...", " ", " (", "ok", ")"});
+	check_split("caf\xC3\xA9 na\xC3\xAFve", {"caf\xC3\xA9", " na\xC3\xAFve"});
+	// Japanese letters run together; Arabic-Indic digits group by three
+	check_split("\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\xE3\x81\xAE", {"\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\xE3\x81\xAE"});
+	check_split("\xD9\xA3\xD9\xA4\xD9\xA5\xD9\xA6", {"\xD9\xA3\xD9\xA4\xD9\xA5", "\xD9\xA6"});
+	// U+3000 ideographic space is white space, the em dash is punctuation
+	check_split("a\xE3\x80\x80\xE2\x80\x94" "b", {"a", "\xE3\x80\x80", "\xE2\x80\x94" "b"});
+	// Malformed UTF-8 bytes are kept and count as punctuation
+	check_split("ab\xFF\xFE" "cd", {"ab", "\xFF\xFE", "cd"});
+	check_split("", {});
+
+	std::cout << "Pre-tokenizer test PASSED" << std::endl << std::endl;
+}
+
+static std::string random_text(std::mt19937& rng, size_t len) {
+	const std::vector<std::string> alphabet = {
+		"a", "h", "e", "l", "o", "w", "r", "d", " ", " ", "\n", "'", "x", "y", "z", "1", "!", "\xC3\xA9",
+	};
+	std::string s;
+	for (size_t i = 0; i < len; ++i) s += alphabet[rng() % alphabet.size()];
+	return s;
+}
+
+void test_bpe_matches_reference() {
+	std::cout << "=== Test BPE against reference ===" << std::endl;
+
+	SyntheticTokenizer synth;
+	LlamaTokenizer tok;
+	tok.load(synth.path);
+	assert(tok.merges_size() == synth.merges.size());
+	assert(tok.get_bos_token_id() == static_cast<int>(synth.vocab.size()));
+	assert(tok.get_eot_token_id() == static_cast<int>(synth.vocab.size()) + 2);
+
+	auto id = [&](const std::string& raw) { return synth.vocab.at(to_unicode(raw)); };
+	assert(tok.encode("hello world") == (std::vector<int>{id("hello"), id(" world")}));
+	// Merges go by rank, not left to right: a+a twice, then aa+a (rank 10) before aa+aa
+	assert(tok.encode("aaaaa") == (std::vector<int>{id("aa"), id("aaa")}));
+	// A pre-token that is a vocab entry is taken whole even with no merge path to it
+	assert(tok.encode(" xyz") == (std::vector<int>{id(" xyz")}));
+
+	std::mt19937 rng(7);
+	for (size_t t = 0; t < 300; ++t) {
+		std::string text = random_text(rng, 1 + rng() % 60);
+		std::vector<int> ids = tok.encode(text);
+		assert(ids == synth.reference_encode(LlamaTokenizer::pretokenize(text)));
+		assert(tok.decode(ids) == text);
+	}
+
+	std::cout << "BPE reference test PASSED" << std::endl << std::endl;
+}
+
+void test_pretoken_cache() {
+	std::cout << "=== Test pre-token cache ===" << std::endl;
+
+	SyntheticTokenizer synth;
+	LlamaTokenizer cached, uncached;
+	cached.load(synth.path);
+	uncached.load(synth.path);
+	uncached.set_cache_capacity(0);
+
+	std::string text = "hello world hello world hello\n\nworld";
+	std::vector<int> first = cached.encode(text);
+	assert(cached.get_cache_hits() > 0);
+	size_t misses = cached.get_cache_misses();
+	assert(cached.encode(text) == first);
+	assert(cached.get_cache_misses() == misses);  // everything is cached now
+	assert(uncached.encode(text) == first);
+	assert(uncached.get_cache_hits() == 0 && uncached.get_cache_misses() == 0);
+
+	// A tiny cache keeps evicting and still encodes identically
+	cached.set_cache_capacity(3);
+	std::mt19937 rng(11);
+	for (size_t t = 0; t < 100; ++t) {
+		std::string s = random_text(rng, 80);
+		assert(cached.encode(s) == uncached.encode(s));
+	}
+
+	cached.clear_cache();
+	assert(cached.get_cache_hits() == 0 && cached.get_cache_misses() == 0);
+
+	std::cout << "Pre-token cache test PASSED" << std::endl << std::endl;
+}
+
+void test_byte_round_trip() {
+	std::cout << "=== Test byte-level round trip ===" << std::endl;
+
+	SyntheticTokenizer synth;
+	LlamaTokenizer tok;
+	tok.load(synth.path);
+
+	// Every byte value, including invalid UTF-8, comes back unchanged
+	std::string all_bytes;
+	for (int b = 0; b < 256; ++b) all_bytes += static_cast<char>(b);
+	assert(tok.decode(tok.encode(all_bytes)) == all_bytes);
+
+	std::string mixed = "Grüße, 世界! 3.14159 — don't\r\n\ttabs   ";
+	assert(tok.decode(tok.encode(mixed)) == mixed);
+
+	std::cout << "Byte round trip test PASSED" << std::endl << std::endl;
+}
+
+void test_binary_cache() {
+	std::cout << "=== Test binary tokenizer cache ===" << std::endl;
+
+	SyntheticTokenizer synth;
+	const std::string cache = "/tmp/dcz_tokenizer_test.bin";
+	std::remove(cache.c_str());
+
+	LlamaTokenizer from_json;
+	from_json.load(synth.path);
+	assert(!from_json.is_mapped());
+	from_json.save_binary(cache);
+
+	// load() recognizes the binary image and maps it
+	LlamaTokenizer mapped;
+	mapped.load(cache);
+	assert(mapped.is_mapped());
+	assert(mapped.vocab_size() == from_json.vocab_size() && mapped.merges_size() == from_json.merges_size());
+	assert(mapped.get_bos_token_id() == from_json.get_bos_token_id());
+	assert(mapped.get_eot_token_id() == from_json.get_eot_token_id());
+	assert(mapped.apply_chat_template("hello") == from_json.apply_chat_template("hello"));
+	std::mt19937 rng(3);
+	for (size_t t = 0; t < 100; ++t) {
+		std::string text = random_text(rng, 50);
+		assert(mapped.encode(text) == from_json.encode(text));
+		assert(mapped.decode(mapped.encode(text)) == text);
+	}
+	std::remove(cache.c_str());
+
+	// load_cached: first call parses and writes the cache, the second maps it
+	LlamaTokenizer first, second, stale;
+	first.load_cached(synth.path, cache);
+	assert(!first.is_mapped() && std::ifstream(cache).good());
+	second.load_cached(synth.path, cache);
+	assert(second.is_mapped());
+	assert(second.encode("hello world") == first.encode("hello world"));
+
+	// A changed tokenizer.json invalidates the cache
+	std::ofstream(synth.path, std::ios::app) << " ";
+	stale.load_cached(synth.path, cache);
+	assert(!stale.is_mapped());
+	second.load_cached(synth.path, cache);
+	assert(second.is_mapped());
+
+	// A truncated cache is rejected and rebuilt
+	{
+		std::ifstream in(cache, std::ios::binary);
+		std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		std::ofstream(cache, std::ios::binary).write(bytes.data(), 100);
+	}
+	bool threw = false;
+	try {
+		LlamaTokenizer broken;
+		broken.load(cache);
+	} catch (const std::runtime_error&) {
+		threw = true;
+	}
+	assert(threw);
+	LlamaTokenizer rebuilt;
+	rebuilt.load_cached(synth.path, cache);
+	assert(!rebuilt.is_mapped() && rebuilt.encode("hello world") == first.encode("hello world"));
+	std::remove(cache.c_str());
+
+	// Without a cache path the image goes next to the json
+	const std::string default_cache = synth.path + ".bin";
+	std::remove(default_cache.c_str());
+	LlamaTokenizer beside, beside_mapped;
+	beside.load_cached(synth.path);
+	assert(!beside.is_mapped() && std::ifstream(default_cache).good());
+	beside_mapped.load_cached(synth.path);
+	assert(beside_mapped.is_mapped());
+	assert(beside_mapped.encode("hello world") == first.encode("hello world"));
+	std::remove(default_cache.c_str());
+	std::cout << "Binary cache test PASSED" << std::endl << std::endl;
+}
+
+void test_encode_batch() {
+	std::cout << "=== Test batch encode ===" << std::endl;
+
+	SyntheticTokenizer synth;
+	LlamaTokenizer tok;
+	tok.load(synth.path);
+
+	std::mt19937 rng(5);
+	std::vector<std::string> texts;
+	for (size_t t = 0; t < 64; ++t) texts.push_back(random_text(rng, rng() % 200));
+	std::vector<std::vector<int>> expected;
+	for (const auto& text : texts) expected.push_back(tok.encode(text));
+
+	for (int threads : {1, 2, 4}) {
+		tok.clear_cache();
+		assert(tok.encode_batch(texts, threads) == expected);
+	}
+	assert(tok.encode_batch({}).empty());
+
+	std::cout << "Batch encode test PASSED" << std::endl << std::endl;
+}
+
+void test_incremental_detokenizer() {
+	std::cout << "=== Test incremental detokenizer ===" << std::endl;
+
+	SyntheticTokenizer synth;
+	LlamaTokenizer tok;
+	tok.load(synth.path);
+
+	// Byte-level vocab: every multi-byte character spans several tokens
+	std::string text = "h\xC3\xA9llo \xE4\xB8\x96\xE7\x95\x8C \xF0\x9F\x98\x80!";
+	std::vector<int> ids = tok.encode(text);
+	IncrementalDetokenizer detok(tok);
+	std::string streamed;
+	for (int id : ids) {
+		std::string piece = detok.push(id);
+		// Each piece is whole characters: it never ends inside a sequence
+		for (size_t i = 0; i < piece.size();) {
+			unsigned char c = static_cast<unsigned char>(piece[i]);
+			size_t len = c < 0x80 ? 1 : (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : 4;
+			assert(i + len <= piece.size());
+			i += len;
+		}
+		streamed += piece;
+	}
+	assert(detok.pending_bytes() == 0);
+	assert(streamed == text && detok.flush().empty());
+
+	// The first byte of the emoji alone is held; flushing then yields U+FFFD
+	auto byte_id = [&](unsigned char b) { return synth.vocab.at(byte_unicode(b)); };
+	assert(detok.push(byte_id('a')) == "a");
+	assert(detok.push(byte_id(0xF0)).empty() && detok.push(byte_id(0x9F)).empty());
+	assert(detok.pending_bytes() == 2);
+	assert(detok.flush() == "\xEF\xBF\xBD" && detok.pending_bytes() == 0);
+
+	// Stray continuation bytes are passed through instead of stalling the stream
+	assert(detok.push(byte_id(0x80)) == "\x80");
+
+	// Special tokens produce no text
+	assert(detok.push(tok.get_eot_token_id()).empty());
+
+	std::cout << "Incremental detokenizer test PASSED" << std::endl << std::endl;
+}
+
+int main() {
+	test_pretokenize();
+	test_bpe_matches_reference();
+	test_pretoken_cache();
+	test_byte_round_trip();
+	test_binary_cache();
+	test_encode_batch();
+	test_incremental_detokenizer();
+
+	std::cout << "All tokenizer tests PASSED!" << std::endl;
+	return 0;
+}
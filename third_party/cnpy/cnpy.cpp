@@ -0,0 +1,118 @@
+#include "cnpy.h"
+#include <fstream>
+#include <sstream>
+#include <zlib.h>
+#include <cstdint>
+namespace cnpy {
+static void parse_header(const char* buf, size_t len, size_t& hdr_len, std::vector<size_t>& shape, size_t& ws, bool& fortran) {
+	if (len < 10 || std::memcmp(buf, "\x93NUMPY", 6) != 0) throw std::runtime_error("npy: bad magic");
+	uint8_t major = buf[6];
+	size_t hl; size_t pre;
+	if (major == 1) { hl = (uint8_t)buf[8] | ((uint8_t)buf[9] << 8); pre = 10; }
+	else { hl = (uint8_t)buf[8] | ((uint8_t)buf[9] << 8) | ((uint8_t)buf[10] << 16) | ((uint32_t)(uint8_t)buf[11] << 24); pre = 12; }
+	std::string h(buf + pre, hl);
+	hdr_len = pre + hl;
+	fortran = h.find("'fortran_order': True") != std::string::npos;
+	size_t d = h.find("'descr': '");
+	std::string descr = h.substr(d + 10, h.find("'", d + 10) - d - 10);
+	ws = std::stoul(descr.substr(2));
+	size_t s0 = h.find("(", h.find("'shape'")), s1 = h.find(")", s0);
+	std::string sh = h.substr(s0 + 1, s1 - s0 - 1);
+	shape.clear();
+	std::stringstream ss(sh); std::string tok;
+	while (std::getline(ss, tok, ',')) {
+		size_t a = tok.find_first_not_of(" ");
+		if (a == std::string::npos) continue;
+		shape.push_back(std::stoul(tok.substr(a)));
+	}
+}
+static NpyArray from_buffer(const std::vector<char>& b) {
+	size_t hl, ws; bool f; std::vector<size_t> shape;
+	parse_header(b.data(), b.size(), hl, shape, ws, f);
+	NpyArray arr(shape, ws, f);
+	std::memcpy(arr.data<char>(), b.data() + hl, arr.num_bytes());
+	return arr;
+}
+static uint16_t r16(const char* p) { return (uint8_t)p[0] | ((uint8_t)p[1] << 8); }
+static uint32_t r32(const char* p) { return r16(p) | ((uint32_t)r16(p + 2) << 16); }
+npz_t npz_load(std::string fname) {
+	std::ifstream f(fname, std::ios::binary);
+	if (!f) throw std::runtime_error("npz_load: cannot open " + fname);
+	std::vector<char> all((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+	npz_t out;
+	size_t pos = 0;
+	while (pos + 30 <= all.size() && r32(&all[pos]) == 0x04034b50) {
+		const char* h = &all[pos];
+		uint16_t method = r16(h + 8);
+		uint32_t csize = r32(h + 18), usize = r32(h + 22);
+		uint16_t nlen = r16(h + 26), xlen = r16(h + 28);
+		std::string name(h + 30, nlen);
+		size_t dpos = pos + 30 + nlen + xlen;
+		std::vector<char> raw(usize);
+		if (method == 0) std::memcpy(raw.data(), &all[dpos], usize);
+		else {
+			z_stream zs{}; inflateInit2(&zs, -MAX_WBITS);
+			zs.next_in = (Bytef*)&all[dpos]; zs.avail_in = csize;
+			zs.next_out = (Bytef*)raw.data(); zs.avail_out = usize;
+			inflate(&zs, Z_FINISH); inflateEnd(&zs);
+		}
+		if (name.size() > 4 && name.substr(name.size() - 4) == ".npy") name = name.substr(0, name.size() - 4);
+		out[name] = from_buffer(raw);
+		pos = dpos + csize;
+	}
+	return out;
+}
+NpyArray npz_load(std::string fname, std::string varname) {
+	npz_t all = npz_load(fname);
+	auto it = all.find(varname);
+	if (it == all.end()) throw std::runtime_error("npz_load: variable not found " + varname);
+	return it->second;
+}
+NpyArray npy_load(std::string fname) {
+	std::ifstream f(fname, std::ios::binary);
+	std::vector<char> all((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+	return from_buffer(all);
+}
+static void w16(std::string& s, uint16_t v) { s += (char)(v & 0xff); s += (char)(v >> 8); }
+static void w32(std::string& s, uint32_t v) { w16(s, v & 0xffff); w16(s, v >> 16); }
+void npz_save_raw(std::string zipname, std::string fname, const void* data, const std::vector<size_t>& shape, char type, size_t ws, std::string mode) {
+	// Stored (uncompressed) zip; appends rebuild the whole archive.
+	std::vector<std::pair<std::string, std::string>> entries;
+	if (mode == "a") {
+		std::ifstream f(zipname, std::ios::binary);
+		if (f) {
+			std::vector<char> all((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+			size_t pos = 0;
+			while (pos + 30 <= all.size() && r32(&all[pos]) == 0x04034b50) {
+				const char* h = &all[pos];
+				uint32_t csize = r32(h + 18); uint16_t nlen = r16(h + 26), xlen = r16(h + 28);
+				std::string name(h + 30, nlen);
+				size_t dpos = pos + 30 + nlen + xlen;
+				entries.push_back({name, std::string(&all[dpos], csize)});
+				pos = dpos + csize;
+			}
+		}
+	}
+	std::string hdr = "{'descr': '<"; hdr += type; hdr += std::to_string(ws) + "', 'fortran_order': False, 'shape': (";
+	for (size_t i = 0; i < shape.size(); ++i) hdr += std::to_string(shape[i]) + (shape.size() == 1 || i + 1 < shape.size() ? "," : "");
+	hdr += "), }";
+	while ((hdr.size() + 11) % 16) hdr += ' ';
+	hdr += '\n';
+	std::string npy = "\x93NUMPY"; npy += (char)1; npy += (char)0; w16(npy, hdr.size()); npy += hdr;
+	size_t n = 1; for (size_t s : shape) n *= s;
+	npy.append((const char*)data, n * ws);
+	entries.push_back({fname + ".npy", npy});
+	std::string out, cd;
+	for (auto& [name, body] : entries) {
+		uint32_t crc = crc32(0, (const Bytef*)body.data(), body.size());
+		std::string lh; w32(lh, 0x04034b50); w16(lh, 20); w16(lh, 0); w16(lh, 0); w16(lh, 0); w16(lh, 0);
+		w32(lh, crc); w32(lh, body.size()); w32(lh, body.size()); w16(lh, name.size()); w16(lh, 0); lh += name;
+		std::string c; w32(c, 0x02014b50); w16(c, 20); w16(c, 20); w16(c, 0); w16(c, 0); w16(c, 0); w16(c, 0);
+		w32(c, crc); w32(c, body.size()); w32(c, body.size()); w16(c, name.size()); w16(c, 0); w16(c, 0); w16(c, 0); w16(c, 0); w32(c, 0); w32(c, out.size()); c += name;
+		cd += c; out += lh; out += body;
+	}
+	std::string end; w32(end, 0x06054b50); w16(end, 0); w16(end, 0); w16(end, entries.size()); w16(end, entries.size()); w32(end, cd.size()); w32(end, out.size()); w16(end, 0);
+	std::ofstream f(zipname, std::ios::binary);
+	f << out << cd << end;
+}
+}
@@ -0,0 +1,49 @@
+// Local stand-in for the cnpy submodule (test harness only, not part of repo)
+#pragma once
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <cstring>
+#include <stdexcept>
+#include <numeric>
+#include <functional>
+namespace cnpy {
+struct NpyArray {
+	NpyArray(const std::vector<size_t>& _shape, size_t _word_size, bool _fortran_order)
+		: shape(_shape), word_size(_word_size), fortran_order(_fortran_order) {
+		num_vals = 1;
+		for (size_t s : shape) num_vals *= s;
+		data_holder = std::make_shared<std::vector<char>>(num_vals * word_size);
+	}
+	NpyArray() : word_size(0), fortran_order(0), num_vals(0) {}
+	template<typename T> T* data() { return reinterpret_cast<T*>(&(*data_holder)[0]); }
+	template<typename T> const T* data() const { return reinterpret_cast<T*>(&(*data_holder)[0]); }
+	template<typename T> std::vector<T> as_vec() const {
+		const T* p = data<T>();
+		return std::vector<T>(p, p + num_vals);
+	}
+	size_t num_bytes() const { return data_holder->size(); }
+	std::shared_ptr<std::vector<char>> data_holder;
+	std::vector<size_t> shape;
+	size_t word_size;
+	bool fortran_order;
+	size_t num_vals;
+};
+using npz_t = std::map<std::string, NpyArray>;
+npz_t npz_load(std::string fname);
+NpyArray npz_load(std::string fname, std::string varname);
+NpyArray npy_load(std::string fname);
+void npz_save_raw(std::string zipname, std::string fname, const void* data, const std::vector<size_t>& shape, char type, size_t word_size, std::string mode);
+template<typename T> char type_char() {
+	if (std::is_floating_point<T>::value) return 'f';
+	if (std::is_signed<T>::value) return 'i';
+	return 'u';
+}
+template<typename T> void npz_save(std::string zipname, std::string fname, const T* data, const std::vector<size_t>& shape, std::string mode = "w") {
+	npz_save_raw(zipname, fname, data, shape, type_char<T>(), sizeof(T), mode);
+}
+template<typename T> void npz_save(std::string zipname, std::string fname, const std::vector<T> data, std::string mode = "w") {
+	npz_save(zipname, fname, data.data(), {data.size()}, mode);
+}
+}